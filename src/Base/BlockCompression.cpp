@@ -0,0 +1,695 @@
+#include "BlockCompression.h"
+#include <cstdint>
+#include <cstring>
+#include "Logger.h"
+
+namespace SoftGL
+{
+    // BC7 tables, Ref: https://learn.microsoft.com/en-us/windows/win32/direct3d11/bc7-format-mode-reference
+    struct BC7ModeInfo
+    {
+        int subsets;
+        int partitionBits;
+        int rotationBits;
+        int indexSelectionBits;
+        int colorBits;
+        int alphaBits;
+        int endpointPBits;
+        int sharedPBits;
+        int indexBits;
+        int index2Bits;
+    };
+
+    static const BC7ModeInfo BC7_MODES[8] = {
+            {3, 4, 0, 0, 4, 0, 1, 0, 3, 0},
+            {2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+            {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+            {2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+            {1, 0, 2, 1, 5, 6, 0, 0, 2, 3},
+            {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+            {1, 0, 0, 0, 7, 7, 1, 0, 4, 0},
+            {2, 6, 0, 0, 5, 5, 1, 0, 2, 0},
+    };
+
+    // bit i: subset of texel i
+    static const uint16_t BC7_PARTITION2[64] = {
+            0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+            0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+            0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+            0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+            0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+            0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+            0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+            0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+    };
+
+    // bits (2i, 2i + 1): subset of texel i
+    static const uint32_t BC7_PARTITION3[64] = {
+            0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+            0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+            0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+            0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+            0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+            0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+            0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+            0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254,
+    };
+
+    static const uint8_t BC7_ANCHOR2[64] = {
+            15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+            15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+            15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+            6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15,
+    };
+
+    static const uint8_t BC7_ANCHOR3_1[64] = {
+            3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3,
+            3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+            8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15,
+            3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3,
+    };
+
+    static const uint8_t BC7_ANCHOR3_2[64] = {
+            15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8,
+            15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+            15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8,
+            15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8,
+    };
+
+    static const uint8_t BC7_WEIGHTS2[4] = {0, 21, 43, 64};
+    static const uint8_t BC7_WEIGHTS3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+    static const uint8_t BC7_WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    static inline const uint8_t *BC7Weights(int bits)
+    {
+        return bits == 2 ? BC7_WEIGHTS2 : (bits == 3 ? BC7_WEIGHTS3 : BC7_WEIGHTS4);
+    }
+
+    static inline int BC7Interpolate(int e0, int e1, int weight)
+    {
+        return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+    }
+
+    // little endian bit stream of one block
+    class BlockBitReader
+    {
+    public:
+        explicit BlockBitReader(const uint8_t *data, int pos = 0) : data_(data), pos_(pos) {}
+
+        inline uint32_t read(int bits)
+        {
+            uint32_t ret = 0;
+            for (int i = 0; i < bits; i++, pos_++)
+            {
+                ret |= (uint32_t)((data_[pos_ >> 3] >> (pos_ & 7)) & 1) << i;
+            }
+            return ret;
+        }
+
+    private:
+        const uint8_t *data_;
+        int pos_;
+    };
+
+    class BlockBitWriter
+    {
+    public:
+        explicit BlockBitWriter(uint8_t *data, size_t size) : data_(data)
+        {
+            memset(data_, 0, size);
+        }
+
+        inline void write(uint32_t value, int bits)
+        {
+            for (int i = 0; i < bits; i++, pos_++)
+            {
+                data_[pos_ >> 3] |= (uint8_t)(((value >> i) & 1) << (pos_ & 7));
+            }
+        }
+
+    private:
+        uint8_t *data_;
+        int pos_ = 0;
+    };
+
+    static inline uint16_t packRGB565(int r, int g, int b)
+    {
+        return (uint16_t)((((r * 31 + 127) / 255) << 11) | (((g * 63 + 127) / 255) << 5) | ((b * 31 + 127) / 255));
+    }
+
+    static inline RGBA unpackRGB565(uint16_t c)
+    {
+        int r = (c >> 11) & 31;
+        int g = (c >> 5) & 63;
+        int b = c & 31;
+        return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255};
+    }
+
+    static inline int colorDistance(const RGBA &a, const RGBA &b)
+    {
+        int dr = a.r - b.r;
+        int dg = a.g - b.g;
+        int db = a.b - b.b;
+        int da = a.a - b.a;
+        return dr * dr + dg * dg + db * db + da * da;
+    }
+
+    BlockBuffer::BlockBuffer(BlockFormat format, size_t width, size_t height)
+        : format_(format), width_(width), height_(height)
+    {
+        blockCntX_ = (width + 3) / 4;
+        blockCntY_ = (height + 3) / 4;
+        blockBytes_ = BlockCompression::blockBytes(format);
+        data_.resize(blockCntX_ * blockCntY_ * blockBytes_, 0);
+    }
+
+    RGBA BlockBuffer::getTexel(size_t x, size_t y) const
+    {
+        // direct mapped, covers an 8x8 blocks window
+        struct CacheEntry
+        {
+            int64_t key;
+            RGBA texels[16];
+        };
+        const static int cacheBits = 3;
+        static thread_local CacheEntry cache[1 << cacheBits << cacheBits] = {};
+
+        size_t blockX = x >> 2;
+        size_t blockY = y >> 2;
+        // 0 is reserved for empty entries
+        int64_t key = ((int64_t)(uuid_.get() + 1) << 40) | ((int64_t)blockY << 20) | (int64_t)blockX;
+        const size_t mask = (1 << cacheBits) - 1;
+        CacheEntry &entry = cache[(blockX & mask) | ((blockY & mask) << cacheBits)];
+        if (entry.key != key)
+        {
+            BlockCompression::decodeBlock(format_, getBlock(blockX, blockY), entry.texels);
+            entry.key = key;
+        }
+        return entry.texels[(y & 3) * 4 + (x & 3)];
+    }
+
+    size_t BlockCompression::blockBytes(BlockFormat format)
+    {
+        return format == BlockFormat_BC1 ? 8 : 16;
+    }
+
+    void BlockCompression::decodeBlock(BlockFormat format, const uint8_t *block, RGBA *texels)
+    {
+        switch (format)
+        {
+            case BlockFormat_BC1:
+                decodeBC1(block, texels, true);
+                break;
+            case BlockFormat_BC3:
+                decodeBC1(block + 8, texels, false);
+                decodeBC4(block, texels, 3);
+                break;
+            case BlockFormat_BC5:
+                for (int i = 0; i < 16; i++)
+                {
+                    texels[i] = RGBA(0, 0, 0, 255);
+                }
+                decodeBC4(block, texels, 0);
+                decodeBC4(block + 8, texels, 1);
+                break;
+            case BlockFormat_BC7:
+                decodeBC7(block, texels);
+                break;
+        }
+    }
+
+    void BlockCompression::encodeBlock(BlockFormat format, const RGBA *texels, uint8_t *block)
+    {
+        switch (format)
+        {
+            case BlockFormat_BC1:
+                encodeBC1(texels, block);
+                break;
+            case BlockFormat_BC3:
+            {
+                // color part of BC3 is always 4 colors mode, make alpha opaque before fitting
+                RGBA opaque[16];
+                for (int i = 0; i < 16; i++)
+                {
+                    opaque[i] = RGBA(texels[i].r, texels[i].g, texels[i].b, 255);
+                }
+                encodeBC4(texels, block, 3);
+                encodeBC1(opaque, block + 8);
+                break;
+            }
+            case BlockFormat_BC5:
+                encodeBC4(texels, block, 0);
+                encodeBC4(texels, block + 8, 1);
+                break;
+            case BlockFormat_BC7:
+                encodeBC7(texels, block);
+                break;
+        }
+    }
+
+    std::shared_ptr<BlockBuffer> BlockCompression::encode(Buffer<RGBA> &buffer, BlockFormat format)
+    {
+        auto ret = std::make_shared<BlockBuffer>(format, buffer.getWidth(), buffer.getHeight());
+        if (buffer.empty())
+        {
+            return ret;
+        }
+        uint8_t *dst = ret->getRawDataPtr();
+        RGBA texels[16];
+        for (size_t blockY = 0; blockY < ret->getBlockCntY(); blockY++)
+        {
+            for (size_t blockX = 0; blockX < ret->getBlockCntX(); blockX++)
+            {
+                // replicate edge texels for partial blocks
+                for (size_t i = 0; i < 16; i++)
+                {
+                    size_t x = std::min(blockX * 4 + (i & 3), buffer.getWidth() - 1);
+                    size_t y = std::min(blockY * 4 + (i >> 2), buffer.getHeight() - 1);
+                    texels[i] = *buffer.get(x, y);
+                }
+                encodeBlock(format, texels, dst);
+                dst += ret->getBlockBytes();
+            }
+        }
+        return ret;
+    }
+
+    std::shared_ptr<Buffer<RGBA>> BlockCompression::decode(const BlockBuffer &blocks, BufferLayout layout)
+    {
+        auto ret = Buffer<RGBA>::makeLayout(blocks.getWidth(), blocks.getHeight(), layout);
+        RGBA texels[16];
+        for (size_t blockY = 0; blockY < blocks.getBlockCntY(); blockY++)
+        {
+            for (size_t blockX = 0; blockX < blocks.getBlockCntX(); blockX++)
+            {
+                decodeBlock(blocks.getFormat(), blocks.getBlock(blockX, blockY), texels);
+                for (size_t i = 0; i < 16; i++)
+                {
+                    // out of range texels are ignored by set
+                    ret->set(blockX * 4 + (i & 3), blockY * 4 + (i >> 2), texels[i]);
+                }
+            }
+        }
+        return ret;
+    }
+
+    void BlockCompression::decodeBC1(const uint8_t *block, RGBA *texels, bool punchThrough)
+    {
+        uint16_t c0 = block[0] | (block[1] << 8);
+        uint16_t c1 = block[2] | (block[3] << 8);
+        RGBA palette[4];
+        palette[0] = unpackRGB565(c0);
+        palette[1] = unpackRGB565(c1);
+        if (c0 > c1 || !punchThrough)
+        {
+            palette[2] = RGBA((glm::ivec4(palette[0]) * 2 + glm::ivec4(palette[1])) / 3);
+            palette[3] = RGBA((glm::ivec4(palette[0]) + glm::ivec4(palette[1]) * 2) / 3);
+        }
+        else
+        {
+            palette[2] = RGBA((glm::ivec4(palette[0]) + glm::ivec4(palette[1])) / 2);
+            palette[3] = RGBA(0);
+        }
+        uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+        for (int i = 0; i < 16; i++)
+        {
+            texels[i] = palette[(indices >> (2 * i)) & 3];
+        }
+    }
+
+    void BlockCompression::decodeBC4(const uint8_t *block, RGBA *texels, int channel)
+    {
+        int v0 = block[0];
+        int v1 = block[1];
+        uint8_t palette[8];
+        palette[0] = (uint8_t)v0;
+        palette[1] = (uint8_t)v1;
+        if (v0 > v1)
+        {
+            for (int k = 2; k < 8; k++)
+            {
+                palette[k] = (uint8_t)(((8 - k) * v0 + (k - 1) * v1) / 7);
+            }
+        }
+        else
+        {
+            for (int k = 2; k < 6; k++)
+            {
+                palette[k] = (uint8_t)(((6 - k) * v0 + (k - 1) * v1) / 5);
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; i++)
+        {
+            indices |= (uint64_t)block[2 + i] << (8 * i);
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            texels[i][channel] = palette[(indices >> (3 * i)) & 7];
+        }
+    }
+
+    void BlockCompression::decodeBC7(const uint8_t *block, RGBA *texels)
+    {
+        int mode = 0;
+        while (mode < 8 && !(block[0] & (1 << mode)))
+        {
+            mode++;
+        }
+        if (mode == 8)
+        {
+            // reserved mode
+            for (int i = 0; i < 16; i++)
+            {
+                texels[i] = RGBA(0);
+            }
+            return;
+        }
+
+        const BC7ModeInfo &info = BC7_MODES[mode];
+        BlockBitReader reader(block, mode + 1);
+        int partition = (int)reader.read(info.partitionBits);
+        int rotation = (int)reader.read(info.rotationBits);
+        int indexSelection = (int)reader.read(info.indexSelectionBits);
+
+        int endpointCnt = info.subsets * 2;
+        int endpoints[6][4];
+        for (int c = 0; c < 3; c++)
+        {
+            for (int e = 0; e < endpointCnt; e++)
+            {
+                endpoints[e][c] = (int)reader.read(info.colorBits);
+            }
+        }
+        for (int e = 0; e < endpointCnt; e++)
+        {
+            endpoints[e][3] = info.alphaBits ? (int)reader.read(info.alphaBits) : 255;
+        }
+
+        int pBits[6] = {0};
+        if (info.endpointPBits)
+        {
+            for (int e = 0; e < endpointCnt; e++)
+            {
+                pBits[e] = (int)reader.read(1);
+            }
+        }
+        if (info.sharedPBits)
+        {
+            for (int s = 0; s < info.subsets; s++)
+            {
+                pBits[2 * s] = pBits[2 * s + 1] = (int)reader.read(1);
+            }
+        }
+
+        // unquantize endpoints to 8 bits
+        bool hasPBits = info.endpointPBits || info.sharedPBits;
+        for (int e = 0; e < endpointCnt; e++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                int bits = c < 3 ? info.colorBits : info.alphaBits;
+                if (bits == 0)
+                {
+                    continue;
+                }
+                int v = endpoints[e][c];
+                if (hasPBits)
+                {
+                    v = (v << 1) | pBits[e];
+                    bits++;
+                }
+                v <<= 8 - bits;
+                endpoints[e][c] = v | (v >> bits);
+            }
+        }
+
+        int subsetOf[16];
+        bool isAnchor[16] = {false};
+        isAnchor[0] = true;
+        for (int i = 0; i < 16; i++)
+        {
+            if (info.subsets == 2)
+            {
+                subsetOf[i] = (BC7_PARTITION2[partition] >> i) & 1;
+            }
+            else if (info.subsets == 3)
+            {
+                subsetOf[i] = (BC7_PARTITION3[partition] >> (2 * i)) & 3;
+            }
+            else
+            {
+                subsetOf[i] = 0;
+            }
+        }
+        if (info.subsets == 2)
+        {
+            isAnchor[BC7_ANCHOR2[partition]] = true;
+        }
+        else if (info.subsets == 3)
+        {
+            isAnchor[BC7_ANCHOR3_1[partition]] = true;
+            isAnchor[BC7_ANCHOR3_2[partition]] = true;
+        }
+
+        int indices[16];
+        int indices2[16] = {0};
+        for (int i = 0; i < 16; i++)
+        {
+            indices[i] = (int)reader.read(info.indexBits - (isAnchor[i] ? 1 : 0));
+        }
+        if (info.index2Bits)
+        {
+            for (int i = 0; i < 16; i++)
+            {
+                indices2[i] = (int)reader.read(info.index2Bits - (i == 0 ? 1 : 0));
+            }
+        }
+
+        for (int i = 0; i < 16; i++)
+        {
+            const int *e0 = endpoints[2 * subsetOf[i]];
+            const int *e1 = endpoints[2 * subsetOf[i] + 1];
+            int colorWeight, alphaWeight;
+            if (info.index2Bits == 0)
+            {
+                colorWeight = alphaWeight = BC7Weights(info.indexBits)[indices[i]];
+            }
+            else if (indexSelection)
+            {
+                colorWeight = BC7Weights(info.index2Bits)[indices2[i]];
+                alphaWeight = BC7Weights(info.indexBits)[indices[i]];
+            }
+            else
+            {
+                colorWeight = BC7Weights(info.indexBits)[indices[i]];
+                alphaWeight = BC7Weights(info.index2Bits)[indices2[i]];
+            }
+            RGBA &texel = texels[i];
+            texel.r = (uint8_t)BC7Interpolate(e0[0], e1[0], colorWeight);
+            texel.g = (uint8_t)BC7Interpolate(e0[1], e1[1], colorWeight);
+            texel.b = (uint8_t)BC7Interpolate(e0[2], e1[2], colorWeight);
+            texel.a = (uint8_t)BC7Interpolate(e0[3], e1[3], alphaWeight);
+            if (rotation > 0)
+            {
+                std::swap(texel.a, texel[rotation - 1]);
+            }
+        }
+    }
+
+    void BlockCompression::encodeBC1(const RGBA *texels, uint8_t *block)
+    {
+        bool punchThrough = false;
+        glm::ivec3 minColor(255), maxColor(0);
+        for (int i = 0; i < 16; i++)
+        {
+            if (texels[i].a < 128)
+            {
+                punchThrough = true;
+                continue;
+            }
+            minColor = glm::min(minColor, glm::ivec3(texels[i]));
+            maxColor = glm::max(maxColor, glm::ivec3(texels[i]));
+        }
+        if (glm::any(glm::greaterThan(minColor, maxColor)))
+        {
+            // all transparent
+            minColor = maxColor = glm::ivec3(0);
+        }
+
+        uint16_t c0 = packRGB565(maxColor.r, maxColor.g, maxColor.b);
+        uint16_t c1 = packRGB565(minColor.r, minColor.g, minColor.b);
+        // 4 colors mode requires c0 > c1, 3 colors + transparent mode requires c0 <= c1
+        if (punchThrough == (c0 > c1))
+        {
+            std::swap(c0, c1);
+        }
+        block[0] = (uint8_t)(c0 & 0xFF);
+        block[1] = (uint8_t)(c0 >> 8);
+        block[2] = (uint8_t)(c1 & 0xFF);
+        block[3] = (uint8_t)(c1 >> 8);
+
+        uint32_t indices = 0;
+        if (c0 != c1 || punchThrough)
+        {
+            // decode indices 0, 1, 2, 3 to get the palette
+            RGBA palette[16];
+            memset(block + 4, 0xE4, 4);
+            decodeBC1(block, palette, true);
+            int paletteCnt = punchThrough ? 3 : 4;
+            for (int i = 0; i < 16; i++)
+            {
+                int best = 0;
+                if (punchThrough && texels[i].a < 128)
+                {
+                    best = 3;
+                }
+                else
+                {
+                    RGBA opaque(texels[i].r, texels[i].g, texels[i].b, 255);
+                    int bestDist = INT32_MAX;
+                    for (int k = 0; k < paletteCnt; k++)
+                    {
+                        int dist = colorDistance(opaque, palette[k]);
+                        if (dist < bestDist)
+                        {
+                            bestDist = dist;
+                            best = k;
+                        }
+                    }
+                }
+                indices |= (uint32_t)best << (2 * i);
+            }
+        }
+        block[4] = (uint8_t)(indices & 0xFF);
+        block[5] = (uint8_t)((indices >> 8) & 0xFF);
+        block[6] = (uint8_t)((indices >> 16) & 0xFF);
+        block[7] = (uint8_t)(indices >> 24);
+    }
+
+    void BlockCompression::encodeBC4(const RGBA *texels, uint8_t *block, int channel)
+    {
+        int minValue = 255, maxValue = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            minValue = std::min(minValue, (int)texels[i][channel]);
+            maxValue = std::max(maxValue, (int)texels[i][channel]);
+        }
+        memset(block, 0, 8);
+        block[0] = (uint8_t)maxValue;
+        block[1] = (uint8_t)minValue;
+        if (maxValue == minValue)
+        {
+            return;
+        }
+
+        // palette of 8 values mode, same as decodeBC4
+        int palette[8];
+        palette[0] = maxValue;
+        palette[1] = minValue;
+        for (int k = 2; k < 8; k++)
+        {
+            palette[k] = ((8 - k) * maxValue + (k - 1) * minValue) / 7;
+        }
+        uint64_t indices = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            int v = texels[i][channel];
+            int best = 0;
+            for (int k = 1; k < 8; k++)
+            {
+                if (std::abs(palette[k] - v) < std::abs(palette[best] - v))
+                {
+                    best = k;
+                }
+            }
+            indices |= (uint64_t)best << (3 * i);
+        }
+        for (int i = 0; i < 6; i++)
+        {
+            block[2 + i] = (uint8_t)((indices >> (8 * i)) & 0xFF);
+        }
+    }
+
+    // mode 6 only: single subset, rgba 7.7.7.7 endpoints with p-bit, 4 bits indices
+    void BlockCompression::encodeBC7(const RGBA *texels, uint8_t *block)
+    {
+        glm::ivec4 bounds[2] = {glm::ivec4(255), glm::ivec4(0)};
+        for (int i = 0; i < 16; i++)
+        {
+            bounds[0] = glm::min(bounds[0], glm::ivec4(texels[i]));
+            bounds[1] = glm::max(bounds[1], glm::ivec4(texels[i]));
+        }
+
+        // quantize endpoints, p-bit chosen by least error
+        glm::ivec4 quantized[2];
+        int pBits[2];
+        glm::ivec4 endpoints[2];
+        for (int e = 0; e < 2; e++)
+        {
+            int bestErr = INT32_MAX;
+            for (int p = 0; p < 2; p++)
+            {
+                glm::ivec4 q = glm::clamp((bounds[e] - p + 1) / 2, 0, 127);
+                glm::ivec4 v = (q << 1) | p;
+                glm::ivec4 d = v - bounds[e];
+                int err = d.x * d.x + d.y * d.y + d.z * d.z + d.w * d.w;
+                if (err < bestErr)
+                {
+                    bestErr = err;
+                    quantized[e] = q;
+                    pBits[e] = p;
+                    endpoints[e] = v;
+                }
+            }
+        }
+
+        int indices[16];
+        for (int i = 0; i < 16; i++)
+        {
+            int bestDist = INT32_MAX;
+            indices[i] = 0;
+            for (int k = 0; k < 16; k++)
+            {
+                RGBA c;
+                for (int ch = 0; ch < 4; ch++)
+                {
+                    c[ch] = (uint8_t)BC7Interpolate(endpoints[0][ch], endpoints[1][ch], BC7_WEIGHTS4[k]);
+                }
+                int dist = colorDistance(texels[i], c);
+                if (dist < bestDist)
+                {
+                    bestDist = dist;
+                    indices[i] = k;
+                }
+            }
+        }
+
+        // anchor index msb must be 0
+        if (indices[0] & 8)
+        {
+            std::swap(quantized[0], quantized[1]);
+            std::swap(pBits[0], pBits[1]);
+            for (int i = 0; i < 16; i++)
+            {
+                indices[i] = 15 - indices[i];
+            }
+        }
+
+        BlockBitWriter writer(block, 16);
+        writer.write(1 << 6, 7);
+        for (int ch = 0; ch < 4; ch++)
+        {
+            writer.write(quantized[0][ch], 7);
+            writer.write(quantized[1][ch], 7);
+        }
+        writer.write(pBits[0], 1);
+        writer.write(pBits[1], 1);
+        for (int i = 0; i < 16; i++)
+        {
+            writer.write(indices[i], i == 0 ? 3 : 4);
+        }
+    }
+}
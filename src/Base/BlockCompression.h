@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+#include "Buffer.h"
+#include "UUID.h"
+
+namespace SoftGL
+{
+    enum BlockFormat
+    {
+        BlockFormat_BC1,    // rgb + 1 bit alpha, 8 bytes per block
+        BlockFormat_BC3,    // rgba, 16 bytes per block
+        BlockFormat_BC5,    // rg, 16 bytes per block
+        BlockFormat_BC7,    // rgba, 16 bytes per block
+    };
+
+    // block compressed image of one mip level, 4x4 texels per block
+    class BlockBuffer
+    {
+    public:
+        BlockBuffer(BlockFormat format, size_t width, size_t height);
+
+        inline BlockFormat getFormat() const
+        {
+            return format_;
+        }
+
+        inline size_t getWidth() const
+        {
+            return width_;
+        }
+
+        inline size_t getHeight() const
+        {
+            return height_;
+        }
+
+        inline size_t getBlockCntX() const
+        {
+            return blockCntX_;
+        }
+
+        inline size_t getBlockCntY() const
+        {
+            return blockCntY_;
+        }
+
+        inline size_t getBlockBytes() const
+        {
+            return blockBytes_;
+        }
+
+        inline uint8_t *getRawDataPtr()
+        {
+            return data_.data();
+        }
+
+        inline size_t getRawDataByteSize() const
+        {
+            return data_.size();
+        }
+
+        inline const uint8_t *getBlock(size_t blockX, size_t blockY) const
+        {
+            return &data_[(blockY * blockCntX_ + blockX) * blockBytes_];
+        }
+
+        // decoded texel, blocks are decoded on demand through a small per-thread cache
+        RGBA getTexel(size_t x, size_t y) const;
+
+    private:
+        UUID<BlockBuffer> uuid_;
+        BlockFormat format_;
+        size_t width_ = 0;
+        size_t height_ = 0;
+        size_t blockCntX_ = 0;
+        size_t blockCntY_ = 0;
+        size_t blockBytes_ = 0;
+        std::vector<uint8_t> data_;
+    };
+
+    class BlockCompression
+    {
+    public:
+        static size_t blockBytes(BlockFormat format);
+
+        // decode one block to 16 texels in row-major order
+        static void decodeBlock(BlockFormat format, const uint8_t *block, RGBA *texels);
+        static void encodeBlock(BlockFormat format, const RGBA *texels, uint8_t *block);
+
+        static std::shared_ptr<BlockBuffer> encode(Buffer<RGBA> &buffer, BlockFormat format);
+        static std::shared_ptr<Buffer<RGBA>> decode(const BlockBuffer &blocks, BufferLayout layout = Layout_Linear);
+
+    private:
+        static void decodeBC1(const uint8_t *block, RGBA *texels, bool alpha);
+        static void decodeBC4(const uint8_t *block, RGBA *texels, int channel);
+        static void decodeBC7(const uint8_t *block, RGBA *texels);
+
+        static void encodeBC1(const RGBA *texels, uint8_t *block);
+        static void encodeBC4(const RGBA *texels, uint8_t *block, int channel);
+        static void encodeBC7(const RGBA *texels, uint8_t *block);
+    };
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include "GLMInc.h"
 #include "MemoryUtils.h"
 
@@ -12,27 +15,127 @@ namespace SoftGL
         Layout_Morton,
     };
 
+    // fast clear tile state
+    enum ClearTileState
+    {
+        ClearTile_None = 0,         // tile memory holds valid data
+        ClearTile_Pending = 1,      // tile holds clear value, memory not written yet
+        ClearTile_Busy = 2,         // tile clear value is being written
+    };
+
+#if SOFTGL_TEXTURE_TILED
+    #define SOFTGL_BUFFER_LAYOUT_DEFAULT Layout_Tiled
+#elif SOFTGL_TEXTURE_MORTON
+    #define SOFTGL_BUFFER_LAYOUT_DEFAULT Layout_Morton
+#else
+    #define SOFTGL_BUFFER_LAYOUT_DEFAULT Layout_Linear
+#endif
+
+    // pixel index of each memory layout, resolved at compile time
+    template<BufferLayout L>
+    struct BufferIndexer;
+
+    template<>
+    struct BufferIndexer<Layout_Linear>
+    {
+        static inline size_t innerSize(size_t size)
+        {
+            return size;
+        }
+
+        static inline size_t index(size_t x, size_t y, size_t innerWidth)
+        {
+            return x + y * innerWidth;
+        }
+    };
+
+    template<>
+    struct BufferIndexer<Layout_Tiled>
+    {
+        const static int tileSize = 4;  // 4 x 4
+        const static int bits = 2;      // tileSize = 2^bits
+
+        static inline size_t innerSize(size_t size)
+        {
+            return (size + tileSize - 1) & ~(size_t) (tileSize - 1);
+        }
+
+        static inline size_t index(size_t x, size_t y, size_t innerWidth)
+        {
+            size_t tileX = x >> bits;               // x / tileSize
+            size_t tileY = y >> bits;               // y / tileSize
+            size_t inTileX = x & (tileSize - 1);    // x % tileSize
+            size_t inTileY = y & (tileSize - 1);    // y % tileSize
+            return ((tileY * (innerWidth >> bits) + tileX) << bits << bits) + (inTileY << bits) + inTileX;
+        }
+    };
+
+    template<>
+    struct BufferIndexer<Layout_Morton>
+    {
+        const static int tileSize = 32; // 32 x 32
+        const static int bits = 5;      // tileSize = 2^bits
+
+        static inline size_t innerSize(size_t size)
+        {
+            return (size + tileSize - 1) & ~(size_t) (tileSize - 1);
+        }
+
+        // ref: https://gist.github.com/JarkkoPFC/0e4e599320b0cc7ea92df45fb416d79a
+        static inline uint16_t encode16_morton2(uint8_t x, uint8_t y)
+        {
+            uint32_t res = x | (uint32_t(y) << 16);
+            res = (res | (res << 4)) & 0x0f0f0f0f;
+            res = (res | (res << 2)) & 0x33333333;
+            res = (res | (res << 1)) & 0x55555555;
+            return uint16_t(res | (res >> 15));
+        }
+
+        static inline size_t index(size_t x, size_t y, size_t innerWidth)
+        {
+            size_t tileX = x >> bits;               // x / tileSize
+            size_t tileY = y >> bits;               // y / tileSize
+            size_t inTileX = x & (tileSize - 1);    // x % tileSize
+            size_t inTileY = y & (tileSize - 1);    // y % tileSize
+            uint16_t mortonIdx = encode16_morton2(inTileX, inTileY);
+            return ((tileY * (innerWidth >> bits) + tileX) << bits << bits) + mortonIdx;
+        }
+    };
+
+    template<typename T, BufferLayout L>
+    class BufferView;
+
     template <typename T>
     class Buffer
     {
      public:
         static std::shared_ptr<Buffer<T>> makeDefault(size_t w, size_t h);
         static std::shared_ptr<Buffer<T>> makeLayout(size_t w, size_t h, BufferLayout layout);
+        static std::shared_ptr<Buffer<T>> makeLayoutCopy(Buffer<T> &src, BufferLayout layout);
 
-        virtual void initLayout()
+        explicit Buffer(BufferLayout layout = Layout_Linear) : layout_(layout) {}
+
+        inline size_t convertIndex(size_t x, size_t y) const
         {
-            innerWidth_ = width_;
-            innerHeight_ = height_;
+            switch (layout_)
+            {
+                case Layout_Tiled: return BufferIndexer<Layout_Tiled>::index(x, y, innerWidth_);
+                case Layout_Morton: return BufferIndexer<Layout_Morton>::index(x, y, innerWidth_);
+                default: break;
+            }
+            return BufferIndexer<Layout_Linear>::index(x, y, innerWidth_);
         }
 
-        virtual inline size_t convertIndex(size_t x, size_t y) const
+        inline BufferLayout getLayout() const
         {
-            return x + y * innerWidth_;
+            return layout_;
         }
 
-        virtual BufferLayout getLayout() const
+        // typed view with layout known at compile time, fetch once and use in hot loops
+        template<BufferLayout L>
+        inline BufferView<T, L> view()
         {
-            return Layout_Linear;
+            return BufferView<T, L>(this);
         }
 
         void create(size_t w, size_t h, const uint8_t *data = nullptr)
@@ -45,14 +148,22 @@ namespace SoftGL
             {
                 return;
             }
-            width_ = w;
-            height_ = h;
-            initLayout();
-            dataSize_ = innerWidth_ * innerHeight_;
+            initSize(w, h);
             data_ = MemoryUtils::makeBuffer<T>(dataSize_, data);
         }
 
-        virtual void destroy()
+        // take shared storage instead of allocating, must hold the layout's inner size (w * h if linear)
+        void create(size_t w, size_t h, const std::shared_ptr<T> &data)
+        {
+            if (w <= 0 || h <= 0)
+            {
+                return;
+            }
+            initSize(w, h);
+            data_ = data;
+        }
+
+        void destroy()
         {
             width_ = 0;
             height_ = 0;
@@ -60,6 +171,10 @@ namespace SoftGL
             innerHeight_ = 0;
             dataSize_ = 0;
             data_ = nullptr;
+            clearTileCntX_ = 0;
+            clearTileCntY_ = 0;
+            clearTiles_ = nullptr;
+            clearPending_.store(false, std::memory_order_release);
         }
 
         inline T *getRawDataPtr() const
@@ -97,6 +212,7 @@ namespace SoftGL
             T *ptr = data_.get();
             if (ptr != nullptr && x < width_ && y < height_)
             {
+                resolveClearAt(x, y);
                 return &ptr[convertIndex(x, y)];
             }
             return nullptr;
@@ -107,6 +223,7 @@ namespace SoftGL
             T *ptr = data_.get();
             if (ptr != nullptr && x < width_ && y < height_)
             {
+                resolveClearAt(x, y);
                 ptr[convertIndex(x, y)] = pixel;
             }
         }
@@ -129,6 +246,31 @@ namespace SoftGL
                     memcpy(out + innerWidth_ * i, ptr + innerWidth_ * (innerHeight_ - 1 - i), innerWidth_ * sizeof(T));
                 }
             }
+            if (!clearPending_.load(std::memory_order_acquire))
+            {
+                return;
+            }
+            // tiles not written yet are read back from clear tag
+            for (size_t tileY = 0; tileY < clearTileCntY_; tileY++)
+            {
+                for (size_t tileX = 0; tileX < clearTileCntX_; tileX++)
+                {
+                    if (!isTileCleared(tileX, tileY))
+                    {
+                        continue;
+                    }
+                    size_t xEnd = std::min((tileX + 1) << clearTileBits_, width_);
+                    size_t yEnd = std::min((tileY + 1) << clearTileBits_, height_);
+                    for (size_t y = tileY << clearTileBits_; y < yEnd; y++)
+                    {
+                        size_t outY = flip_y ? (innerHeight_ - 1 - y) : y;
+                        for (size_t x = tileX << clearTileBits_; x < xEnd; x++)
+                        {
+                            out[convertIndex(x, outY)] = clearValue_;
+                        }
+                    }
+                }
+            }
         }
 
         inline void clear() const
@@ -139,11 +281,12 @@ namespace SoftGL
                 return;
             }
             memset(ptr, 0, getRawDataByteSize());
+            resetClearTiles();
         }
 
         inline void setAll(T val) const
         {
-            T *ptr = date_.get();
+            T *ptr = data_.get();
             if (ptr == nullptr)
             {
                 return;
@@ -152,130 +295,271 @@ namespace SoftGL
             {
                 ptr[i] = val;
             }
+            resetClearTiles();
+        }
+
+        /**
+         * Fast clear: only tag every tile with the clear value, the tile memory is
+         * written on first access (get/set), readbacks of untouched tiles use the tag.
+         */
+        void fastClear(const T &val)
+        {
+            if (data_ == nullptr)
+            {
+                return;
+            }
+            size_t tileCnt = clearTileCntX_ * clearTileCntY_;
+            if (!clearTiles_)
+            {
+                clearTiles_ = MemoryUtils::makeBuffer<std::atomic<uint8_t>>(tileCnt);
+            }
+            std::atomic<uint8_t> *tiles = clearTiles_.get();
+            for (size_t i = 0; i < tileCnt; i++)
+            {
+                tiles[i].store(ClearTile_Pending, std::memory_order_relaxed);
+            }
+            clearValue_ = val;
+            clearPending_.store(true, std::memory_order_release);
+        }
+
+        // write clear value to all tiles not accessed yet
+        void flushClear()
+        {
+            if (!clearPending_.load(std::memory_order_acquire))
+            {
+                return;
+            }
+            for (size_t tileY = 0; tileY < clearTileCntY_; tileY++)
+            {
+                for (size_t tileX = 0; tileX < clearTileCntX_; tileX++)
+                {
+                    materializeClearTile(tileX, tileY);
+                }
+            }
+            clearPending_.store(false, std::memory_order_release);
+        }
+
+        inline bool isTileCleared(size_t tileX, size_t tileY) const
+        {
+            if (!clearPending_.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            return clearTiles_.get()[tileY * clearTileCntX_ + tileX].load(std::memory_order_acquire) != ClearTile_None;
+        }
+
+        // caller will overwrite the whole tile, drop the clear tag without writing clear value
+        inline void discardTileClear(size_t tileX, size_t tileY)
+        {
+            if (clearPending_.load(std::memory_order_acquire))
+            {
+                clearTiles_.get()[tileY * clearTileCntX_ + tileX].store(ClearTile_None, std::memory_order_release);
+            }
+        }
+
+        inline const T &getClearValue() const
+        {
+            return clearValue_;
+        }
+
+        inline size_t getClearTileCntX() const
+        {
+            return clearTileCntX_;
+        }
+
+        inline size_t getClearTileCntY() const
+        {
+            return clearTileCntY_;
+        }
+
+        static inline size_t getClearTileSize()
+        {
+            return clearTileSize_;
+        }
+
+        // write clear value of the tile containing (x, y) if still pending
+        inline void resolveClearAt(size_t x, size_t y)
+        {
+            if (clearPending_.load(std::memory_order_acquire))
+            {
+                materializeClearTile(x >> clearTileBits_, y >> clearTileBits_);
+            }
         }
 
      protected:
-        size_t width_ = 0;
-        size_t height_ = 0;
-        size_t innerWidth_ = 0;
-        size_t innerHeight_ = 0;
-        std::shared_ptr<T> data_ = nullptr;
-        size_t dataSize_ = 0;
-    };
+        void initSize(size_t w, size_t h)
+        {
+            width_ = w;
+            height_ = h;
+            switch (layout_)
+            {
+                case Layout_Tiled:
+                    innerWidth_ = BufferIndexer<Layout_Tiled>::innerSize(w);
+                    innerHeight_ = BufferIndexer<Layout_Tiled>::innerSize(h);
+                    break;
+                case Layout_Morton:
+                    innerWidth_ = BufferIndexer<Layout_Morton>::innerSize(w);
+                    innerHeight_ = BufferIndexer<Layout_Morton>::innerSize(h);
+                    break;
+                default:
+                    innerWidth_ = w;
+                    innerHeight_ = h;
+                    break;
+            }
+            dataSize_ = innerWidth_ * innerHeight_;
 
-    template<typename T>
-    class TiledBuffer : public Buffer<T>
-    {
-     public:
-        void initLayout() override
+            clearTileCntX_ = (width_ + clearTileSize_ - 1) / clearTileSize_;
+            clearTileCntY_ = (height_ + clearTileSize_ - 1) / clearTileSize_;
+            clearTiles_ = nullptr;
+            clearPending_.store(false, std::memory_order_release);
+        }
+
+        void materializeClearTile(size_t tileX, size_t tileY)
+        {
+            auto &state = clearTiles_.get()[tileY * clearTileCntX_ + tileX];
+            if (state.load(std::memory_order_acquire) == ClearTile_None)
+            {
+                return;
+            }
+            uint8_t expected = ClearTile_Pending;
+            if (state.compare_exchange_strong(expected, (uint8_t) ClearTile_Busy, std::memory_order_acquire))
+            {
+                fillTile(tileX, tileY, clearValue_);
+                state.store(ClearTile_None, std::memory_order_release);
+                return;
+            }
+            // another thread is writing this tile
+            while (state.load(std::memory_order_acquire) != ClearTile_None)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        void fillTile(size_t tileX, size_t tileY, const T &val)
         {
-            tileWidth_ = (this->width_ + tileSize_ - 1) / tileSize_;
-            tileHeight_ = (this->height_ + tileSize_ - 1) / tileSize_;
-            this->innerWidth_ = tileWidth_ * tileSize_;
-            this->innerHeight_ = tileHeight_ * tileSize_;
+            switch (layout_)
+            {
+                case Layout_Tiled: fillTileImpl<Layout_Tiled>(tileX, tileY, val); break;
+                case Layout_Morton: fillTileImpl<Layout_Morton>(tileX, tileY, val); break;
+                default: fillTileImpl<Layout_Linear>(tileX, tileY, val); break;
+            }
         }
 
-        inline size_t convertIndex(size_t x, size_t y) const override
+        template<BufferLayout L>
+        void fillTileImpl(size_t tileX, size_t tileY, const T &val)
         {
-            uint16_t tileX = x >> bits_;            // x / tileSize_
-            uint16_t tileY = y >> bits_;            // y / tileSize_
-            uint16_t inTileX = x & (tileSize_ - 1); // x % tileSize_
-            uint16_t inTileY = y & (tileSize_ - 1); // y % tileSize_
-            return ((tileY * tileWidth_ + tileX) << bits_ << bits_) + (inTileY << bits_) + inTileX;
+            T *ptr = data_.get();
+            size_t xStart = tileX << clearTileBits_;
+            size_t xEnd = std::min(xStart + clearTileSize_, width_);
+            size_t yEnd = std::min((tileY + 1) << clearTileBits_, height_);
+            for (size_t y = tileY << clearTileBits_; y < yEnd; y++)
+            {
+                if (L == Layout_Linear)
+                {
+                    T *row = ptr + BufferIndexer<L>::index(0, y, innerWidth_);
+                    std::fill(row + xStart, row + xEnd, val);
+                    continue;
+                }
+                for (size_t x = xStart; x < xEnd; x++)
+                {
+                    ptr[BufferIndexer<L>::index(x, y, innerWidth_)] = val;
+                }
+            }
         }
 
-        BufferLayout getLayout() const override
+        inline void resetClearTiles() const
         {
-            return Layout_Tiled;
+            clearPending_.store(false, std::memory_order_release);
         }
 
-     private:
-        const static int tileSize_ = 4; // 4 x 4
-        const static int bits_ = 2;     // tileSize_ = 2^bits_
-        size_t tileWidth_ = 0;
-        size_t tileHeight_ = 0;
+     protected:
+        BufferLayout layout_ = Layout_Linear;
+        size_t width_ = 0;
+        size_t height_ = 0;
+        size_t innerWidth_ = 0;
+        size_t innerHeight_ = 0;
+        std::shared_ptr<T> data_ = nullptr;
+        size_t dataSize_ = 0;
+
+        // fast clear tags
+        const static int clearTileSize_ = 32;   // 32 x 32
+        const static int clearTileBits_ = 5;    // clearTileSize_ = 2^clearTileBits_
+        size_t clearTileCntX_ = 0;
+        size_t clearTileCntY_ = 0;
+        std::shared_ptr<std::atomic<uint8_t>> clearTiles_ = nullptr;
+        // written by the render thread only while no raster task runs, raster workers read it
+        mutable std::atomic<bool> clearPending_{false};
+        T clearValue_{};
     };
 
-    template<typename T>
-    class MortonBuffer : public Buffer<T>
+    template<typename T, BufferLayout L>
+    class BufferView
     {
      public:
-        void initLayout() override
-        {
-            tileWidth_ = (this->width_ + tileSize_ - 1) / tileSize_;
-            tileHeight_ = (this->height_ + tileSize_ - 1) / tileSize_;
-            this->innerWidth_ = tileWidth_ * tileSize_;
-            this->innerHeight_ = tileHeight_ * tileSize_;
-        }
+        explicit BufferView(Buffer<T> *buffer)
+            : buffer_(buffer),
+              ptr_(buffer->getRawDataPtr()),
+              width_(buffer->getWidth()),
+              height_(buffer->getHeight()),
+              innerWidth_(BufferIndexer<L>::innerSize(buffer->getWidth())) {}
 
-        // ref: https://gist.github.com/JarkkoPFC/0e4e599320b0cc7ea92df45fb416d79a
-        static inline uint16_t encode16_morton2(uint8_t x, uint8_t y)
+        inline size_t convertIndex(size_t x, size_t y) const
         {
-            uint32_t res = x | (uint32_t(y) << 16);
-            res = (res | (res << 4)) & 0x0f0f0f0f;
-            res = (res | (res << 2)) & 0x33333333;
-            res = (res | (res << 1)) & 0x55555555;
-            return uint16_t(res | (res >> 15));
+            return BufferIndexer<L>::index(x, y, innerWidth_);
         }
 
-        inline size_t convertIndex(size_t x, size_t y) const override
+        inline T *get(size_t x, size_t y)
         {
-            uint16_t tileX = x >> bits_;            // x / tileSize_
-            uint16_t tileY = x >> bits_;            // y / tileSize_
-            uint16_t inTileX = x & (tileSize_ - 1); // x % tileSize_
-            uint16_t inTileY = y & (tileSize_ - 1); // y % tileSize_
-            uint16_t mortonIdex = encode16_morton2(inTileX, inTileY);
-            return ((tileY * tileWidth_ + tileX) << bits_ << bits_) + mortonIdex;
+            if (ptr_ != nullptr && x < width_ && y < height_)
+            {
+                buffer_->resolveClearAt(x, y);
+                return &ptr_[convertIndex(x, y)];
+            }
+            return nullptr;
         }
 
-        BufferLayout getLayout() const override
+        inline void set(size_t x, size_t y, const T &pixel)
         {
-            return Layout_Morton;
+            if (ptr_ != nullptr && x < width_ && y < height_)
+            {
+                buffer_->resolveClearAt(x, y);
+                ptr_[convertIndex(x, y)] = pixel;
+            }
         }
 
      private:
-        const static int tileSize_ = 32;    // 32 x 32
-        const static int bits_ = 5;         // tileSize_ = 2^bits_
-        size_t tileWidth_ = 0;
-        size_t tileHeight_ = 0;
+        Buffer<T> *buffer_ = nullptr;
+        T *ptr_ = nullptr;
+        size_t width_ = 0;
+        size_t height_ = 0;
+        size_t innerWidth_ = 0;
     };
 
     template<typename T>
     std::shared_ptr<Buffer<T>> Buffer<T>::makeDefault(size_t w, size_t h)
     {
-        std::shared_ptr<Buffer<T>> ret = nullptr;
-#if SOFTGL_TEXTURE_TILED
-        ret = std::make_shared<TiledBuffer<T>>();
-#elif SOFTGL_TEXTURE_MORTON
-        ret = std::make_shared<MortonBuffer<T>>();
-#else
-        ret = std::make_shared<Buffer<T>>();
-#endif
+        return makeLayout(w, h, SOFTGL_BUFFER_LAYOUT_DEFAULT);
+    }
+
+    template <typename T>
+    std::shared_ptr<Buffer<T>> Buffer<T>::makeLayout(size_t w, size_t h, BufferLayout layout)
+    {
+        auto ret = std::make_shared<Buffer<T>>(layout);
         ret->create(w, h);
         return ret;
     }
 
     template <typename T>
-    std::shared_ptr<Buffer<T>> Buffer<T>::makeLayout(size_t w, size_t h, BufferLayout layout)
+    std::shared_ptr<Buffer<T>> Buffer<T>::makeLayoutCopy(Buffer<T> &src, BufferLayout layout)
     {
-        std::shared_ptr<Buffer<T>> ret = nullptr;
-        switch (layout)
+        auto ret = makeLayout(src.getWidth(), src.getHeight(), layout);
+        for (size_t y = 0; y < src.getHeight(); y++)
         {
-            case Layout_Tiled:
-            {
-                ret = std::make_shared<TiledBuffer<T>>();
-            }
-            case Layout_Morton:
+            for (size_t x = 0; x < src.getWidth(); x++)
             {
-                ret = std::make_shared<MortonBuffer<T>>();
-            }
-            case Layout_Linear:
-            default:
-            {
-                ret = std::make_shared<Buffer<T>>();
+                ret->set(x, y, *src.get(x, y));
             }
         }
-        ret->create(w, h);
         return ret;
     }
-}
\ No newline at end of file
+}
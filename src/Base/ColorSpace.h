@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include "GLMInc.h"
+
+#ifdef SOFTGL_SIMD_OPT
+#include <immintrin.h>
+#endif
+
+namespace SoftGL
+{
+    // sRGB transfer of RGBA8 colors, alpha is always linear. decode is a table lookup,
+    // encode is a piecewise linear fit indexed by float bits (error <= 1 of 255), after Fabian Giesen's
+    // float to sRGB8 table approach
+    class ColorSpace
+    {
+    public:
+        static inline float srgbToLinear(uint8_t v)
+        {
+            return decodeLut()[v];
+        }
+
+        static inline uint8_t linearToSrgb(float v)
+        {
+            const uint32_t minBits = (127 - 13) << 23;    // 2^-13 and below encode to 0
+            const uint32_t almostOneBits = 0x3f7fffff;
+            uint32_t bits;
+            memcpy(&bits, &v, sizeof(uint32_t));
+            // also clamps negative and NaN
+            if (!(v > floatBits(minBits)))
+            {
+                bits = minBits;
+            }
+            else if (bits > almostOneBits)
+            {
+                bits = almostOneBits;
+            }
+            uint32_t tab = encodeTable()[(bits - minBits) >> 20];
+            uint32_t bias = (tab >> 16) << 9;
+            uint32_t scale = tab & 0xffff;
+            uint32_t t = (bits >> 12) & 0xff;
+            return (uint8_t) ((bias + scale * t) >> 16);
+        }
+
+        static inline uint8_t linearToUnorm8(float v)
+        {
+            return (uint8_t) (glm::clamp(v, 0.f, 1.f) * 255.f + 0.5f);
+        }
+
+        // sRGB encoded RGBA8 to linear color in [0, 1]
+        static inline glm::vec4 decode(const RGBA &c)
+        {
+#ifdef SOFTGL_SIMD_OPT
+            int32_t bits;
+            memcpy(&bits, &c, sizeof(int32_t));
+            __m128i idx = _mm_add_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(bits)), _mm_setr_epi32(0, 0, 0, 256));
+            glm::vec4 ret;
+            _mm_storeu_ps(&ret[0], _mm_i32gather_ps(decodeLut(), idx, 4));
+            return ret;
+#else
+            const float *lut = decodeLut();
+            return {lut[c.r], lut[c.g], lut[c.b], lut[256 + c.a]};
+#endif
+        }
+
+        // linear color in [0, 1] to sRGB encoded RGBA8
+        static inline RGBA encode(const glm::vec4 &c)
+        {
+#ifdef SOFTGL_SIMD_OPT
+            __m128 v = _mm_loadu_ps(&c[0]);
+            const __m128i minBits = _mm_set1_epi32((127 - 13) << 23);
+            __m128 clamped = _mm_min_ps(_mm_max_ps(v, _mm_castsi128_ps(minBits)), _mm_castsi128_ps(_mm_set1_epi32(0x3f7fffff)));
+            __m128i bits = _mm_castps_si128(clamped);
+            __m128i tab = _mm_i32gather_epi32((const int *) encodeTable(), _mm_srli_epi32(_mm_sub_epi32(bits, minBits), 20), 4);
+            __m128i bias = _mm_slli_epi32(_mm_srli_epi32(tab, 16), 9);
+            __m128i scale = _mm_and_si128(tab, _mm_set1_epi32(0xffff));
+            __m128i t = _mm_and_si128(_mm_srli_epi32(bits, 12), _mm_set1_epi32(0xff));
+            __m128i ret = _mm_srli_epi32(_mm_add_epi32(bias, _mm_mullo_epi32(scale, t)), 16);
+            // alpha is linear
+            __m128 alpha = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.f));
+            alpha = _mm_add_ps(_mm_mul_ps(alpha, _mm_set1_ps(255.f)), _mm_set1_ps(0.5f));
+            ret = _mm_blend_epi16(ret, _mm_cvttps_epi32(alpha), 0xC0);
+            ret = _mm_packus_epi16(_mm_packus_epi32(ret, ret), ret);
+            int32_t packed = _mm_cvtsi128_si32(ret);
+            RGBA color;
+            memcpy(&color, &packed, sizeof(int32_t));
+            return color;
+#else
+            return {linearToSrgb(c.r), linearToSrgb(c.g), linearToSrgb(c.b), linearToUnorm8(c.a)};
+#endif
+        }
+
+        // [0, 256): sRGB to linear, [256, 512): unorm to float for alpha
+        static inline const float *decodeLut()
+        {
+            static const DecodeLut lut;
+            return lut.values;
+        }
+
+    private:
+        struct DecodeLut
+        {
+            float values[512];
+
+            DecodeLut()
+            {
+                for (int i = 0; i < 256; i++)
+                {
+                    float c = (float) i / 255.f;
+                    values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                    values[256 + i] = c;
+                }
+            }
+        };
+
+        static inline float floatBits(uint32_t bits)
+        {
+            float ret;
+            memcpy(&ret, &bits, sizeof(float));
+            return ret;
+        }
+
+        // per 1/8 octave of [2^-13, 1): bias (high 16 bits) and scale (low 16 bits) of the linear fit
+        static inline const uint32_t *encodeTable()
+        {
+            static const uint32_t table[104] = {
+                0x0073000d, 0x007a000d, 0x0080000d, 0x0087000d, 0x008d000d, 0x0094000d, 0x009a000d, 0x00a1000d,
+                0x00a7001a, 0x00b4001a, 0x00c1001a, 0x00ce001a, 0x00da001a, 0x00e7001a, 0x00f4001a, 0x0101001a,
+                0x010e0033, 0x01280033, 0x01410033, 0x015b0033, 0x01750033, 0x018f0033, 0x01a80033, 0x01c20033,
+                0x01dc0067, 0x020f0067, 0x02430067, 0x02760067, 0x02aa0067, 0x02dd0067, 0x03110067, 0x03440067,
+                0x037800ce, 0x03df00ce, 0x044600ce, 0x04ad00ce, 0x051400ce, 0x057b00c5, 0x05dd00bc, 0x063b00b5,
+                0x06970158, 0x07420142, 0x07e30130, 0x087b0120, 0x090b0112, 0x09940106, 0x0a1700fc, 0x0a9500f2,
+                0x0b0f01cb, 0x0bf401ae, 0x0ccb0195, 0x0d950180, 0x0e56016e, 0x0f0d015e, 0x0fbc0150, 0x10630143,
+                0x11070264, 0x1238023e, 0x1357021d, 0x14660201, 0x156601e9, 0x165a01d3, 0x174401c0, 0x182401af,
+                0x18fe0331, 0x1a9602fe, 0x1c1502d2, 0x1d7e02ad, 0x1ed4028d, 0x201a0270, 0x21520256, 0x227d0240,
+                0x239f0443, 0x25c003fe, 0x27bf03c4, 0x29a10392, 0x2b6a0367, 0x2d1d0341, 0x2ebe031f, 0x304d0300,
+                0x31d105b0, 0x34a80555, 0x37520507, 0x39d504c5, 0x3c37048b, 0x3e7c0458, 0x40a8042a, 0x42bd0401,
+                0x44c20798, 0x488e071e, 0x4c1c06b6, 0x4f76065d, 0x52a50610, 0x55ac05cc, 0x5892058f, 0x5b590559,
+                0x5e0c0a23, 0x631c0980, 0x67db08f6, 0x6c55087f, 0x70940818, 0x74a007bd, 0x787d076c, 0x7c330723,
+            };
+            return table;
+        }
+    };
+}
@@ -3,6 +3,12 @@
 #include <fstream>
 #include <vector>
 #include "Logger.h"
+#include "Platform.h"
+
+#include <sys/stat.h>
+#ifdef PLATFORM_WINDOWS
+#include <direct.h>
+#endif
 
 namespace SoftGL
 {
@@ -15,6 +21,31 @@ namespace SoftGL
             return file.good();
         }
 
+        // create the directory and its parents
+        static bool makeDirs(const std::string &path)
+        {
+            for (size_t pos = path.find_first_of("/\\", 1); ; pos = path.find_first_of("/\\", pos + 1))
+            {
+                std::string dir = path.substr(0, pos);
+#ifdef PLATFORM_WINDOWS
+                _mkdir(dir.c_str());
+#else
+                mkdir(dir.c_str(), 0755);
+#endif
+                if (pos == std::string::npos)
+                {
+                    break;
+                }
+            }
+            struct stat st{};
+            if (stat(path.c_str(), &st) != 0 || !(st.st_mode & S_IFDIR))
+            {
+                LOGE("failed to make directory: %s", path.c_str());
+                return false;
+            }
+            return true;
+        }
+
         static std::vector<uint8_t> readBytes(const std::string &path)
         {
             std::vector<uint8_t> ret;
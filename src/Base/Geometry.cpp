@@ -193,4 +193,16 @@ namespace SoftGL
         }
         return true;
     }
+
+    bool Frustum::intersects(const glm::vec3 &center, float radius) const
+    {
+        for (auto &plane : planes)
+        {
+            if (plane.distance(center) < -radius)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
 }
\ No newline at end of file
@@ -74,6 +74,8 @@ namespace SoftGL
         bool intersects(const glm::vec3 &p0, const glm::vec3 &p1) const;
         // 与三角形相交结果
         bool intersects(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2) const;
+        // 与包围球相交结果(世界坐标)
+        bool intersects(const glm::vec3 &center, float radius) const;
 
      public:
         // near far top bottom left right
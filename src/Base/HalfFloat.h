@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include "GLMInc.h"
+#include <glm/gtc/packing.hpp>
+
+#ifdef SOFTGL_SIMD_OPT
+#include <immintrin.h>
+#endif
+
+namespace SoftGL
+{
+    // conversion of 16 bit and packed texel formats, F16C is used when SIMD is enabled
+    class HalfFloat
+    {
+    public:
+        static inline uint16_t pack(float v)
+        {
+#ifdef SOFTGL_SIMD_OPT
+            return (uint16_t) _cvtss_sh(v, _MM_FROUND_TO_NEAREST_INT);
+#else
+            return glm::packHalf1x16(v);
+#endif
+        }
+
+        static inline float unpack(uint16_t v)
+        {
+#ifdef SOFTGL_SIMD_OPT
+            return _cvtsh_ss(v);
+#else
+            return glm::unpackHalf1x16(v);
+#endif
+        }
+
+        static inline glm::u16vec4 pack4(const glm::vec4 &v)
+        {
+#ifdef SOFTGL_SIMD_OPT
+            __m128i h = _mm_cvtps_ph(_mm_loadu_ps(&v[0]), _MM_FROUND_TO_NEAREST_INT);
+            glm::u16vec4 ret;
+            _mm_storel_epi64((__m128i *) &ret, h);
+            return ret;
+#else
+            uint64_t bits = glm::packHalf4x16(v);
+            glm::u16vec4 ret;
+            memcpy(&ret, &bits, sizeof(uint64_t));
+            return ret;
+#endif
+        }
+
+        static inline glm::vec4 unpack4(const glm::u16vec4 &v)
+        {
+#ifdef SOFTGL_SIMD_OPT
+            glm::vec4 ret;
+            _mm_storeu_ps(&ret[0], _mm_cvtph_ps(_mm_loadl_epi64((const __m128i *) &v)));
+            return ret;
+#else
+            uint64_t bits;
+            memcpy(&bits, &v, sizeof(uint64_t));
+            return glm::unpackHalf4x16(bits);
+#endif
+        }
+
+        // unsigned 11/11/10 bit floats, red in lowest bits. same exponent bias as half,
+        // mantissa is rounded from 10 to 6 (5) bits. negative values and NaN are stored as 0,
+        // overflow and infinity saturate to the largest finite value
+        static inline uint32_t packR11G11B10(const glm::vec3 &v)
+        {
+            uint32_t r = std::min((pack(saturateUFloat(v.x)) + 0x8u) >> 4, 0x7bfu);
+            uint32_t g = std::min((pack(saturateUFloat(v.y)) + 0x8u) >> 4, 0x7bfu);
+            uint32_t b = std::min((pack(saturateUFloat(v.z)) + 0x10u) >> 5, 0x3dfu);
+            return r | (g << 11) | (b << 22);
+        }
+
+        // NaN and negative values to 0, infinity to the largest half
+        static inline float saturateUFloat(float v)
+        {
+            return v > 0.f ? std::min(v, 65504.f) : 0.f;
+        }
+
+        static inline glm::vec3 unpackR11G11B10(uint32_t v)
+        {
+            return {unpack((uint16_t) ((v & 0x7ffu) << 4)),
+                    unpack((uint16_t) (((v >> 11) & 0x7ffu) << 4)),
+                    unpack((uint16_t) (((v >> 22) & 0x3ffu) << 5))};
+        }
+
+        static inline uint16_t packUnorm16(float v)
+        {
+            return (uint16_t) (glm::clamp(v, 0.f, 1.f) * 65535.f + 0.5f);
+        }
+
+        static inline float unpackUnorm16(uint16_t v)
+        {
+            return (float) v * (1.f / 65535.f);
+        }
+
+        // bulk conversion of float arrays, 8 values per iteration
+        static void packArray(uint16_t *dst, const float *src, size_t cnt)
+        {
+            size_t i = 0;
+#ifdef SOFTGL_SIMD_OPT
+            for (; i + 8 <= cnt; i += 8)
+            {
+                _mm_storeu_si128((__m128i *) (dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+            }
+#endif
+            for (; i < cnt; i++)
+            {
+                dst[i] = pack(src[i]);
+            }
+        }
+
+        static void unpackArray(float *dst, const uint16_t *src, size_t cnt)
+        {
+            size_t i = 0;
+#ifdef SOFTGL_SIMD_OPT
+            for (; i + 8 <= cnt; i += 8)
+            {
+                _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (src + i))));
+            }
+#endif
+            for (; i < cnt; i++)
+            {
+                dst[i] = unpack(src[i]);
+            }
+        }
+    };
+}
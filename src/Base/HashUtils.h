@@ -46,10 +46,16 @@ namespace SoftGL
 
         inline static std::string getHashMD5(const char *data, size_t length)
         {
-            unsigned char digest[17] = {0};
             MD5_CTX ctx;
             MD5_Init(&ctx);
             MD5_Update(&ctx, (unsigned char *)data, length);
+            return finalHashMD5(ctx);
+        }
+
+        // hex digest of an incremental hash, ctx is updated by the caller
+        inline static std::string finalHashMD5(MD5_CTX &ctx)
+        {
+            unsigned char digest[17] = {0};
             MD5_Final(digest, &ctx);
             char str[33] = {0};
             hexToStr(str, digest, 16);
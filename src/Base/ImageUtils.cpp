@@ -3,11 +3,81 @@
 
 #include "ImageUtils.h";
 #include "Logger.h"
+#include "FileUtils.h"
 #include <stb/stb_image.h>
 #include <stb/stb_image_write.h>
 
+#ifdef SOFTGL_SIMD_OPT
+#include <immintrin.h>
+#endif
+
 namespace SoftGL
 {
+    static inline void convertGrey(RGBA *dst, const uint8_t *src, size_t cnt)
+    {
+        size_t i = 0;
+#ifdef SOFTGL_SIMD_OPT
+        // 16 pixels per step, each lane expands 8 of the broadcast source bytes
+        const __m256i alpha = _mm256_set1_epi32((int) 0xFF000000);
+        const __m256i mask0 = _mm256_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1,
+                                               4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1);
+        const __m256i mask1 = _mm256_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1,
+                                               12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1);
+        for (; i + 16 <= cnt; i += 16)
+        {
+            __m256i v = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) (src + i)));
+            _mm256_storeu_si256((__m256i *) (dst + i), _mm256_or_si256(_mm256_shuffle_epi8(v, mask0), alpha));
+            _mm256_storeu_si256((__m256i *) (dst + i + 8), _mm256_or_si256(_mm256_shuffle_epi8(v, mask1), alpha));
+        }
+#endif
+        for (; i < cnt; i++)
+        {
+            dst[i] = RGBA(src[i], src[i], src[i], 255);
+        }
+    }
+
+    static inline void convertGreyAlpha(RGBA *dst, const uint8_t *src, size_t cnt)
+    {
+        size_t i = 0;
+#ifdef SOFTGL_SIMD_OPT
+        // 8 pixels per step
+        const __m256i mask = _mm256_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7,
+                                              8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+        for (; i + 8 <= cnt; i += 8)
+        {
+            __m256i v = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) (src + i * 2)));
+            _mm256_storeu_si256((__m256i *) (dst + i), _mm256_shuffle_epi8(v, mask));
+        }
+#endif
+        for (; i < cnt; i++)
+        {
+            dst[i] = RGBA(src[i * 2], src[i * 2], src[i * 2], src[i * 2 + 1]);
+        }
+    }
+
+    static inline void convertRGB(RGBA *dst, const uint8_t *src, size_t cnt)
+    {
+        size_t i = 0;
+#ifdef SOFTGL_SIMD_OPT
+        // 8 pixels per step, 12 source bytes per lane. the second load reads 4 bytes past the
+        // 24 consumed, so stop while a full 16 bytes is still in range
+        const __m256i alpha = _mm256_set1_epi32((int) 0xFF000000);
+        const __m256i mask = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                              0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        for (; (i + 8) * 3 + 4 <= cnt * 3; i += 8)
+        {
+            const uint8_t *p = src + i * 3;
+            __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) p)),
+                                                _mm_loadu_si128((const __m128i *) (p + 12)), 1);
+            _mm256_storeu_si256((__m256i *) (dst + i), _mm256_or_si256(_mm256_shuffle_epi8(v, mask), alpha));
+        }
+#endif
+        for (; i < cnt; i++)
+        {
+            dst[i] = RGBA(src[i * 3], src[i * 3 + 1], src[i * 3 + 2], 255);
+        }
+    }
+
     std::shared_ptr<Buffer<RGBA>> ImageUtils::readImageRGBA(const std::string &path)
     {
         int iw = 0, ih = 0, n = 0;
@@ -17,53 +87,104 @@ namespace SoftGL
             LOGD("ImageUtils::readImage failed, path: %s", path.c_str());
             return nullptr;
         }
-        auto buffer = Buffer<RGBA>::makeDefault(iw, ih);
-        // convert to rgba
-        for (size_t y = 0; y < ih; y++)
+        // decoded images stay linear, textures convert to their own layout on upload
+        auto buffer = std::make_shared<Buffer<RGBA>>(Layout_Linear);
+        if (n == STBI_rgb_alpha)
+        {
+            // already RGBA, keep the decoded pixels
+            buffer->create(iw, ih, std::shared_ptr<RGBA>((RGBA *) data, [](const RGBA *ptr) { stbi_image_free((void *) ptr); }));
+            return buffer;
+        }
+        buffer->create(iw, ih);
+        convertToRGBA(buffer->getRawDataPtr(), data, (size_t) iw * ih, n);
+        stbi_image_free(data);
+        return buffer;
+    }
+
+    bool ImageUtils::readImageSize(const std::string &path, int &width, int &height)
+    {
+        int n = 0;
+        if (!stbi_info(path.c_str(), &width, &height, &n))
+        {
+            LOGD("ImageUtils::readImageSize failed, path: %s", path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    #define DDS_FOURCC(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+    #define DDS_HEADER_SIZE 124
+    #define DDS_HEADER_DX10_SIZE 20
+    #define DDS_CAPS2_CUBEMAP 0x200
+
+    std::vector<std::shared_ptr<BlockBuffer>> ImageUtils::readImageDDS(const std::string &path)
+    {
+        std::vector<std::shared_ptr<BlockBuffer>> ret;
+        auto data = FileUtils::readBytes(path);
+        if (data.size() < 4 + DDS_HEADER_SIZE || *(uint32_t *)data.data() != DDS_FOURCC('D', 'D', 'S', ' '))
+        {
+            LOGD("ImageUtils::readImageDDS failed, invalid header: %s", path.c_str());
+            return ret;
+        }
+        const auto *header = (const uint32_t *)(data.data() + 4);
+        uint32_t height = header[2];
+        uint32_t width = header[3];
+        uint32_t mipCount = std::max(1u, header[6]);
+        uint32_t fourCC = header[20];
+        uint32_t caps2 = header[27];
+        size_t offset = 4 + DDS_HEADER_SIZE;
+        if (caps2 & DDS_CAPS2_CUBEMAP)
         {
-            for (size_t x = 0; x < iw; x++)
+            LOGD("ImageUtils::readImageDDS failed, cube map not support: %s", path.c_str());
+            return ret;
+        }
+
+        BlockFormat format;
+        switch (fourCC)
+        {
+            case DDS_FOURCC('D', 'X', 'T', '1'): format = BlockFormat_BC1; break;
+            case DDS_FOURCC('D', 'X', 'T', '5'): format = BlockFormat_BC3; break;
+            case DDS_FOURCC('A', 'T', 'I', '2'):
+            case DDS_FOURCC('B', 'C', '5', 'U'): format = BlockFormat_BC5; break;
+            case DDS_FOURCC('D', 'X', '1', '0'):
             {
-                auto &to = *buffer->get(x, y);
-                size_t idx = x + y * iw;
-                switch (n)
+                if (data.size() < offset + DDS_HEADER_DX10_SIZE)
+                {
+                    LOGD("ImageUtils::readImageDDS failed, invalid header: %s", path.c_str());
+                    return ret;
+                }
+                uint32_t dxgiFormat = *(const uint32_t *)(data.data() + offset);
+                offset += DDS_HEADER_DX10_SIZE;
+                switch (dxgiFormat)
                 {
-                    case STBI_grey: 
-                    {
-                        to.r = data[idx];
-                        to.g = to.b = to.r;
-                        to.a = 255;
-                        break;
-                    }
-                    case STBI_grey_alpha:
-                    {
-                        to.r = data[idx * 2 + 0];
-                        to.g = to.b = to.r;
-                        to.a = data[idx * 2 + 1];
-                        break;
-                    }
-                    case STBI_rgb: 
-                    {
-                        to.r = data[idx * 3 + 0];
-                        to.g = data[idx * 3 + 1];
-                        to.b = data[idx * 3 + 2];
-                        to.a = 255;
-                        break;
-                    }
-                    case STBI_rgb_alpha: 
-                    {
-                        to.r = data[idx * 4 + 0];
-                        to.g = data[idx * 4 + 1];
-                        to.b = data[idx * 4 + 2];
-                        to.a = data[idx * 4 + 3];
-                        break;
-                    }
+                    case 70: case 71: case 72: format = BlockFormat_BC1; break;     // DXGI_FORMAT_BC1_*
+                    case 76: case 77: case 78: format = BlockFormat_BC3; break;     // DXGI_FORMAT_BC3_*
+                    case 82: case 83:          format = BlockFormat_BC5; break;     // DXGI_FORMAT_BC5_TYPELESS/UNORM
+                    case 97: case 98: case 99: format = BlockFormat_BC7; break;     // DXGI_FORMAT_BC7_*
                     default:
-                        break;
+                        LOGD("ImageUtils::readImageDDS failed, dxgi format not support: %d, %s", dxgiFormat, path.c_str());
+                        return ret;
                 }
+                break;
             }
+            default:
+                LOGD("ImageUtils::readImageDDS failed, format not support: %s", path.c_str());
+                return ret;
         }
-        stbi_image_free(data);
-        return buffer;
+
+        for (uint32_t level = 0; level < mipCount; level++)
+        {
+            auto buffer = std::make_shared<BlockBuffer>(format, std::max(1u, width >> level), std::max(1u, height >> level));
+            if (offset + buffer->getRawDataByteSize() > data.size())
+            {
+                LOGD("ImageUtils::readImageDDS level %d truncated: %s", level, path.c_str());
+                break;
+            }
+            memcpy(buffer->getRawDataPtr(), data.data() + offset, buffer->getRawDataByteSize());
+            offset += buffer->getRawDataByteSize();
+            ret.push_back(buffer);
+        }
+        return ret;
     }
 
     void ImageUtils::writeImage(char const *filename, int w, int h, int comp, const void *data, int strideInBytes, bool flipY)
@@ -72,6 +193,44 @@ namespace SoftGL
         stbi_write_png(filename, w, h, comp, data, strideInBytes);
     }
 
+    std::shared_ptr<Buffer<RGBA>> ImageUtils::downsample(Buffer<RGBA> &src)
+    {
+        size_t srcWidth = src.getWidth();
+        size_t srcHeight = src.getHeight();
+        size_t width = std::max<size_t>(1, srcWidth / 2);
+        size_t height = std::max<size_t>(1, srcHeight / 2);
+        auto ret = Buffer<RGBA>::makeLayout(width, height, Layout_Linear);
+        const RGBA *in = src.getRawDataPtr();
+        RGBA *out = ret->getRawDataPtr();
+        for (size_t y = 0; y < height; y++)
+        {
+            const RGBA *row0 = in + std::min(y * 2, srcHeight - 1) * srcWidth;
+            const RGBA *row1 = in + std::min(y * 2 + 1, srcHeight - 1) * srcWidth;
+            for (size_t x = 0; x < width; x++)
+            {
+                size_t x0 = std::min(x * 2, srcWidth - 1);
+                size_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+                glm::uvec4 sum = glm::uvec4(row0[x0]) + glm::uvec4(row0[x1]) + glm::uvec4(row1[x0]) + glm::uvec4(row1[x1]);
+                out[y * width + x] = RGBA((sum + 2u) / 4u);
+            }
+        }
+        return ret;
+    }
+
+    void ImageUtils::convertToRGBA(RGBA *dst, const uint8_t *src, size_t pixelCnt, int channels)
+    {
+        switch (channels)
+        {
+            case STBI_grey: convertGrey(dst, src, pixelCnt); break;
+            case STBI_grey_alpha: convertGreyAlpha(dst, src, pixelCnt); break;
+            case STBI_rgb: convertRGB(dst, src, pixelCnt); break;
+            case STBI_rgb_alpha: memcpy(dst, src, pixelCnt * sizeof(RGBA)); break;
+            default:
+                LOGE("ImageUtils::convertToRGBA failed, channels not support: %d", channels);
+                break;
+        }
+    }
+
     void ImageUtils::convertFloatImage(RGBA *dst, float *src, uint32_t width, uint32_t height)
     {
         float *srcPixel = src;
@@ -98,4 +257,18 @@ namespace SoftGL
             dstPixel++;
         }
     }
+
+    void ImageUtils::convertHDRImage(RGBA *dst, const float *src, uint32_t width, uint32_t height, uint32_t channels, uint32_t stride)
+    {
+        for (size_t i = 0; i < (size_t) width * height; i++)
+        {
+            const float *srcPixel = src + i * stride;
+            glm::vec4 color(0.f, 0.f, 0.f, 1.f);
+            for (uint32_t c = 0; c < channels; c++)
+            {
+                color[c] = srcPixel[c];
+            }
+            dst[i] = RGBA(glm::clamp(color, 0.f, 1.f) * 255.f + 0.5f);
+        }
+    }
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "Buffer.h"
+#include "BlockCompression.h"
 
 namespace SoftGL
 {
@@ -9,7 +11,17 @@ namespace SoftGL
     {
     public:
         static std::shared_ptr<Buffer<RGBA>> readImageRGBA(const std::string &path);
+        // image size from the file header, without decoding
+        static bool readImageSize(const std::string &path, int &width, int &height);
+        // block compressed 2D image with all stored mip levels, empty if failed
+        static std::vector<std::shared_ptr<BlockBuffer>> readImageDDS(const std::string &path);
         static void writeImage(char const *filename, int w, int h, int comp, const void *data, int strideInBytes, bool flipY);
+        // half size 2x2 box filtered copy of a linear image, odd edges repeat the last texel
+        static std::shared_ptr<Buffer<RGBA>> downsample(Buffer<RGBA> &src);
+        // expand 8 bit grey, grey alpha, rgb or rgba pixels to RGBA
+        static void convertToRGBA(RGBA *dst, const uint8_t *src, size_t pixelCnt, int channels);
         static void convertFloatImage(RGBA *dst, float *src, uint32_t width, uint32_t height);
+        // clamp float color to [0, 1], stride in floats per texel
+        static void convertHDRImage(RGBA *dst, const float *src, uint32_t width, uint32_t height, uint32_t channels, uint32_t stride);
     };
 }
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <string>
+#include "Platform.h"
+#include "Logger.h"
+
+#ifdef PLATFORM_WINDOWS
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SoftGL
+{
+    // whole file mapped copy-on-write: pages load on first access, writes stay private to the process
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        ~MappedFile()
+        {
+            close();
+        }
+
+        bool open(const std::string &path)
+        {
+            close();
+#ifdef PLATFORM_WINDOWS
+            file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file_ == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+            {
+                close();
+                return false;
+            }
+            size_ = (size_t) size.QuadPart;
+            mapping_ = CreateFileMappingA(file_, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+            data_ = mapping_ ? (uint8_t *) MapViewOfFile(mapping_, FILE_MAP_COPY, 0, 0, 0) : nullptr;
+#else
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                return false;
+            }
+            struct stat st{};
+            if (fstat(fd, &st) != 0 || st.st_size == 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            size_ = (size_t) st.st_size;
+            void *ptr = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            // the mapping stays valid after the descriptor is closed
+            ::close(fd);
+            data_ = ptr == MAP_FAILED ? nullptr : (uint8_t *) ptr;
+#endif
+            if (!data_)
+            {
+                LOGE("map file failed: %s", path.c_str());
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        void close()
+        {
+#ifdef PLATFORM_WINDOWS
+            if (data_)
+            {
+                UnmapViewOfFile(data_);
+            }
+            if (mapping_)
+            {
+                CloseHandle(mapping_);
+                mapping_ = nullptr;
+            }
+            if (file_ != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(file_);
+                file_ = INVALID_HANDLE_VALUE;
+            }
+#else
+            if (data_)
+            {
+                munmap(data_, size_);
+            }
+#endif
+            data_ = nullptr;
+            size_ = 0;
+        }
+
+        inline uint8_t *data() const
+        {
+            return data_;
+        }
+
+        inline size_t size() const
+        {
+            return size_;
+        }
+
+    private:
+        uint8_t *data_ = nullptr;
+        size_t size_ = 0;
+#ifdef PLATFORM_WINDOWS
+        HANDLE file_ = INVALID_HANDLE_VALUE;
+        HANDLE mapping_ = nullptr;
+#endif
+    };
+}
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <memory>
+#include <vector>
 #include "Logger.h"
 
 #define SOFTGL_ALIGNMENT 32
@@ -75,4 +77,125 @@ namespace SoftGL
             }
         }
     };
+
+    /**
+     * Bump allocator for transient memory (per frame or per thread, not thread safe).
+     * Allocations are not freed one by one, reset() releases all of them and keeps the
+     * memory for reuse, blocks are merged on reset so a steady workload fits in one block.
+     * Only for trivially destructible types, no constructor/destructor is called.
+     */
+    class MemoryArena
+    {
+     public:
+        explicit MemoryArena(size_t blockSize = 4 * 1024 * 1024) : blockSize_(blockSize) {}
+
+        ~MemoryArena()
+        {
+            release();
+        }
+
+        MemoryArena(const MemoryArena &) = delete;
+        MemoryArena &operator=(const MemoryArena &) = delete;
+
+        void *alloc(size_t size, size_t alignment = SOFTGL_ALIGNMENT)
+        {
+            if (size == 0)
+            {
+                return nullptr;
+            }
+            while (true)
+            {
+                if (blockIdx_ < blocks_.size())
+                {
+                    Block &block = blocks_[blockIdx_];
+                    size_t addr = (size_t) block.data + offset_;
+                    size_t alignedAddr = (addr + alignment - 1) & ~(alignment - 1);
+                    size_t end = alignedAddr - (size_t) block.data + size;
+                    if (end <= block.size)
+                    {
+                        usedSize_ += end - offset_;
+                        offset_ = end;
+                        return (void *) alignedAddr;
+                    }
+                    if (blockIdx_ + 1 < blocks_.size())
+                    {
+                        blockIdx_++;
+                        offset_ = 0;
+                        continue;
+                    }
+                }
+                // out of space, append new block
+                Block block;
+                block.size = std::max(blockSize_, size + alignment);
+                block.data = (uint8_t *) MemoryUtils::alignedMalloc(block.size);
+                if (!block.data)
+                {
+                    return nullptr;
+                }
+                blocks_.push_back(block);
+                blockIdx_ = blocks_.size() - 1;
+                offset_ = 0;
+            }
+        }
+
+        template <typename T>
+        inline T *alloc(size_t elemCnt)
+        {
+            return (T *) alloc(elemCnt * sizeof(T), std::max(alignof(T), (size_t) SOFTGL_ALIGNMENT));
+        }
+
+        void reset()
+        {
+            if (blocks_.size() > 1)
+            {
+                size_t totalSize = 0;
+                for (auto &block : blocks_)
+                {
+                    totalSize += block.size;
+                }
+                release();
+                Block block;
+                block.size = totalSize;
+                block.data = (uint8_t *) MemoryUtils::alignedMalloc(block.size);
+                if (block.data)
+                {
+                    blocks_.push_back(block);
+                }
+            }
+            blockIdx_ = 0;
+            offset_ = 0;
+            usedSize_ = 0;
+        }
+
+        inline size_t getUsedSize() const
+        {
+            return usedSize_;
+        }
+
+     private:
+        void release()
+        {
+            for (auto &block : blocks_)
+            {
+                MemoryUtils::alignedFree(block.data);
+            }
+            blocks_.clear();
+            blockIdx_ = 0;
+            offset_ = 0;
+            usedSize_ = 0;
+        }
+
+     private:
+        struct Block
+        {
+            uint8_t *data = nullptr;
+            size_t size = 0;
+        };
+
+        size_t blockSize_;
+        std::vector<Block> blocks_;
+        size_t blockIdx_ = 0;
+        size_t offset_ = 0;
+        size_t usedSize_ = 0;
+    };
 }
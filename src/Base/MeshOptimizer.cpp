@@ -0,0 +1,1023 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "GLMInc.h"
+
+namespace SoftGL
+{
+    #define OVERDRAW_VIEWPORT 64
+    #define SIMPLIFY_BORDER_WEIGHT 10.0
+    #define SIMPLIFY_FLIP_COS 0.5f     // moved triangles stay within 60 degrees of their source triangle
+
+    static inline glm::vec3 getPosition(const float *positions, size_t stride, int32_t idx)
+    {
+        const float *p = (const float *) ((const uint8_t *) positions + (size_t) idx * stride);
+        return {p[0], p[1], p[2]};
+    }
+
+    // FIFO cache of the last cacheSize transformed vertexes, tracked with insertion timestamps
+    class VertexCache
+    {
+    public:
+        VertexCache(size_t vertexCnt, size_t cacheSize) : stamps_(vertexCnt, 0), cacheSize_((uint32_t) cacheSize)
+        {
+            flush();
+        }
+
+        inline void flush()
+        {
+            time_ += cacheSize_ + 1;
+        }
+
+        // returns true on a miss
+        inline bool access(int32_t idx)
+        {
+            if (time_ - stamps_[idx] > cacheSize_)
+            {
+                stamps_[idx] = time_++;
+                return true;
+            }
+            return false;
+        }
+
+        inline int triangleMisses(const int32_t *tri)
+        {
+            return (int) access(tri[0]) + (int) access(tri[1]) + (int) access(tri[2]);
+        }
+
+        inline uint32_t time() const
+        {
+            return time_;
+        }
+
+        inline uint32_t stamp(int32_t idx) const
+        {
+            return stamps_[idx];
+        }
+
+    private:
+        std::vector<uint32_t> stamps_;
+        uint32_t cacheSize_;
+        uint32_t time_ = 0;
+    };
+
+    // plane distance quadric accumulated with area weights
+    struct Quadric
+    {
+        double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+        double a11 = 0, a12 = 0, a13 = 0;
+        double a22 = 0, a23 = 0;
+        double a33 = 0;
+        double weight = 0;
+
+        void addPlane(const glm::vec3 &n, float d, double w)
+        {
+            double a = n.x, b = n.y, c = n.z;
+            a00 += a * a * w; a01 += a * b * w; a02 += a * c * w; a03 += a * d * w;
+            a11 += b * b * w; a12 += b * c * w; a13 += b * d * w;
+            a22 += c * c * w; a23 += c * d * w;
+            a33 += (double) d * d * w;
+            weight += w;
+        }
+
+        void add(const Quadric &q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+            a11 += q.a11; a12 += q.a12; a13 += q.a13;
+            a22 += q.a22; a23 += q.a23;
+            a33 += q.a33;
+            weight += q.weight;
+        }
+
+        // weighted mean squared plane distance
+        double error(const glm::vec3 &p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double e = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+                     + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+                     + a22 * z * z + 2 * a23 * z
+                     + a33;
+            return weight > 0 ? std::abs(e) / weight : 0;
+        }
+    };
+
+    enum SimplifyVertexKind
+    {
+        SimplifyVertex_Manifold,
+        SimplifyVertex_Border,
+        SimplifyVertex_Locked,   // non-manifold edges
+    };
+
+    static bool validIndices(const int32_t *indices, size_t indexCnt, size_t vertexCnt)
+    {
+        for (size_t i = 0; i < indexCnt; i++)
+        {
+            if (indices[i] < 0 || (size_t) indices[i] >= vertexCnt)
+            {
+                return false;
+            }
+        }
+        return indexCnt % 3 == 0;
+    }
+
+    // vertex -> triangles, triangles of vertex v are adjacency[offsets[v], offsets[v + 1])
+    static void buildVertexTriangles(const int32_t *indices, size_t indexCnt, size_t vertexCnt,
+                                     std::vector<uint32_t> &offsets, std::vector<uint32_t> &adjacency)
+    {
+        offsets.assign(vertexCnt + 1, 0);
+        for (size_t i = 0; i < indexCnt; i++)
+        {
+            offsets[indices[i] + 1]++;
+        }
+        for (size_t v = 0; v < vertexCnt; v++)
+        {
+            offsets[v + 1] += offsets[v];
+        }
+        adjacency.resize(indexCnt);
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indexCnt; i++)
+        {
+            adjacency[fill[indices[i]]++] = (uint32_t) (i / 3);
+        }
+    }
+
+    // vertexes with bitwise equal positions share one welded index, returns the welded vertex count
+    static size_t weldPositions(const float *positions, size_t vertexCnt, size_t stride, std::vector<int32_t> &welded)
+    {
+        std::vector<int32_t> sorted(vertexCnt);
+        for (size_t v = 0; v < vertexCnt; v++)
+        {
+            sorted[v] = (int32_t) v;
+        }
+        auto positionBits = [positions, stride](int32_t idx) -> const void *
+        {
+            return (const uint8_t *) positions + (size_t) idx * stride;
+        };
+        std::sort(sorted.begin(), sorted.end(), [&](int32_t a, int32_t b) -> bool
+        {
+            return memcmp(positionBits(a), positionBits(b), sizeof(float) * 3) < 0;
+        });
+        welded.resize(vertexCnt);
+        size_t weldedCnt = 0;
+        for (size_t i = 0; i < vertexCnt; i++)
+        {
+            if (i > 0 && memcmp(positionBits(sorted[i - 1]), positionBits(sorted[i]), sizeof(float) * 3) != 0)
+            {
+                weldedCnt++;
+            }
+            welded[sorted[i]] = (int32_t) weldedCnt;
+        }
+        return vertexCnt > 0 ? weldedCnt + 1 : 0;
+    }
+
+    // returns triangle order, hard cluster starts (triangle index) are appended to clusters
+    static std::vector<int32_t> tipsify(const int32_t *indices, size_t indexCnt, size_t vertexCnt, size_t cacheSize,
+                                        std::vector<size_t> &clusters)
+    {
+        size_t triangleCnt = indexCnt / 3;
+
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> adjacency;
+        buildVertexTriangles(indices, indexCnt, vertexCnt, offsets, adjacency);
+
+        std::vector<uint32_t> live(vertexCnt);
+        for (size_t v = 0; v < vertexCnt; v++)
+        {
+            live[v] = offsets[v + 1] - offsets[v];
+        }
+        std::vector<uint8_t> emitted(triangleCnt, 0);
+        std::vector<int32_t> deadEnd;
+        std::vector<int32_t> candidates;
+        VertexCache cache(vertexCnt, cacheSize);
+        std::vector<int32_t> ret;
+        ret.reserve(indexCnt);
+
+        size_t cursor = 0;
+        auto skipDeadEnd = [&]() -> int32_t
+        {
+            while (!deadEnd.empty())
+            {
+                int32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0)
+                {
+                    return v;
+                }
+            }
+            for (; cursor < vertexCnt; cursor++)
+            {
+                if (live[cursor] > 0)
+                {
+                    return (int32_t) cursor;
+                }
+            }
+            return -1;
+        };
+
+        int32_t fanning = skipDeadEnd();
+        while (fanning >= 0)
+        {
+            // emit all remaining triangles around the fanning vertex
+            candidates.clear();
+            for (uint32_t i = offsets[fanning]; i < offsets[fanning + 1]; i++)
+            {
+                uint32_t tri = adjacency[i];
+                if (emitted[tri])
+                {
+                    continue;
+                }
+                for (int k = 0; k < 3; k++)
+                {
+                    int32_t v = indices[tri * 3 + k];
+                    ret.push_back(v);
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    cache.access(v);
+                }
+                emitted[tri] = 1;
+            }
+
+            // next fanning vertex: the oldest candidate that stays in cache while its triangles are emitted
+            int32_t best = -1;
+            int64_t bestPriority = -1;
+            for (int32_t v : candidates)
+            {
+                if (live[v] == 0)
+                {
+                    continue;
+                }
+                int64_t age = (int64_t) cache.time() - cache.stamp(v);
+                int64_t priority = 0;
+                if (age + 2 * (int64_t) live[v] <= (int64_t) cacheSize)
+                {
+                    priority = age;
+                }
+                if (priority > bestPriority)
+                {
+                    best = v;
+                    bestPriority = priority;
+                }
+            }
+            if (best < 0)
+            {
+                best = skipDeadEnd();
+                if (best >= 0)
+                {
+                    clusters.push_back(ret.size() / 3);
+                }
+            }
+            fanning = best;
+        }
+        return ret;
+    }
+
+    void MeshOptimizer::optimizeTriangleOrder(int32_t *indices, size_t indexCnt, const float *positions, size_t vertexCnt, size_t stride,
+                                              float threshold)
+    {
+        if (indexCnt < 6 || !validIndices(indices, indexCnt, vertexCnt))
+        {
+            return;
+        }
+        size_t triangleCnt = indexCnt / 3;
+        std::vector<size_t> hardClusters = {0};
+        std::vector<int32_t> order = tipsify(indices, indexCnt, vertexCnt, MESH_VERTEX_CACHE_SIZE, hardClusters);
+        hardClusters.push_back(triangleCnt);
+
+        // split clusters where the prefix cache cost is within threshold of the whole cluster,
+        // the cache is assumed flushed at every split
+        std::vector<size_t> clusters;
+        VertexCache cache(vertexCnt, MESH_VERTEX_CACHE_SIZE);
+        for (size_t c = 0; c + 1 < hardClusters.size(); c++)
+        {
+            size_t begin = hardClusters[c];
+            size_t end = hardClusters[c + 1];
+            cache.flush();
+            size_t clusterMisses = 0;
+            for (size_t t = begin; t < end; t++)
+            {
+                clusterMisses += cache.triangleMisses(&order[t * 3]);
+            }
+            float clusterAcmr = (float) clusterMisses / (float) (end - begin);
+
+            cache.flush();
+            clusters.push_back(begin);
+            size_t start = begin;
+            size_t misses = 0;
+            for (size_t t = begin; t + 1 < end; t++)
+            {
+                misses += cache.triangleMisses(&order[t * 3]);
+                if ((float) misses <= threshold * clusterAcmr * (float) (t + 1 - start))
+                {
+                    clusters.push_back(t + 1);
+                    start = t + 1;
+                    misses = 0;
+                    cache.flush();
+                }
+            }
+        }
+        clusters.push_back(triangleCnt);
+
+        // area weighted centroids & normals
+        size_t clusterCnt = clusters.size() - 1;
+        std::vector<glm::vec3> centroids(clusterCnt, glm::vec3(0.f));
+        std::vector<glm::vec3> normals(clusterCnt, glm::vec3(0.f));
+        glm::vec3 meshCentroid(0.f);
+        float meshArea = 0.f;
+        for (size_t c = 0; c < clusterCnt; c++)
+        {
+            float clusterArea = 0.f;
+            for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+            {
+                glm::vec3 p0 = getPosition(positions, stride, order[t * 3 + 0]);
+                glm::vec3 p1 = getPosition(positions, stride, order[t * 3 + 1]);
+                glm::vec3 p2 = getPosition(positions, stride, order[t * 3 + 2]);
+                glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+                float area = glm::length(n);
+                centroids[c] += (p0 + p1 + p2) * (area / 3.f);
+                normals[c] += n;
+                clusterArea += area;
+            }
+            meshCentroid += centroids[c];
+            meshArea += clusterArea;
+            centroids[c] = clusterArea > 0.f ? centroids[c] / clusterArea : getPosition(positions, stride, order[clusters[c] * 3]);
+        }
+        meshCentroid = meshArea > 0.f ? meshCentroid / meshArea : centroids[0];
+
+        // clusters facing away from the center occlude the inner ones, draw them first
+        std::vector<float> sortKeys(clusterCnt);
+        std::vector<size_t> clusterOrder(clusterCnt);
+        for (size_t c = 0; c < clusterCnt; c++)
+        {
+            float len = glm::length(normals[c]);
+            sortKeys[c] = len > 0.f ? glm::dot(centroids[c] - meshCentroid, normals[c] / len) : 0.f;
+            clusterOrder[c] = c;
+        }
+        std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](size_t a, size_t b) -> bool
+        {
+            return sortKeys[a] > sortKeys[b];
+        });
+
+        int32_t *dst = indices;
+        for (size_t c : clusterOrder)
+        {
+            size_t cnt = (clusters[c + 1] - clusters[c]) * 3;
+            memcpy(dst, &order[clusters[c] * 3], cnt * sizeof(int32_t));
+            dst += cnt;
+        }
+    }
+
+    void MeshOptimizer::buildMeshlets(int32_t *indices, size_t indexCnt, const float *positions, size_t vertexCnt, size_t stride,
+                                      std::vector<Meshlet> &meshlets)
+    {
+        meshlets.clear();
+        if (indexCnt < 3 || !validIndices(indices, indexCnt, vertexCnt))
+        {
+            return;
+        }
+        size_t triangleCnt = indexCnt / 3;
+
+        // vertexes welded by position, attribute seams do not break triangle adjacency
+        std::vector<int32_t> welded;
+        size_t weldedCnt = weldPositions(positions, vertexCnt, stride, welded);
+        std::vector<int32_t> weldedIndices(indexCnt);
+        for (size_t i = 0; i < indexCnt; i++)
+        {
+            weldedIndices[i] = welded[indices[i]];
+        }
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> adjacency;
+        buildVertexTriangles(weldedIndices.data(), indexCnt, weldedCnt, offsets, adjacency);
+
+        // unit face normals, zero for degenerate triangles
+        std::vector<glm::vec3> normals(triangleCnt);
+        for (size_t t = 0; t < triangleCnt; t++)
+        {
+            glm::vec3 p0 = getPosition(positions, stride, indices[t * 3]);
+            glm::vec3 n = glm::cross(getPosition(positions, stride, indices[t * 3 + 1]) - p0,
+                                     getPosition(positions, stride, indices[t * 3 + 2]) - p0);
+            float len = glm::length(n);
+            normals[t] = len > 0.f ? n / len : glm::vec3(0.f);
+        }
+
+        // greedy growth: seeded with the first free triangle in the current order, then the adjacent triangle adding
+        // the fewest new vertexes, ties broken by the normal closest to the meshlet average
+        const uint32_t none = ~0u;
+        std::vector<uint8_t> emitted(triangleCnt, 0);
+        std::vector<uint32_t> vertexStamp(weldedCnt, none);
+        std::vector<uint32_t> triangleStamp(triangleCnt, none);
+        std::vector<std::vector<uint32_t>> clusters;
+        std::vector<uint32_t> candidates;
+        size_t cursor = 0;
+        while (true)
+        {
+            while (cursor < triangleCnt && emitted[cursor])
+            {
+                cursor++;
+            }
+            if (cursor == triangleCnt)
+            {
+                break;
+            }
+            auto stamp = (uint32_t) clusters.size();
+            clusters.emplace_back();
+            std::vector<uint32_t> &cluster = clusters.back();
+            candidates.clear();
+            size_t clusterVertexCnt = 0;
+            glm::vec3 normalSum(0.f);
+            auto next = (uint32_t) cursor;
+            while (next != none)
+            {
+                emitted[next] = 1;
+                cluster.push_back(next);
+                normalSum += normals[next];
+                for (int k = 0; k < 3; k++)
+                {
+                    int32_t v = weldedIndices[next * 3 + k];
+                    if (vertexStamp[v] == stamp)
+                    {
+                        continue;
+                    }
+                    vertexStamp[v] = stamp;
+                    clusterVertexCnt++;
+                    for (uint32_t i = offsets[v]; i < offsets[v + 1]; i++)
+                    {
+                        uint32_t tri = adjacency[i];
+                        if (!emitted[tri] && triangleStamp[tri] != stamp)
+                        {
+                            triangleStamp[tri] = stamp;
+                            candidates.push_back(tri);
+                        }
+                    }
+                }
+                if (cluster.size() >= MESHLET_MAX_TRIANGLES)
+                {
+                    break;
+                }
+
+                next = none;
+                int bestNew = 4;
+                float bestDot = -2.f;
+                for (size_t c = 0; c < candidates.size();)
+                {
+                    uint32_t tri = candidates[c];
+                    int newCnt = 0;
+                    for (int k = 0; k < 3; k++)
+                    {
+                        newCnt += vertexStamp[weldedIndices[tri * 3 + k]] != stamp;
+                    }
+                    // emitted or over the vertex limit, never a candidate again for this meshlet
+                    if (emitted[tri] || clusterVertexCnt + newCnt > MESHLET_MAX_VERTEXES)
+                    {
+                        candidates[c] = candidates.back();
+                        candidates.pop_back();
+                        continue;
+                    }
+                    float d = glm::dot(normalSum, normals[tri]);
+                    if (newCnt < bestNew || (newCnt == bestNew && d > bestDot))
+                    {
+                        next = tri;
+                        bestNew = newCnt;
+                        bestDot = d;
+                    }
+                    c++;
+                }
+            }
+            // keep the incoming (cache optimized) order inside the meshlet
+            std::sort(cluster.begin(), cluster.end());
+        }
+
+        std::vector<int32_t> reordered;
+        reordered.reserve(indexCnt);
+        meshlets.resize(clusters.size());
+        for (size_t m = 0; m < clusters.size(); m++)
+        {
+            Meshlet &meshlet = meshlets[m];
+            const std::vector<uint32_t> &cluster = clusters[m];
+            meshlet.indexOffset = (uint32_t) reordered.size();
+            meshlet.indexCnt = (uint32_t) cluster.size() * 3;
+            glm::vec3 boundsMin(std::numeric_limits<float>::max());
+            glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+            glm::vec3 axis(0.f);
+            for (uint32_t tri : cluster)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    int32_t v = indices[tri * 3 + k];
+                    reordered.push_back(v);
+                    glm::vec3 p = getPosition(positions, stride, v);
+                    boundsMin = glm::min(boundsMin, p);
+                    boundsMax = glm::max(boundsMax, p);
+                }
+                axis += normals[tri];
+            }
+            meshlet.center = (boundsMin + boundsMax) * 0.5f;
+            for (uint32_t tri : cluster)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    float dist = glm::length(getPosition(positions, stride, indices[tri * 3 + k]) - meshlet.center);
+                    meshlet.radius = std::max(meshlet.radius, dist);
+                }
+            }
+
+            // normal cone, the apex lies behind the planes of all triangles
+            float axisLen = glm::length(axis);
+            if (axisLen <= 0.f)
+            {
+                continue;
+            }
+            axis /= axisLen;
+            float minDot = 1.f;
+            for (uint32_t tri : cluster)
+            {
+                if (normals[tri] != glm::vec3(0.f))
+                {
+                    minDot = std::min(minDot, glm::dot(axis, normals[tri]));
+                }
+            }
+            if (minDot <= 0.f)
+            {
+                continue;
+            }
+            float maxT = 0.f;
+            for (uint32_t tri : cluster)
+            {
+                const glm::vec3 &n = normals[tri];
+                if (n == glm::vec3(0.f))
+                {
+                    continue;
+                }
+                float t = glm::dot(meshlet.center - getPosition(positions, stride, indices[tri * 3]), n) / glm::dot(axis, n);
+                maxT = std::max(maxT, t);
+            }
+            meshlet.coneApex = meshlet.center - axis * maxT;
+            meshlet.coneAxis = axis;
+            meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+        }
+        memcpy(indices, reordered.data(), indexCnt * sizeof(int32_t));
+    }
+
+    size_t MeshOptimizer::simplify(int32_t *destination, const int32_t *indices, size_t indexCnt, const float *positions, size_t vertexCnt,
+                                   size_t stride, size_t targetIndexCnt, float targetError, float *resultError)
+    {
+        if (resultError)
+        {
+            *resultError = 0.f;
+        }
+        if (indexCnt < 3 || !validIndices(indices, indexCnt, vertexCnt))
+        {
+            return 0;
+        }
+        std::vector<int32_t> welded;
+        size_t weldedCnt = weldPositions(positions, vertexCnt, stride, welded);
+        std::vector<glm::vec3> weldedPos(weldedCnt);
+        for (size_t v = 0; v < vertexCnt; v++)
+        {
+            weldedPos[welded[v]] = getPosition(positions, stride, (int32_t) v);
+        }
+
+        // face quadrics of the source surface
+        std::vector<Quadric> quadrics(weldedCnt);
+        for (size_t i = 0; i < indexCnt; i += 3)
+        {
+            const glm::vec3 &p0 = weldedPos[welded[indices[i]]];
+            glm::vec3 n = glm::cross(weldedPos[welded[indices[i + 1]]] - p0, weldedPos[welded[indices[i + 2]]] - p0);
+            float len = glm::length(n);
+            if (len <= 0.f)
+            {
+                continue;
+            }
+            n /= len;
+            for (int k = 0; k < 3; k++)
+            {
+                quadrics[welded[indices[i + k]]].addPlane(n, -glm::dot(n, p0), len * 0.5);
+            }
+        }
+
+        struct Edge
+        {
+            int32_t v0;
+            int32_t v1;
+            uint32_t tri;
+        };
+        struct Collapse
+        {
+            int32_t from;
+            int32_t to;
+            double cost;
+        };
+        // triangles degenerate after welding carry no surface
+        std::vector<int32_t> result;
+        result.reserve(indexCnt);
+        for (size_t i = 0; i < indexCnt; i += 3)
+        {
+            int32_t w0 = welded[indices[i]];
+            int32_t w1 = welded[indices[i + 1]];
+            int32_t w2 = welded[indices[i + 2]];
+            if (w0 != w1 && w1 != w2 && w0 != w2)
+            {
+                result.insert(result.end(), indices + i, indices + i + 3);
+            }
+        }
+        // collapses only move vertexes, so each result triangle keeps the normal of its source triangle
+        std::vector<glm::vec3> sourceNormals(result.size() / 3);
+        for (size_t t = 0; t < sourceNormals.size(); t++)
+        {
+            const glm::vec3 &p0 = weldedPos[welded[result[t * 3]]];
+            glm::vec3 n = glm::cross(weldedPos[welded[result[t * 3 + 1]]] - p0, weldedPos[welded[result[t * 3 + 2]]] - p0);
+            float len = glm::length(n);
+            sourceNormals[t] = len > 0.f ? n / len : n;
+        }
+        std::vector<int32_t> weldedIndices;
+        std::vector<Edge> edges;
+        std::vector<uint8_t> kinds(weldedCnt);
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> adjacency;
+        std::vector<Collapse> collapses;
+        std::vector<int32_t> remap(vertexCnt);
+        std::vector<int32_t> weldedRemap(weldedCnt);
+        std::vector<uint8_t> collapsed(weldedCnt);
+        std::vector<std::pair<int32_t, int32_t>> copies;
+        double maxCost = (double) targetError * targetError;
+        double resultCost = 0;
+        bool firstPass = true;
+
+        while (result.size() > targetIndexCnt)
+        {
+            size_t triangleCnt = result.size() / 3;
+            weldedIndices.resize(result.size());
+            for (size_t i = 0; i < result.size(); i++)
+            {
+                weldedIndices[i] = welded[result[i]];
+            }
+
+            // edge use counts classify vertexes: one use is a border edge, more than two a non-manifold edge
+            edges.clear();
+            for (size_t t = 0; t < triangleCnt; t++)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    int32_t a = weldedIndices[t * 3 + k];
+                    int32_t b = weldedIndices[t * 3 + (k + 1) % 3];
+                    edges.push_back({std::min(a, b), std::max(a, b), (uint32_t) t});
+                }
+            }
+            std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) -> bool
+            {
+                return a.v0 != b.v0 ? a.v0 < b.v0 : a.v1 < b.v1;
+            });
+            std::fill(kinds.begin(), kinds.end(), (uint8_t) SimplifyVertex_Manifold);
+            for (size_t i = 0; i < edges.size();)
+            {
+                size_t j = i + 1;
+                while (j < edges.size() && edges[j].v0 == edges[i].v0 && edges[j].v1 == edges[i].v1)
+                {
+                    j++;
+                }
+                uint8_t kind = j - i == 1 ? SimplifyVertex_Border : (j - i > 2 ? SimplifyVertex_Locked : SimplifyVertex_Manifold);
+                kinds[edges[i].v0] = std::max(kinds[edges[i].v0], kind);
+                kinds[edges[i].v1] = std::max(kinds[edges[i].v1], kind);
+                // borders keep their shape with planes through the edge, perpendicular to the face
+                if (firstPass && j - i == 1)
+                {
+                    const int32_t *tri = &weldedIndices[edges[i].tri * 3];
+                    const glm::vec3 &p0 = weldedPos[edges[i].v0];
+                    glm::vec3 e = weldedPos[edges[i].v1] - p0;
+                    glm::vec3 n = glm::cross(weldedPos[tri[1]] - weldedPos[tri[0]], weldedPos[tri[2]] - weldedPos[tri[0]]);
+                    glm::vec3 plane = glm::cross(e, n);
+                    float len = glm::length(plane);
+                    if (len > 0.f)
+                    {
+                        plane /= len;
+                        double w = glm::dot(e, e) * SIMPLIFY_BORDER_WEIGHT;
+                        quadrics[edges[i].v0].addPlane(plane, -glm::dot(plane, p0), w);
+                        quadrics[edges[i].v1].addPlane(plane, -glm::dot(plane, p0), w);
+                    }
+                }
+                i = j;
+            }
+            firstPass = false;
+            buildVertexTriangles(weldedIndices.data(), weldedIndices.size(), weldedCnt, offsets, adjacency);
+
+            // cheapest valid direction per edge
+            collapses.clear();
+            for (size_t i = 0; i < edges.size();)
+            {
+                size_t j = i + 1;
+                while (j < edges.size() && edges[j].v0 == edges[i].v0 && edges[j].v1 == edges[i].v1)
+                {
+                    j++;
+                }
+                bool borderEdge = j - i == 1;
+                Collapse best = {-1, -1, 0};
+                for (int dir = 0; dir < 2; dir++)
+                {
+                    int32_t from = dir == 0 ? edges[i].v0 : edges[i].v1;
+                    int32_t to = dir == 0 ? edges[i].v1 : edges[i].v0;
+                    if (kinds[from] == SimplifyVertex_Locked || (kinds[from] == SimplifyVertex_Border && !borderEdge))
+                    {
+                        continue;
+                    }
+                    double cost = quadrics[from].error(weldedPos[to]);
+                    if (best.from < 0 || cost < best.cost)
+                    {
+                        best = {from, to, cost};
+                    }
+                }
+                if (best.from >= 0 && best.cost <= maxCost)
+                {
+                    collapses.push_back(best);
+                }
+                i = j;
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) -> bool
+            {
+                return a.cost < b.cost;
+            });
+
+            // one collapse per vertex neighborhood and pass, a manifold collapse removes two triangles, a border collapse one
+            for (size_t v = 0; v < vertexCnt; v++)
+            {
+                remap[v] = (int32_t) v;
+            }
+            for (size_t v = 0; v < weldedCnt; v++)
+            {
+                weldedRemap[v] = (int32_t) v;
+            }
+            std::fill(collapsed.begin(), collapsed.end(), 0);
+            size_t removeGoal = triangleCnt - targetIndexCnt / 3;
+            size_t removed = 0;
+            size_t collapseCnt = 0;
+            for (auto &collapse : collapses)
+            {
+                if (removed >= removeGoal)
+                {
+                    break;
+                }
+                int32_t from = collapse.from;
+                int32_t to = collapse.to;
+                if (collapsed[from] || collapsed[to])
+                {
+                    continue;
+                }
+                // every copy of the source vertex moves to a copy of the target it shares an edge with
+                copies.clear();
+                for (uint32_t i = offsets[from]; i < offsets[from + 1]; i++)
+                {
+                    const int32_t *tri = &result[adjacency[i] * 3];
+                    int32_t copyFrom = -1;
+                    int32_t copyTo = -1;
+                    for (int k = 0; k < 3; k++)
+                    {
+                        int32_t w = welded[tri[k]];
+                        copyFrom = w == from ? tri[k] : copyFrom;
+                        copyTo = w == to ? tri[k] : copyTo;
+                    }
+                    if (copyTo >= 0 && std::find_if(copies.begin(), copies.end(), [copyFrom](const std::pair<int32_t, int32_t> &c) -> bool
+                    {
+                        return c.first == copyFrom;
+                    }) == copies.end())
+                    {
+                        copies.emplace_back(copyFrom, copyTo);
+                    }
+                }
+                bool valid = !copies.empty();
+                for (uint32_t i = offsets[from]; i < offsets[from + 1] && valid; i++)
+                {
+                    const int32_t *tri = &result[adjacency[i] * 3];
+                    const int32_t *weldedTri = &weldedIndices[adjacency[i] * 3];
+                    if (weldedTri[0] == to || weldedTri[1] == to || weldedTri[2] == to)
+                    {
+                        continue;
+                    }
+                    // copy without an edge to the target, or a triangle turned over
+                    glm::vec3 p[3];
+                    glm::vec3 moved[3];
+                    for (int k = 0; k < 3; k++)
+                    {
+                        if (weldedTri[k] == from)
+                        {
+                            int32_t copy = tri[k];
+                            valid = std::find_if(copies.begin(), copies.end(), [copy](const std::pair<int32_t, int32_t> &c) -> bool
+                            {
+                                return c.first == copy;
+                            }) != copies.end();
+                            p[k] = weldedPos[from];
+                            moved[k] = weldedPos[to];
+                        }
+                        else
+                        {
+                            p[k] = weldedPos[weldedRemap[weldedTri[k]]];
+                            moved[k] = p[k];
+                        }
+                    }
+                    glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+                    glm::vec3 nMoved = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                    float nLen = glm::length(n);
+                    float nMovedLen = glm::length(nMoved);
+                    if (nLen > 0.f && glm::dot(n, nMoved) <= SIMPLIFY_FLIP_COS * nLen * nMovedLen)
+                    {
+                        valid = false;
+                    }
+                    // rotations of several passes add up, the source surface bounds them
+                    if (glm::dot(sourceNormals[adjacency[i]], nMoved) <= SIMPLIFY_FLIP_COS * nMovedLen)
+                    {
+                        valid = false;
+                    }
+                }
+                if (!valid)
+                {
+                    continue;
+                }
+                for (auto &copy : copies)
+                {
+                    remap[copy.first] = copy.second;
+                }
+                weldedRemap[from] = to;
+                quadrics[to].add(quadrics[from]);
+                // the 1-ring of the source is locked for the pass: flip checks see the pass start surface, so a
+                // triangle must not move more than one vertex per pass
+                for (uint32_t i = offsets[from]; i < offsets[from + 1]; i++)
+                {
+                    const int32_t *weldedTri = &weldedIndices[adjacency[i] * 3];
+                    collapsed[weldedTri[0]] = 1;
+                    collapsed[weldedTri[1]] = 1;
+                    collapsed[weldedTri[2]] = 1;
+                }
+                collapsed[to] = 1;
+                removed += kinds[from] == SimplifyVertex_Border ? 1 : 2;
+                resultCost = std::max(resultCost, collapse.cost);
+                collapseCnt++;
+            }
+            if (collapseCnt == 0)
+            {
+                break;
+            }
+
+            // collapsed triangles dropped
+            size_t cnt = 0;
+            for (size_t i = 0; i < result.size(); i += 3)
+            {
+                int32_t v0 = remap[result[i]];
+                int32_t v1 = remap[result[i + 1]];
+                int32_t v2 = remap[result[i + 2]];
+                if (welded[v0] == welded[v1] || welded[v1] == welded[v2] || welded[v0] == welded[v2])
+                {
+                    continue;
+                }
+                sourceNormals[cnt / 3] = sourceNormals[i / 3];
+                result[cnt++] = v0;
+                result[cnt++] = v1;
+                result[cnt++] = v2;
+            }
+            result.resize(cnt);
+            sourceNormals.resize(cnt / 3);
+        }
+
+        memcpy(destination, result.data(), result.size() * sizeof(int32_t));
+        if (resultError)
+        {
+            *resultError = (float) std::sqrt(resultCost);
+        }
+        return result.size();
+    }
+
+    size_t MeshOptimizer::optimizeVertexFetch(void *vertexes, size_t vertexCnt, size_t vertexSize, int32_t *indices, size_t indexCnt)
+    {
+        if (!validIndices(indices, indexCnt, vertexCnt))
+        {
+            return vertexCnt;
+        }
+        std::vector<int32_t> remap(vertexCnt, -1);
+        int32_t nextIdx = 0;
+        for (size_t i = 0; i < indexCnt; i++)
+        {
+            int32_t &newIdx = remap[indices[i]];
+            if (newIdx < 0)
+            {
+                newIdx = nextIdx++;
+            }
+            indices[i] = newIdx;
+        }
+        auto *data = (uint8_t *) vertexes;
+        std::vector<uint8_t> reordered((size_t) nextIdx * vertexSize);
+        for (size_t v = 0; v < vertexCnt; v++)
+        {
+            if (remap[v] >= 0)
+            {
+                memcpy(&reordered[(size_t) remap[v] * vertexSize], data + v * vertexSize, vertexSize);
+            }
+        }
+        memcpy(data, reordered.data(), reordered.size());
+        return (size_t) nextIdx;
+    }
+
+    float MeshOptimizer::analyzeVertexCache(const int32_t *indices, size_t indexCnt, size_t vertexCnt, size_t cacheSize)
+    {
+        if (indexCnt < 3 || !validIndices(indices, indexCnt, vertexCnt))
+        {
+            return 0.f;
+        }
+        VertexCache cache(vertexCnt, cacheSize);
+        size_t misses = 0;
+        for (size_t i = 0; i < indexCnt; i++)
+        {
+            misses += cache.access(indices[i]);
+        }
+        return (float) misses / (float) (indexCnt / 3);
+    }
+
+    float MeshOptimizer::analyzeOverdraw(const int32_t *indices, size_t indexCnt, const float *positions, size_t vertexCnt, size_t stride)
+    {
+        if (indexCnt < 3 || !validIndices(indices, indexCnt, vertexCnt))
+        {
+            return 0.f;
+        }
+        // mesh bounds scaled to the viewport, aspect kept
+        glm::vec3 boundsMin(std::numeric_limits<float>::max());
+        glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+        for (size_t v = 0; v < vertexCnt; v++)
+        {
+            glm::vec3 p = getPosition(positions, stride, (int32_t) v);
+            boundsMin = glm::min(boundsMin, p);
+            boundsMax = glm::max(boundsMax, p);
+        }
+        glm::vec3 extent = boundsMax - boundsMin;
+        float scale = std::max(extent.x, std::max(extent.y, extent.z));
+        scale = scale > 0.f ? 1.f / scale : 0.f;
+
+        const int res = OVERDRAW_VIEWPORT;
+        std::vector<float> depth(res * res);
+        size_t shaded = 0;
+        size_t covered = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            int axisU = (axis + 1) % 3;
+            int axisV = (axis + 2) % 3;
+            for (int dir = 0; dir < 2; dir++)
+            {
+                std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+                for (size_t i = 0; i + 2 < indexCnt; i += 3)
+                {
+                    glm::vec3 p[3];
+                    for (int k = 0; k < 3; k++)
+                    {
+                        p[k] = (getPosition(positions, stride, indices[i + k]) - boundsMin) * scale;
+                    }
+                    // back faces culled, counter clockwise front faces
+                    float facing = glm::cross(p[1] - p[0], p[2] - p[0])[axis];
+                    if (dir == 0 ? facing >= 0.f : facing <= 0.f)
+                    {
+                        continue;
+                    }
+                    glm::vec3 pt[3];
+                    for (int k = 0; k < 3; k++)
+                    {
+                        pt[k] = glm::vec3(p[k][axisU] * (float) res, p[k][axisV] * (float) res, dir == 0 ? p[k][axis] : 1.f - p[k][axis]);
+                    }
+                    float area = (pt[1].x - pt[0].x) * (pt[2].y - pt[0].y) - (pt[2].x - pt[0].x) * (pt[1].y - pt[0].y);
+                    if (std::abs(area) < 1e-8f)
+                    {
+                        continue;
+                    }
+                    int minX = std::max(0, (int) std::floor(std::min(pt[0].x, std::min(pt[1].x, pt[2].x))));
+                    int maxX = std::min(res - 1, (int) std::ceil(std::max(pt[0].x, std::max(pt[1].x, pt[2].x))));
+                    int minY = std::max(0, (int) std::floor(std::min(pt[0].y, std::min(pt[1].y, pt[2].y))));
+                    int maxY = std::min(res - 1, (int) std::ceil(std::max(pt[0].y, std::max(pt[1].y, pt[2].y))));
+                    float invArea = 1.f / area;
+                    for (int y = minY; y <= maxY; y++)
+                    {
+                        for (int x = minX; x <= maxX; x++)
+                        {
+                            float px = (float) x + 0.5f;
+                            float py = (float) y + 0.5f;
+                            float w0 = ((pt[1].x - px) * (pt[2].y - py) - (pt[2].x - px) * (pt[1].y - py)) * invArea;
+                            float w1 = ((pt[2].x - px) * (pt[0].y - py) - (pt[0].x - px) * (pt[2].y - py)) * invArea;
+                            float w2 = 1.f - w0 - w1;
+                            if (w0 < 0.f || w1 < 0.f || w2 < 0.f)
+                            {
+                                continue;
+                            }
+                            float z = w0 * pt[0].z + w1 * pt[1].z + w2 * pt[2].z;
+                            float &d = depth[y * res + x];
+                            if (z < d)
+                            {
+                                d = z;
+                                shaded++;
+                            }
+                        }
+                    }
+                }
+                for (float d : depth)
+                {
+                    covered += d < std::numeric_limits<float>::max();
+                }
+            }
+        }
+        return covered > 0 ? (float) shaded / (float) covered : 0.f;
+    }
+}
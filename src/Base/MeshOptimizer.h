@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "GLMInc.h"
+
+namespace SoftGL
+{
+    #define MESH_VERTEX_CACHE_SIZE 16
+    #define MESHLET_MAX_VERTEXES 64
+    #define MESHLET_MAX_TRIANGLES 124
+
+    // triangle cluster of a mesh, its triangles are contiguous in the index buffer
+    struct Meshlet
+    {
+        uint32_t indexOffset = 0;
+        uint32_t indexCnt = 0;
+        // bounding sphere
+        glm::vec3 center{0.f};
+        float radius = 0.f;
+        // normal cone: all triangles are back facing to a view point p if dot(normalize(coneApex - p), coneAxis) >= coneCutoff,
+        // coneCutoff >= 1 if the normals spread too wide to cull
+        glm::vec3 coneApex{0.f};
+        glm::vec3 coneAxis{0.f};
+        float coneCutoff = 1.f;
+    };
+
+    // triangle list reordering for the post-transform vertex cache, early depth rejection and vertex fetch,
+    // clustering for culling.
+    // positions are 3 floats read with the given byte stride
+    class MeshOptimizer
+    {
+    public:
+        // Tipsify (Sander et al. 2007) triangle order, then its cache clusters are split where the cache cost
+        // allows and sorted so triangles facing away from the mesh center are drawn first.
+        // threshold is the allowed ACMR increase from the extra splits
+        static void optimizeTriangleOrder(int32_t *indices, size_t indexCnt, const float *positions, size_t vertexCnt, size_t stride,
+                                          float threshold = 1.05f);
+
+        // triangles regrouped into meshlets of spatially adjacent triangles, up to MESHLET_MAX_VERTEXES distinct positions and
+        // MESHLET_MAX_TRIANGLES triangles each. triangle order inside a meshlet is kept, counter clockwise front faces
+        static void buildMeshlets(int32_t *indices, size_t indexCnt, const float *positions, size_t vertexCnt, size_t stride,
+                                  std::vector<Meshlet> &meshlets);
+
+        // quadric error metric (Garland & Heckbert 1997) edge collapses onto existing vertexes, so every level shares the
+        // vertex buffer. attribute seams collapse only along the seam, open borders only along the border. stops at
+        // targetIndexCnt or before a collapse moves the surface further than targetError. writes up to indexCnt indices to
+        // destination and returns the simplified index count, resultError is the largest collapse distance
+        static size_t simplify(int32_t *destination, const int32_t *indices, size_t indexCnt, const float *positions, size_t vertexCnt,
+                               size_t stride, size_t targetIndexCnt, float targetError, float *resultError = nullptr);
+
+        // vertexes sorted by first use, unused vertexes are dropped. returns the new vertex count
+        static size_t optimizeVertexFetch(void *vertexes, size_t vertexCnt, size_t vertexSize, int32_t *indices, size_t indexCnt);
+
+        // average cache miss ratio, transformed vertexes per triangle with a FIFO cache
+        static float analyzeVertexCache(const int32_t *indices, size_t indexCnt, size_t vertexCnt, size_t cacheSize = MESH_VERTEX_CACHE_SIZE);
+
+        // shaded / covered pixels with depth test, from 6 axis aligned views of the mesh bounds, back faces culled
+        static float analyzeOverdraw(const int32_t *indices, size_t indexCnt, const float *positions, size_t vertexCnt, size_t stride);
+    };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <iostream>
 #include <memory>
@@ -25,6 +26,44 @@ namespace SoftGL
             joinThreads();
         }
 
+        // process wide pool, the software renderer and texture filtering share its threads
+        static ThreadPool &shared()
+        {
+            static ThreadPool pool;
+            return pool;
+        }
+
+        // tasks of one submission on a shared pool, the caller blocks until only these are done
+        class TaskGroup
+        {
+        public:
+            inline void add()
+            {
+                const std::lock_guard<std::mutex> lock(mutex_);
+                pending_++;
+            }
+
+            inline void done()
+            {
+                const std::lock_guard<std::mutex> lock(mutex_);
+                if (--pending_ == 0)
+                {
+                    cond_.notify_all();
+                }
+            }
+
+            void wait()
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this] { return pending_ == 0; });
+            }
+
+        private:
+            std::mutex mutex_;
+            std::condition_variable cond_;
+            size_t pending_ = 0;
+        };
+
         inline size_t getThreadCnt() const
         {
             return threadCnt_;
@@ -40,6 +79,17 @@ namespace SoftGL
             }
         }
 
+        template<typename F>
+        void pushTask(TaskGroup &group, const F &task)
+        {
+            group.add();
+            pushTask([&group, task](size_t threadId)
+                     {
+                         task(threadId);
+                         group.done();
+                     });
+        }
+
         template<typename F, typename... A>
         void pushTask(const F &task, const A &...args)
         {
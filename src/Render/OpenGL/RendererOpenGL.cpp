@@ -132,7 +132,71 @@ namespace SoftGL
     void RendererOpenGL::draw()
     {
         GLenum mode = OpenGL::cvtDrawMode(pipelineStates_->renderStates.primitiveType);
-        GL_CHECK(glDrawElements(mode, (GLsizei) vao_->getIndicesCnt(), GL_UNSIGNED_INT, nullptr));
+        GL_CHECK(glDrawElements(mode, (GLsizei) vao_->getIndicesCnt(), vao_->getIndexType(), nullptr));
+    }
+
+    void RendererOpenGL::drawRanges(const std::vector<DrawRange> &ranges)
+    {
+        std::vector<GLsizei> counts;
+        std::vector<const void *> offsets;
+        counts.reserve(ranges.size());
+        offsets.reserve(ranges.size());
+        for (auto &range : ranges)
+        {
+            if (range.count == 0 || range.first + range.count > vao_->getIndicesCnt())
+            {
+                continue;
+            }
+            counts.push_back((GLsizei) range.count);
+            offsets.push_back((const void *) (range.first * vao_->getIndexSize()));
+        }
+        if (counts.empty())
+        {
+            return;
+        }
+        GLenum mode = OpenGL::cvtDrawMode(pipelineStates_->renderStates.primitiveType);
+        GL_CHECK(glMultiDrawElements(mode, counts.data(), vao_->getIndexType(), offsets.data(), (GLsizei) counts.size()));
+    }
+
+    void RendererOpenGL::drawInstanced(size_t instanceCnt)
+    {
+        if (instanceCnt == 0)
+        {
+            return;
+        }
+        GLenum mode = OpenGL::cvtDrawMode(pipelineStates_->renderStates.primitiveType);
+        GL_CHECK(glDrawElementsInstanced(mode, (GLsizei) vao_->getIndicesCnt(), vao_->getIndexType(), nullptr, (GLsizei) instanceCnt));
+    }
+
+    void RendererOpenGL::drawMulti(const std::vector<DrawCommand> &commands, const UniformTable &uniforms)
+    {
+        GLenum mode = OpenGL::cvtDrawMode(pipelineStates_->renderStates.primitiveType);
+        for (auto &command : commands)
+        {
+            auto *vao = dynamic_cast<VertexArrayObjectOpenGL *>(command.vao);
+            if (!vao || command.count == 0 || command.first + command.count > vao->getIndicesCnt())
+            {
+                continue;
+            }
+            // uniform blocks stay bound to the program, only their data changes per draw
+            size_t recordOffset = command.uniformOffset;
+            for (auto &block : uniforms.blocks)
+            {
+                if (recordOffset + block->getSize() > uniforms.data.size())
+                {
+                    break;
+                }
+                block->setData((void *) (uniforms.data.data() + recordOffset), block->getSize());
+                recordOffset += block->getSize();
+            }
+            vao->bind();
+            GL_CHECK(glDrawElements(mode, (GLsizei) command.count, vao->getIndexType(),
+                                    (const void *) (command.first * vao->getIndexSize())));
+        }
+        if (vao_)
+        {
+            vao_->bind();
+        }
     }
 
     void RendererOpenGL::endRenderPass()
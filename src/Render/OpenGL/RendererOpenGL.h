@@ -31,6 +31,9 @@ namespace SoftGL
         void setShaderResources(std::shared_ptr<ShaderResources> &resources) override;
         void setPipelineStates(std::shared_ptr<PipelineStates> &states) override;
         void draw() override;
+        void drawRanges(const std::vector<DrawRange> &ranges) override;
+        void drawInstanced(size_t instanceCnt) override;
+        void drawMulti(const std::vector<DrawCommand> &commands, const UniformTable &uniforms) override;
         void endRenderPass() override;
         void waitIdle() override;
 
@@ -30,6 +30,13 @@ namespace SoftGL
                     ret.type = GL_UNSIGNED_BYTE;
                     break;
                 }
+                case TextureFormat_RGBA8_SRGB:
+                {
+                    ret.internalformat = GL_SRGB8_ALPHA8;
+                    ret.format = GL_RGBA;
+                    ret.type = GL_UNSIGNED_BYTE;
+                    break;
+                }
                 case TextureFormat_FLOAT32:
                 {
                     ret.internalformat = GL_DEPTH_COMPONENT;
@@ -37,6 +44,36 @@ namespace SoftGL
                     ret.type = GL_FLOAT;
                     break;
                 }
+                case TextureFormat_RGBA16F:
+                {
+                    ret.internalformat = GL_RGBA16F;
+                    ret.format = GL_RGBA;
+                    ret.type = GL_FLOAT;
+                    break;
+                }
+                case TextureFormat_R11G11B10F:
+                {
+                    // glm::vec3 is 16 bytes aligned, uploaded as RGBA
+                    ret.internalformat = GL_R11F_G11F_B10F;
+                    ret.format = GL_RGBA;
+                    ret.type = GL_FLOAT;
+                    break;
+                }
+                case TextureFormat_R16:
+                {
+                    ret.internalformat = GL_R16;
+                    ret.format = GL_RED;
+                    ret.type = GL_FLOAT;
+                    break;
+                }
+                case TextureFormat_D16:
+                {
+                    ret.internalformat = GL_DEPTH_COMPONENT16;
+                    ret.format = GL_DEPTH_COMPONENT;
+                    ret.type = GL_FLOAT;
+                    break;
+                }
+                default: break;
             }
             return ret;
         }
@@ -49,7 +86,7 @@ namespace SoftGL
             GL_CHECK(glGenFramebuffers(1, &fbo));
             GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
 
-            GLenum attachment = format == TextureFormat_FLOAT32 ? GL_DEPTH_ATTACHMENT : GL_COLOR_ATTACHMENT0;
+            GLenum attachment = isDepthFormat() ? GL_DEPTH_ATTACHMENT : GL_COLOR_ATTACHMENT0;
             GLenum target = multiSample ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
             if (type == TextureType_CUBE)
             {
@@ -60,14 +97,17 @@ namespace SoftGL
             auto levelWidth = (int32_t)getLevelWidth(level);
             auto levelHeight = (int32_t)getLevelHeight(level);
 
+            // color formats are read back as RGBA8, depth as float
+            GLenum readFormat = isDepthFormat() ? GL_DEPTH_COMPONENT : GL_RGBA;
+            GLenum readType = isDepthFormat() ? GL_FLOAT : GL_UNSIGNED_BYTE;
             auto *pixels = new uint8_t[levelWidth * levelHeight * 4];
-            GL_CHECK(glReadPixels(0, 0, levelWidth, levelHeight, glDesc_.format, glDesc_.type, pixels));
+            GL_CHECK(glReadPixels(0, 0, levelWidth, levelHeight, readFormat, readType, pixels));
 
             GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
             GL_CHECK(glDeleteFramebuffers(1, &fbo));
 
             // convert float to rgba
-            if (format == TextureFormat_FLOAT32)
+            if (isDepthFormat())
             {
                 ImageUtils::convertFloatImage(reinterpret_cast<RGBA *>(pixels), reinterpret_cast<float *>(pixels), levelWidth, levelHeight);
             }
@@ -120,6 +160,45 @@ namespace SoftGL
         }
 
         void setImageData(const std::vector<std::shared_ptr<Buffer<RGBA>>> &buffers) override
+        {
+            setImageDataInternal(buffers, format == TextureFormat_RGBA8 || isSrgb());
+        }
+
+        void setImageData(const std::vector<std::shared_ptr<Buffer<float>>> &buffers) override
+        {
+            setImageDataInternal(buffers, isDepthFormat() || format == TextureFormat_R16);
+        }
+
+        void setImageData(const std::vector<std::shared_ptr<Buffer<glm::vec4>>> &buffers) override
+        {
+            setImageDataInternal(buffers, format == TextureFormat_RGBA16F);
+        }
+
+        void setImageData(const std::vector<std::shared_ptr<Buffer<glm::vec3>>> &buffers) override
+        {
+            setImageDataInternal(buffers, format == TextureFormat_R11G11B10F);
+        }
+
+        void initImageData() override
+        {
+            GL_CHECK(glBindTexture(target_, texId_));
+            if (multiSample)
+            {
+                GL_CHECK(glTexImage2DMultisample(target_, 4, glDesc_.internalformat, width, height, GL_TRUE));
+            }
+            else
+            {
+                GL_CHECK(glTexImage2D(target_, 0, glDesc_.internalformat, width, height, 0, glDesc_.format, glDesc_.type, nullptr));
+                if (useMipmaps)
+                {
+                    GL_CHECK(glGenerateMipmap(target_));
+                }
+            }
+        }
+
+    private:
+        template<typename T>
+        void setImageDataInternal(const std::vector<std::shared_ptr<Buffer<T>>> &buffers, bool formatMatch)
         {
             if (multiSample)
             {
@@ -127,7 +206,7 @@ namespace SoftGL
                 return;
             }
 
-            if (format != TextureFormat_RGBA8)
+            if (!formatMatch)
             {
                 LOGE("setImageData error: format not match");
                 return;
@@ -148,24 +227,6 @@ namespace SoftGL
             }
         }
 
-        void initImageData() override
-        {
-            GL_CHECK(glBindTexture(target_, texId_));
-            if (multiSample)
-            {
-                GL_CHECK(glTexImage2DMultisample(target_, 4, glDesc_.internalformat, width, height, GL_TRUE));
-            }
-            else
-            {
-                GL_CHECK(glTexImage2D(target_, 0, glDesc_.internalformat, width, height, 0, glDesc_.format, glDesc_.type, nullptr));
-                if (useMipmaps)
-                {
-                    GL_CHECK(glGenerateMipmap(target_));
-                }
-            }
-        }
-
-    private:
         GLenum target_;
     };
 
@@ -211,24 +272,25 @@ namespace SoftGL
 
         void setImageData(const std::vector<std::shared_ptr<Buffer<RGBA>>> &buffers) override
         {
-            if (multiSample) return;
+            setImageDataInternal(buffers, format == TextureFormat_RGBA8 || isSrgb());
+        }
 
-            if (format != TextureFormat_RGBA8)
-            {
-                LOGE("setImageData error: format not match");
-                return;
-            }
+        void setImageData(const std::vector<std::shared_ptr<Buffer<glm::vec4>>> &buffers) override
+        {
+            setImageDataInternal(buffers, format == TextureFormat_RGBA16F);
+        }
 
-            if (width != buffers[0]->getWidth() || height != buffers[0]->getHeight())
-            {
-                LOGE("setImageData error: size not match");
-                return;
-            }
+        void setImageData(const std::vector<std::shared_ptr<Buffer<glm::vec3>>> &buffers) override
+        {
+            setImageDataInternal(buffers, format == TextureFormat_R11G11B10F);
+        }
 
+        void initImageData() override
+        {
             GL_CHECK(glBindTexture(GL_TEXTURE_CUBE_MAP, texId_));
             for (int i = 0; i < 6; i++)
             {
-                GL_CHECK(glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, glDesc_.internalformat, width, height, 0, glDesc_.format, glDesc_.type, buffers[i]->getRawDataPtr()));
+                GL_CHECK(glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, glDesc_.internalformat, width, height, 0, glDesc_.format, glDesc_.type, nullptr));
             }
             if (useMipmaps)
             {
@@ -236,12 +298,28 @@ namespace SoftGL
             }
         }
 
-        void initImageData() override
+    private:
+        template<typename T>
+        void setImageDataInternal(const std::vector<std::shared_ptr<Buffer<T>>> &buffers, bool formatMatch)
         {
+            if (multiSample) return;
+
+            if (!formatMatch)
+            {
+                LOGE("setImageData error: format not match");
+                return;
+            }
+
+            if (width != buffers[0]->getWidth() || height != buffers[0]->getHeight())
+            {
+                LOGE("setImageData error: size not match");
+                return;
+            }
+
             GL_CHECK(glBindTexture(GL_TEXTURE_CUBE_MAP, texId_));
             for (int i = 0; i < 6; i++)
             {
-                GL_CHECK(glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, glDesc_.internalformat, width, height, 0, glDesc_.format, glDesc_.type, nullptr));
+                GL_CHECK(glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, glDesc_.internalformat, width, height, 0, glDesc_.format, glDesc_.type, buffers[i]->getRawDataPtr()));
             }
             if (useMipmaps)
             {
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <glad/glad.h>
-#include "Render/Vertex.h"
+#include "Render/VertexCodec.h"
 #include "Render/OpenGL/OpenGLUtils.h"
 
 namespace SoftGL
@@ -12,20 +12,42 @@ namespace SoftGL
         explicit VertexArrayObjectOpenGL(const VertexArray &vertexArray)
         {
             if (!vertexArray.vertexesBuffer || !vertexArray.indexBuffer) return;
-            indicesCnt_ = vertexArray.indexBufferLength / sizeof(int32_t);
+            indicesCnt_ = vertexArray.indexCnt();
+            indexSize_ = VertexArray::indexSize(vertexArray.indexType);
+            indexType_ = vertexArray.indexType == IndexType_UINT16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
             // vao
             GL_CHECK(glGenVertexArrays(1, &vao_));
             GL_CHECK(glBindVertexArray(vao_));
             // vbo
             GL_CHECK(glGenBuffers(1, &vbo_));
             GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vbo_));
-            GL_CHECK(glBufferData(GL_ARRAY_BUFFER, vertexArray.vertexesBufferLength, vertexArray.vertexesBuffer, GL_STATIC_DRAW));
-            for (int i = 0; i < vertexArray.vertexesDesc.size(); i++)
+            // packed vertexes are decoded on upload, the shaders read float attributes
+            codec_ = VertexCodec(vertexArray);
+            vboSize_ = codec_.packed() ? vertexArray.vertexesBufferLength / codec_.vertexSize() * codec_.decodedVertexSize()
+                                       : vertexArray.vertexesBufferLength;
+            GL_CHECK(glBufferData(GL_ARRAY_BUFFER, vboSize_, nullptr, GL_STATIC_DRAW));
+            updateVertexData(vertexArray.vertexesBuffer, vertexArray.vertexesBufferLength, 0);
+            auto vertexesDesc = codec_.packed() ? codec_.decodedDesc() : vertexArray.vertexesDesc;
+            for (int i = 0; i < vertexesDesc.size(); i++)
             {
-                auto &desc = vertexArray.vertexesDesc[i];
+                auto &desc = vertexesDesc[i];
                 GL_CHECK(glVertexAttribPointer(i, desc.size, GL_FLOAT, GL_FALSE, desc.stride, (void *)desc.offset));
                 GL_CHECK(glEnableVertexAttribArray(i));
             }
+            // instance vbo, its attributes follow the vertex attributes and advance once per instance
+            if (!vertexArray.instanceDesc.empty())
+            {
+                GL_CHECK(glGenBuffers(1, &instanceVbo_));
+                updateInstanceData(vertexArray.instanceBuffer, vertexArray.instanceBufferLength);
+                for (size_t i = 0; i < vertexArray.instanceDesc.size(); i++)
+                {
+                    auto &desc = vertexArray.instanceDesc[i];
+                    GLuint location = (GLuint) (vertexesDesc.size() + i);
+                    GL_CHECK(glVertexAttribPointer(location, desc.size, GL_FLOAT, GL_FALSE, desc.stride, (void *)desc.offset));
+                    GL_CHECK(glEnableVertexAttribArray(location));
+                    GL_CHECK(glVertexAttribDivisor(location, 1));
+                }
+            }
             // ebo
             GL_CHECK(glGenBuffers(1, &ebo_));
             GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_));
@@ -42,16 +64,54 @@ namespace SoftGL
             {
                 GL_CHECK(glDeleteBuffers(1, &ebo_));
             }
+            if (instanceVbo_)
+            {
+                GL_CHECK(glDeleteBuffers(1, &instanceVbo_));
+            }
             if (vao_)
             {
                 GL_CHECK(glDeleteVertexArrays(1, &vao_));
             }
         }
 
-        void updateVertexData(void *data, size_t length) override
+        void updateVertexData(void *data, size_t length, size_t offset) override
         {
             GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vbo_));
-            GL_CHECK(glBufferData(GL_ARRAY_BUFFER, length, data, GL_STATIC_DRAW));
+            if (codec_.packed())
+            {
+                size_t vertexCnt = length / codec_.vertexSize();
+                offset = offset / codec_.vertexSize() * codec_.decodedVertexSize();
+                std::vector<uint8_t> decoded(vertexCnt * codec_.decodedVertexSize());
+                codec_.decode((const uint8_t *) data, vertexCnt, decoded.data());
+                if (offset + decoded.size() <= vboSize_)
+                {
+                    GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, offset, decoded.size(), decoded.data()));
+                }
+                return;
+            }
+            if (offset + length <= vboSize_)
+            {
+                GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, offset, length, data));
+            }
+        }
+
+        void updateInstanceData(void *data, size_t length) override
+        {
+            if (!instanceVbo_)
+            {
+                return;
+            }
+            GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, instanceVbo_));
+            if (length > instanceVboSize_ || instanceVboSize_ == 0)
+            {
+                instanceVboSize_ = std::max(length, (size_t) 1);
+                GL_CHECK(glBufferData(GL_ARRAY_BUFFER, instanceVboSize_, data, GL_DYNAMIC_DRAW));
+                return;
+            }
+            if (data && length > 0)
+            {
+                GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, 0, length, data));
+            }
         }
 
         int getId() const override
@@ -72,10 +132,26 @@ namespace SoftGL
             return indicesCnt_;
         }
 
+        inline size_t getIndexSize() const
+        {
+            return indexSize_;
+        }
+
+        inline GLenum getIndexType() const
+        {
+            return indexType_;
+        }
+
     private:
         GLuint vao_ = 0;
         GLuint vbo_ = 0;
         GLuint ebo_ = 0;
+        size_t vboSize_ = 0;
+        GLuint instanceVbo_ = 0;
+        size_t instanceVboSize_ = 0;
         size_t indicesCnt_ = 0;
+        size_t indexSize_ = sizeof(uint32_t);
+        GLenum indexType_ = GL_UNSIGNED_INT;
+        VertexCodec codec_;
     };
 }
\ No newline at end of file
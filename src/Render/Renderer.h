@@ -16,6 +16,31 @@ namespace SoftGL
         Renderer_Vulkan,
     };
 
+    // index range of the bound vertex array object
+    struct DrawRange
+    {
+        size_t first;
+        size_t count;
+    };
+
+    // one draw of a multi draw: index range of a vertex array object, kept alive by the caller,
+    // and the offset of its uniform block data in the uniform table
+    struct DrawCommand
+    {
+        VertexArrayObject *vao;
+        size_t first;
+        size_t count;
+        size_t uniformOffset;
+    };
+
+    // per draw uniform block data of a multi draw, a draw record holds the data of each block
+    // back to back, getSize() bytes each
+    struct UniformTable
+    {
+        std::vector<std::shared_ptr<UniformBlock>> blocks;
+        std::vector<uint8_t> data;
+    };
+
     class Renderer
     {
     public:
@@ -50,6 +75,13 @@ namespace SoftGL
         virtual void setShaderResources(std::shared_ptr<ShaderResources> &uniforms) = 0;
         virtual void setPipelineStates(std::shared_ptr<PipelineStates> &states) = 0;
         virtual void draw() = 0;
+        // index ranges drawn as one batch, vertexes not referenced by the ranges may be skipped
+        virtual void drawRanges(const std::vector<DrawRange> &ranges) = 0;
+        // whole index buffer drawn for each instance, with the per instance attributes of the vertex array object
+        virtual void drawInstanced(size_t instanceCnt) = 0;
+        // draws sharing the shader program, resources & pipeline states, each with its own vertex array object range and
+        // uniform blocks from the table. the bound vertex array object is not used
+        virtual void drawMulti(const std::vector<DrawCommand> &commands, const UniformTable &uniforms) = 0;
         virtual void endRenderPass() = 0;
         virtual void waitIdle() = 0;
     };
@@ -27,10 +27,21 @@ namespace SoftGL
             {
                 return nullptr;
             }
+            // only RGBA8 color attachments are rendered to
             auto *colorTex = dynamic_cast<TextureSoft<RGBA> *>(colorAttachment_.tex.get());
+            if (!colorTex)
+            {
+                return nullptr;
+            }
             return colorTex->getImage(colorAttachment_.layer).getBuffer(colorAttachment_.level);
         }
 
+        // color attachment stores sRGB encoded color, blending is done in linear space
+        bool isColorSrgb() const
+        {
+            return colorReady_ && colorAttachment_.tex && colorAttachment_.tex->isSrgb();
+        }
+
         std::shared_ptr<ImageBufferSoft<float>> getDepthBuffer() const
         {
             if (!depthReady_)
@@ -38,6 +49,10 @@ namespace SoftGL
                 return nullptr;
             }
             auto *depthTex = dynamic_cast<TextureSoft<float> *>(depthAttachment_.tex.get());
+            if (!depthTex)
+            {
+                return nullptr;
+            }
             return depthTex->getImage(depthAttachment_.layer).getBuffer(depthAttachment_.level);
         }
 
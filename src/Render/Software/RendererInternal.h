@@ -1,10 +1,15 @@
 #pragma once
 
+#include <vector>
+#include <algorithm>
+#include "Base/Buffer.h"
 #include "Base/MemoryUtils.h"
 #include "Render/Software/ShaderProgramSoft.h"
 
 namespace SoftGL
 {
+    class VertexArrayObjectSoft;
+
     struct Viewport
     {
         int x = 0;
@@ -22,27 +27,288 @@ namespace SoftGL
         float absMaxDepth;
     };
 
-    struct VertexHolder
+    enum PrimitiveFlag
+    {
+        PrimitiveFlag_Discard = 1 << 0,
+        PrimitiveFlag_FrontFacing = 1 << 1,
+    };
+
+    // vertexes and primitives of one draw in the pipeline: an instance of an instanced draw or a draw of a multi draw.
+    // its vertexes start at vertexBase in the vertex streams
+    struct DrawUnit
     {
-        bool discard = false;
-        size_t index = 0;
-        
-        void *vertex = nullptr;
-        float *varyings = nullptr;
-
-        int clipMask = 0;
-        glm::aligned_vec4 clipPos = glm::vec4(0.0f);    // clip space position
-        glm::aligned_vec4 fragPos = glm::vec4(0.0f);    // screen space position
-
-        std::shared_ptr<uint8_t> vertexHolder = nullptr;
-        std::shared_ptr<float> varyingsHolder = nullptr;
+        VertexArrayObjectSoft *vao;
+        size_t instance;
+        size_t vertexBase;
+        size_t rangeBegin;      // draw ranges [rangeBegin, rangeEnd)
+        size_t rangeEnd;
+        size_t uniformOffset;   // uniform table record of a multi draw
     };
 
-    struct PrimitiveHolder
+    // post-transform vertex data, stored as SoA streams indexed by vertex index
+    class VertexStreams
     {
-        bool discard = false;
-        bool frontFacing = true;
-        size_t indices[3] = {0, 0, 0};
+    public:
+        void Resize(size_t cnt)
+        {
+            clipX.resize(cnt);
+            clipY.resize(cnt);
+            clipZ.resize(cnt);
+            clipW.resize(cnt);
+            fragX.resize(cnt);
+            fragY.resize(cnt);
+            fragZ.resize(cnt);
+            fragW.resize(cnt);
+            clipMask.resize(cnt);
+            vertex.resize(cnt);
+            varyings.resize(cnt);
+        }
+
+        void Reserve(size_t cnt)
+        {
+            clipX.reserve(cnt);
+            clipY.reserve(cnt);
+            clipZ.reserve(cnt);
+            clipW.reserve(cnt);
+            fragX.reserve(cnt);
+            fragY.reserve(cnt);
+            fragZ.reserve(cnt);
+            fragW.reserve(cnt);
+            clipMask.reserve(cnt);
+            vertex.reserve(cnt);
+            varyings.reserve(cnt);
+        }
+
+        // note: invalidates stream pointers
+        inline size_t Append()
+        {
+            size_t idx = Size();
+            if (idx == clipX.capacity())
+            {
+                // clip vertexes come one at a time, grow all streams together geometrically
+                Reserve(std::max<size_t>(idx * 2, 64));
+            }
+            Resize(idx + 1);
+            return idx;
+        }
+
+        inline size_t Size() const
+        {
+            return clipX.size();
+        }
+
+        inline glm::vec4 GetClipPos(size_t idx) const
+        {
+            return {clipX[idx], clipY[idx], clipZ[idx], clipW[idx]};
+        }
+
+        inline void SetClipPos(size_t idx, const glm::vec4 &pos)
+        {
+            clipX[idx] = pos.x;
+            clipY[idx] = pos.y;
+            clipZ[idx] = pos.z;
+            clipW[idx] = pos.w;
+        }
+
+        inline glm::aligned_vec4 GetFragPos(size_t idx) const
+        {
+            return {fragX[idx], fragY[idx], fragZ[idx], fragW[idx]};
+        }
+
+    public:
+        std::vector<float> clipX, clipY, clipZ, clipW;  // clip space position
+        std::vector<float> fragX, fragY, fragZ, fragW;  // screen space position, fragW = 1 / clipW
+        std::vector<uint8_t> clipMask;                  // FrustumClipMask bits
+        std::vector<void *> vertex;                     // vertex attributes
+        std::vector<float *> varyings;                  // vertex shader varyings
+    };
+
+    // primitives as packed index triples (point/line use the first 1/2 indices), flags in separate stream
+    class PrimitiveStreams
+    {
+    public:
+        void Resize(size_t cnt)
+        {
+            indices.resize(cnt * 3);
+            flags.resize(cnt);
+            draws.resize(cnt);
+        }
+
+        // note: invalidates stream pointers
+        inline size_t Append(uint32_t idx0, uint32_t idx1, uint32_t idx2, uint8_t flag, uint32_t draw)
+        {
+            indices.push_back(idx0);
+            indices.push_back(idx1);
+            indices.push_back(idx2);
+            flags.push_back(flag);
+            draws.push_back(draw);
+            return flags.size() - 1;
+        }
+
+        inline size_t Size() const
+        {
+            return flags.size();
+        }
+
+        inline uint32_t *GetIndices(size_t idx)
+        {
+            return &indices[idx * 3];
+        }
+
+        inline bool IsDiscard(size_t idx) const
+        {
+            return flags[idx] & PrimitiveFlag_Discard;
+        }
+
+        inline bool IsFrontFacing(size_t idx) const
+        {
+            return flags[idx] & PrimitiveFlag_FrontFacing;
+        }
+
+        inline void SetDiscard(size_t idx)
+        {
+            flags[idx] |= PrimitiveFlag_Discard;
+        }
+
+        inline void SetFrontFacing(size_t idx, bool frontFacing)
+        {
+            flags[idx] = frontFacing ? (flags[idx] | PrimitiveFlag_FrontFacing) : (flags[idx] & ~PrimitiveFlag_FrontFacing);
+        }
+
+    public:
+        std::vector<uint32_t> indices;
+        std::vector<uint8_t> flags;     // PrimitiveFlag bits
+        std::vector<uint32_t> draws;    // draw unit of the primitive
+    };
+
+    /**
+     * Tile-resident framebuffer storage: color/depth samples of one screen tile live in
+     * thread local memory while the tile's primitives are rasterized, then flushed once.
+     * Samples of a pixel are stored contiguously, same as Buffer<glm::tvec4<T>>.
+     */
+    class RasterTile
+    {
+    public:
+        void Init(int tileSize, int colorSamples, int depthSamples)
+        {
+            size_t pixelCnt = tileSize * tileSize;
+            if (size != tileSize || colorSampleCnt != colorSamples || depthSampleCnt != depthSamples)
+            {
+                colorPool_ = MemoryUtils::makeAlignedBuffer<RGBA>(pixelCnt * colorSamples);
+                depthPool_ = MemoryUtils::makeAlignedBuffer<float>(pixelCnt * depthSamples);
+                resolvePool_ = colorSamples > 1 ? MemoryUtils::makeAlignedBuffer<RGBA>(pixelCnt) : nullptr;
+            }
+            size = tileSize;
+            colorSampleCnt = colorSamples;
+            depthSampleCnt = depthSamples;
+        }
+
+        void SetRegion(int x, int y, int w, int h)
+        {
+            originX = x;
+            originY = y;
+            width = w;
+            height = h;
+            colorDirty = false;
+            depthDirty = false;
+        }
+
+        inline bool Contains(int x, int y) const
+        {
+            return x >= originX && y >= originY && x < originX + width && y < originY + height;
+        }
+
+        inline RGBA *GetColor(int x, int y, int sample)
+        {
+            if (!Contains(x, y)) { return nullptr; }
+            return colorPool_.get() + ((y - originY) * size + (x - originX)) * colorSampleCnt + sample;
+        }
+
+        inline float *GetDepth(int x, int y, int sample)
+        {
+            if (!Contains(x, y)) { return nullptr; }
+            return depthPool_.get() + ((y - originY) * size + (x - originX)) * depthSampleCnt + sample;
+        }
+
+        inline RGBA *GetColorPtr() { return colorPool_.get(); }
+        inline float *GetDepthPtr() { return depthPool_.get(); }
+        inline RGBA *GetResolvePtr() { return resolvePool_.get(); }
+
+        // tiles untouched since fast clear are loaded from the clear tag, framebuffer memory is not read
+        template<typename T>
+        void LoadBuffer(Buffer<T> *buffer, T *dst) const
+        {
+            LoadBuffer(buffer, dst, [](const T &v) -> T { return v; });
+        }
+
+        // packed attachments are converted per texel
+        template<typename S, typename T, typename F>
+        void LoadBuffer(Buffer<S> *buffer, T *dst, F cvt) const
+        {
+            int clearSize = (int) Buffer<S>::getClearTileSize();
+            for (int cy = originY; cy < originY + height; cy += clearSize)
+            {
+                for (int cx = originX; cx < originX + width; cx += clearSize)
+                {
+                    bool cleared = buffer->isTileCleared(cx / clearSize, cy / clearSize);
+                    int xEnd = std::min(cx + clearSize, originX + width);
+                    int yEnd = std::min(cy + clearSize, originY + height);
+                    for (int y = cy; y < yEnd; y++)
+                    {
+                        T *row = dst + (y - originY) * size;
+                        for (int x = cx; x < xEnd; x++)
+                        {
+                            row[x - originX] = cvt(cleared ? buffer->getClearValue() : *buffer->get(x, y));
+                        }
+                    }
+                }
+            }
+        }
+
+        // tile region is aligned to clear tiles, so clear tags are dropped without writing clear value
+        template<typename T>
+        void StoreBuffer(Buffer<T> *buffer, const T *src) const
+        {
+            StoreBuffer(buffer, src, [](const T &v) -> T { return v; });
+        }
+
+        template<typename S, typename T, typename F>
+        void StoreBuffer(Buffer<S> *buffer, const T *src, F cvt) const
+        {
+            int clearSize = (int) Buffer<S>::getClearTileSize();
+            for (int cy = originY; cy < originY + height; cy += clearSize)
+            {
+                for (int cx = originX; cx < originX + width; cx += clearSize)
+                {
+                    buffer->discardTileClear(cx / clearSize, cy / clearSize);
+                }
+            }
+            S *ptr = buffer->getRawDataPtr();
+            for (int y = originY; y < originY + height; y++)
+            {
+                const T *row = src + (y - originY) * size;
+                for (int x = originX; x < originX + width; x++)
+                {
+                    ptr[buffer->convertIndex(x, y)] = cvt(row[x - originX]);
+                }
+            }
+        }
+
+    public:
+        int originX = 0;
+        int originY = 0;
+        int width = 0;
+        int height = 0;
+        int size = 0;
+        int colorSampleCnt = 0;
+        int depthSampleCnt = 0;
+        bool colorDirty = false;
+        bool depthDirty = false;
+
+    private:
+        std::shared_ptr<RGBA> colorPool_ = nullptr;
+        std::shared_ptr<float> depthPool_ = nullptr;
+        std::shared_ptr<RGBA> resolvePool_ = nullptr;
     };
 
     class SampleContext
@@ -154,16 +420,14 @@ namespace SoftGL
     class PixelQuadContext
     {
     public:
-        void SetVrayingsSize(size_t size)
+        // varyings of the 4 pixels come from the raster thread's arena, valid until it resets
+        void SetVrayingsSize(size_t size, MemoryArena &arena)
         {
-            if (varyingsAlignedCnt_ != size)
+            varyingsAlignedCnt_ = size;
+            float *varyingPool = arena.alloc<float>(size * 4);
+            for (int i = 0; i < 4; i++)
             {
-                varyingsAlignedCnt_ = size;
-                varyingPool_ = MemoryUtils::makeAlignedBuffer<float>(size * 4);
-                for (int i = 0; i < 4; i++)
-                {
-                    pixels[i].varyingsFrag = varyingPool_.get() + i * varyingsAlignedCnt_;
-                }
+                pixels[i].varyingsFrag = varyingPool + i * varyingsAlignedCnt_;
             }
         }
 
@@ -199,9 +463,10 @@ namespace SoftGL
           bool frontFacing = true;
           // shader program
           std::shared_ptr<ShaderProgramSoft> shaderProgram = nullptr;
+          // tile-resident framebuffer storage
+          RasterTile *tile = nullptr;
 
     private:
         size_t varyingsAlignedCnt_ = 0;
-        std::shared_ptr<float> varyingPool_ = nullptr;
     };
 }
\ No newline at end of file
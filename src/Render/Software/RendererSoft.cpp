@@ -13,6 +13,8 @@ namespace SoftGL
 {
 
 #define RASTER_MULTI_THREAD
+#define CLIP_MAX_VERTEXES 9
+#define THREAD_ARENA_BLOCK_SIZE (64 * 1024)
 
     // framebuffer
     std::shared_ptr<FrameBuffer> RendererSoft::createFrameBuffer(bool offscreen)
@@ -25,8 +27,36 @@ namespace SoftGL
     {
         switch (desc.format)
         {
-            case TextureFormat_RGBA8:   return std::make_shared<TextureSoft<RGBA>>(desc);
+            case TextureFormat_RGBA8:
+            case TextureFormat_RGBA8_SRGB:
+            {
+                auto texture = std::make_shared<TextureSoft<RGBA>>(desc);
+                // candidates for streaming, dropped by the streamer if uploaded with image data
+                if (desc.type == TextureType_2D && desc.useMipmaps && !desc.multiSample && (desc.usage & TextureUsage_UploadData))
+                {
+                    textureStreamer_.addTexture(texture);
+                    if (samplerFeedback_)
+                    {
+                        TextureFeedback feedback;
+                        feedback.texture = texture;
+                        feedback.feedback = std::make_shared<SamplerFeedback>();
+                        texture->setSamplerFeedback(feedback.feedback);
+                        feedbackTextures_.push_back(std::move(feedback));
+                    }
+                }
+                return texture;
+            }
             case TextureFormat_FLOAT32: return std::make_shared<TextureSoft<float>>(desc);
+            // stored compressed, decoded on sampling
+            case TextureFormat_BC1:
+            case TextureFormat_BC3:
+            case TextureFormat_BC5:
+            case TextureFormat_BC7:     return std::make_shared<TextureSoft<RGBA>>(desc);
+            // stored packed, unpacked on sampling
+            case TextureFormat_RGBA16F:     return std::make_shared<TextureSoft<glm::vec4>>(desc);
+            case TextureFormat_R11G11B10F:  return std::make_shared<TextureSoft<glm::vec3>>(desc);
+            case TextureFormat_R16:
+            case TextureFormat_D16:         return std::make_shared<TextureSoft<float>>(desc);
         }
         return nullptr;
     }
@@ -66,28 +96,37 @@ namespace SoftGL
         fbo_ = dynamic_cast<FrameBufferSoft *>(frameBuffer.get());
         if (!fbo_) { return; }
         fboColor_ = fbo_->getColorBuffer();
+        fboColorSrgb_ = fbo_->isColorSrgb();
         fboDepth_ = fbo_->getDepthBuffer();
+        // fast clear: tiles are tagged only, memory is written on first access
         if (states.colorFlag && fboColor_)
         {
-            RGBA color = RGBA(states.clearColor.r * 255, states.clearColor.g * 255, states.clearColor.b * 255, states.clearColor.a * 255);
+            RGBA color = fboColorSrgb_ ? ColorSpace::encode(states.clearColor)
+                                       : RGBA(states.clearColor.r * 255, states.clearColor.g * 255, states.clearColor.b * 255, states.clearColor.a * 255);
             if (fboColor_->multiSample)
             {
-                fboColor_->bufferMs4x->setAll(glm::tvec4<RGBA>(color));
+                fboColor_->bufferMs4x->fastClear(glm::tvec4<RGBA>(color));
+                prepareResolveBuffer();
+                fboColor_->buffer->fastClear(color);
             }
             else
             {
-                fboColor_->buffer->setAll(color);
+                fboColor_->buffer->fastClear(color);
             }
         }
         if (states.depthFlag && fboDepth_)
         {
             if (fboDepth_->multiSample)
             {
-                fboDepth_->bufferMs4x->setAll(glm::tvec4<float>(states.clearDepth));
+                fboDepth_->bufferMs4x->fastClear(glm::tvec4<float>(states.clearDepth));
+            }
+            else if (fboDepth_->packed)
+            {
+                fboDepth_->packed->fastClear(TexelPacking<float>::pack(states.clearDepth));
             }
             else
             {
-                fboDepth_->buffer->setAll(states.clearDepth);
+                fboDepth_->buffer->fastClear(states.clearDepth);
             }
         }
     }
@@ -109,7 +148,7 @@ namespace SoftGL
         viewport_.innerP.x = viewport_.width / 2.f;     // divide by 2 in advance
         viewport_.innerP.y = viewport_.height / 2.f;    // divide by 2 in advance
         viewport_.innerP.z = viewport_.maxDepth - viewport_.minDepth;
-        viewport_.innerO.w = 1.f;
+        viewport_.innerP.w = 1.f;
     }
 
     void RendererSoft::setVertexArrayObject(std::shared_ptr<VertexArrayObject> &vao)
@@ -139,7 +178,144 @@ namespace SoftGL
     void RendererSoft::draw()
     {
         if (!fbo_ || !vao_ || !shaderProgram_) { return; }
+        drawRanges_.assign(1, {0, vao_->indicesCnt});
+        drawUnits_.assign(1, {vao_, 0, 0, 0, 1, 0});
+        drawAllVertexes_ = true;
+        drawImpl();
+    }
+
+    void RendererSoft::drawRanges(const std::vector<DrawRange> &ranges)
+    {
+        if (!fbo_ || !vao_ || !shaderProgram_) { return; }
+        // whole primitives inside the index buffer
+        size_t primitiveSize = primitiveType_ == Primitive_TRIANGLE ? 3 : (primitiveType_ == Primitive_LINE ? 2 : 1);
+        drawRanges_.clear();
+        for (auto &range : ranges)
+        {
+            if (range.first >= vao_->indicesCnt)
+            {
+                continue;
+            }
+            size_t count = std::min(range.count, vao_->indicesCnt - range.first);
+            count -= count % primitiveSize;
+            if (count > 0)
+            {
+                drawRanges_.push_back({range.first, count});
+            }
+        }
+        if (drawRanges_.empty()) { return; }
+        drawUnits_.assign(1, {vao_, 0, 0, 0, drawRanges_.size(), 0});
+        drawAllVertexes_ = false;
+        drawImpl();
+    }
+
+    void RendererSoft::drawInstanced(size_t instanceCnt)
+    {
+        if (!fbo_ || !vao_ || !shaderProgram_) { return; }
+        // instances beyond the instance data are not drawn
+        if (vao_->instanceStride > 0)
+        {
+            instanceCnt = std::min(instanceCnt, vao_->instanceCnt);
+        }
+        if (instanceCnt == 0) { return; }
+        drawRanges_.assign(1, {0, vao_->indicesCnt});
+        // vertexes of instance i follow those of instance i - 1
+        drawUnits_.resize(instanceCnt);
+        for (size_t instance = 0; instance < instanceCnt; instance++)
+        {
+            drawUnits_[instance] = {vao_, instance, instance * vao_->vertexCnt, 0, 1, 0};
+        }
+        drawAllVertexes_ = true;
+        drawImpl();
+    }
+
+    void RendererSoft::drawMulti(const std::vector<DrawCommand> &commands, const UniformTable &uniforms)
+    {
+        if (!fbo_ || !shaderProgram_) { return; }
+        size_t primitiveSize = primitiveType_ == Primitive_TRIANGLE ? 3 : (primitiveType_ == Primitive_LINE ? 2 : 1);
+        drawRanges_.clear();
+        drawUnits_.clear();
+        size_t vertexCnt = 0;
+        for (auto &command : commands)
+        {
+            auto *vao = dynamic_cast<VertexArrayObjectSoft *>(command.vao);
+            if (!vao || command.first >= vao->indicesCnt)
+            {
+                continue;
+            }
+            // all draws share one fetched vertex layout
+            if (!drawUnits_.empty() && vao->fetchStride != drawUnits_[0].vao->fetchStride)
+            {
+                LOGD("drawMulti: vertex layout mismatch, draw skipped");
+                continue;
+            }
+            size_t count = std::min(command.count, vao->indicesCnt - command.first);
+            count -= count % primitiveSize;
+            if (count == 0)
+            {
+                continue;
+            }
+            if (!vao->indicesInRange(command.first, count))
+            {
+                LOGE("drawMulti: index out of vertex range, draw skipped");
+                continue;
+            }
+            drawRanges_.push_back({command.first, count});
+            // ranges of the same vertex array object and uniforms shade their vertexes once
+            if (!drawUnits_.empty() && drawUnits_.back().vao == vao && drawUnits_.back().uniformOffset == command.uniformOffset)
+            {
+                drawUnits_.back().rangeEnd = drawRanges_.size();
+                continue;
+            }
+            drawUnits_.push_back({vao, 0, vertexCnt, drawRanges_.size() - 1, drawRanges_.size(), command.uniformOffset});
+            vertexCnt += vao->vertexCnt;
+        }
+        if (drawUnits_.empty()) { return; }
+
+        // uniform buffer image of each draw unit: the bound uniforms, then the unit's blocks from the table
+        size_t uniformsSize = shaderProgram_->getShaderUniformsSize();
+        std::vector<int> blockOffsets(uniforms.blocks.size(), -1);
+        for (size_t i = 0; i < uniforms.blocks.size(); i++)
+        {
+            int loc = uniforms.blocks[i]->getLocation(*shaderProgram_);
+            int offset = loc < 0 ? -1 : shaderProgram_->getUniformOffset(loc);
+            if (offset >= 0 && (size_t) offset + uniforms.blocks[i]->getSize() <= uniformsSize)
+            {
+                blockOffsets[i] = offset;
+            }
+        }
+        drawUniformsSize_ = MemoryUtils::alignedSize(uniformsSize);
+        drawUniforms_ = frameArena_.alloc<uint8_t>(drawUnits_.size() * drawUniformsSize_);
+        for (size_t unit = 0; unit < drawUnits_.size(); unit++)
+        {
+            uint8_t *image = drawUniforms_ + unit * drawUniformsSize_;
+            memcpy(image, shaderProgram_->getUniformBuffer(), uniformsSize);
+            size_t recordOffset = drawUnits_[unit].uniformOffset;
+            for (size_t i = 0; i < uniforms.blocks.size(); i++)
+            {
+                size_t blockSize = uniforms.blocks[i]->getSize();
+                if (recordOffset + blockSize > uniforms.data.size())
+                {
+                    break;
+                }
+                if (blockOffsets[i] >= 0)
+                {
+                    memcpy(image + blockOffsets[i], uniforms.data.data() + recordOffset, blockSize);
+                }
+                recordOffset += blockSize;
+            }
+        }
+        drawAllVertexes_ = false;
+        drawImpl();
+        // program back to its own uniform buffer
+        shaderProgram_->bindShaderUniforms(nullptr);
+        drawUniforms_ = nullptr;
+    }
+
+    void RendererSoft::drawImpl()
+    {
         fboColor_ = fbo_->getColorBuffer();
+        fboColorSrgb_ = fbo_->isColorSrgb();
         fboDepth_ = fbo_->getDepthBuffer();
         if (fboColor_)
         {
@@ -159,38 +335,144 @@ namespace SoftGL
         processPerspectiveDivide();
         procesViewportTransform();
         processFaceCulling();
-        processRasterization();
         if (fboColor_ && fboColor_->multiSample)
+        {
+            prepareResolveBuffer();
+        }
+        processRasterization();
+        // tile-resident rasterization resolves msaa tiles on flush
+        bool tileResolved = primitiveType_ == Primitive_TRIANGLE && renderStates_->polygonMode == PolygonMode_FILL;
+        if (fboColor_ && fboColor_->multiSample && !tileResolved)
         {
             multiSampleResolve();
         }
+        // transient draw memory is not referenced after the draw, the arena peak is the largest draw
+        frameArena_.reset();
+        for (auto &arena : threadArenas_)
+        {
+            arena->reset();
+        }
+        varyings_ = nullptr;
     }
 
     void RendererSoft::endRenderPass() {}
 
     void RendererSoft::waitIdle() {}
 
+    bool RendererSoft::setRasterTileSize(int size)
+    {
+        // a raster tile covers whole buffer clear tiles, so tile tasks never share a clear tag
+        int clearTileSize = (int) Buffer<RGBA>::getClearTileSize();
+        if (size != clearTileSize && size != 2 * clearTileSize)
+        {
+            LOGE("set raster tile size failed: %d, must be %d or %d", size, clearTileSize, 2 * clearTileSize);
+            return false;
+        }
+        rasterTileSize_ = size;
+        return true;
+    }
+
+    void RendererSoft::updateSamplerFeedback()
+    {
+        for (auto it = feedbackTextures_.begin(); it != feedbackTextures_.end();)
+        {
+            if (it->texture.expired())
+            {
+                it = feedbackTextures_.erase(it);
+                continue;
+            }
+            it->feedback->resolve(it->stats);
+            it++;
+        }
+    }
+
     void RendererSoft::processVertexShader()
     {
-        // init shader varyings
+        // init shader varyings, vertexes of each draw unit follow those of the previous one
+        const DrawUnit &lastUnit = drawUnits_.back();
+        size_t vertexCnt = lastUnit.vertexBase + lastUnit.vao->vertexCnt;
         varyingsCnt_ = shaderProgram_->getShaderVaryingsSize() / sizeof(float);
         varyingsAlignedSize_ = MemoryUtils::alignedSize(varyingsCnt_ * sizeof(float));
         varyingsAlignedCnt_ = varyingsAlignedSize_ / sizeof(float);
-        varyings_ = MemoryUtils::makeAlignedBuffer<float>(vao_->vertexCnt * varyingsAlignedCnt_);
-        float *varyingsBuffer = varyings_.get();
-        uint8_t *vertexPtr = vao_->vertexes.data();
-        vertexes_.resize(vao_->vertexCnt);
-        for (int idx = 0; idx < vao_->vertexCnt; idx++)
+        varyings_ = frameArena_.alloc<float>(vertexCnt * varyingsAlignedCnt_);
+        vertexes_.Resize(vertexCnt);
+        // ranged draws shade only the vertexes their primitives reference
+        const uint8_t *vertexUsed = nullptr;
+        if (!drawAllVertexes_)
+        {
+            vertexUsed_.assign(vertexCnt, 0);
+            for (auto &unit : drawUnits_)
+            {
+                for (size_t r = unit.rangeBegin; r < unit.rangeEnd; r++)
+                {
+                    auto &range = drawRanges_[r];
+                    for (size_t i = range.first; i < range.first + range.count; i++)
+                    {
+                        vertexUsed_[unit.vertexBase + unit.vao->getIndex(i)] = 1;
+                    }
+                }
+            }
+            vertexUsed = vertexUsed_.data();
+        }
+        // packed vertexes and instance attributes are fetched to float vertexes, only those shaded
+        bool needFetch = false;
+        for (auto &unit : drawUnits_)
+        {
+            needFetch = needFetch || unit.vao->codec.packed() || unit.vao->instanceStride > 0;
+        }
+        VertexArrayObjectSoft *firstVao = drawUnits_[0].vao;
+        fetchStride_ = firstVao->instanceStride > 0 ? firstVao->instanceFetchStride : firstVao->fetchStride;
+        uint8_t *fetched = nullptr;
+        if (needFetch)
         {
-            VertexHolder &holder = vertexes_[idx];
-            holder.discard = false;
-            holder.index = idx;
-            holder.vertex = vertexPtr;
-            holder.varyings = (varyingsAlignedSize_ > 0) ? (varyingsBuffer + idx * varyingsAlignedCnt_) : nullptr;
-            vertexShaderImpl(holder);
-            vertexPtr += vao_->vertexStride;
+            fetched = frameArena_.alloc<uint8_t>(vertexCnt * fetchStride_);
         }
+        auto shadeUnit = [&](uint32_t draw, ShaderProgramSoft *program)
+        {
+            const DrawUnit &unit = drawUnits_[draw];
+            VertexArrayObjectSoft *vao = unit.vao;
+            bindDrawUniforms(program, draw);
+            for (size_t i = 0; i < vao->vertexCnt; i++)
+            {
+                size_t idx = unit.vertexBase + i;
+                vertexes_.vertex[idx] = fetched ? fetched + idx * fetchStride_ : vao->vertexes + i * vao->vertexStride;
+                vertexes_.varyings[idx] = (varyingsAlignedSize_ > 0) ? (varyings_ + idx * varyingsAlignedCnt_) : nullptr;
+                if (!vertexUsed || vertexUsed[idx])
+                {
+                    if (fetched)
+                    {
+                        vao->fetchVertex(i, unit.instance, (uint8_t *) vertexes_.vertex[idx]);
+                    }
+                    vertexShaderImpl(idx, program);
+                }
+                else
+                {
+                    vertexes_.SetClipPos(idx, glm::vec4(0.f, 0.f, 0.f, 1.f));
+                }
+            }
+        };
+        if (drawUnits_.size() > 1)
+        {
+            // draw units shaded in parallel, one program clone per thread
+            prepareThreadPrograms();
+            for (uint32_t draw = 0; draw < drawUnits_.size(); draw++)
+            {
+                threadPool_.pushTask(drawTasks_, [&, draw](int thread_id)
+                {
+                    shadeUnit(draw, threadPrograms_[thread_id].get());
+                });
+            }
+            drawTasks_.wait();
+            pointSize_ = threadPrograms_[0]->getShaderBuiltin().PointSize;
+        }
+        else
+        {
+            shadeUnit(0, shaderProgram_);
+            pointSize_ = shaderProgram_->getShaderBuiltin().PointSize;
+        }
+        countFrustumClipMask(0, vertexes_.Size());
     }
+
     void RendererSoft::processPrimitiveAssembly()
     {
         switch (primitiveType_)
@@ -209,18 +491,25 @@ namespace SoftGL
 
     void RendererSoft::processClipping()
     {
-        size_t primitiveCnt = primitives_.size();
-        for (int i = 0; i < primitiveCnt; i++)
+        size_t primitiveCnt = primitives_.Size();
+        for (size_t i = 0; i < primitiveCnt; i++)
         {
-            auto &primitive = primitives_[i];
-            if (primitive.discard) { continue; }
+            if (primitives_.IsDiscard(i)) { continue; }
+            // vertexes created by clipping are shaded with the uniforms of the primitive's draw
+            bindDrawUniforms(shaderProgram_, primitives_.draws[i]);
             switch (primitiveType_)
             {
                 case Primitive_POINT:
-                    clippingPoint(primitive);
+                    if (!clippingPoint(primitives_.GetIndices(i)[0]))
+                    {
+                        primitives_.SetDiscard(i);
+                    }
                     break;
                 case Primitive_LINE:
-                    clippingLine(primitive);
+                    if (!clippingLine(primitives_.GetIndices(i)))
+                    {
+                        primitives_.SetDiscard(i);
+                    }
                     break;
                 case Primitive_TRIANGLE:
                     // skip clipping if draw triangle with point/line mode
@@ -228,72 +517,46 @@ namespace SoftGL
                     {
                         continue;
                     }
-                    std::vector<PrimitiveHolder> appendPrimitives;
-                    clippingTriangle(primitive, appendPrimitives);
-                    primitives_.insert(primitives_.end(), appendPrimitives.begin(), appendPrimitives.end());
+                    clippingTriangle(i);
                     break;
             }
         }
-        // set all vertexes discard flag to true
-        for (auto &vertex : vertexes_)
+        if (drawUniforms_)
         {
-            vertex.discard = true;
-        }
-        // set discard flag to false base on primitive discard flag
-        for (auto &primitive : primitives_)
-        {
-            if (primitive.discard) { continue; }
-            switch (primitiveType_)
-            {
-                case Primitive_POINT:
-                    vertexes_[primitive.indices[0]].discard = false;
-                    break;
-                case Primitive_LINE:
-                    vertexes_[primitive.indices[0]].discard = false;
-                    vertexes_[primitive.indices[1]].discard = false;
-                    break;
-                case Primitive_TRIANGLE:
-                    vertexes_[primitive.indices[0]].discard = false;
-                    vertexes_[primitive.indices[1]].discard = false;
-                    vertexes_[primitive.indices[2]].discard = false;
-                    break;
-            }
+            shaderProgram_->bindShaderUniforms(nullptr);
         }
     }
 
+    // divide and viewport transform run over all vertexes, branch free loops on contiguous streams
     void RendererSoft::processPerspectiveDivide()
     {
-        for (auto &vertex : vertexes_)
-        {
-            if (vertex.discard) { continue; }
-            perspectiveDivideImpl(vertex);
-        }
+        perspectiveDivideImpl(0, vertexes_.Size());
     }
 
     void RendererSoft::procesViewportTransform()
     {
-        for (auto &vertex : vertexes_)
-        {
-            if (vertex.discard) { continue; }
-            viewportTransformImpl(vertex);
-        }
+        viewportTransformImpl(0, vertexes_.Size());
     }
 
     void RendererSoft::processFaceCulling()
     {
         if (primitiveType_ != Primitive_TRIANGLE) { return; }
-        for (auto &triangle : primitives_)
+        const float *fragX = vertexes_.fragX.data();
+        const float *fragY = vertexes_.fragY.data();
+        for (size_t i = 0; i < primitives_.Size(); i++)
         {
-            if (triangle.discard) { continue; }
-            glm::vec4 &v0 = vertexes_[triangle.indices[0]].fragPos;
-            glm::vec4 &v1 = vertexes_[triangle.indices[1]].fragPos;
-            glm::vec4 &v2 = vertexes_[triangle.indices[2]].fragPos;
-            glm::vec3 n = glm::cross(glm::vec3(v1 - v0), glm::vec3(v2 - v0));
-            float area = glm::dot(n, glm::vec3(0, 0, 1));
-            triangle.frontFacing = area > 0;
-            if (renderStates_->cullFace)
+            if (primitives_.IsDiscard(i)) { continue; }
+            const uint32_t *idx = primitives_.GetIndices(i);
+            float e1x = fragX[idx[1]] - fragX[idx[0]];
+            float e1y = fragY[idx[1]] - fragY[idx[0]];
+            float e2x = fragX[idx[2]] - fragX[idx[0]];
+            float e2y = fragY[idx[2]] - fragY[idx[0]];
+            float area = e1x * e2y - e1y * e2x;
+            bool frontFacing = area > 0;
+            primitives_.SetFrontFacing(i, frontFacing);
+            if (renderStates_->cullFace && !frontFacing)
             {
-                triangle.discard = !triangle.frontFacing;   // cull back face
+                primitives_.SetDiscard(i);   // cull back face
             }
         }
     }
@@ -303,28 +566,41 @@ namespace SoftGL
         switch (primitiveType_)
         {
             case Primitive_POINT:
-                for(auto &primitive : primitives_)
+                for (size_t i = 0; i < primitives_.Size(); i++)
                 {
-                    if (primitive.discard) { continue; }
-                    auto *vert0 = &vertexes_[primitive.indices[0]];
-                    rasterizationPoint(vert0, pointSize_);
+                    if (primitives_.IsDiscard(i)) { continue; }
+                    bindDrawUniforms(shaderProgram_, primitives_.draws[i]);
+                    uint32_t idx = primitives_.GetIndices(i)[0];
+                    rasterizationPoint(vertexes_.GetFragPos(idx), vertexes_.varyings[idx], pointSize_);
                 }
                 break;
             case Primitive_LINE:
-                for(auto &primitive : primitives_)
+                for (size_t i = 0; i < primitives_.Size(); i++)
                 {
-                    if (primitive.discard) { continue; }
-                    auto *vert0 = &vertexes_[primitive.indices[0]];
-                    auto *vert1 = &vertexes_[primitive.indices[1]];
-                    rasterizationLine(vert0, vert1, renderStates_->lineWidth);
+                    if (primitives_.IsDiscard(i)) { continue; }
+                    bindDrawUniforms(shaderProgram_, primitives_.draws[i]);
+                    const uint32_t *idx = primitives_.GetIndices(i);
+                    rasterizationLine(idx[0], idx[1], renderStates_->lineWidth);
                 }
                 break;
             case Primitive_TRIANGLE:
+                threadRasterTile_.resize(threadPool_.getThreadCnt());
+                for (auto &tile : threadRasterTile_)
+                {
+                    tile.Init(rasterTileSize_, fboColor_ ? fboColor_->sampleCnt : 1, fboDepth_ ? fboDepth_->sampleCnt : 1);
+                }
+                prepareThreadPrograms();
                 threadQuadCtx_.resize(threadPool_.getThreadCnt());
-                for (auto &ctx : threadQuadCtx_)
+                threadArenas_.resize(threadPool_.getThreadCnt());
+                for (size_t i = 0; i < threadQuadCtx_.size(); i++)
                 {
-                    ctx.SetVrayingsSize(varyingsAlignedCnt_);
-                    ctx.shaderProgram = shaderProgram_->clone();
+                    if (!threadArenas_[i])
+                    {
+                        threadArenas_[i].reset(new MemoryArena(THREAD_ARENA_BLOCK_SIZE));
+                    }
+                    auto &ctx = threadQuadCtx_[i];
+                    ctx.SetVrayingsSize(varyingsAlignedCnt_, *threadArenas_[i]);
+                    ctx.shaderProgram = threadPrograms_[i];
                     ctx.shaderProgram->prepareFragmentShader();
                     // setup derivative
                     DerivativeContext &df_ctx = ctx.shaderProgram->getShaderBuiltin().dfCtx;
@@ -333,8 +609,8 @@ namespace SoftGL
                     df_ctx.p2 = ctx.pixels[2].varyingsFrag;
                     df_ctx.p3 = ctx.pixels[3].varyingsFrag;
                 }
-                rasterizationPolygons(primitives_);
-                threadPool_.waitTasksFinish();
+                rasterizationPolygons();
+                drawTasks_.wait();
                 break;
         }
     }
@@ -349,47 +625,70 @@ namespace SoftGL
         shader->execFragmentShader();
     }
 
-    void RendererSoft::processPerSampleOperations(int x, int y, float depth, const glm::vec4 &color, int sample)
+    void RendererSoft::processPerSampleOperations(int x, int y, float depth, const glm::vec4 &color, int sample, RasterTile *tile)
     {
         // depth test
-        if (!processDepthTest(x, y, depth, sample, false)) { return; }
+        if (!processDepthTest(x, y, depth, sample, false, tile)) { return; }
         if (!fboColor_) { return; }
         glm::vec4 color_clamp = glm::clamp(color, 0.0f, 1.0f);
         // color blending
-        processColorBlending(x, y, color_clamp, sample);
+        processColorBlending(x, y, color_clamp, sample, tile);
         // write final color to fbo
-        setFrameColor(x, y, color_clamp * 255.0f, sample);
+        setFrameColor(x, y, fboColorSrgb_ ? ColorSpace::encode(color_clamp) : RGBA(color_clamp * 255.0f), sample, tile);
     }
 
-    bool RendererSoft::processDepthTest(int x, int y, float depth, int sample, bool skipWirte)
+    bool RendererSoft::processDepthTest(int x, int y, float depth, int sample, bool skipWirte, RasterTile *tile)
     {
         if (!renderStates_->depthTest || !fboDepth_) { return true; }
         // depth clampping
         depth = glm::clamp(depth, viewport_.absMinDepth, viewport_.absMaxDepth);
+        // packed depth outside of tiles, compare with unpacked value
+        if (!tile && fboDepth_->packed)
+        {
+            uint16_t *packedPtr = fboDepth_->packed->get(x, y);
+            if (!packedPtr)
+            {
+                return false;
+            }
+            float z = TexelPacking<float>::unpack(*packedPtr);
+            if (!DepthTest(depth, z, renderStates_->depthFunc))
+            {
+                return false;
+            }
+            if (!skipWirte && renderStates_->depthMask)
+            {
+                *packedPtr = TexelPacking<float>::pack(depth);
+            }
+            return true;
+        }
         // depth comparison
-        float *zPtr = getFrameDepth(x, y, sample);
+        float *zPtr = getFrameDepth(x, y, sample, tile);
         if (zPtr && DepthTest(depth, *zPtr, renderStates_->depthFunc))
         {
             // depth attachment writes
             if (!skipWirte && renderStates_->depthMask)
             {
                 *zPtr = depth;
+                if (tile)
+                {
+                    tile->depthDirty = true;
+                }
             }
             return true;
         }
         return false;
     }
 
-    void RendererSoft::processColorBlending(int x, int y, glm::vec4 &color, int sample)
+    void RendererSoft::processColorBlending(int x, int y, glm::vec4 &color, int sample, RasterTile *tile)
     {
         if (renderStates_->blend)
         {
             glm::vec4 &srcColor = color;
             glm::vec4 dstColor = glm::vec4(0.f);
-            auto *ptr = getFrameColor(x, y, sample);
+            auto *ptr = getFrameColor(x, y, sample, tile);
             if (ptr)
             {
-                dstColor = glm::vec4(*ptr) / 255.0f;
+                dstColor = fboColorSrgb_ ? ColorSpace::decode(*ptr) : glm::vec4(*ptr) / 255.0f;
             }
             color = calcBlendColor(srcColor, dstColor, renderStates_->blendParams);
         }
@@ -397,54 +696,127 @@ namespace SoftGL
 
     void RendererSoft::processPointAssembly()
     {
-        primitives_.resize(vao_->indicesCnt);
-        for (int idx = 0; idx < primitives_.size(); idx++)
+        primitives_.Resize(countRangePrimitives(1));
+        size_t idx = 0;
+        for (uint32_t draw = 0; draw < drawUnits_.size(); draw++)
         {
-            auto &point = primitives_[idx];
-            point.indices[0] = vao_->indices[idx];
-            point.discard = false;
+            const DrawUnit &unit = drawUnits_[draw];
+            auto base = (uint32_t) unit.vertexBase;
+            for (size_t r = unit.rangeBegin; r < unit.rangeEnd; r++)
+            {
+                auto &range = drawRanges_[r];
+                for (size_t i = range.first; i < range.first + range.count; i++, idx++)
+                {
+                    primitives_.GetIndices(idx)[0] = base + unit.vao->getIndex(i);
+                    primitives_.flags[idx] = PrimitiveFlag_FrontFacing;
+                    primitives_.draws[idx] = draw;
+                }
+            }
         }
     }
 
     void RendererSoft::processLineAssembly()
     {
-        primitives_.resize(vao_->indicesCnt / 2);
-        for (int idx = 0; idx < primitives_.size(); idx++)
+        primitives_.Resize(countRangePrimitives(2));
+        size_t idx = 0;
+        for (uint32_t draw = 0; draw < drawUnits_.size(); draw++)
         {
-            auto &line = primitives_[idx];
-            line.indices[0] = vao_->indices[idx * 2];
-            line.indices[1] = vao_->indices[idx * 2 + 1];
-            line.discard = false;
+            const DrawUnit &unit = drawUnits_[draw];
+            auto base = (uint32_t) unit.vertexBase;
+            for (size_t r = unit.rangeBegin; r < unit.rangeEnd; r++)
+            {
+                auto &range = drawRanges_[r];
+                for (size_t i = range.first; i + 1 < range.first + range.count; i += 2, idx++)
+                {
+                    uint32_t *indices = primitives_.GetIndices(idx);
+                    indices[0] = base + unit.vao->getIndex(i);
+                    indices[1] = base + unit.vao->getIndex(i + 1);
+                    primitives_.flags[idx] = PrimitiveFlag_FrontFacing;
+                    primitives_.draws[idx] = draw;
+                }
+            }
         }
     }
 
     void RendererSoft::processPolygonAssembly()
     {
-        primitives_.resize(vao_->indicesCnt / 3);
-        for (int idx = 0; idx < primitives_.size(); idx++)
+        primitives_.Resize(countRangePrimitives(3));
+        size_t idx = 0;
+        for (uint32_t draw = 0; draw < drawUnits_.size(); draw++)
+        {
+            const DrawUnit &unit = drawUnits_[draw];
+            auto base = (uint32_t) unit.vertexBase;
+            for (size_t r = unit.rangeBegin; r < unit.rangeEnd; r++)
+            {
+                auto &range = drawRanges_[r];
+                for (size_t i = range.first; i + 2 < range.first + range.count; i += 3, idx++)
+                {
+                    uint32_t *indices = primitives_.GetIndices(idx);
+                    indices[0] = base + unit.vao->getIndex(i);
+                    indices[1] = base + unit.vao->getIndex(i + 1);
+                    indices[2] = base + unit.vao->getIndex(i + 2);
+                    primitives_.flags[idx] = PrimitiveFlag_FrontFacing;
+                    primitives_.draws[idx] = draw;
+                }
+            }
+        }
+    }
+
+    size_t RendererSoft::countRangePrimitives(size_t primitiveSize) const
+    {
+        size_t cnt = 0;
+        for (auto &unit : drawUnits_)
+        {
+            for (size_t r = unit.rangeBegin; r < unit.rangeEnd; r++)
+            {
+                cnt += drawRanges_[r].count / primitiveSize;
+            }
+        }
+        return cnt;
+    }
+
+    // fragment and vertex shading of a multi draw read the uniforms of the primitive's draw unit
+    void RendererSoft::prepareThreadPrograms()
+    {
+        // clones share defines and uniform buffer with the program, so they are kept while it stays bound
+        size_t threadCnt = threadPool_.getThreadCnt();
+        if (threadPrograms_.size() != threadCnt || threadProgramId_ != shaderProgram_->getId()
+            || threadProgramUniforms_ != shaderProgram_->getUniformBuffer())
+        {
+            threadPrograms_.resize(threadCnt);
+            for (auto &program : threadPrograms_)
+            {
+                program = shaderProgram_->clone();
+            }
+            threadProgramId_ = shaderProgram_->getId();
+            threadProgramUniforms_ = shaderProgram_->getUniformBuffer();
+        }
+        // a previous multi draw may have left them on its per draw uniforms
+        for (auto &program : threadPrograms_)
         {
-            auto &triangle = primitives_[idx];
-            triangle.indices[0] = vao_->indices[idx * 3];
-            triangle.indices[1] = vao_->indices[idx * 3 + 1];
-            triangle.indices[2] = vao_->indices[idx * 3 + 2];
-            triangle.discard = false;
+            program->bindShaderUniforms(nullptr);
         }
     }
 
-    void RendererSoft::clippingPoint(PrimitiveHolder &point)
+    void RendererSoft::bindDrawUniforms(ShaderProgramSoft *program, uint32_t draw)
     {
-        point.discard =  (vertexes_[point.indices[0]].clipMask != 0);
+        if (drawUniforms_)
+        {
+            program->bindShaderUniforms(drawUniforms_ + draw * drawUniformsSize_);
+        }
     }
 
-    void RendererSoft::clippingLine(PrimitiveHolder &line, bool postVertexProcess)
+    bool RendererSoft::clippingPoint(uint32_t idx)
     {
-        VertexHolder *v0 = &vertexes_[line.indices[0]];
-        VertexHolder *v1 = &vertexes_[line.indices[1]];
-        auto clipMaskV0 = v0->clipMask;
-        auto clipMaskV1 = v1->clipMask;
-        auto clipPosV0 = v0->clipPos;
-        auto clipPosV1 = v1->clipPos;
-        bool fullClip = false;
+        return vertexes_.clipMask[idx] == 0;
+    }
+
+    bool RendererSoft::clippingLine(uint32_t *indices, bool postVertexProcess)
+    {
+        auto clipMaskV0 = vertexes_.clipMask[indices[0]];
+        auto clipMaskV1 = vertexes_.clipMask[indices[1]];
+        auto clipPosV0 = vertexes_.GetClipPos(indices[0]);
+        auto clipPosV1 = vertexes_.GetClipPos(indices[1]);
         float t0 = 0.0f;
         float t1 = 1.0f;
         int mask = clipMaskV0 | clipMaskV1;
@@ -458,8 +830,7 @@ namespace SoftGL
                     float d1 = glm::dot(FrustumClipPlane[i], clipPosV1);
                     if (d0 < 0 && d1 < 0)
                     {
-                        fullClip = true;
-                        break;
+                        return false;
                     }
                     else if (d0 < 0)
                     {
@@ -474,170 +845,221 @@ namespace SoftGL
                 }
             }
         }
-        if (fullClip)
-        {
-            line.discard = true;
-            return;
-        }
         if (clipMaskV0)
         {
-            line.indices[0] = clippingNewVertex(line.indices[0], line.indices[1], t0, postVertexProcess);
+            indices[0] = clippingNewVertex(indices[0], indices[1], t0, postVertexProcess);
         }
         if (clipMaskV1)
         {
-            line.indices[1] = clippingNewVertex(line.indices[0], line.indices[1], t1, postVertexProcess);
+            indices[1] = clippingNewVertex(indices[0], indices[1], t1, postVertexProcess);
         }
+        return true;
     }
 
-    void RendererSoft::clippingTriangle(PrimitiveHolder &triangle, std::vector<PrimitiveHolder> &appendPrimitives)
+    void RendererSoft::clippingTriangle(size_t primitiveIdx)
     {
-        auto *v0 = &vertexes_[triangle.indices[0]];
-        auto *v1 = &vertexes_[triangle.indices[1]];
-        auto *v2 = &vertexes_[triangle.indices[2]];
-        int mask = v0->clipMask | v1->clipMask | v2->clipMask;
+        uint32_t *indices = primitives_.GetIndices(primitiveIdx);
+        int mask = vertexes_.clipMask[indices[0]] | vertexes_.clipMask[indices[1]] | vertexes_.clipMask[indices[2]];
         if (mask == 0) return;
         bool fullClip = false;
-        std::vector<size_t> indicesIn;
-        std::vector<size_t> indicesOut;
-        indicesIn.push_back(v0->index);
-        indicesIn.push_back(v1->index);
-        indicesIn.push_back(v2->index);
+        // each plane adds at most one vertex to the convex polygon, one more slot closes the loop
+        uint32_t polygons[2][CLIP_MAX_VERTEXES + 1];
+        uint32_t *indicesIn = polygons[0];
+        uint32_t *indicesOut = polygons[1];
+        size_t inCnt = 3;
+        indicesIn[0] = indices[0];
+        indicesIn[1] = indices[1];
+        indicesIn[2] = indices[2];
         for (int planeIdx = 0; planeIdx < 6; planeIdx++)
         {
             if (mask & FrustumClipMaskArray[planeIdx])
             {
-                if (indicesIn.size() < 3)
+                if (inCnt < 3)
                 {
                     fullClip = true;
                     break;
                 }
-                indicesOut.clear();
-                size_t idxPre = indicesIn[0];
-                float dPre = glm::dot(FrustumClipPlane[planeIdx], vertexes_[idxPre].clipPos);
-                
-                indicesIn.push_back(idxPre);
-                for (int i = 1; i < indicesIn.size(); i++)
+                size_t outCnt = 0;
+                uint32_t idxPre = indicesIn[0];
+                float dPre = glm::dot(FrustumClipPlane[planeIdx], vertexes_.GetClipPos(idxPre));
+
+                indicesIn[inCnt] = idxPre;
+                for (size_t i = 1; i <= inCnt; i++)
                 {
-                    size_t idx = indicesIn[i];
-                    float d = glm::dot(FrustumClipPlane[planeIdx], vertexes_[idx].clipPos);
+                    uint32_t idx = indicesIn[i];
+                    float d = glm::dot(FrustumClipPlane[planeIdx], vertexes_.GetClipPos(idx));
                     if (dPre >= 0)
                     {
-                        indicesOut.push_back(idxPre);
+                        indicesOut[outCnt++] = idxPre;
                     }
                     if (std::signbit(dPre) != std::signbit(d))
                     {
                         float t = d < 0 ? dPre / (dPre - d) : -dPre / (d - dPre);
                         // create new vertex
                         auto vertIdx = clippingNewVertex(idxPre, idx, t);
-                        indicesOut.push_back(vertIdx);
+                        indicesOut[outCnt++] = vertIdx;
                     }
                     idxPre = idx;
                     dPre = d;
                 }
                 std::swap(indicesIn, indicesOut);
+                inCnt = outCnt;
             }
         }
-        if (fullClip || indicesIn.empty())
+        if (fullClip || inCnt < 3)
         {
-            triangle.discard = true;
+            primitives_.SetDiscard(primitiveIdx);
             return;
         }
-        triangle.indices[0] = indicesIn[0];
-        triangle.indices[1] = indicesIn[1];
-        triangle.indices[2] = indicesIn[2];
-        for (int i = 3; i < indicesIn.size(); i++)
+        indices[0] = indicesIn[0];
+        indices[1] = indicesIn[1];
+        indices[2] = indicesIn[2];
+        uint8_t flags = primitives_.flags[primitiveIdx];
+        uint32_t draw = primitives_.draws[primitiveIdx];
+        for (size_t i = 3; i < inCnt; i++)
         {
-            appendPrimitives.emplace_back();
-            PrimitiveHolder &ph = appendPrimitives.back();
-            ph.discard = false;
-            ph.indices[0] = indicesIn[0];
-            ph.indices[1] = indicesIn[i - 1];
-            ph.indices[2] = indicesIn[i];
-            ph.frontFacing = triangle.frontFacing;
+            primitives_.Append(indicesIn[0], indicesIn[i - 1], indicesIn[i], flags, draw);
         }
     }
 
-    void RendererSoft::rasterizationPolygons(std::vector<PrimitiveHolder> &primitives)
+    void RendererSoft::rasterizationPolygons()
     {
         switch (renderStates_->polygonMode)
         {
             case PolygonMode_POINT:
-                rasterizationPolygonsPoint(primitives);
+                rasterizationPolygonsPoint();
                 break;
             case PolygonMode_LINE:
-                rasterizationPolygonsLine(primitives);
+                rasterizationPolygonsLine();
                 break;
             case PolygonMode_FILL:
-                rasterizationPolygonsTriangle(primitives);
+                rasterizationPolygonsTriangle();
                 break;
         }
     }
 
-    void RendererSoft::rasterizationPolygonsPoint(std::vector<PrimitiveHolder> &primitives)
+    void RendererSoft::rasterizationPolygonsPoint()
     {
-        for (auto &triangle : primitives)
+        for (size_t i = 0; i < primitives_.Size(); i++)
         {
-            if (triangle.discard) { continue; }
-            for (size_t idx : triangle.indices)
+            if (primitives_.IsDiscard(i)) { continue; }
+            bindDrawUniforms(shaderProgram_, primitives_.draws[i]);
+            const uint32_t *indices = primitives_.GetIndices(i);
+            for (int k = 0; k < 3; k++)
             {
-                PrimitiveHolder point;
-                point.discard = false;
-                point.frontFacing = triangle.frontFacing;
-                point.indices[0] = idx;
+                uint32_t idx = indices[k];
                 // clipping
-                clippingPoint(point);
-                if (point.discard) { continue; }
+                if (!clippingPoint(idx)) { continue; }
                 // rasterization
-                rasterizationPoint(&vertexes_[point.indices[0]], pointSize_);
+                rasterizationPoint(vertexes_.GetFragPos(idx), vertexes_.varyings[idx], pointSize_);
             }
         }
     }
 
-    void RendererSoft::rasterizationPolygonsLine(std::vector<PrimitiveHolder> &primitives)
+    void RendererSoft::rasterizationPolygonsLine()
     {
-        for (auto &triangle : primitives)
+        for (size_t i = 0; i < primitives_.Size(); i++)
         {
-            if (triangle.discard) { continue; }
-            for (size_t i = 0; i < 3; i++)
+            if (primitives_.IsDiscard(i)) { continue; }
+            bindDrawUniforms(shaderProgram_, primitives_.draws[i]);
+            for (int k = 0; k < 3; k++)
             {
-                PrimitiveHolder line;
-                line.discard = false;
-                line.frontFacing = triangle.frontFacing;
-                line.indices[0] = triangle.indices[i];
-                line.indices[1] = triangle.indices[(i + 1) % 3];
+                const uint32_t *indices = primitives_.GetIndices(i);
+                uint32_t line[2] = {indices[k], indices[(k + 1) % 3]};
                 // clipping
-                clippingLine(line, true);
-                if (line.discard) { continue; }
+                if (!clippingLine(line, true)) { continue; }
                 // rasterization
-                rasterizationLine(&vertexes_[line.indices[0]], &vertexes_[line.indices[1]], renderStates_->lineWidth);
+                rasterizationLine(line[0], line[1], renderStates_->lineWidth);
             }
         }
     }
 
-    void RendererSoft::rasterizationPolygonsTriangle(std::vector<PrimitiveHolder> &primitives)
+    void RendererSoft::rasterizationPolygonsTriangle()
     {
-        for (auto &triangle : primitives)
+        if (!fboColor_ && !fboDepth_) { return; }
+        int fboWidth = fboColor_ ? fboColor_->width : fboDepth_->width;
+        int fboHeight = fboColor_ ? fboColor_->height : fboDepth_->height;
+
+        // bin triangles to screen tiles, keep primitive order in each bin
+        rasterTileCntX_ = (fboWidth + rasterTileSize_ - 1) / rasterTileSize_;
+        rasterTileCntY_ = (fboHeight + rasterTileSize_ - 1) / rasterTileSize_;
+        rasterTileBins_.resize(rasterTileCntX_ * rasterTileCntY_);
+        for (auto &bin : rasterTileBins_)
         {
-            if (triangle.discard) { continue; }
-            rasterizationTriangle(&vertexes_[triangle.indices[0]], &vertexes_[triangle.indices[1]], &vertexes_[triangle.indices[2]], triangle.frontFacing);
+            bin.clear();
         }
+        for (size_t idx = 0; idx < primitives_.Size(); idx++)
+        {
+            if (primitives_.IsDiscard(idx)) { continue; }
+            const uint32_t *indices = primitives_.GetIndices(idx);
+            glm::aligned_vec4 screenPos[3] = {vertexes_.GetFragPos(indices[0]),
+                                              vertexes_.GetFragPos(indices[1]),
+                                              vertexes_.GetFragPos(indices[2])};
+            BoundingBox bounds = triangleBoundingBox(screenPos, viewport_.width, viewport_.height);
+            int tileMinX = (int) bounds.min.x / rasterTileSize_;
+            int tileMinY = (int) bounds.min.y / rasterTileSize_;
+            int tileMaxX = std::min((int) bounds.max.x / rasterTileSize_, rasterTileCntX_ - 1);
+            int tileMaxY = std::min((int) bounds.max.y / rasterTileSize_, rasterTileCntY_ - 1);
+            for (int tileY = tileMinY; tileY <= tileMaxY; tileY++)
+            {
+                for (int tileX = tileMinX; tileX <= tileMaxX; tileX++)
+                {
+                    rasterTileBins_[tileY * rasterTileCntX_ + tileX].push_back(idx);
+                }
+            }
+        }
+
+        // each tile is owned by one task, no framebuffer access races between tiles
+        for (int tileY = 0; tileY < rasterTileCntY_; tileY++)
+        {
+            for (int tileX = 0; tileX < rasterTileCntX_; tileX++)
+            {
+                if (rasterTileBins_[tileY * rasterTileCntX_ + tileX].empty()) { continue; }
+#ifdef RASTER_MULTI_THREAD
+                threadPool_.pushTask(drawTasks_, [&, tileX, tileY](int thread_id)
+                {
+                    rasterizationTile(tileX, tileY, threadQuadCtx_[thread_id], threadRasterTile_[thread_id]);
+                });
+#else
+                rasterizationTile(tileX, tileY, threadQuadCtx_[0], threadRasterTile_[0]);
+#endif
+            }
+        }
+    }
+
+    void RendererSoft::rasterizationTile(int tileX, int tileY, PixelQuadContext &quad, RasterTile &tile)
+    {
+        int fboWidth = fboColor_ ? fboColor_->width : fboDepth_->width;
+        int fboHeight = fboColor_ ? fboColor_->height : fboDepth_->height;
+        int originX = tileX * rasterTileSize_;
+        int originY = tileY * rasterTileSize_;
+        tile.SetRegion(originX, originY, std::min(rasterTileSize_, fboWidth - originX), std::min(rasterTileSize_, fboHeight - originY));
+        loadTile(tile);
+        quad.tile = &tile;
+        for (size_t idx : rasterTileBins_[tileY * rasterTileCntX_ + tileX])
+        {
+            bindDrawUniforms(quad.shaderProgram.get(), primitives_.draws[idx]);
+            rasterizationTriangle(primitives_.GetIndices(idx), primitives_.IsFrontFacing(idx), quad);
+        }
+        quad.tile = nullptr;
+        storeTile(tile);
     }
 
-    void RendererSoft::rasterizationPoint(VertexHolder *v, float pointSize)
+    void RendererSoft::rasterizationPoint(const glm::vec4 &fragPos, float *varyings, float pointSize)
     {
         if (!fboColor_) { return; }
-        float left = v->fragPos.x - pointSize / 2.f + 0.5f;
+        float left = fragPos.x - pointSize / 2.f + 0.5f;
         float right = left + pointSize;
-        float top = v->fragPos.y - pointSize / 2.f + 0.5f;
+        float top = fragPos.y - pointSize / 2.f + 0.5f;
         float bottom = top + pointSize;
-        glm::vec4 &screenPos = v->fragPos;
+        glm::vec4 screenPos = fragPos;
         for (int x = (int)left; x < (int)right; x++)
         {
             for (int y = (int)top; y < (int)bottom; y++)
             {
                 screenPos.x = (float)x;
                 screenPos.y = (float)y;
-                processFragmentShader(screenPos, true, v->varyings, shaderProgram_);
+                processFragmentShader(screenPos, true, varyings, shaderProgram_);
                 auto &builtIn = shaderProgram_->getShaderBuiltin();
                 if (!builtIn.discard)
                 {
@@ -651,13 +1073,13 @@ namespace SoftGL
         }
     }
 
-    void RendererSoft::rasterizationLine(VertexHolder *v0, VertexHolder *v1, float lineWidth)
+    void RendererSoft::rasterizationLine(size_t idx0, size_t idx1, float lineWidth)
     {
         // TODO diamond-exit rule
-        int x0 = (int)v0->fragPos.x, y0 = (int)v0->fragPos.y;
-        int x1 = (int)v1->fragPos.x, y1 = (int)v1->fragPos.y;
-        float z0 = v0->fragPos.z, z1 = v1->fragPos.z;
-        float w0 = v0->fragPos.w, w1 = v1->fragPos.w;
+        int x0 = (int)vertexes_.fragX[idx0], y0 = (int)vertexes_.fragY[idx0];
+        int x1 = (int)vertexes_.fragX[idx1], y1 = (int)vertexes_.fragY[idx1];
+        float z0 = vertexes_.fragZ[idx0], z1 = vertexes_.fragZ[idx1];
+        float w0 = vertexes_.fragW[idx0], w1 = vertexes_.fragW[idx1];
         bool steep = false;
         if (std::abs(x0 - x1) < std::abs(y0 - y1))
         {
@@ -665,7 +1087,7 @@ namespace SoftGL
             std::swap(x1, y1);
             steep = true;
         }
-        const float *varyingsIn[2] = {v0->varyings, v1->varyings};
+        const float *varyingsIn[2] = {vertexes_.varyings[idx0], vertexes_.varyings[idx1]};
         if (x0 > x1)
         {
             std::swap(x0, x1);
@@ -680,21 +1102,19 @@ namespace SoftGL
         int dError = 2 * std::abs(dy);
         int y = y0;
 
-        auto varyings = MemoryUtils::makeBuffer<float>(varyingsCnt_);
-        VertexHolder pt{};
-        pt.varyings = varyings.get();
+        float *ptVaryings = frameArena_.alloc<float>(varyingsCnt_);
 
         float t = 0;
         for (int x = x0; x < x1; x++)
         {
             t = (float)(x - x0) / (float)dx;
-            pt.fragPos = glm::vec4(x, y, glm::mix(z0, z1, t), glm::mix(w0, w1, t));
+            glm::vec4 ptPos = glm::vec4(x, y, glm::mix(z0, z1, t), glm::mix(w0, w1, t));
             if (steep)
             {
-                std::swap(pt.fragPos.x, pt.fragPos.y);
+                std::swap(ptPos.x, ptPos.y);
             }
-            interpolateLinear(pt.varyings, varyingsIn, varyingsCnt_, t);
-            rasterizationPoint(&pt, lineWidth);
+            interpolateLinear(ptVaryings, varyingsIn, varyingsCnt_, t);
+            rasterizationPoint(ptPos, ptVaryings, lineWidth);
 
             error += dError;
             if (error > dx)
@@ -705,57 +1125,43 @@ namespace SoftGL
         }
     }
 
-    void RendererSoft::rasterizationTriangle(VertexHolder *v0, VertexHolder *v1, VertexHolder *v2, bool frontFacing)
+    void RendererSoft::rasterizationTriangle(const uint32_t *indices, bool frontFacing, PixelQuadContext &quad)
     {
         // TODO top-left rule
-        VertexHolder *vert[3] = {v0, v1, v2};
-        glm::aligned_vec4 screenPOs[3] = {v0->fragPos, v1->fragPos, v2->fragPos};
-        BoundingBox bounds = triangleBoundingBox(screenPOs, viewport_.width, viewport_.height);
-        bounds.min -= 1.f;
-
-        auto blockSize = rasterBlockSize_;
-        int blockCntX = (bounds.max.x - bounds.min.x + blockSize - 1.f) / blockSize;    // 向上取整
-        int blockCntY = (bounds.max.y - bounds.min.y + blockSize - 1.f) / blockSize;
+        glm::aligned_vec4 *vertPos = quad.vertPos;
+        for (int i = 0; i < 3; i++)
+        {
+            vertPos[i] = vertexes_.GetFragPos(indices[i]);
+        }
+        BoundingBox bounds = triangleBoundingBox(vertPos, viewport_.width, viewport_.height);
+
+        // clip to tile, quads start at even coordinates so they never cross tile borders
+        RasterTile &tile = *quad.tile;
+        int minX = std::max((int) bounds.min.x & ~1, tile.originX);
+        int minY = std::max((int) bounds.min.y & ~1, tile.originY);
+        int maxX = std::min((int) bounds.max.x, tile.originX + tile.width - 1);
+        int maxY = std::min((int) bounds.max.y, tile.originY + tile.height - 1);
+        if (minX > maxX || minY > maxY) { return; }
+
+        // init pixel quad
+        quad.frontFacing = frontFacing;
+        for (int i = 0; i < 3; i++)
+        {
+            quad.vertZ[i] = &vertPos[i].z;     // z, w interpolated together
+            quad.vertW[i] = vertPos[i].w;
+            quad.vertVaryings[i] = vertexes_.varyings[indices[i]];
+        }
+        quad.vertPosFlat[0] = {vertPos[2].x, vertPos[1].x, vertPos[0].x, 0.f};
+        quad.vertPosFlat[1] = {vertPos[2].y, vertPos[1].y, vertPos[0].y, 0.f};
+        quad.vertPosFlat[2] = {vertPos[0].z, vertPos[1].z, vertPos[2].z, 0.f};
+        quad.vertPosFlat[3] = {vertPos[0].w, vertPos[1].w, vertPos[2].w, 0.f};
 
-        for (int blockY = 0; blockY < blockCntY; blockY++)
+        for (int y = minY; y <= maxY; y += 2)
         {
-            for (int blockX = 0; blockX < blockCntX; blockX++)
+            for (int x = minX; x <= maxX; x += 2)
             {
-#ifdef RASTER_MULTI_THREAD
-                threadPool_.pushTask([&, vert, bounds, blockSize, blockX, blockY](int thread_id)
-                {
-                    // init pixel quad
-                    auto pixelQuad = threadQuadCtx_[thread_id];
-#else
-                    auto pixelQuad = threadQuadCtx[0];
-#endif
-                    pixelQuad.frontFacing = frontFacing;
-                    for (int i = 0; i < 3; i++)
-                    {
-                        pixelQuad.vertPos[i] = vert[i]->fragPos;
-                        pixelQuad.vertZ[i] = &vert[i]->fragPos.z;
-                        pixelQuad.vertW[i] = vert[i]->fragPos.w;
-                        pixelQuad.vertVaryings[i] = vert[i]->varyings;
-                    }
-                    glm::aligned_vec4 *vertPos = pixelQuad.vertPos;
-                    pixelQuad.vertPosFlat[0] = {vertPos[2].x, vertPos[1].x, vertPos[0].x, 0.f};
-                    pixelQuad.vertPosFlat[1] = {vertPos[2].y, vertPos[1].y, vertPos[0].y, 0.f};
-                    pixelQuad.vertPosFlat[2] = {vertPos[0].z, vertPos[1].z, vertPos[2].z, 0.f};
-                    pixelQuad.vertPosFlat[3] = {vertPos[0].w, vertPos[1].w, vertPos[2].w, 0.f};
-                    // block rasterization
-                    int blockStartX = bounds.min.x + blockX * blockSize;
-                    int blockStartY = bounds.min.y + blockY * blockSize;
-                    for (int y = blockStartY + 1; y < blockStartY + blockSize && y <= bounds.max.y; y += 2)
-                    {
-                        for (int x = blockStartX + 1; x < blockStartX + blockSize && x <= bounds.max.x; x += 2)
-                        {
-                            pixelQuad.Init((float)x, (float)y, rasterSamples_);
-                            rasterizationPixelQuad(pixelQuad);
-                        }
-                    }
-#ifdef RASTER_MULTI_THREAD
-                });
-#endif
+                quad.Init((float)x, (float)y, rasterSamples_);
+                rasterizationPixelQuad(quad);
             }
         }
     }
@@ -803,6 +1209,7 @@ namespace SoftGL
             interpolateBarycentric((float *)pixel.varyingsFrag, quad.vertVaryings, varyingsCnt_, pixel.sampleShading->barycentric);
         }
         // pixel shading
+        quad.shaderProgram->getShaderBuiltin().dfCtx.quadId++;
         for (auto &pixel : quad.pixels)
         {
             if (!pixel.inside) { continue; }
@@ -817,13 +1224,13 @@ namespace SoftGL
                 {
                     auto &sample = pixel.samples[idx];
                     if (!sample.inside) { continue; }
-                    processPerSampleOperations(sample.fboCoord.x, sample.fboCoord.y, sample.position.z, builtIn.FragColor, idx);
+                    processPerSampleOperations(sample.fboCoord.x, sample.fboCoord.y, sample.position.z, builtIn.FragColor, idx, quad.tile);
                 }
             }
             else
             {
                 auto &sample = *pixel.sampleShading;
-                processPerSampleOperations(sample.fboCoord.x, sample.fboCoord.y, sample.position.z, builtIn.FragColor, 0);
+                processPerSampleOperations(sample.fboCoord.x, sample.fboCoord.y, sample.position.z, builtIn.FragColor, 0, quad.tile);
             }
         }
     }
@@ -840,7 +1247,7 @@ namespace SoftGL
                 {
                     auto &sample = pixel.samples[idx];
                     if (!sample.inside) { continue; }
-                    sample.inside = processDepthTest(sample.fboCoord.x, sample.fboCoord.y, sample.position.z, idx, true);
+                    sample.inside = processDepthTest(sample.fboCoord.x, sample.fboCoord.y, sample.position.z, idx, true, quad.tile);
                     if (sample.inside) { inside = true; }
                 }
                 pixel.inside = inside;
@@ -848,53 +1255,176 @@ namespace SoftGL
             else
             {
                 auto &sample = *pixel.sampleShading;
-                sample.inside = processDepthTest(sample.fboCoord.x, sample.fboCoord.y, sample.position.z, 0, true);
+                sample.inside = processDepthTest(sample.fboCoord.x, sample.fboCoord.y, sample.position.z, 0, true, quad.tile);
                 pixel.inside = sample.inside;
             }
         }
         return quad.CheckInside();
     }
 
-    void RendererSoft::multiSampleResolve()
+    void RendererSoft::loadTile(RasterTile &tile)
     {
-        if (!fboColor_->buffer)
+        if (fboColor_)
         {
-            fboColor_->buffer = Buffer<RGBA>::makeDefault(fboColor_->width, fboColor_->height);
+            if (fboColor_->multiSample)
+            {
+                tile.LoadBuffer(fboColor_->bufferMs4x.get(), (glm::tvec4<RGBA> *) tile.GetColorPtr());
+            }
+            else
+            {
+                tile.LoadBuffer(fboColor_->buffer.get(), tile.GetColorPtr());
+            }
         }
-        auto *srcPtr = fboColor_->bufferMs4x->getRawDataPtr();
-        auto *dstPtr = fboColor_->buffer->getRawDataPtr();
-        for (size_t row = 0; row < fboColor_->height; row++)
+        if (fboDepth_ && renderStates_->depthTest)
         {
-            auto *rowSrc = srcPtr + row * fboColor_->width;
-            auto *rowDst = dstPtr + row * fboColor_->width;
-#ifdef RASTER_MULTI_THREAD
-            threadPool_.pushTask([&, rowSrc, rowDst](int thread_id)
+            if (fboDepth_->multiSample)
             {
-#endif
-            auto *src = rowSrc;
-            auto *dst = rowDst;
-            for (size_t idx = 0; idx < fboColor_->width; idx++)
+                tile.LoadBuffer(fboDepth_->bufferMs4x.get(), (glm::tvec4<float> *) tile.GetDepthPtr());
+            }
+            else if (fboDepth_->packed)
+            {
+                tile.LoadBuffer(fboDepth_->packed.get(), tile.GetDepthPtr(), TexelPacking<float>::unpack);
+            }
+            else
+            {
+                tile.LoadBuffer(fboDepth_->buffer.get(), tile.GetDepthPtr());
+            }
+        }
+    }
+
+    void RendererSoft::storeTile(RasterTile &tile)
+    {
+        if (fboColor_ && tile.colorDirty)
+        {
+            if (fboColor_->multiSample)
             {
-                glm::vec4 color(0.f);
-                for (int i = 0; i < fboColor_->sampleCnt; i++)
+                tile.StoreBuffer(fboColor_->bufferMs4x.get(), (glm::tvec4<RGBA> *) tile.GetColorPtr());
+                // resolve while samples are still in cache
+                auto *src = (glm::tvec4<RGBA> *) tile.GetColorPtr();
+                auto *dst = tile.GetResolvePtr();
+                for (int y = 0; y < tile.height; y++)
                 {
-                    color += (glm::vec4) (*src)[i];
+                    for (int x = 0; x < tile.width; x++)
+                    {
+                        dst[y * tile.size + x] = resolveSamples(src[y * tile.size + x]);
+                    }
                 }
-                color /= fboColor_->sampleCnt;
-                *dst = color;
-                src++;
-                dst++;
+                tile.StoreBuffer(fboColor_->buffer.get(), tile.GetResolvePtr());
+            }
+            else
+            {
+                tile.StoreBuffer(fboColor_->buffer.get(), tile.GetColorPtr());
+            }
+        }
+        if (fboDepth_ && tile.depthDirty)
+        {
+            if (fboDepth_->multiSample)
+            {
+                tile.StoreBuffer(fboDepth_->bufferMs4x.get(), (glm::tvec4<float> *) tile.GetDepthPtr());
             }
+            else if (fboDepth_->packed)
+            {
+                tile.StoreBuffer(fboDepth_->packed.get(), tile.GetDepthPtr(), TexelPacking<float>::pack);
+            }
+            else
+            {
+                tile.StoreBuffer(fboDepth_->buffer.get(), tile.GetDepthPtr());
+            }
+        }
+    }
+
+    void RendererSoft::prepareResolveBuffer()
+    {
+        auto layout = fboColor_->bufferMs4x->getLayout();
+        if (!fboColor_->buffer || fboColor_->buffer->getLayout() != layout)
+        {
+            fboColor_->buffer = Buffer<RGBA>::makeLayout(fboColor_->width, fboColor_->height, layout);
+        }
+    }
+
+    RGBA RendererSoft::resolveSamples(const glm::tvec4<RGBA> &samples) const
+    {
+        glm::vec4 color(0.f);
+        if (fboColorSrgb_)
+        {
+            for (int i = 0; i < fboColor_->sampleCnt; i++)
+            {
+                color += ColorSpace::decode(samples[i]);
+            }
+            return ColorSpace::encode(color / (float) fboColor_->sampleCnt);
+        }
+        for (int i = 0; i < fboColor_->sampleCnt; i++)
+        {
+            color += (glm::vec4) samples[i];
+        }
+        color /= fboColor_->sampleCnt;
+        return color;
+    }
+
+    void RendererSoft::multiSampleResolve()
+    {
+        prepareResolveBuffer();
+        switch (fboColor_->bufferMs4x->getLayout())
+        {
+            case Layout_Tiled: multiSampleResolveImpl<Layout_Tiled>(); break;
+            case Layout_Morton: multiSampleResolveImpl<Layout_Morton>(); break;
+            default: multiSampleResolveImpl<Layout_Linear>(); break;
+        }
+    }
+
+    template<BufferLayout L>
+    void RendererSoft::multiSampleResolveImpl()
+    {
+        auto *srcBuffer = fboColor_->bufferMs4x.get();
+        auto *dstBuffer = fboColor_->buffer.get();
+
+        // tiles untouched since clear are resolved from tag
+        dstBuffer->fastClear(resolveSamples(srcBuffer->getClearValue()));
+
+        // raw access: touched source tiles are materialized, destination tiles are fully overwritten
+        auto *srcPtr = srcBuffer->getRawDataPtr();
+        auto *dstPtr = dstBuffer->getRawDataPtr();
+        auto srcView = srcBuffer->template view<L>();
+        auto dstView = dstBuffer->template view<L>();
+        size_t tileSize = Buffer<RGBA>::getClearTileSize();
+        for (size_t tileY = 0; tileY < srcBuffer->getClearTileCntY(); tileY++)
+        {
+            for (size_t tileX = 0; tileX < srcBuffer->getClearTileCntX(); tileX++)
+            {
+                if (srcBuffer->isTileCleared(tileX, tileY))
+                {
+                    continue;
+                }
+                dstBuffer->discardTileClear(tileX, tileY);
+#ifdef RASTER_MULTI_THREAD
+                threadPool_.pushTask(drawTasks_, [&, tileX, tileY](int thread_id)
+                {
+#endif
+                size_t xStart = tileX * tileSize;
+                size_t xEnd = std::min(xStart + tileSize, (size_t) fboColor_->width);
+                size_t yEnd = std::min((tileY + 1) * tileSize, (size_t) fboColor_->height);
+                for (size_t y = tileY * tileSize; y < yEnd; y++)
+                {
+                    for (size_t x = xStart; x < xEnd; x++)
+                    {
+                        dstPtr[dstView.convertIndex(x, y)] = resolveSamples(srcPtr[srcView.convertIndex(x, y)]);
+                    }
+                }
 #ifdef RASTER_MULTI_THREAD
-            });
+                });
 #endif
+            }
         }
-        threadPool_.waitTasksFinish();
+        drawTasks_.wait();
     }
 
-    RGBA *RendererSoft::getFrameColor(int x, int y, int sample)
+    RGBA *RendererSoft::getFrameColor(int x, int y, int sample, RasterTile *tile)
     {
         if (!fboColor_) { return nullptr; }
+        if (tile)
+        {
+            return tile->GetColor(x, y, sample);
+        }
         RGBA *ptr = nullptr;
         if (fboColor_->multiSample)
         {
@@ -911,9 +1441,13 @@ namespace SoftGL
         return ptr;
     }
 
-    float *RendererSoft::getFrameDepth(int x, int y, int sample)
+    float *RendererSoft::getFrameDepth(int x, int y, int sample, RasterTile *tile)
     {
         if (!fboDepth_) { return nullptr; }
+        if (tile)
+        {
+            return tile->GetDepth(x, y, sample);
+        }
         float *depthPtr = nullptr;
         if (fboDepth_->multiSample)
         {
@@ -930,65 +1464,98 @@ namespace SoftGL
         return depthPtr;
     }
 
-    void RendererSoft::setFrameColor(int x, int y, const RGBA &color, int sample)
+    void RendererSoft::setFrameColor(int x, int y, const RGBA &color, int sample, RasterTile *tile)
     {
-        RGBA *ptr = getFrameColor(x, y, sample);
+        RGBA *ptr = getFrameColor(x, y, sample, tile);
         if (ptr)
         {
             *ptr = color;
+            if (tile)
+            {
+                tile->colorDirty = true;
+            }
         }
     }
 
     size_t RendererSoft::clippingNewVertex(size_t idx0, size_t idx1, float t, bool postVertexProcess)
     {
-        vertexes_.emplace_back();
-        VertexHolder &vh = vertexes_.back();
-        vh.discard = false;
-        vh.index = vertexes_.size() - 1;
-        interpolateVertex(vh, vertexes_[idx0], vertexes_[idx1], t);
+        size_t idx = vertexes_.Append();
+        interpolateVertex(idx, idx0, idx1, t);
         if (postVertexProcess)
         {
-            perspectiveDivideImpl(vh);
-            viewportTransformImpl(vh);
+            perspectiveDivideImpl(idx, idx + 1);
+            viewportTransformImpl(idx, idx + 1);
         }
-        return vh.index;
+        return idx;
     }
 
-    void RendererSoft::vertexShaderImpl(VertexHolder &vertex)
+    void RendererSoft::vertexShaderImpl(size_t idx)
     {
-        shaderProgram_->bindVertexAttributes(vertex.vertex);
-        shaderProgram_->bindVertexShaderVaryings(vertex.varyings);
-        shaderProgram_->execVertexShader();
+        vertexShaderImpl(idx, shaderProgram_);
         pointSize_ = shaderProgram_->getShaderBuiltin().PointSize;
-        vertex.clipPos = shaderProgram_->getShaderBuiltin().Position;
-        vertex.clipMask = countFrustumClipMask(vertex.clipPos);
     }
 
-    void RendererSoft::perspectiveDivideImpl(VertexHolder &vertex)
+    void RendererSoft::vertexShaderImpl(size_t idx, ShaderProgramSoft *program)
     {
-        vertex.fragPos = vertex.clipPos;
-        auto &pos = vertex.fragPos;
-        float invW = 1.f / pos.w;
-        pos *= invW;
-        pos.w = invW;
+        program->bindVertexAttributes(vertexes_.vertex[idx]);
+        program->bindVertexShaderVaryings(vertexes_.varyings[idx]);
+        program->execVertexShader();
+        vertexes_.SetClipPos(idx, program->getShaderBuiltin().Position);
     }
 
-    void RendererSoft::viewportTransformImpl(VertexHolder &vertex)
+    void RendererSoft::perspectiveDivideImpl(size_t start, size_t end)
     {
-        vertex.fragPos *= viewport_.innerP;
-        vertex.fragPos += viewport_.innerO;
+        const float *clipX = vertexes_.clipX.data();
+        const float *clipY = vertexes_.clipY.data();
+        const float *clipZ = vertexes_.clipZ.data();
+        const float *clipW = vertexes_.clipW.data();
+        float *fragX = vertexes_.fragX.data();
+        float *fragY = vertexes_.fragY.data();
+        float *fragZ = vertexes_.fragZ.data();
+        float *fragW = vertexes_.fragW.data();
+        for (size_t i = start; i < end; i++)
+        {
+            float invW = 1.f / clipW[i];
+            fragX[i] = clipX[i] * invW;
+            fragY[i] = clipY[i] * invW;
+            fragZ[i] = clipZ[i] * invW;
+            fragW[i] = invW;
+        }
     }
 
-    int RendererSoft::countFrustumClipMask(glm::vec4 &clipPos)
+    void RendererSoft::viewportTransformImpl(size_t start, size_t end)
     {
-        int mask = 0;
-        if (clipPos.w < clipPos.x) mask |= FrustumClipMask::POSITIVE_X;
-        if (clipPos.w < -clipPos.x) mask |= FrustumClipMask::NEGATIVE_X;
-        if (clipPos.w < clipPos.y) mask |= FrustumClipMask::POSITIVE_Y;
-        if (clipPos.w < -clipPos.y) mask |= FrustumClipMask::NEGATIVE_Y;
-        if (clipPos.w < clipPos.z) mask |= FrustumClipMask::POSITIVE_Z;
-        if (clipPos.w < -clipPos.z) mask |= FrustumClipMask::NEGATIVE_Z;
-        return mask;
+        // w (1 / clip w) is not transformed
+        float *fragX = vertexes_.fragX.data();
+        float *fragY = vertexes_.fragY.data();
+        float *fragZ = vertexes_.fragZ.data();
+        const glm::vec4 &p = viewport_.innerP;
+        const glm::vec4 &o = viewport_.innerO;
+        for (size_t i = start; i < end; i++)
+        {
+            fragX[i] = fragX[i] * p.x + o.x;
+            fragY[i] = fragY[i] * p.y + o.y;
+            fragZ[i] = fragZ[i] * p.z + o.z;
+        }
+    }
+
+    void RendererSoft::countFrustumClipMask(size_t start, size_t end)
+    {
+        const float *clipX = vertexes_.clipX.data();
+        const float *clipY = vertexes_.clipY.data();
+        const float *clipZ = vertexes_.clipZ.data();
+        const float *clipW = vertexes_.clipW.data();
+        uint8_t *clipMask = vertexes_.clipMask.data();
+        for (size_t i = start; i < end; i++)
+        {
+            float w = clipW[i];
+            clipMask[i] = (w < clipX[i]) * FrustumClipMask::POSITIVE_X
+                        | (w < -clipX[i]) * FrustumClipMask::NEGATIVE_X
+                        | (w < clipY[i]) * FrustumClipMask::POSITIVE_Y
+                        | (w < -clipY[i]) * FrustumClipMask::NEGATIVE_Y
+                        | (w < clipZ[i]) * FrustumClipMask::POSITIVE_Z
+                        | (w < -clipZ[i]) * FrustumClipMask::NEGATIVE_Z;
+        }
     }
 
     BoundingBox RendererSoft::triangleBoundingBox(glm::vec4 *vert, float width, float height)
@@ -1047,19 +1614,18 @@ namespace SoftGL
         return true;
     }
 
-    void RendererSoft::interpolateVertex(VertexHolder &out, VertexHolder &v0, VertexHolder &v1, float t) 
+    void RendererSoft::interpolateVertex(size_t out, size_t v0, size_t v1, float t) 
     {
-        out.vertexHolder = MemoryUtils::makeBuffer<uint8_t>(vao_->vertexStride);
-        out.vertex = out.vertexHolder.get();
-        out.varyingsHolder = MemoryUtils::makeAlignedBuffer<float>(varyingsAlignedCnt_);
-        out.varyings = out.varyingsHolder.get();
+        vertexes_.vertex[out] = frameArena_.alloc<uint8_t>(fetchStride_);
+        vertexes_.varyings[out] = frameArena_.alloc<float>(varyingsAlignedCnt_);
 
-        // interpolate vertex (only support float element right now)
-        const float *vertexIn[2] = {(float *) v0.vertex, (float *) v1.vertex};
-        interpolateLinear((float *) out.vertex, vertexIn, vao_->vertexStride / sizeof(float), t);
+        // interpolate vertex (float elements, packed vertexes and instance attributes are already fetched)
+        const float *vertexIn[2] = {(float *) vertexes_.vertex[v0], (float *) vertexes_.vertex[v1]};
+        interpolateLinear((float *) vertexes_.vertex[out], vertexIn, fetchStride_ / sizeof(float), t);
 
         // vertex shader
         vertexShaderImpl(out);
+        countFrustumClipMask(out, out + 1);
     }
 
     void RendererSoft::interpolateLinear(float *varsOut, const float *varsIn[2], size_t elemCnt, float t) {
@@ -6,6 +6,7 @@
 #include "Render/Renderer.h"
 #include "Render/Software/VertexSoft.h"
 #include "Render/Software/FrameBufferSoft.h"
+#include "Render/Software/TextureStreamer.h"
 
 namespace SoftGL
 {
@@ -34,13 +35,26 @@ namespace SoftGL
         void setShaderResources(std::shared_ptr<ShaderResources> &uniforms) override;
         void setPipelineStates(std::shared_ptr<PipelineStates> &states) override;
         void draw() override;
+        void drawRanges(const std::vector<DrawRange> &ranges) override;
+        void drawInstanced(size_t instanceCnt) override;
+        void drawMulti(const std::vector<DrawCommand> &commands, const UniformTable &uniforms) override;
         void endRenderPass() override;
         void waitIdle() override;
     
     public:
         inline void setEnableEarlyZ(bool enable) { earlyZ_ = enable; } 
+        // tile-resident rasterization tile size (32 or 64), returns false and keeps the size if not valid
+        bool setRasterTileSize(int size);
+        // mip streaming of textures with an image loader, update once per frame
+        inline TextureStreamer &getTextureStreamer() { return textureStreamer_; }
+        // mip usage of mipmapped RGBA8 textures created while enabled
+        inline void setEnableSamplerFeedback(bool enable) { samplerFeedback_ = enable; }
+        inline std::vector<TextureFeedback> &getSamplerFeedback() { return feedbackTextures_; }
+        // merge per thread feedback records, once per frame
+        void updateSamplerFeedback();
     
     private:
+        void drawImpl();
         void processVertexShader();
         void processPrimitiveAssembly();
         void processClipping();
@@ -49,45 +63,56 @@ namespace SoftGL
         void processFaceCulling();
         void processRasterization();
         void processFragmentShader(glm::vec4 &screenPos, bool frontFacing, void *varyings, ShaderProgramSoft *shader);
-        void processPerSampleOperations(int x, int y, float depth, const glm::vec4 &color, int sample);
-        bool processDepthTest(int x, int y, float depth, int sample, bool skipWirte);
-        void processColorBlending(int x, int y, glm::vec4 &color, int sample);
+        void processPerSampleOperations(int x, int y, float depth, const glm::vec4 &color, int sample, RasterTile *tile = nullptr);
+        bool processDepthTest(int x, int y, float depth, int sample, bool skipWirte, RasterTile *tile = nullptr);
+        void processColorBlending(int x, int y, glm::vec4 &color, int sample, RasterTile *tile = nullptr);
 
         void processPointAssembly();
         void processLineAssembly();
         void processPolygonAssembly();
+        size_t countRangePrimitives(size_t primitiveSize) const;
+        void prepareThreadPrograms();
+        inline void bindDrawUniforms(ShaderProgramSoft *program, uint32_t draw);
 
-        void clippingPoint(PrimitiveHolder &point);
-        void clippingLine(PrimitiveHolder &line, bool postVertexProcess = false);
-        void clippingTriangle(PrimitiveHolder &triangle, std::vector<PrimitiveHolder> &appendPrimitives);
+        bool clippingPoint(uint32_t idx);
+        bool clippingLine(uint32_t *indices, bool postVertexProcess = false);
+        void clippingTriangle(size_t primitiveIdx);
 
-        void interpolateVertex(VertexHolder &out, VertexHolder &v0, VertexHolder &v1, float t);
+        void interpolateVertex(size_t out, size_t v0, size_t v1, float t);
         void interpolateLinear(float *varsOut, const float *varsIn[2], size_t elemCnt, float t);
         void interpolateBarycentric(float *varsOut, const float *varsIn[3], size_t elemCnt, glm::aligned_vec4 &bc);
         void interpolateBarycentricSIMD(float *varsOut, const float *varsIn[3], size_t elemCnt, glm::aligned_vec4 &bc);
 
-        void rasterizationPoint(VertexHolder *v, float pointSize);
-        void rasterizationLine(VertexHolder *v0, VertexHolder *v1, float lineWidth);
-        void rasterizationTriangle(VertexHolder *v0, VertexHolder *v1, VertexHolder *v2, bool frontFacing);
-        void rasterizationPolygons(std::vector<PrimitiveHolder> &primitives);
-        void rasterizationPolygonsPoint(std::vector<PrimitiveHolder> &primitives);
-        void rasterizationPolygonsLine(std::vector<PrimitiveHolder> &primitives);
-        void rasterizationPolygonsTriangle(std::vector<PrimitiveHolder> &primitives);
+        void rasterizationPoint(const glm::vec4 &fragPos, float *varyings, float pointSize);
+        void rasterizationLine(size_t idx0, size_t idx1, float lineWidth);
+        void rasterizationTriangle(const uint32_t *indices, bool frontFacing, PixelQuadContext &quad);
+        void rasterizationTile(int tileX, int tileY, PixelQuadContext &quad, RasterTile &tile);
+        void rasterizationPolygons();
+        void rasterizationPolygonsPoint();
+        void rasterizationPolygonsLine();
+        void rasterizationPolygonsTriangle();
         void rasterizationPixelQuad(PixelQuadContext &quad);
 
         bool earlyZTest(PixelQuadContext &quad);
+        void loadTile(RasterTile &tile);
+        void storeTile(RasterTile &tile);
+        void prepareResolveBuffer();
         void multiSampleResolve();
+        RGBA resolveSamples(const glm::tvec4<RGBA> &samples) const;
+        template<BufferLayout L>
+        void multiSampleResolveImpl();
 
     private:
-        inline RGBA *getFrameColor(int x, int y, int sample);
-        inline float *getFrameDepth(int x, int y, int sample);
-        inline void setFrameColor(int x, int y, const RGBA &color, int sample);
+        inline RGBA *getFrameColor(int x, int y, int sample, RasterTile *tile = nullptr);
+        inline float *getFrameDepth(int x, int y, int sample, RasterTile *tile = nullptr);
+        inline void setFrameColor(int x, int y, const RGBA &color, int sample, RasterTile *tile = nullptr);
 
         size_t clippingNewVertex(size_t idx0, size_t idx1, float t, bool postVertexProcess = false);
-        void vertexShaderImpl(VertexHolder &vertex);
-        void perspectiveDivideImpl(VertexHolder &vertex);
-        void viewportTransformImpl(VertexHolder &vertex);
-        int countFrustumClipMask(glm::vec4 &clipPos);
+        void vertexShaderImpl(size_t idx);
+        void vertexShaderImpl(size_t idx, ShaderProgramSoft *program);
+        void perspectiveDivideImpl(size_t start, size_t end);
+        void viewportTransformImpl(size_t start, size_t end);
+        void countFrustumClipMask(size_t start, size_t end);
         BoundingBox triangleBoundingBox(glm::vec4 *vert, float width, float height);
         bool barycentric(glm::aligned_vec4 *vert, glm::aligned_vec4 &v0, glm::aligned_vec4 &p, glm::aligned_vec4 &bc);
 
@@ -99,18 +124,39 @@ namespace SoftGL
         VertexArrayObjectSoft *vao_ = nullptr;
         ShaderProgramSoft *shaderProgram_ = nullptr;
         std::shared_ptr<ImageBufferSoft<RGBA>> fboColor_ = nullptr;
+        bool fboColorSrgb_ = false;
         std::shared_ptr<ImageBufferSoft<float>> fboDepth_ = nullptr;
-        std::vector<VertexHolder> vertexes_;
-        std::vector<PrimitiveHolder> primitives_;
-        std::shared_ptr<float> varyings_ = nullptr;
+        std::vector<DrawRange> drawRanges_;
+        bool drawAllVertexes_ = true;
+        std::vector<DrawUnit> drawUnits_;
+        uint8_t *drawUniforms_ = nullptr;    // uniform buffer image per draw unit of a multi draw
+        size_t drawUniformsSize_ = 0;
+        size_t fetchStride_ = 0;
+        std::vector<std::shared_ptr<ShaderProgramSoft>> threadPrograms_;   // per worker clones of the bound program
+        int threadProgramId_ = -1;
+        const uint8_t *threadProgramUniforms_ = nullptr;
+        std::vector<uint8_t> vertexUsed_;
+        VertexStreams vertexes_;
+        PrimitiveStreams primitives_;
+        MemoryArena frameArena_;
+        float *varyings_ = nullptr;
         size_t varyingsCnt_ = 0;
         size_t varyingsAlignedCnt_ = 0;
         size_t varyingsAlignedSize_ = 0;
         float pointSize_ = 1.0f;
         bool earlyZ_ = true;
         int rasterSamples_ = 1;
-        int rasterBlockSize_ = 1;
-        ThreadPool threadPool_;
+        int rasterTileSize_ = 32;
+        int rasterTileCntX_ = 0;
+        int rasterTileCntY_ = 0;
+        std::vector<std::vector<size_t>> rasterTileBins_;
+        ThreadPool &threadPool_ = ThreadPool::shared();
+        ThreadPool::TaskGroup drawTasks_;   // waited per draw stage, the pool also runs mipmap work
         std::vector<PixelQuadContext> threadQuadCtx_;
+        std::vector<std::unique_ptr<MemoryArena>> threadArenas_;   // per raster thread scratch, reset per draw
+        std::vector<RasterTile> threadRasterTile_;
+        TextureStreamer textureStreamer_;
+        bool samplerFeedback_ = false;
+        std::vector<TextureFeedback> feedbackTextures_;
     };
 }
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include "Base/GLMInc.h"
+#include "Render/Texture.h"
+
+namespace SoftGL
+{
+    #define FEEDBACK_MAX_LEVELS 16
+    #define FEEDBACK_REGIONS 8      // feedback map is FEEDBACK_REGIONS x FEEDBACK_REGIONS over uv [0, 1)
+    #define FEEDBACK_LEVEL_NONE 0xFF
+
+    // merged mip usage of one texture, counts accumulate until reset
+    struct FeedbackStats
+    {
+        uint64_t levelCounts[FEEDBACK_MAX_LEVELS];
+        uint8_t regionMinLevel[FEEDBACK_REGIONS * FEEDBACK_REGIONS];
+        int minLevel;           // finest level sampled
+        int frameMinLevel;      // finest level sampled last frame
+
+        FeedbackStats()
+        {
+            reset();
+        }
+
+        inline void reset()
+        {
+            memset(levelCounts, 0, sizeof(levelCounts));
+            memset(regionMinLevel, FEEDBACK_LEVEL_NONE, sizeof(regionMinLevel));
+            minLevel = FEEDBACK_LEVEL_NONE;
+            frameMinLevel = FEEDBACK_LEVEL_NONE;
+        }
+    };
+
+    // records sampled mip levels of a texture. threads are spread over slots to keep contention low,
+    // a slot may still be shared so updates are atomic RMWs. slots are merged once per frame when no draw is running
+    class SamplerFeedback
+    {
+    public:
+        SamplerFeedback() : slotCnt_(std::max(1u, std::thread::hardware_concurrency())), slots_(new Slot[slotCnt_]) {}
+
+        inline void record(const glm::vec2 &uv, int level)
+        {
+            Slot &slot = slots_[threadIndex() % slotCnt_];
+            level = std::min(level, FEEDBACK_MAX_LEVELS - 1);
+            slot.levelCounts[level].fetch_add(1, std::memory_order_relaxed);
+
+            int rx = std::min((int) ((uv.x - std::floor(uv.x)) * FEEDBACK_REGIONS), FEEDBACK_REGIONS - 1);
+            int ry = std::min((int) ((uv.y - std::floor(uv.y)) * FEEDBACK_REGIONS), FEEDBACK_REGIONS - 1);
+            auto &regionMin = slot.regionMinLevel[ry * FEEDBACK_REGIONS + rx];
+            uint8_t current = regionMin.load(std::memory_order_relaxed);
+            while (level < current && !regionMin.compare_exchange_weak(current, (uint8_t) level, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        // merge and clear all thread slots
+        void resolve(FeedbackStats &stats)
+        {
+            stats.frameMinLevel = FEEDBACK_LEVEL_NONE;
+            for (size_t i = 0; i < slotCnt_; i++)
+            {
+                Slot &slot = slots_[i];
+                for (int level = 0; level < FEEDBACK_MAX_LEVELS; level++)
+                {
+                    uint32_t cnt = slot.levelCounts[level].exchange(0, std::memory_order_relaxed);
+                    if (cnt > 0)
+                    {
+                        stats.levelCounts[level] += cnt;
+                        stats.frameMinLevel = std::min(stats.frameMinLevel, level);
+                    }
+                }
+                for (int r = 0; r < FEEDBACK_REGIONS * FEEDBACK_REGIONS; r++)
+                {
+                    uint8_t level = slot.regionMinLevel[r].exchange(FEEDBACK_LEVEL_NONE, std::memory_order_relaxed);
+                    stats.regionMinLevel[r] = std::min(stats.regionMinLevel[r], level);
+                }
+            }
+            stats.minLevel = std::min(stats.minLevel, stats.frameMinLevel);
+        }
+
+    private:
+        struct Slot
+        {
+            std::atomic<uint32_t> levelCounts[FEEDBACK_MAX_LEVELS];
+            std::atomic<uint8_t> regionMinLevel[FEEDBACK_REGIONS * FEEDBACK_REGIONS];
+
+            Slot()
+            {
+                for (auto &cnt : levelCounts)
+                {
+                    cnt.store(0);
+                }
+                for (auto &level : regionMinLevel)
+                {
+                    level.store(FEEDBACK_LEVEL_NONE);
+                }
+            }
+        };
+
+        static inline size_t threadIndex()
+        {
+            static std::atomic<size_t> nextIndex{0};
+            static thread_local size_t index = nextIndex++;
+            return index;
+        }
+
+    private:
+        size_t slotCnt_;
+        std::unique_ptr<Slot[]> slots_;
+    };
+
+    // feedback of a texture created while collection is enabled
+    struct TextureFeedback
+    {
+        std::weak_ptr<Texture> texture;
+        std::shared_ptr<SamplerFeedback> feedback;
+        FeedbackStats stats;
+    };
+}
@@ -0,0 +1,619 @@
+#pragma once
+
+#include <cstring>
+#include "Base/Buffer.h"
+#include "Base/BlockCompression.h"
+#include "Base/ColorSpace.h"
+#include "Render/Texture.h"
+
+#ifdef SOFTGL_SIMD_OPT
+#include <immintrin.h>
+#endif
+
+namespace SoftGL
+{
+    // texel coordinate wrapping, resolved at compile time. return false if texel is border color
+    template<WrapMode W>
+    struct TexelWrap;
+
+    template<>
+    struct TexelWrap<Wrap_REPEAT>
+    {
+        static inline bool apply(int &x, int &y, int w, int h)
+        {
+            x = ((x % w) + w) % w;
+            y = ((y % h) + h) % h;
+            return true;
+        }
+    };
+
+    template<>
+    struct TexelWrap<Wrap_MIRRORED_REPEAT>
+    {
+        static inline bool apply(int &x, int &y, int w, int h)
+        {
+            x = ((x % (2 * w)) + 2 * w) % (2 * w);
+            y = ((y % (2 * h)) + 2 * h) % (2 * h);
+            x = x < w ? x : 2 * w - 1 - x;
+            y = y < h ? y : 2 * h - 1 - y;
+            return true;
+        }
+    };
+
+    template<>
+    struct TexelWrap<Wrap_CLAMP_TO_EDGE>
+    {
+        static inline bool apply(int &x, int &y, int w, int h)
+        {
+            x = glm::clamp(x, 0, w - 1);
+            y = glm::clamp(y, 0, h - 1);
+            return true;
+        }
+    };
+
+    template<>
+    struct TexelWrap<Wrap_CLAMP_TO_BORDER>
+    {
+        static inline bool apply(int &x, int &y, int w, int h)
+        {
+            return x >= 0 && x < w && y >= 0 && y < h;
+        }
+    };
+
+    // memory index of 4 texels at once, texels masked as border get index 0
+    template<BufferLayout L>
+    struct TexelIndexer
+    {
+        static inline void index4(const int *xs, const int *ys, size_t innerWidth, const int32_t *mask, int32_t *index)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                index[i] = mask[i] ? (int32_t)BufferIndexer<L>::index(xs[i], ys[i], innerWidth) : 0;
+            }
+        }
+    };
+
+#ifdef SOFTGL_SIMD_OPT
+    template<>
+    struct TexelIndexer<Layout_Linear>
+    {
+        static inline void index4(const int *xs, const int *ys, size_t innerWidth, const int32_t *mask, int32_t *index)
+        {
+            __m128i x = _mm_loadu_si128((const __m128i *)xs);
+            __m128i y = _mm_loadu_si128((const __m128i *)ys);
+            __m128i idx = _mm_add_epi32(x, _mm_mullo_epi32(y, _mm_set1_epi32((int)innerWidth)));
+            _mm_storeu_si128((__m128i *)index, _mm_and_si128(idx, _mm_loadu_si128((const __m128i *)mask)));
+        }
+    };
+
+    template<>
+    struct TexelIndexer<Layout_Tiled>
+    {
+        static inline void index4(const int *xs, const int *ys, size_t innerWidth, const int32_t *mask, int32_t *index)
+        {
+            const int bits = BufferIndexer<Layout_Tiled>::bits;
+            __m128i x = _mm_loadu_si128((const __m128i *)xs);
+            __m128i y = _mm_loadu_si128((const __m128i *)ys);
+            __m128i inTileMask = _mm_set1_epi32(BufferIndexer<Layout_Tiled>::tileSize - 1);
+            __m128i tile = _mm_add_epi32(_mm_mullo_epi32(_mm_srli_epi32(y, bits), _mm_set1_epi32((int)(innerWidth >> bits))),
+                                         _mm_srli_epi32(x, bits));
+            __m128i inTile = _mm_add_epi32(_mm_slli_epi32(_mm_and_si128(y, inTileMask), bits), _mm_and_si128(x, inTileMask));
+            __m128i idx = _mm_add_epi32(_mm_slli_epi32(tile, 2 * bits), inTile);
+            _mm_storeu_si128((__m128i *)index, _mm_and_si128(idx, _mm_loadu_si128((const __m128i *)mask)));
+        }
+    };
+
+    template<>
+    struct TexelIndexer<Layout_Morton>
+    {
+        // spread 5 bits in tile coordinate to even bits, same as encode16_morton2
+        static inline __m128i spreadBits(__m128i v)
+        {
+            v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 4)), _mm_set1_epi32(0x0f0f));
+            v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 2)), _mm_set1_epi32(0x3333));
+            v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 1)), _mm_set1_epi32(0x5555));
+            return v;
+        }
+
+        static inline void index4(const int *xs, const int *ys, size_t innerWidth, const int32_t *mask, int32_t *index)
+        {
+            const int bits = BufferIndexer<Layout_Morton>::bits;
+            __m128i x = _mm_loadu_si128((const __m128i *)xs);
+            __m128i y = _mm_loadu_si128((const __m128i *)ys);
+            __m128i inTileMask = _mm_set1_epi32(BufferIndexer<Layout_Morton>::tileSize - 1);
+            __m128i tile = _mm_add_epi32(_mm_mullo_epi32(_mm_srli_epi32(y, bits), _mm_set1_epi32((int)(innerWidth >> bits))),
+                                         _mm_srli_epi32(x, bits));
+            __m128i morton = _mm_or_si128(spreadBits(_mm_and_si128(x, inTileMask)),
+                                          _mm_slli_epi32(spreadBits(_mm_and_si128(y, inTileMask)), 1));
+            __m128i idx = _mm_add_epi32(_mm_slli_epi32(tile, 2 * bits), morton);
+            _mm_storeu_si128((__m128i *)index, _mm_and_si128(idx, _mm_loadu_si128((const __m128i *)mask)));
+        }
+    };
+#endif
+
+    // memory index and weight of 2x2 texels used by bilinear filter
+    struct BilinearFootprint
+    {
+        int32_t index[4];   // texel (0, 0), (1, 0), (0, 1), (1, 1)
+        int32_t mask[4];    // -1: inside, 0: border color
+        float weight[4];
+
+        // weights and wrapped coordinates, texels out of border are masked
+        template<WrapMode W>
+        inline void initCoords(glm::vec2 texUV, int w, int h, int *xs, int *ys)
+        {
+            float fx = texUV.x - 0.5f;
+            float fy = texUV.y - 0.5f;
+            int x0 = (int)std::floor(fx);
+            int y0 = (int)std::floor(fy);
+            fx -= (float)x0;
+            fy -= (float)y0;
+
+            weight[0] = (1.f - fx) * (1.f - fy);
+            weight[1] = fx * (1.f - fy);
+            weight[2] = (1.f - fx) * fy;
+            weight[3] = fx * fy;
+
+            for (int i = 0; i < 4; i++)
+            {
+                xs[i] = x0 + (i & 1);
+                ys[i] = y0 + (i >> 1);
+                mask[i] = TexelWrap<W>::apply(xs[i], ys[i], w, h) ? -1 : 0;
+            }
+        }
+
+        // buffer must have no pending fast clear, see TextureImageSoft::flushClear
+        template<WrapMode W, BufferLayout L, typename T>
+        inline void init(Buffer<T> *buffer, glm::vec2 texUV)
+        {
+            int xs[4], ys[4];
+            initCoords<W>(texUV, (int)buffer->getWidth(), (int)buffer->getHeight(), xs, ys);
+            TexelIndexer<L>::index4(xs, ys, BufferIndexer<L>::innerSize(buffer->getWidth()), mask, index);
+        }
+    };
+
+    // weighted sum of texels, generic version works on texel type directly
+    template<typename T>
+    struct TexelFilter
+    {
+        static inline T bilinear(const T *ptr, const BilinearFootprint &fp, const T &border)
+        {
+            T s[4];
+            for (int i = 0; i < 4; i++)
+            {
+                s[i] = fp.mask[i] ? ptr[fp.index[i]] : border;
+            }
+            float fx = fp.weight[1] + fp.weight[3];
+            float fy = fp.weight[2] + fp.weight[3];
+            return glm::mix(glm::mix(s[0], s[1], fx), glm::mix(s[2], s[3], fx), fy);
+        }
+
+        static inline T trilinear(const T *ptrHi, const BilinearFootprint &fpHi,
+                                  const T *ptrLo, const BilinearFootprint &fpLo, float f, const T &border)
+        {
+            return glm::mix(bilinear(ptrHi, fpHi, border), bilinear(ptrLo, fpLo, border), f);
+        }
+    };
+
+#ifdef SOFTGL_SIMD_OPT
+    // RGBA8: gather 4 texels as int32, filter in float
+    template<>
+    struct TexelFilter<RGBA>
+    {
+        static inline __m128 gatherWeighted(const RGBA *ptr, const BilinearFootprint &fp, const RGBA &border, float scale, __m128 sum)
+        {
+            int32_t borderBits;
+            memcpy(&borderBits, &border, sizeof(int32_t));
+            __m128i texels = _mm_mask_i32gather_epi32(_mm_set1_epi32(borderBits), (const int *)ptr,
+                                                      _mm_loadu_si128((const __m128i *)fp.index),
+                                                      _mm_loadu_si128((const __m128i *)fp.mask), 4);
+            __m128 w = _mm_mul_ps(_mm_loadu_ps(fp.weight), _mm_set1_ps(scale));
+            __m128 t0 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(texels));
+            __m128 t1 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(texels, 4)));
+            __m128 t2 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(texels, 8)));
+            __m128 t3 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(texels, 12)));
+            sum = _mm_fmadd_ps(t0, _mm_shuffle_ps(w, w, _MM_SHUFFLE(0, 0, 0, 0)), sum);
+            sum = _mm_fmadd_ps(t1, _mm_shuffle_ps(w, w, _MM_SHUFFLE(1, 1, 1, 1)), sum);
+            sum = _mm_fmadd_ps(t2, _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 2, 2)), sum);
+            sum = _mm_fmadd_ps(t3, _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 3, 3)), sum);
+            return sum;
+        }
+
+        static inline RGBA pack(__m128 color)
+        {
+            __m128i c = _mm_cvtps_epi32(color);
+            c = _mm_packus_epi16(_mm_packus_epi32(c, c), c);
+            int32_t bits = _mm_cvtsi128_si32(c);
+            RGBA ret;
+            memcpy(&ret, &bits, sizeof(int32_t));
+            return ret;
+        }
+
+        static inline RGBA bilinear(const RGBA *ptr, const BilinearFootprint &fp, const RGBA &border)
+        {
+            return pack(gatherWeighted(ptr, fp, border, 1.f, _mm_setzero_ps()));
+        }
+
+        static inline RGBA trilinear(const RGBA *ptrHi, const BilinearFootprint &fpHi,
+                                     const RGBA *ptrLo, const BilinearFootprint &fpLo, float f, const RGBA &border)
+        {
+            __m128 sum = gatherWeighted(ptrHi, fpHi, border, 1.f - f, _mm_setzero_ps());
+            sum = gatherWeighted(ptrLo, fpLo, border, f, sum);
+            return pack(sum);
+        }
+    };
+
+    // float (depth): gather 4 texels into one register, dot with weights
+    template<>
+    struct TexelFilter<float>
+    {
+        static inline __m128 gatherWeighted(const float *ptr, const BilinearFootprint &fp, float border, float scale, __m128 sum)
+        {
+            __m128 texels = _mm_mask_i32gather_ps(_mm_set1_ps(border), ptr,
+                                                  _mm_loadu_si128((const __m128i *)fp.index),
+                                                  _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)fp.mask)), 4);
+            __m128 w = _mm_mul_ps(_mm_loadu_ps(fp.weight), _mm_set1_ps(scale));
+            return _mm_fmadd_ps(texels, w, sum);
+        }
+
+        static inline float horizontalSum(__m128 v)
+        {
+            __m128 t = _mm_add_ps(v, _mm_movehl_ps(v, v));
+            t = _mm_add_ss(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 1, 1, 1)));
+            return _mm_cvtss_f32(t);
+        }
+
+        static inline float bilinear(const float *ptr, const BilinearFootprint &fp, const float &border)
+        {
+            return horizontalSum(gatherWeighted(ptr, fp, border, 1.f, _mm_setzero_ps()));
+        }
+
+        static inline float trilinear(const float *ptrHi, const BilinearFootprint &fpHi,
+                                      const float *ptrLo, const BilinearFootprint &fpLo, float f, const float &border)
+        {
+            __m128 sum = gatherWeighted(ptrHi, fpHi, border, 1.f - f, _mm_setzero_ps());
+            sum = gatherWeighted(ptrLo, fpLo, border, f, sum);
+            return horizontalSum(sum);
+        }
+    };
+#endif
+
+    // sampling kernels specialized by texel type, wrap mode and memory layout
+    template<typename T, WrapMode W, BufferLayout L>
+    struct SampleKernel
+    {
+        static inline T texel(Buffer<T> *buffer, int x, int y, const T &border)
+        {
+            if (!TexelWrap<W>::apply(x, y, (int)buffer->getWidth(), (int)buffer->getHeight()))
+            {
+                return border;
+            }
+            return buffer->getRawDataPtr()[BufferIndexer<L>::index(x, y, BufferIndexer<L>::innerSize(buffer->getWidth()))];
+        }
+
+        static inline T nearest(Buffer<T> *buffer, const glm::vec2 &uv, const glm::ivec2 &offset, const T &border)
+        {
+            int x = (int)std::floor(uv.x * (float)buffer->getWidth()) + offset.x;
+            int y = (int)std::floor(uv.y * (float)buffer->getHeight()) + offset.y;
+            return texel(buffer, x, y, border);
+        }
+
+        // texUV: texel space coordinate
+        static inline T bilinearTexel(Buffer<T> *buffer, const glm::vec2 &texUV, const T &border)
+        {
+            BilinearFootprint fp;
+            fp.init<W, L>(buffer, texUV);
+            return TexelFilter<T>::bilinear(buffer->getRawDataPtr(), fp, border);
+        }
+
+        static inline T bilinear(Buffer<T> *buffer, const glm::vec2 &uv, const glm::ivec2 &offset, const T &border)
+        {
+            glm::vec2 texUV = uv * glm::vec2(buffer->getWidth(), buffer->getHeight()) + glm::vec2(offset);
+            return bilinearTexel(buffer, texUV, border);
+        }
+
+        // bilinear on two mip levels, blended in one pass
+        static inline T trilinear(Buffer<T> *bufferHi, Buffer<T> *bufferLo, const glm::vec2 &uv,
+                                  const glm::ivec2 &offset, float f, const T &border)
+        {
+            BilinearFootprint fpHi, fpLo;
+            fpHi.init<W, L>(bufferHi, uv * glm::vec2(bufferHi->getWidth(), bufferHi->getHeight()) + glm::vec2(offset));
+            fpLo.init<W, L>(bufferLo, uv * glm::vec2(bufferLo->getWidth(), bufferLo->getHeight()) + glm::vec2(offset));
+            return TexelFilter<T>::trilinear(bufferHi->getRawDataPtr(), fpHi, bufferLo->getRawDataPtr(), fpLo, f, border);
+        }
+    };
+
+    // sampling kernels of block compressed images, texels are fetched through the block cache
+    template<WrapMode W>
+    struct BlockSampleKernel
+    {
+        static inline RGBA texel(BlockBuffer *blocks, int x, int y, const RGBA &border)
+        {
+            if (!TexelWrap<W>::apply(x, y, (int)blocks->getWidth(), (int)blocks->getHeight()))
+            {
+                return border;
+            }
+            return blocks->getTexel(x, y);
+        }
+
+        static inline RGBA nearest(BlockBuffer *blocks, const glm::vec2 &uv, const glm::ivec2 &offset, const RGBA &border)
+        {
+            int x = (int)std::floor(uv.x * (float)blocks->getWidth()) + offset.x;
+            int y = (int)std::floor(uv.y * (float)blocks->getHeight()) + offset.y;
+            return texel(blocks, x, y, border);
+        }
+
+        // fetch 2x2 texels into a local array, footprint indexes into it
+        static inline void gather(BlockBuffer *blocks, const glm::vec2 &texUV, BilinearFootprint &fp, RGBA *texels, const RGBA &border)
+        {
+            int xs[4], ys[4];
+            fp.initCoords<W>(texUV, (int)blocks->getWidth(), (int)blocks->getHeight(), xs, ys);
+            for (int i = 0; i < 4; i++)
+            {
+                texels[i] = fp.mask[i] ? blocks->getTexel(xs[i], ys[i]) : border;
+                fp.index[i] = i;
+            }
+        }
+
+        static inline RGBA bilinear(BlockBuffer *blocks, const glm::vec2 &uv, const glm::ivec2 &offset, const RGBA &border)
+        {
+            BilinearFootprint fp;
+            RGBA texels[4];
+            gather(blocks, uv * glm::vec2(blocks->getWidth(), blocks->getHeight()) + glm::vec2(offset), fp, texels, border);
+            return TexelFilter<RGBA>::bilinear(texels, fp, border);
+        }
+
+        static inline RGBA trilinear(BlockBuffer *blocksHi, BlockBuffer *blocksLo, const glm::vec2 &uv,
+                                     const glm::ivec2 &offset, float f, const RGBA &border)
+        {
+            BilinearFootprint fpHi, fpLo;
+            RGBA texelsHi[4], texelsLo[4];
+            gather(blocksHi, uv * glm::vec2(blocksHi->getWidth(), blocksHi->getHeight()) + glm::vec2(offset), fpHi, texelsHi, border);
+            gather(blocksLo, uv * glm::vec2(blocksLo->getWidth(), blocksLo->getHeight()) + glm::vec2(offset), fpLo, texelsLo, border);
+            return TexelFilter<RGBA>::trilinear(texelsHi, fpHi, texelsLo, fpLo, f, border);
+        }
+    };
+
+    // sampling kernels of packed images (half float, unorm16), P: packing traits of the sampled type
+    template<typename P, WrapMode W, BufferLayout L>
+    struct PackedSampleKernel
+    {
+        typedef typename P::Type T;
+        typedef typename P::Packed Packed;
+
+        static inline T texel(Buffer<Packed> *buffer, int x, int y, const T &border)
+        {
+            if (!TexelWrap<W>::apply(x, y, (int)buffer->getWidth(), (int)buffer->getHeight()))
+            {
+                return border;
+            }
+            return P::unpack(buffer->getRawDataPtr()[BufferIndexer<L>::index(x, y, BufferIndexer<L>::innerSize(buffer->getWidth()))]);
+        }
+
+        static inline T nearest(Buffer<Packed> *buffer, const glm::vec2 &uv, const glm::ivec2 &offset, const T &border)
+        {
+            int x = (int)std::floor(uv.x * (float)buffer->getWidth()) + offset.x;
+            int y = (int)std::floor(uv.y * (float)buffer->getHeight()) + offset.y;
+            return texel(buffer, x, y, border);
+        }
+
+        // unpack 2x2 texels into a local array, footprint indexes into it
+        static inline void gather(Buffer<Packed> *buffer, const glm::vec2 &texUV, BilinearFootprint &fp, T *texels, const T &border)
+        {
+            fp.init<W, L>(buffer, texUV);
+            const Packed *ptr = buffer->getRawDataPtr();
+            for (int i = 0; i < 4; i++)
+            {
+                texels[i] = fp.mask[i] ? P::unpack(ptr[fp.index[i]]) : border;
+                fp.index[i] = i;
+            }
+        }
+
+        static inline T bilinear(Buffer<Packed> *buffer, const glm::vec2 &uv, const glm::ivec2 &offset, const T &border)
+        {
+            BilinearFootprint fp;
+            T texels[4];
+            gather(buffer, uv * glm::vec2(buffer->getWidth(), buffer->getHeight()) + glm::vec2(offset), fp, texels, border);
+            return TexelFilter<T>::bilinear(texels, fp, border);
+        }
+
+        static inline T trilinear(Buffer<Packed> *bufferHi, Buffer<Packed> *bufferLo, const glm::vec2 &uv,
+                                  const glm::ivec2 &offset, float f, const T &border)
+        {
+            BilinearFootprint fpHi, fpLo;
+            T texelsHi[4], texelsLo[4];
+            gather(bufferHi, uv * glm::vec2(bufferHi->getWidth(), bufferHi->getHeight()) + glm::vec2(offset), fpHi, texelsHi, border);
+            gather(bufferLo, uv * glm::vec2(bufferLo->getWidth(), bufferLo->getHeight()) + glm::vec2(offset), fpLo, texelsLo, border);
+            return TexelFilter<T>::trilinear(texelsHi, fpHi, texelsLo, fpLo, f, border);
+        }
+    };
+
+    // sRGB RGBA8: texels are decoded by table, filtered in linear space and encoded back
+    struct SrgbTexelFilter
+    {
+        static inline glm::vec4 weightedSum(const RGBA *ptr, const BilinearFootprint &fp, const RGBA &border, float scale, glm::vec4 sum)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                sum += ColorSpace::decode(fp.mask[i] ? ptr[fp.index[i]] : border) * (fp.weight[i] * scale);
+            }
+            return sum;
+        }
+
+        static inline RGBA bilinear(const RGBA *ptr, const BilinearFootprint &fp, const RGBA &border)
+        {
+            return ColorSpace::encode(weightedSum(ptr, fp, border, 1.f, glm::vec4(0.f)));
+        }
+
+        static inline RGBA trilinear(const RGBA *ptrHi, const BilinearFootprint &fpHi,
+                                     const RGBA *ptrLo, const BilinearFootprint &fpLo, float f, const RGBA &border)
+        {
+            glm::vec4 sum = weightedSum(ptrHi, fpHi, border, 1.f - f, glm::vec4(0.f));
+            return ColorSpace::encode(weightedSum(ptrLo, fpLo, border, f, sum));
+        }
+    };
+
+    // sampling kernels of sRGB images, only RGBA8 images are sRGB encoded
+    template<typename T, WrapMode W, BufferLayout L>
+    struct SrgbSampleKernel : SampleKernel<T, W, L> {};
+
+    template<WrapMode W, BufferLayout L>
+    struct SrgbSampleKernel<RGBA, W, L>
+    {
+        static inline RGBA nearest(Buffer<RGBA> *buffer, const glm::vec2 &uv, const glm::ivec2 &offset, const RGBA &border)
+        {
+            return SampleKernel<RGBA, W, L>::nearest(buffer, uv, offset, border);
+        }
+
+        static inline RGBA bilinearTexel(Buffer<RGBA> *buffer, const glm::vec2 &texUV, const RGBA &border)
+        {
+            BilinearFootprint fp;
+            fp.init<W, L>(buffer, texUV);
+            return SrgbTexelFilter::bilinear(buffer->getRawDataPtr(), fp, border);
+        }
+
+        static inline RGBA bilinear(Buffer<RGBA> *buffer, const glm::vec2 &uv, const glm::ivec2 &offset, const RGBA &border)
+        {
+            glm::vec2 texUV = uv * glm::vec2(buffer->getWidth(), buffer->getHeight()) + glm::vec2(offset);
+            return bilinearTexel(buffer, texUV, border);
+        }
+
+        static inline RGBA trilinear(Buffer<RGBA> *bufferHi, Buffer<RGBA> *bufferLo, const glm::vec2 &uv,
+                                     const glm::ivec2 &offset, float f, const RGBA &border)
+        {
+            BilinearFootprint fpHi, fpLo;
+            fpHi.init<W, L>(bufferHi, uv * glm::vec2(bufferHi->getWidth(), bufferHi->getHeight()) + glm::vec2(offset));
+            fpLo.init<W, L>(bufferLo, uv * glm::vec2(bufferLo->getWidth(), bufferLo->getHeight()) + glm::vec2(offset));
+            return SrgbTexelFilter::trilinear(bufferHi->getRawDataPtr(), fpHi, bufferLo->getRawDataPtr(), fpLo, f, border);
+        }
+    };
+
+    // sampling of buffers not bound to a texture, memory layout is dispatched per call
+    template<typename T, WrapMode W>
+    struct BufferSampleKernel
+    {
+        static inline T texel(Buffer<T> *buffer, int x, int y, const T &border)
+        {
+            switch (buffer->getLayout())
+            {
+                case Layout_Tiled:  return SampleKernel<T, W, Layout_Tiled>::texel(buffer, x, y, border);
+                case Layout_Morton: return SampleKernel<T, W, Layout_Morton>::texel(buffer, x, y, border);
+                default:            break;
+            }
+            return SampleKernel<T, W, Layout_Linear>::texel(buffer, x, y, border);
+        }
+
+        static inline T nearest(Buffer<T> *buffer, const glm::vec2 &uv, const glm::ivec2 &offset, const T &border)
+        {
+            switch (buffer->getLayout())
+            {
+                case Layout_Tiled:  return SampleKernel<T, W, Layout_Tiled>::nearest(buffer, uv, offset, border);
+                case Layout_Morton: return SampleKernel<T, W, Layout_Morton>::nearest(buffer, uv, offset, border);
+                default:            break;
+            }
+            return SampleKernel<T, W, Layout_Linear>::nearest(buffer, uv, offset, border);
+        }
+
+        static inline T bilinearTexel(Buffer<T> *buffer, const glm::vec2 &texUV, const T &border)
+        {
+            switch (buffer->getLayout())
+            {
+                case Layout_Tiled:  return SampleKernel<T, W, Layout_Tiled>::bilinearTexel(buffer, texUV, border);
+                case Layout_Morton: return SampleKernel<T, W, Layout_Morton>::bilinearTexel(buffer, texUV, border);
+                default:            break;
+            }
+            return SampleKernel<T, W, Layout_Linear>::bilinearTexel(buffer, texUV, border);
+        }
+    };
+
+    // 2x2 box average used by mipmap generation
+    template<typename T>
+    struct TexelBox
+    {
+        static inline T average(const T &a, const T &b, const T &c, const T &d)
+        {
+            return glm::mix(glm::mix(a, b, 0.5f), glm::mix(c, d, 0.5f), 0.5f);
+        }
+    };
+
+    template<>
+    struct TexelBox<float>
+    {
+        static inline float average(const float &a, const float &b, const float &c, const float &d)
+        {
+            return (a + b + c + d) * 0.25f;
+        }
+    };
+
+    template<>
+    struct TexelBox<RGBA>
+    {
+        static inline RGBA average(const RGBA &a, const RGBA &b, const RGBA &c, const RGBA &d)
+        {
+#ifdef SOFTGL_SIMD_OPT
+            int32_t bits[4];
+            memcpy(&bits[0], &a, sizeof(int32_t));
+            memcpy(&bits[1], &b, sizeof(int32_t));
+            memcpy(&bits[2], &c, sizeof(int32_t));
+            memcpy(&bits[3], &d, sizeof(int32_t));
+            __m128i texels = _mm_loadu_si128((const __m128i *)bits);
+            // widen to 16 bits, sum of (a, b) and (c, d) in each 64 bits half
+            __m128i sum = _mm_add_epi16(_mm_cvtepu8_epi16(texels), _mm_cvtepu8_epi16(_mm_srli_si128(texels, 8)));
+            sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+            int32_t avg = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+            RGBA ret;
+            memcpy(&ret, &avg, sizeof(int32_t));
+            return ret;
+#else
+            glm::u16vec4 sum = glm::u16vec4(a) + glm::u16vec4(b) + glm::u16vec4(c) + glm::u16vec4(d);
+            return RGBA((sum + glm::u16vec4(2)) / glm::u16vec4(4));
+#endif
+        }
+    };
+
+    // box average of sRGB images in linear space
+    template<typename T>
+    struct TexelBoxSrgb : TexelBox<T> {};
+
+    template<>
+    struct TexelBoxSrgb<RGBA>
+    {
+        static inline RGBA average(const RGBA &a, const RGBA &b, const RGBA &c, const RGBA &d)
+        {
+            glm::vec4 sum = ColorSpace::decode(a) + ColorSpace::decode(b) + ColorSpace::decode(c) + ColorSpace::decode(d);
+            return ColorSpace::encode(sum * 0.25f);
+        }
+    };
+
+    // mipmap level downsample with memory layout resolved at compile time
+    template<typename T, BufferLayout L, typename Box = TexelBox<T>>
+    struct MipmapKernel
+    {
+        // out size must be half of in size (or 1 where in size is 1)
+        static void boxFilter(Buffer<T> *out, Buffer<T> *in, int yStart, int yEnd)
+        {
+            const T *src = in->getRawDataPtr();
+            T *dst = out->getRawDataPtr();
+            size_t inW = in->getWidth();
+            size_t inH = in->getHeight();
+            size_t inInnerW = BufferIndexer<L>::innerSize(inW);
+            size_t outInnerW = BufferIndexer<L>::innerSize(out->getWidth());
+            for (size_t y = yStart; y < (size_t)yEnd; y++)
+            {
+                size_t y0 = 2 * y;
+                size_t y1 = std::min(y0 + 1, inH - 1);
+                for (size_t x = 0; x < out->getWidth(); x++)
+                {
+                    size_t x0 = 2 * x;
+                    size_t x1 = std::min(x0 + 1, inW - 1);
+                    dst[BufferIndexer<L>::index(x, y, outInnerW)] = Box::average(
+                            src[BufferIndexer<L>::index(x0, y0, inInnerW)],
+                            src[BufferIndexer<L>::index(x1, y0, inInnerW)],
+                            src[BufferIndexer<L>::index(x0, y1, inInnerW)],
+                            src[BufferIndexer<L>::index(x1, y1, inInnerW)]);
+                }
+            }
+        }
+    };
+}
@@ -1,12 +1,106 @@
 #pragma once 
 
 #include <functional>
+#include "Base/ThreadPool.h"
 #include "TextureSoft.h"
+#include "SamplerKernel.h"
 
 namespace SoftGL
 {
-    #define CoordMod(i, n) ((i) & ((n) - 1) + (n)) & ((n) - 1)  // (i % n + n) % n
-    #define CoordMirror(i) (i) >= 0 ? (i) : (-1 - (i))
+
+    // texel fetch of uncompressed image levels
+    template<typename T, WrapMode W, BufferLayout L>
+    struct ImageSampleKernel
+    {
+        static inline T nearest(ImageBufferSoft<T> *image, const glm::vec2 &uv, const glm::ivec2 &offset, const T &border)
+        {
+            return SampleKernel<T, W, L>::nearest(image->buffer.get(), uv, offset, border);
+        }
+
+        static inline T bilinear(ImageBufferSoft<T> *image, const glm::vec2 &uv, const glm::ivec2 &offset, const T &border)
+        {
+            return SampleKernel<T, W, L>::bilinear(image->buffer.get(), uv, offset, border);
+        }
+
+        static inline T trilinear(ImageBufferSoft<T> *imageHi, ImageBufferSoft<T> *imageLo, const glm::vec2 &uv,
+                                  const glm::ivec2 &offset, float f, const T &border)
+        {
+            return SampleKernel<T, W, L>::trilinear(imageHi->buffer.get(), imageLo->buffer.get(), uv, offset, f, border);
+        }
+    };
+
+    // texel fetch of block compressed image levels, only RGBA8 images hold blocks
+    template<typename T, WrapMode W>
+    struct ImageBlockSampleKernel
+    {
+        static inline T nearest(ImageBufferSoft<T> *, const glm::vec2 &, const glm::ivec2 &, const T &border) { return border; }
+        static inline T bilinear(ImageBufferSoft<T> *, const glm::vec2 &, const glm::ivec2 &, const T &border) { return border; }
+        static inline T trilinear(ImageBufferSoft<T> *, ImageBufferSoft<T> *, const glm::vec2 &, const glm::ivec2 &, float, const T &border) { return border; }
+    };
+
+    template<WrapMode W>
+    struct ImageBlockSampleKernel<RGBA, W>
+    {
+        static inline RGBA nearest(ImageBufferSoft<RGBA> *image, const glm::vec2 &uv, const glm::ivec2 &offset, const RGBA &border)
+        {
+            return BlockSampleKernel<W>::nearest(image->blocks.get(), uv, offset, border);
+        }
+
+        static inline RGBA bilinear(ImageBufferSoft<RGBA> *image, const glm::vec2 &uv, const glm::ivec2 &offset, const RGBA &border)
+        {
+            return BlockSampleKernel<W>::bilinear(image->blocks.get(), uv, offset, border);
+        }
+
+        static inline RGBA trilinear(ImageBufferSoft<RGBA> *imageHi, ImageBufferSoft<RGBA> *imageLo, const glm::vec2 &uv,
+                                     const glm::ivec2 &offset, float f, const RGBA &border)
+        {
+            return BlockSampleKernel<W>::trilinear(imageHi->blocks.get(), imageLo->blocks.get(), uv, offset, f, border);
+        }
+    };
+
+    // texel fetch of packed image levels, unpacked to the sampled type
+    template<typename T, WrapMode W, BufferLayout L>
+    struct ImagePackedSampleKernel
+    {
+        typedef PackedSampleKernel<TexelPacking<T>, W, L> Kernel;
+
+        static inline T nearest(ImageBufferSoft<T> *image, const glm::vec2 &uv, const glm::ivec2 &offset, const T &border)
+        {
+            return Kernel::nearest(image->packed.get(), uv, offset, border);
+        }
+
+        static inline T bilinear(ImageBufferSoft<T> *image, const glm::vec2 &uv, const glm::ivec2 &offset, const T &border)
+        {
+            return Kernel::bilinear(image->packed.get(), uv, offset, border);
+        }
+
+        static inline T trilinear(ImageBufferSoft<T> *imageHi, ImageBufferSoft<T> *imageLo, const glm::vec2 &uv,
+                                  const glm::ivec2 &offset, float f, const T &border)
+        {
+            return Kernel::trilinear(imageHi->packed.get(), imageLo->packed.get(), uv, offset, f, border);
+        }
+    };
+
+    // texel fetch of sRGB encoded image levels, filtered in linear space
+    template<typename T, WrapMode W, BufferLayout L>
+    struct ImageSrgbSampleKernel
+    {
+        static inline T nearest(ImageBufferSoft<T> *image, const glm::vec2 &uv, const glm::ivec2 &offset, const T &border)
+        {
+            return SrgbSampleKernel<T, W, L>::nearest(image->buffer.get(), uv, offset, border);
+        }
+
+        static inline T bilinear(ImageBufferSoft<T> *image, const glm::vec2 &uv, const glm::ivec2 &offset, const T &border)
+        {
+            return SrgbSampleKernel<T, W, L>::bilinear(image->buffer.get(), uv, offset, border);
+        }
+
+        static inline T trilinear(ImageBufferSoft<T> *imageHi, ImageBufferSoft<T> *imageLo, const glm::vec2 &uv,
+                                  const glm::ivec2 &offset, float f, const T &border)
+        {
+            return SrgbSampleKernel<T, W, L>::trilinear(imageHi->buffer.get(), imageLo->buffer.get(), uv, offset, f, border);
+        }
+    };
 
     template<typename T>
     class BaseSampler
@@ -18,6 +112,12 @@ namespace SoftGL
         inline T& borderColor() { return borderColor_; }
 
         T textureImpl(TextureImageSoft<T> *tex, glm::vec2 &uv, float lod = 0.f, glm::ivec2 offset = glm::ivec2(0));
+        template<WrapMode W>
+        T textureWrapImpl(TextureImageSoft<T> *tex, glm::vec2 &uv, float lod, glm::ivec2 &offset);
+        template<WrapMode W, BufferLayout L>
+        T textureLayoutImpl(TextureImageSoft<T> *tex, glm::vec2 &uv, float lod, glm::ivec2 &offset);
+        template<typename Kernel>
+        T textureLevelsImpl(TextureImageSoft<T> *tex, glm::vec2 &uv, float lod, glm::ivec2 &offset);
         static T sampleNearest(Buffer<T> *buffer, glm::vec2 &uv, WrapMode wrap, glm::ivec2 &offset, T border);
         static T sampleBilinear(Buffer<T> *buffer, glm::vec2 &uv, WrapMode wrap, glm::ivec2 &offset, T border);
 
@@ -41,6 +141,10 @@ namespace SoftGL
         }
 
         static void generateMipmaps(TextureImageSoft<T> *tex, bool sample);
+        static void generateMipmaps(TextureImageSoft<T> **texs, size_t cnt, bool sample);
+        static void downsampleLevel(Buffer<T> *buffer_out, Buffer<T> *buffer_in, int yStart, int yEnd, bool srgb = false);
+        template<BufferLayout L>
+        static void downsampleBilinear(Buffer<T> *buffer_out, Buffer<T> *buffer_in, int yStart, int yEnd, bool srgb);
 
     protected:
         T borderColor_;
@@ -88,30 +192,144 @@ namespace SoftGL
         TextureImageSoft<T> *tex_ = nullptr;
     };
 
+    #define MIPMAP_PARALLEL_MIN_PIXELS (256 * 256)   // smaller images are filtered on caller thread
+    #define MIPMAP_ROWS_PER_TASK 32
+
     template<typename T>
     void BaseSampler<T>::generateMipmaps(TextureImageSoft<T> *tex, bool sample)
     {
-        int width = tex->getWidth();
-        int height = tex->getHeight();
-
-        auto level0 = tex->getBuffer();
-        tex->levels.resize(1);
-        tex->levels[0] = level0;
+        generateMipmaps(&tex, 1, sample);
+    }
 
-        uint32_t levelCount = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height))) + 1);
-        for (uint32_t level = 1; level < levelCount; level++)
+    template<typename T>
+    void BaseSampler<T>::generateMipmaps(TextureImageSoft<T> **texs, size_t cnt, bool sample)
+    {
+        size_t maxLevelCount = 0;
+        size_t pixelCount = 0;
+        for (size_t i = 0; i < cnt; i++)
         {
-            tex.levels.push_back(std::make_shared<ImageBufferSoft<T>>(std::max(1, width >> level), std::max(1, height >> level)));
+            TextureImageSoft<T> *tex = texs[i];
+            int width = tex->getWidth();
+            int height = tex->getHeight();
+
+            auto level0 = tex->getBuffer();
+            tex->levels.resize(1);
+            tex->levels[0] = level0;
+
+            uint32_t levelCount = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height))) + 1);
+            for (uint32_t level = 1; level < levelCount; level++)
+            {
+                tex->levels.push_back(std::make_shared<ImageBufferSoft<T>>(std::max(1, width >> level), std::max(1, height >> level), 1, level0->buffer->getLayout()));
+            }
+            maxLevelCount = std::max(maxLevelCount, (size_t)levelCount);
+            pixelCount += (size_t)width * height;
         }
 
         if (!sample)
         {
             return;
         }
+        // filter kernels read level 0 without fast clear tags
+        for (size_t i = 0; i < cnt; i++)
+        {
+            texs[i]->levels[0]->buffer->flushClear();
+        }
 
-        for (int i = 1; i < tex->levels.size(); i++)
+        if (pixelCount < MIPMAP_PARALLEL_MIN_PIXELS)
         {
-            BaseSampler<T>::sampleBufferBilinear(tex->levels[i]->buffer.get(), tex->levels[i - 1]->buffer.get(), T(0));
+            for (size_t i = 0; i < cnt; i++)
+            {
+                auto &levels = texs[i]->levels;
+                for (size_t level = 1; level < levels.size(); level++)
+                {
+                    downsampleLevel(levels[level]->buffer.get(), levels[level - 1]->buffer.get(), 0, levels[level]->height, texs[i]->srgb);
+                }
+            }
+            return;
+        }
+
+        // levels depend on the previous one, rows of the same level from all images run in parallel.
+        // the pool may be shared with other callers, only the tasks of this call are waited for
+        ThreadPool &pool = ThreadPool::shared();
+        for (size_t level = 1; level < maxLevelCount; level++)
+        {
+            ThreadPool::TaskGroup levelTasks;
+            for (size_t i = 0; i < cnt; i++)
+            {
+                auto &levels = texs[i]->levels;
+                if (level >= levels.size())
+                {
+                    continue;
+                }
+                Buffer<T> *buffer_out = levels[level]->buffer.get();
+                Buffer<T> *buffer_in = levels[level - 1]->buffer.get();
+                int rows = levels[level]->height;
+                bool srgb = texs[i]->srgb;
+                for (int y = 0; y < rows; y += MIPMAP_ROWS_PER_TASK)
+                {
+                    int yEnd = std::min(y + MIPMAP_ROWS_PER_TASK, rows);
+                    pool.pushTask(levelTasks, [buffer_out, buffer_in, y, yEnd, srgb](size_t thread_id)
+                                  {
+                                      downsampleLevel(buffer_out, buffer_in, y, yEnd, srgb);
+                                  });
+                }
+            }
+            levelTasks.wait();
+        }
+    }
+
+    template<typename T>
+    void BaseSampler<T>::downsampleLevel(Buffer<T> *buffer_out, Buffer<T> *buffer_in, int yStart, int yEnd, bool srgb)
+    {
+        size_t inW = buffer_in->getWidth();
+        size_t inH = buffer_in->getHeight();
+        size_t outW = buffer_out->getWidth();
+        size_t outH = buffer_out->getHeight();
+        bool halfX = inW == 2 * outW || (inW == 1 && outW == 1);
+        bool halfY = inH == 2 * outH || (inH == 1 && outH == 1);
+        if (halfX && halfY && buffer_in->getLayout() == buffer_out->getLayout())
+        {
+            if (srgb)
+            {
+                switch (buffer_out->getLayout())
+                {
+                    case Layout_Tiled:  MipmapKernel<T, Layout_Tiled, TexelBoxSrgb<T>>::boxFilter(buffer_out, buffer_in, yStart, yEnd); return;
+                    case Layout_Morton: MipmapKernel<T, Layout_Morton, TexelBoxSrgb<T>>::boxFilter(buffer_out, buffer_in, yStart, yEnd); return;
+                    default:            MipmapKernel<T, Layout_Linear, TexelBoxSrgb<T>>::boxFilter(buffer_out, buffer_in, yStart, yEnd); return;
+                }
+            }
+            switch (buffer_out->getLayout())
+            {
+                case Layout_Tiled:  MipmapKernel<T, Layout_Tiled>::boxFilter(buffer_out, buffer_in, yStart, yEnd); return;
+                case Layout_Morton: MipmapKernel<T, Layout_Morton>::boxFilter(buffer_out, buffer_in, yStart, yEnd); return;
+                default:            MipmapKernel<T, Layout_Linear>::boxFilter(buffer_out, buffer_in, yStart, yEnd); return;
+            }
+        }
+
+        // odd size, fallback to bilinear
+        switch (buffer_in->getLayout())
+        {
+            case Layout_Tiled:  downsampleBilinear<Layout_Tiled>(buffer_out, buffer_in, yStart, yEnd, srgb); return;
+            case Layout_Morton: downsampleBilinear<Layout_Morton>(buffer_out, buffer_in, yStart, yEnd, srgb); return;
+            default:            downsampleBilinear<Layout_Linear>(buffer_out, buffer_in, yStart, yEnd, srgb); return;
+        }
+    }
+
+    template<typename T>
+    template<BufferLayout L>
+    void BaseSampler<T>::downsampleBilinear(Buffer<T> *buffer_out, Buffer<T> *buffer_in, int yStart, int yEnd, bool srgb)
+    {
+        float ratio_x = (float)buffer_in->getWidth() / (float)buffer_out->getWidth();
+        float ratio_y = (float)buffer_in->getHeight() / (float)buffer_out->getHeight();
+        glm::vec2 delta = 0.5f * glm::vec2(ratio_x, ratio_y);
+        for (int y = yStart; y < yEnd; y++)
+        {
+            for (int x = 0; x < (int)buffer_out->getWidth(); x++)
+            {
+                glm::vec2 uv = glm::vec2((float)x * ratio_x, (float)y * ratio_y) + delta;
+                buffer_out->set(x, y, srgb ? SrgbSampleKernel<T, Wrap_CLAMP_TO_EDGE, L>::bilinearTexel(buffer_in, uv, T(0))
+                                           : SampleKernel<T, Wrap_CLAMP_TO_EDGE, L>::bilinearTexel(buffer_in, uv, T(0)));
+            }
         }
     }
 
@@ -121,138 +339,167 @@ namespace SoftGL
         BaseSampler<T>::generateMipmaps(this, sample);
     }
 
+    template<typename T>
+    void TextureImageSoft<T>::generateMipmaps(TextureImageSoft<T> **images, size_t cnt, bool sample)
+    {
+        BaseSampler<T>::generateMipmaps(images, cnt, sample);
+    }
+
     template<typename T>
     T BaseSampler<T>::textureImpl(TextureImageSoft<T> *tex, glm::vec2 &uv, float lod, glm::ivec2 offset)
     {
-        if (tex != nullptr && !tex->empty())
+        if (tex == nullptr || tex->empty())
         {
-            if (filterMode_ == Filter_NEAREST)
-            {
-                return sampleNearest(tex->levels[0]->buffer.get(), uv, wrapMode_, offset, borderColor_);
-            }
-            else
-            {
-                return sampleBilinear(tex->levels[0]->buffer.get(), uv, wrapMode_, offset, borderColor_);
-            }
+            return T(0);
+        }
+        // dispatch wrap mode once per sample, texel fetch inside kernels is branch free
+        switch (wrapMode_)
+        {
+            case Wrap_REPEAT:           return textureWrapImpl<Wrap_REPEAT>(tex, uv, lod, offset);
+            case Wrap_MIRRORED_REPEAT:  return textureWrapImpl<Wrap_MIRRORED_REPEAT>(tex, uv, lod, offset);
+            case Wrap_CLAMP_TO_BORDER:  return textureWrapImpl<Wrap_CLAMP_TO_BORDER>(tex, uv, lod, offset);
+            default:                    break;
+        }
+        return textureWrapImpl<Wrap_CLAMP_TO_EDGE>(tex, uv, lod, offset);
+    }
+
+    template<typename T>
+    template<WrapMode W>
+    T BaseSampler<T>::textureWrapImpl(TextureImageSoft<T> *tex, glm::vec2 &uv, float lod, glm::ivec2 &offset)
+    {
+        if (tex->compressed())
+        {
+            return textureLevelsImpl<ImageBlockSampleKernel<T, W>>(tex, uv, lod, offset);
+        }
+        // all levels share the texture layout, dispatch it once per sample as well
+        switch (tex->layout)
+        {
+            case Layout_Tiled:  return textureLayoutImpl<W, Layout_Tiled>(tex, uv, lod, offset);
+            case Layout_Morton: return textureLayoutImpl<W, Layout_Morton>(tex, uv, lod, offset);
+            default:            break;
         }
-        // mipmaps
+        return textureLayoutImpl<W, Layout_Linear>(tex, uv, lod, offset);
+    }
+
+    template<typename T>
+    template<WrapMode W, BufferLayout L>
+    T BaseSampler<T>::textureLayoutImpl(TextureImageSoft<T> *tex, glm::vec2 &uv, float lod, glm::ivec2 &offset)
+    {
+        if (tex->packed())
+        {
+            return textureLevelsImpl<ImagePackedSampleKernel<T, W, L>>(tex, uv, lod, offset);
+        }
+        if (tex->srgb)
+        {
+            return textureLevelsImpl<ImageSrgbSampleKernel<T, W, L>>(tex, uv, lod, offset);
+        }
+        return textureLevelsImpl<ImageSampleKernel<T, W, L>>(tex, uv, lod, offset);
+    }
+
+    template<typename T>
+    template<typename Kernel>
+    T BaseSampler<T>::textureLevelsImpl(TextureImageSoft<T> *tex, glm::vec2 &uv, float lod, glm::ivec2 &offset)
+    {
+        bool mipmaps = filterMode_ != Filter_NEAREST && filterMode_ != Filter_LINEAR;
         int max_level = (int)tex->levels.size() - 1;
-        if (filterMode_ == Filter_NEAREST_MIPMAP_NEAREST || filterMode_ == Filter_LINEAR_MIPMAP_NEAREST)
+        int min_level = 0;
+        if (tex->feedback || tex->residency)
         {
-            int level = glm::clamp((int)glm::ceil(lod + 0.5f) - 1, 0, max_level);
-            if (filterMode_ == Filter_NEAREST_MIPMAP_NEAREST)
+            int lod_level = mipmaps ? glm::clamp((int)std::floor(lod), 0, max_level) : 0;
+            if (tex->feedback)
             {
-                return sampleNearest(tex->levels[level]->buffer.get(), uv, wrapMode_, offset, borderColor_);
+                tex->feedback->record(uv, lod_level);
             }
-            else
+            if (tex->residency)
             {
-                return sampleBilinear(tex->levels[level]->buffer.get(), uv, wrapMode_, offset, borderColor_);
+                // streamed texture: request the wanted level, sample the finest resident one
+                min_level = tex->residency->request(lod_level);
             }
-        }
-        
-        if (filterMode_ == Filter_NEAREST_MIPMAP_LINEAR || filterMode_ == Filter_LINEAR_MIPMAP_LINEAR)
-        {
-            int level_hi = glm::clamp((int)std::floor(lod), 0, max_level);
-            int level_lo = glm::clamp(level_hi + 1, 0, max_level);
-            T texel_hi, texel_lo;
-            if (filterMode_ == Filter_NEAREST_MIPMAP_LINEAR)
+            if (min_level > max_level)
             {
-                texel_hi = sampleNearest(tex->levels[level_hi]->buffer.get(), uv, wrapMode_, offset, borderColor_);
+                return borderColor_;
             }
-            else
+        }
+        // level 0 of a streamed texture may not be resident, sample the finest one that is
+        if (filterMode_ == Filter_NEAREST)
+        {
+            return Kernel::nearest(tex->levels[min_level].get(), uv, offset, borderColor_);
+        }
+        if (filterMode_ == Filter_LINEAR)
+        {
+            return Kernel::bilinear(tex->levels[min_level].get(), uv, offset, borderColor_);
+        }
+        if (filterMode_ == Filter_NEAREST_MIPMAP_NEAREST || filterMode_ == Filter_LINEAR_MIPMAP_NEAREST)
+        {
+            int level = glm::clamp((int)glm::ceil(lod + 0.5f) - 1, min_level, max_level);
+            if (filterMode_ == Filter_NEAREST_MIPMAP_NEAREST)
             {
-                texel_hi = sampleBilinear(tex->levels[level_hi]->buffer.get(), uv, wrapMode_, offset, borderColor_);
+                return Kernel::nearest(tex->levels[level].get(), uv, offset, borderColor_);
             }
+            return Kernel::bilinear(tex->levels[level].get(), uv, offset, borderColor_);
+        }
 
+        // Filter_NEAREST_MIPMAP_LINEAR, Filter_LINEAR_MIPMAP_LINEAR
+        int level_hi = glm::clamp((int)std::floor(lod), min_level, max_level);
+        int level_lo = glm::clamp(level_hi + 1, min_level, max_level);
+        ImageBufferSoft<T> *buffer_hi = tex->levels[level_hi].get();
+        ImageBufferSoft<T> *buffer_lo = tex->levels[level_lo].get();
+        if (filterMode_ == Filter_NEAREST_MIPMAP_LINEAR)
+        {
+            T texel_hi = Kernel::nearest(buffer_hi, uv, offset, borderColor_);
             if (level_hi == level_lo)
             {
                 return texel_hi;
             }
-            else
-            {
-                if (filterMode_ == Filter_NEAREST_MIPMAP_LINEAR)
-                {
-                    texel_lo = sampleNearest(tex->levels[level_lo]->buffer.get(), uv, wrapMode_, offset, borderColor_);
-                }
-                else
-                {
-                    texel_lo = sampleBilinear(tex->levels[level_lo]->buffer.get(), uv, wrapMode_, offset, borderColor_);
-                }
-            }
-            float f = glm::fract(lod);
-            return glm::mix(texel_hi, texel_lo, f);
+            T texel_lo = Kernel::nearest(buffer_lo, uv, offset, borderColor_);
+            return glm::mix(texel_hi, texel_lo, glm::fract(lod));
         }
+        if (level_hi == level_lo)
+        {
+            return Kernel::bilinear(buffer_hi, uv, offset, borderColor_);
+        }
+        return Kernel::trilinear(buffer_hi, buffer_lo, uv, offset, glm::fract(lod), borderColor_);
     }
 
     template<typename T>
     T BaseSampler<T>::pixelWithWrapMode(Buffer<T> *buffer, int x, int y, WrapMode wrap, T border)
     {
-        int w = (int)buffer->getWidth();
-        int h = (int)buffer->getHeight();
         switch (wrap)
         {
-            case Wrap_REPEAT:
-            {
-                x = CoordMod(x, w);
-                y = CoordMod(y, h);
-                break;
-            }
-            case Wrap_MIRRORED_REPEAT:
-            {
-                x = CoordMod(x, 2 * w);
-                y = CoordMod(y, 2 * h);
-                x -= w;
-                y -= h;
-                x = CoordMirror(x);
-                y = CoordMirror(y);
-                x = w - 1 - x;
-                y = h - 1 - y;
-                break;
-            }
-            case Wrap_CLAMP_TO_EDGE:
-            {
-                if (x < 0) x = 0;
-                if (y < 0) y = 0;
-                if (x >= w) x = w - 1;
-                if (y >= h) y = h - 1;
-                break;
-            }
-            case Wrap_CLAMP_TO_BORDER:
-            {
-                if (x < 0 || x >= w) return border;
-                if (y < 0 || y >= h) return border;
-                break;
-            }
+            case Wrap_REPEAT:           return BufferSampleKernel<T, Wrap_REPEAT>::texel(buffer, x, y, border);
+            case Wrap_MIRRORED_REPEAT:  return BufferSampleKernel<T, Wrap_MIRRORED_REPEAT>::texel(buffer, x, y, border);
+            case Wrap_CLAMP_TO_BORDER:  return BufferSampleKernel<T, Wrap_CLAMP_TO_BORDER>::texel(buffer, x, y, border);
+            default:                    break;
         }
-        T *ptr = buffer->get(x, y);
-        if (ptr)
-        {
-            return *ptr;
-        }
-        return T(0);
+        return BufferSampleKernel<T, Wrap_CLAMP_TO_EDGE>::texel(buffer, x, y, border);
     }
 
     template<typename T>
     T BaseSampler<T>::sampleNearest(Buffer<T> *buffer, glm::vec2 &uv, WrapMode wrap, glm::ivec2 &offset, T border)
     {
-        glm::vec2 texUV = uv * glm::vec2(buffer->getWidth(), buffer->getHeight());
-        auto x = (int)glm::floor(texUV.x) + offset.x;
-        auto y = (int)glm::floor(texUV.y) + offset.y;
-        return pixelWithWrapMode(buffer, x, y, wrap, border);
+        switch (wrap)
+        {
+            case Wrap_REPEAT:           return BufferSampleKernel<T, Wrap_REPEAT>::nearest(buffer, uv, offset, border);
+            case Wrap_MIRRORED_REPEAT:  return BufferSampleKernel<T, Wrap_MIRRORED_REPEAT>::nearest(buffer, uv, offset, border);
+            case Wrap_CLAMP_TO_BORDER:  return BufferSampleKernel<T, Wrap_CLAMP_TO_BORDER>::nearest(buffer, uv, offset, border);
+            default:                    break;
+        }
+        return BufferSampleKernel<T, Wrap_CLAMP_TO_EDGE>::nearest(buffer, uv, offset, border);
     }
 
     template<typename T>
     T BaseSampler<T>::sampleBilinear(Buffer<T> *buffer, glm::vec2 &uv, WrapMode wrap, glm::ivec2 &offset, T border)
     {
         glm::vec2 texUV = uv * glm::vec2(buffer->getWidth(), buffer->getHeight());
-        texUV.x = (float)offset.x;
-        texUV.y = (float)offset.y;
+        texUV.x += (float)offset.x;
+        texUV.y += (float)offset.y;
         return samplePixelBilinear(buffer, texUV, wrap, border);
     }
 
     template<typename T>
     void BaseSampler<T>::sampleBufferBilinear(Buffer<T> *buffer_out, Buffer<T> *buffer_in, T border)
     {
+        buffer_in->flushClear();
         float ratio_x = (float)buffer_in->getWidth() / (float)buffer_out->getWidth();
         float ratio_y = (float)buffer_in->getHeight() / (float)buffer_out->getHeight();
         glm::vec2 delta = 0.5f * glm::vec2(ratio_x, ratio_y);
@@ -262,7 +509,7 @@ namespace SoftGL
             {
                 // 相当于将不同大小的两个buffer的中心点对齐
                 glm::vec2 uv = glm::vec2((float)x * ratio_x, (float)y * ratio_y) + delta;
-                auto color = samplePixelBilinear(buffer_in, uv, Wrap_CLAMP_TO_EDGE, border);
+                auto color = BufferSampleKernel<T, Wrap_CLAMP_TO_EDGE>::bilinearTexel(buffer_in, uv, border);
                 buffer_out->set(x, y, color);
             }
         }
@@ -271,16 +518,18 @@ namespace SoftGL
     template<typename T>
     T BaseSampler<T>::samplePixelBilinear(Buffer<T> *buffer, glm::vec2 uv, WrapMode wrap, T border)
     {
-        auto x = (int) glm::floor(uv.x - 0.5f);
-        auto y = (int) glm::floor(uv.y - 0.5f);
-        auto s1 = pixelWithWrapMode(buffer, x, y, wrap, border);
-        auto s2 = pixelWithWrapMode(buffer, x + 1, y, wrap, border);
-        auto s3 = pixelWithWrapMode(buffer, x, y + 1, wrap, border);
-        auto s4 = pixelWithWrapMode(buffer, x + 1, y + 1, wrap, border);
-        glm::vec2 f = glm::fract(uv - glm::vec2(0.5f));
-        return glm::mix(glm::mix(s1, s2, f.x), glm::mix(s3, s4, f.x), f.y);
+        switch (wrap)
+        {
+            case Wrap_REPEAT:           return BufferSampleKernel<T, Wrap_REPEAT>::bilinearTexel(buffer, uv, border);
+            case Wrap_MIRRORED_REPEAT:  return BufferSampleKernel<T, Wrap_MIRRORED_REPEAT>::bilinearTexel(buffer, uv, border);
+            case Wrap_CLAMP_TO_BORDER:  return BufferSampleKernel<T, Wrap_CLAMP_TO_BORDER>::bilinearTexel(buffer, uv, border);
+            default:                    break;
+        }
+        return BufferSampleKernel<T, Wrap_CLAMP_TO_EDGE>::bilinearTexel(buffer, uv, border);
     }
 
+    #define CUBE_BATCH_SIZE 8   // directions resolved per simd step
+
     template<typename T>
     class BaseSamplerCube : public BaseSampler<T>
     {
@@ -293,7 +542,7 @@ namespace SoftGL
 
         inline void setImage(TextureImageSoft<T> *tex, int idx)
         {
-            tex[idx] = tex;
+            tex_[idx] = tex;
             if (idx == 0)
             {
                 BaseSampler<T>::width_ = (tex == nullptr) ? 0 : tex->getWidth();
@@ -310,8 +559,11 @@ namespace SoftGL
         T textureCubeImpl(glm::vec3 &coord, float bias = 0.f)
         {
             float lod = bias;
-            // cube sampler derivative not support
-            // lod += dFd()...
+            // lod from direction derivatives of the pixel quad
+            if (BaseSampler<T>::useMipmaps && BaseSampler<T>::lodFunc_)
+            {
+                lod += (*BaseSampler<T>::lodFunc_)(this);
+            }
             return textureCubeLodImpl(coord, lod);
         }
 
@@ -324,7 +576,63 @@ namespace SoftGL
             return BaseSampler<T>::textureImpl(tex, uv, lod);
         }
 
-        static void convertXYZ2UV(float x, float y, float z, int *index, float *u, float *v);
+        // sample cnt directions at the same lod
+        void textureCubeLodBatch(const glm::vec3 *coords, size_t cnt, float lod, T *out)
+        {
+            int index[CUBE_BATCH_SIZE];
+            glm::vec2 uv[CUBE_BATCH_SIZE];
+            for (size_t i = 0; i < cnt; i += CUBE_BATCH_SIZE)
+            {
+                size_t n = std::min(cnt - i, (size_t) CUBE_BATCH_SIZE);
+                convertXYZ2UVBatch(coords + i, n, index, uv);
+                for (size_t j = 0; j < n; j++)
+                {
+                    out[i + j] = BaseSampler<T>::textureImpl(tex_[index[j]], uv[j], lod);
+                }
+            }
+        }
+
+        // major axis face: +x, -x, +y, -y, +z, -z. ties resolve to z, then y
+        static inline int selectFace(const glm::vec3 &dir)
+        {
+            float absX = std::fabs(dir.x);
+            float absY = std::fabs(dir.y);
+            float absZ = std::fabs(dir.z);
+            bool isY = absY >= absX;
+            bool isZ = absZ >= std::max(absX, absY);
+            int axis = isZ ? 2 : (isY ? 1 : 0);
+            return axis * 2 + (dir[axis] > 0 ? 0 : 1);
+        }
+
+        // project direction onto the plane of face, directions past the face edge extrapolate
+        static inline glm::vec2 faceUV(const glm::vec3 &dir, int face)
+        {
+            // u axis, u sign, v axis, v sign (v is flipped)
+            static const int faceAxes[6][4] = {
+                {2, -1, 1, -1},
+                {2, 1, 1, -1},
+                {0, 1, 2, 1},
+                {0, 1, 2, -1},
+                {0, 1, 1, -1},
+                {0, -1, 1, -1},
+            };
+            const int *axes = faceAxes[face];
+            float maxAxis = (face & 1) ? -dir[face >> 1] : dir[face >> 1];
+            return {0.5f * ((float) axes[1] * dir[axes[0]] / maxAxis + 1.0f),
+                    0.5f * ((float) axes[3] * dir[axes[2]] / maxAxis + 1.0f)};
+        }
+
+        static inline void convertXYZ2UV(float x, float y, float z, int *index, float *u, float *v)
+        {
+            // Ref: https://en.wikipedia.org/wiki/Cube_mapping
+            glm::vec3 dir(x, y, z);
+            *index = selectFace(dir);
+            glm::vec2 uv = faceUV(dir, *index);
+            *u = uv.x;
+            *v = uv.y;
+        }
+
+        static void convertXYZ2UVBatch(const glm::vec3 *coords, size_t cnt, int *index, glm::vec2 *uv);
         
     private:
         // +x, -x, +y, -y, +z, -z
@@ -332,73 +640,59 @@ namespace SoftGL
     };
 
     template<typename T>
-    void BaseSamplerCube<T>::convertXYZ2UV(float x, float y, float z, int *index, float *u, float *v)
+    void BaseSamplerCube<T>::convertXYZ2UVBatch(const glm::vec3 *coords, size_t cnt, int *index, glm::vec2 *uv)
     {
-        // Ref: https://en.wikipedia.org/wiki/Cube_mapping
-        float absX = std::fabs(x);
-        float absY = std::fabs(y);
-        float absZ = std::fabs(z);
-        bool isXPositive = x > 0;
-        bool isYPositive = y > 0;
-        bool isZPositive = z > 0;
-        float maxAxis, uc, vc;
-        // Positive X
-        if (isXPositive && absX >= absY && absX >= absZ)
-        {
-            // u (0 to 1) goes from +z to -z
-            // v (0 to 1) goes from -y to +y
-            maxAxis = absX;
-            uc = -z;
-            vc = y;
-            *index = 0;
-        }
-        // Negative X
-        if (!isXPositive && absX >= absY && absX >= absZ)
-        {
-            // u (0 to 1) goes from -z to +z
-            // v (0 to 1) goes from -y to +y
-            maxAxis = absX;
-            uc = z;
-            vc = y;
-            *index = 1;
-        }
-        // POSITIVE Y
-        if (isYPositive && absY >= absX && absY >= absZ) 
-        {
-            maxAxis = absY;
-            uc = x;
-            vc = -z;
-            *index = 2;
-        }
-        // NEGATIVE Y
-        if (!isYPositive && absY >= absX && absY >= absZ) 
-        {
-            maxAxis = absY;
-            uc = x;
-            vc = z;
-            *index = 3;
-        }
-        // POSITIVE Z
-        if (isZPositive && absZ >= absX && absZ >= absY) 
-        {
-            maxAxis = absZ;
-            uc = x;
-            vc = y;
-            *index = 4;
-        }
-        // NEGATIVE Z
-        if (!isZPositive && absZ >= absX && absZ >= absY) 
-        {
-            maxAxis = absZ;
-            uc = -x;
-            vc = y;
-            *index = 5;
-        }
-        // flip y
-        vc = -vc;
-        // convert range from -1 to 1 to 0 to 1
-        *u = 0.5f * (uc / maxAxis + 1.0f);
-        *v = 0.5f * (vc / maxAxis + 1.0f);
+        size_t i = 0;
+#ifdef SOFTGL_SIMD_OPT
+        // glm::vec3 may be padded to 16 bytes
+        const int stride = sizeof(glm::vec3) / sizeof(float);
+        const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+        const __m256 signMask = _mm256_set1_ps(-0.f);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.f);
+        const __m256 half = _mm256_set1_ps(0.5f);
+        for (; i + 8 <= cnt; i += 8)
+        {
+            const float *base = &coords[i].x;
+            __m256 x = _mm256_i32gather_ps(base, offsets, 4);
+            __m256 y = _mm256_i32gather_ps(base + 1, offsets, 4);
+            __m256 z = _mm256_i32gather_ps(base + 2, offsets, 4);
+            __m256 absX = _mm256_andnot_ps(signMask, x);
+            __m256 absY = _mm256_andnot_ps(signMask, y);
+            __m256 absZ = _mm256_andnot_ps(signMask, z);
+            __m256 isY = _mm256_cmp_ps(absY, absX, _CMP_GE_OQ);
+            __m256 maxXY = _mm256_max_ps(absX, absY);
+            __m256 isZ = _mm256_cmp_ps(absZ, maxXY, _CMP_GE_OQ);
+            __m256 maxAxis = _mm256_max_ps(maxXY, absZ);
+
+            // face index = axis * 2 + negative
+            __m256 major = _mm256_blendv_ps(_mm256_blendv_ps(x, y, isY), z, isZ);
+            __m256 negative = _mm256_cmp_ps(major, zero, _CMP_NGT_UQ);
+            __m256 face = _mm256_blendv_ps(_mm256_and_ps(isY, _mm256_set1_ps(2.f)), _mm256_set1_ps(4.f), isZ);
+            face = _mm256_add_ps(face, _mm256_and_ps(negative, one));
+            _mm256_storeu_si256((__m256i *) (index + i), _mm256_cvttps_epi32(face));
+
+            // x faces: u = -z, z  y faces: u = x  z faces: u = x, -x
+            __m256 negSign = _mm256_and_ps(negative, signMask);
+            __m256 uc = _mm256_blendv_ps(_mm256_xor_ps(z, _mm256_xor_ps(negSign, signMask)), x, isY);
+            uc = _mm256_blendv_ps(uc, _mm256_xor_ps(x, negSign), isZ);
+            // y faces: v = z, -z  others: v = -y
+            __m256 vc = _mm256_blendv_ps(_mm256_xor_ps(y, signMask), _mm256_xor_ps(z, negSign), isY);
+            vc = _mm256_blendv_ps(vc, _mm256_xor_ps(y, signMask), isZ);
+
+            __m256 u = _mm256_mul_ps(half, _mm256_add_ps(_mm256_div_ps(uc, maxAxis), one));
+            __m256 v = _mm256_mul_ps(half, _mm256_add_ps(_mm256_div_ps(vc, maxAxis), one));
+            // interleave to uv pairs
+            __m256 lo = _mm256_unpacklo_ps(u, v);
+            __m256 hi = _mm256_unpackhi_ps(u, v);
+            _mm256_storeu_ps(&uv[i].x, _mm256_permute2f128_ps(lo, hi, 0x20));
+            _mm256_storeu_ps(&uv[i + 4].x, _mm256_permute2f128_ps(lo, hi, 0x31));
+        }
+#endif
+        for (; i < cnt; i++)
+        {
+            convertXYZ2UV(coords[i].x, coords[i].y, coords[i].z, &index[i], &uv[i].x, &uv[i].y);
+        }
     }
 
     class SamplerSoft
@@ -406,6 +700,8 @@ namespace SoftGL
     public:
         virtual TextureType texType() = 0;
         virtual void setTexture(const std::shared_ptr<Texture> &tex) = 0;
+        // resolve pending fast clears of the bound texture, called once per draw before sampling
+        virtual void flushClear() = 0;
     };
 
     template<typename T>
@@ -421,10 +717,22 @@ namespace SoftGL
             sampler_.setFilterMode(tex_->getSamplerDesc().filterMin);
             sampler_.setWrapMode(tex_->getSamplerDesc().wrapS);
             sampler_.setImage(tex_->getImage());
+            srgb_ = tex_->isSrgb();
+        }
+
+        void flushClear() override
+        {
+            if (tex_)
+            {
+                tex_->getImage().flushClear();
+            }
         }
 
         inline TextureSoft<T> *getTexture() { return tex_; }
 
+        // texels are sRGB encoded, filtering is done in linear space
+        inline bool isSrgb() const { return srgb_; }
+
         inline void setLodFunc(std::function<float(BaseSampler<T> *)> *func)
         {
             sampler_.setLodFunc(func);
@@ -448,6 +756,7 @@ namespace SoftGL
     private:
         BaseSampler2D<T> sampler_;
         TextureSoft<T> *tex_ = nullptr;
+        bool srgb_ = false;
     };
 
     template<typename T>
@@ -466,10 +775,29 @@ namespace SoftGL
             {
                 sampler_.setImage(tex_->getImage((CubeMapFace)i), i);
             }
+            srgb_ = tex_->isSrgb();
+        }
+
+        void flushClear() override
+        {
+            if (tex_)
+            {
+                for (int i = 0; i < 6; i++)
+                {
+                    tex_->getImage((CubeMapFace)i).flushClear();
+                }
+            }
         }
 
         inline TextureSoft<T> *getTexture() { return tex_; }
 
+        inline bool isSrgb() const { return srgb_; }
+
+        inline void setLodFunc(std::function<float(BaseSampler<T> *)> *func)
+        {
+            sampler_.setLodFunc(func);
+        }
+
         inline T textureCube(glm::vec3 &coord, float bias = 0.f)
         {
             return sampler_.textureCubeImpl(coord, bias);
@@ -480,8 +808,14 @@ namespace SoftGL
             return sampler_.textureCubeLodImpl(coord, lod);
         }
 
+        inline void textureCubeLodBatch(const glm::vec3 *coords, size_t cnt, float lod, T *out)
+        {
+            sampler_.textureCubeLodBatch(coords, cnt, lod, out);
+        }
+
     private:
         BaseSamplerCube<T> sampler_;
         TextureSoft<T> *tex_ = nullptr;
+        bool srgb_ = false;
     };
 }
\ No newline at end of file
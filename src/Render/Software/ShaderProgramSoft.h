@@ -72,6 +72,29 @@ namespace SoftGL
             *ptr = sampler.get();
         }
 
+        // shaders read the uniforms from ptr, laid out like the program uniform buffer. nullptr restores the program buffer
+        inline void bindShaderUniforms(uint8_t *ptr)
+        {
+            uint8_t *uniforms = ptr ? ptr : uniformBuffer_.get();
+            vertexShader_->bindShaderUniforms(uniforms);
+            fragmentShader_->bindShaderUniforms(uniforms);
+        }
+
+        inline const uint8_t *getUniformBuffer() const
+        {
+            return uniformBuffer_.get();
+        }
+
+        inline size_t getShaderUniformsSize()
+        {
+            return vertexShader_->getShaderUniformsSize();
+        }
+
+        inline int getUniformOffset(int binding)
+        {
+            return vertexShader_->getUniformOffset(binding);
+        }
+
         inline void bindVertexShaderVaryings(void *ptr)
         {
             vertexShader_->bindShaderVaryings(ptr);
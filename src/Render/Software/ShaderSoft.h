@@ -24,6 +24,7 @@ namespace SoftGL
         float *p1 = nullptr;
         float *p2 = nullptr;
         float *p3 = nullptr;
+        uint32_t quadId = 0;    // advanced by the rasterizer for each shaded pixel quad
     };
 
     struct ShaderBuiltin
@@ -73,10 +74,15 @@ namespace SoftGL
             return {buffer->width, buffer->height};
         }
 
+        // normalized color of RGBA8 texel, sRGB texels are decoded to linear
+        static inline glm::vec4 texelColor(const RGBA &texel, bool srgb)
+        {
+            return srgb ? ColorSpace::decode(texel) : glm::vec4(texel) / 255.0f;
+        }
+
         static inline glm::vec4 texture(Sampler2DSoft<RGBA> *sampler, glm::vec2 coord)
         {
-            glm::vec4 ret = sampler->texture2D(coord);
-            return ret / 255.0f;
+            return texelColor(sampler->texture2D(coord), sampler->isSrgb());
         }
 
         static inline float texture(Sampler2DSoft<float> *sampler, glm::vec2 coord)
@@ -87,31 +93,74 @@ namespace SoftGL
 
         static inline glm::vec4 texture(SamplerCubeSoft<RGBA> *sampler, glm::vec3 coord)
         {
-            glm::vec4 ret = sampler->textureCube(coord);
-            return ret / 255.0f;
+            return texelColor(sampler->textureCube(coord), sampler->isSrgb());
         }
 
         static inline glm::vec4 textureLod(Sampler2DSoft<RGBA> *sampler, glm::vec2 coord, float lod = 0.f)
         {
-            glm::vec4 ret = sampler->texture2DLod(coord, lod);
-            return ret / 255.0f;
+            return texelColor(sampler->texture2DLod(coord, lod), sampler->isSrgb());
         }
 
         static inline glm::vec4 textureLod(SamplerCubeSoft<RGBA> *sampler, glm::vec3 coord, float lod = 0.f)
         {
-            glm::vec4 ret = sampler->textureCubeLod(coord, lod);
-            return ret / 255.0f;
+            return texelColor(sampler->textureCubeLod(coord, lod), sampler->isSrgb());
+        }
+
+        // half float textures, R11G11B10F has no alpha
+        static inline glm::vec4 texture(Sampler2DSoft<glm::vec4> *sampler, glm::vec2 coord)
+        {
+            return sampler->texture2D(coord);
+        }
+
+        static inline glm::vec4 texture(Sampler2DSoft<glm::vec3> *sampler, glm::vec2 coord)
+        {
+            return glm::vec4(sampler->texture2D(coord), 1.f);
+        }
+
+        static inline glm::vec4 texture(SamplerCubeSoft<glm::vec4> *sampler, glm::vec3 coord)
+        {
+            return sampler->textureCube(coord);
+        }
+
+        static inline glm::vec4 texture(SamplerCubeSoft<glm::vec3> *sampler, glm::vec3 coord)
+        {
+            return glm::vec4(sampler->textureCube(coord), 1.f);
+        }
+
+        static inline glm::vec4 textureLod(SamplerCubeSoft<glm::vec4> *sampler, glm::vec3 coord, float lod = 0.f)
+        {
+            return sampler->textureCubeLod(coord, lod);
+        }
+
+        static inline glm::vec4 textureLod(SamplerCubeSoft<glm::vec3> *sampler, glm::vec3 coord, float lod = 0.f)
+        {
+            return glm::vec4(sampler->textureCubeLod(coord, lod), 1.f);
+        }
+
+        // directions are resolved to faces in simd batches, out receives normalized colors
+        static inline void textureLod(SamplerCubeSoft<RGBA> *sampler, const glm::vec3 *coords, size_t cnt, float lod, glm::vec4 *out)
+        {
+            RGBA texels[CUBE_BATCH_SIZE];
+            for (size_t i = 0; i < cnt; i += CUBE_BATCH_SIZE)
+            {
+                size_t n = std::min(cnt - i, (size_t) CUBE_BATCH_SIZE);
+                sampler->textureCubeLodBatch(coords + i, n, lod, texels);
+                for (size_t j = 0; j < n; j++)
+                {
+                    out[i + j] = texelColor(texels[j], sampler->isSrgb());
+                }
+            }
         }
 
         static inline glm::vec4 textureLodOffset(Sampler2DSoft<RGBA> *sampler, glm::vec2 coord, float lod = 0.f, glm::ivec2 offset)
         {
-            glm::vec4 ret = sampler->texture2DLodOffset(coord, lod, offset);
-            return ret / 255.0f;
+            return texelColor(sampler->texture2DLodOffset(coord, lod, offset), sampler->isSrgb());
         }
 
     public:
         ShaderBuiltin *gl = nullptr;
         std::function<float(BaseSampler<RGBA> *)> texLodFunc;
+        std::function<float(BaseSampler<RGBA> *)> texCubeLodFunc;
 
         float getSampler2DLod(BaseSampler<RGBA> *sampler) const
         {
@@ -129,10 +178,41 @@ namespace SoftGL
             float d = glm::max(glm::dot(dx, dx), glm::dot(dy, dy));
             return glm::max(0.5f * glm::log2(d), 0.0f);
         }
+
+        // derivative offset of a cube sampler points to a glm::vec3 direction varying
+        float getSamplerCubeLod(BaseSampler<RGBA> *sampler)
+        {
+            auto &dfCtx = gl->dfCtx;
+            if (cubeLodCache_.quadId == dfCtx.quadId && cubeLodCache_.sampler == sampler)
+            {
+                return cubeLodCache_.lod;
+            }
+            size_t dfOffset = getSamplerDerivativeOffset(sampler);
+            auto &dir0 = *(glm::vec3 *)(dfCtx.p0 + dfOffset);
+            auto &dir1 = *(glm::vec3 *)(dfCtx.p1 + dfOffset);
+            auto &dir2 = *(glm::vec3 *)(dfCtx.p2 + dfOffset);
+            auto &dir3 = *(glm::vec3 *)(dfCtx.p3 + dfOffset);
+            // one face for the whole quad, so derivatives across face edges stay continuous
+            int face = BaseSamplerCube<RGBA>::selectFace(dir0 + dir1 + dir2 + dir3);
+            glm::vec2 uv0 = BaseSamplerCube<RGBA>::faceUV(dir0, face);
+            glm::vec2 texSize = glm::vec2(sampler->width(), sampler->height());
+            glm::vec2 dx = (BaseSamplerCube<RGBA>::faceUV(dir1, face) - uv0) * texSize;
+            glm::vec2 dy = (BaseSamplerCube<RGBA>::faceUV(dir2, face) - uv0) * texSize;
+            float d = glm::max(glm::dot(dx, dx), glm::dot(dy, dy));
+            float lod = glm::max(0.5f * glm::log2(d), 0.0f);
+            // degenerate directions
+            if (!std::isfinite(lod))
+            {
+                lod = 0.f;
+            }
+            cubeLodCache_ = {dfCtx.quadId, sampler, lod};
+            return lod;
+        }
         
         virtual void prepareExecMain()
         {
             texLodFunc = std::bind(&ShaderSoft::getSampler2DLod, this, std::placeholders::_1);
+            texCubeLodFunc = std::bind(&ShaderSoft::getSamplerCubeLod, this, std::placeholders::_1);
         }
 
         virtual size_t getSamplerDerivativeOffset(BaseSampler<RGBA> *sampler) const
@@ -164,6 +244,15 @@ namespace SoftGL
             }
             return desc[loc].offset;
         }
+
+    private:
+        struct CubeLodCache
+        {
+            uint32_t quadId;
+            BaseSampler<RGBA> *sampler;
+            float lod;
+        };
+        CubeLodCache cubeLodCache_ = {0, nullptr, 0.f};
     };
 
 #define CREATE_SHADER_OVERRIDE                          \
@@ -1,22 +1,69 @@
 #pragma once
 
 #include <fstream>
+#include <atomic>
+#include <climits>
 #include "Base/UUID.h"
 #include "Base/Buffer.h"
+#include "Base/HalfFloat.h"
 #include "Base/ImageUtils.h"
 #include "Render/Texture.h"
+#include "SamplerFeedback.h"
 
 namespace SoftGL
 {
     #define SOFT_MS_CNT 4       // multi sample cnt
 
+    // packed storage of a sampled texel type, unpacked on fetch. identity for RGBA8
+    template<typename T>
+    struct TexelPacking
+    {
+        typedef T Type;
+        typedef T Packed;
+        static inline Packed pack(const T &v) { return v; }
+        static inline T unpack(const Packed &v) { return v; }
+    };
+
+    // R16, D16
+    template<>
+    struct TexelPacking<float>
+    {
+        typedef float Type;
+        typedef uint16_t Packed;
+        static inline Packed pack(const float &v) { return HalfFloat::packUnorm16(v); }
+        static inline float unpack(const Packed &v) { return HalfFloat::unpackUnorm16(v); }
+    };
+
+    // RGBA16F
+    template<>
+    struct TexelPacking<glm::vec4>
+    {
+        typedef glm::vec4 Type;
+        typedef glm::u16vec4 Packed;
+        static inline Packed pack(const glm::vec4 &v) { return HalfFloat::pack4(v); }
+        static inline glm::vec4 unpack(const Packed &v) { return HalfFloat::unpack4(v); }
+    };
+
+    // R11G11B10F
+    template<>
+    struct TexelPacking<glm::vec3>
+    {
+        typedef glm::vec3 Type;
+        typedef uint32_t Packed;
+        static inline Packed pack(const glm::vec3 &v) { return HalfFloat::packR11G11B10(v); }
+        static inline glm::vec3 unpack(const Packed &v) { return HalfFloat::unpackR11G11B10(v); }
+    };
+
+    template<typename T>
+    using PackedBuffer = Buffer<typename TexelPacking<T>::Packed>;
+
     template<typename T>
     class ImageBufferSoft
     {
     public:
         ImageBufferSoft() = default;
 
-        ImageBufferSoft(int w, int h, int samples = 1)
+        ImageBufferSoft(int w, int h, int samples = 1, BufferLayout layout = SOFTGL_BUFFER_LAYOUT_DEFAULT)
         {
             width = w;
             height = h;
@@ -25,11 +72,11 @@ namespace SoftGL
 
             if (samples == 1)
             {
-                buffer = Buffer<T>::makeDefault(w, h);
+                buffer = Buffer<T>::makeLayout(w, h, layout);
             }
-            else
+            else if (samples == SOFT_MS_CNT)
             {
-                bufferMs4x = Buffer<glm::tvec4<T>>::makeDefault(w, h);
+                bufferMs4x = Buffer<glm::tvec4<T>>::makeLayout(w, h, layout);
             }
             else
             {
@@ -46,9 +93,56 @@ namespace SoftGL
             buffer = buf;
         }
 
+        explicit ImageBufferSoft(const std::shared_ptr<BlockBuffer> &blk)
+        {
+            width = (int) blk->getWidth();
+            height = (int) blk->getHeight();
+            multiSample = false;
+            sampleCnt = 1;
+            blocks = blk;
+        }
+
+        static std::shared_ptr<ImageBufferSoft<T>> makePacked(const std::shared_ptr<PackedBuffer<T>> &buf)
+        {
+            auto ret = std::make_shared<ImageBufferSoft<T>>();
+            ret->width = (int) buf->getWidth();
+            ret->height = (int) buf->getHeight();
+            ret->packed = buf;
+            return ret;
+        }
+
+        // convert full precision buffer to packed storage, layout is kept
+        static std::shared_ptr<PackedBuffer<T>> packBuffer(Buffer<T> &buf)
+        {
+            buf.flushClear();
+            auto ret = PackedBuffer<T>::makeLayout(buf.getWidth(), buf.getHeight(), buf.getLayout());
+            const T *src = buf.getRawDataPtr();
+            auto *dst = ret->getRawDataPtr();
+            for (size_t i = 0; i < buf.getRawDataSize(); i++)
+            {
+                dst[i] = TexelPacking<T>::pack(src[i]);
+            }
+            return ret;
+        }
+
+        static std::shared_ptr<Buffer<T>> unpackBuffer(PackedBuffer<T> &buf)
+        {
+            buf.flushClear();
+            auto ret = Buffer<T>::makeLayout(buf.getWidth(), buf.getHeight(), buf.getLayout());
+            const auto *src = buf.getRawDataPtr();
+            T *dst = ret->getRawDataPtr();
+            for (size_t i = 0; i < buf.getRawDataSize(); i++)
+            {
+                dst[i] = TexelPacking<T>::unpack(src[i]);
+            }
+            return ret;
+        }
+
     public:
         std::shared_ptr<Buffer<T>> buffer;
         std::shared_ptr<Buffer<glm::tvec4<T>>> bufferMs4x;
+        std::shared_ptr<BlockBuffer> blocks;    // block compressed, buffer is null
+        std::shared_ptr<PackedBuffer<T>> packed;    // 16 bit / packed float, buffer is null
 
         int width = 0;
         int height = 0;
@@ -56,6 +150,25 @@ namespace SoftGL
         int sampleCnt = 1;
     };
 
+    #define STREAM_TAIL_SIZE 64     // levels up to this size are loaded with the loader and stay resident
+
+    // residency of streamed mip levels, levels finer than baseLevel hold no texel storage
+    struct MipResidency
+    {
+        int baseLevel = 0;
+        std::atomic<int> requestLevel{INT_MAX};    // finest level sampled since last streaming update
+
+        // record the wanted level, returns the finest resident level
+        inline int request(int level)
+        {
+            if (level < requestLevel.load(std::memory_order_relaxed))
+            {
+                requestLevel.store(level, std::memory_order_relaxed);
+            }
+            return baseLevel;
+        }
+    };
+
     template<typename T>
     class TextureImageSoft
     {
@@ -75,22 +188,102 @@ namespace SoftGL
             return levels.empty();
         }
 
+        inline bool compressed()
+        {
+            return !empty() && levels[0]->blocks != nullptr;
+        }
+
+        inline bool packed()
+        {
+            return !empty() && levels[0]->packed != nullptr;
+        }
+
         inline std::shared_ptr<ImageBufferSoft<T>> &getBuffer(uint32_t level = 0)
         {
             return levels[level];
         }
 
+        // write pending fast clears of all levels, sampling kernels do not check clear tags per texel
+        inline void flushClear()
+        {
+            for (auto &level : levels)
+            {
+                if (level->buffer)
+                {
+                    level->buffer->flushClear();
+                }
+                if (level->packed)
+                {
+                    level->packed->flushClear();
+                }
+            }
+        }
+
         void generateMipmap(bool sample = true);
+        static void generateMipmaps(TextureImageSoft<T> **images, size_t cnt, bool sample = true);
 
     public:
         std::vector<std::shared_ptr<ImageBufferSoft<T>>> levels;
+        std::shared_ptr<MipResidency> residency;    // null if all levels are resident
+        std::shared_ptr<SamplerFeedback> feedback;  // null if mip usage is not recorded
+        bool srgb = false;      // RGBA8 texels hold sRGB encoded color
+        BufferLayout layout = SOFTGL_BUFFER_LAYOUT_DEFAULT;    // memory layout of all levels
+    };
+
+    // block compression only applies to RGBA8 images
+    template<typename T>
+    struct BlockImageCodec
+    {
+        static std::shared_ptr<BlockBuffer> encode(Buffer<T> &buffer, BlockFormat format) { return nullptr; }
+        static std::shared_ptr<Buffer<T>> decode(const BlockBuffer &blocks, BufferLayout layout) { return nullptr; }
+    };
+
+    template<>
+    struct BlockImageCodec<RGBA>
+    {
+        static std::shared_ptr<BlockBuffer> encode(Buffer<RGBA> &buffer, BlockFormat format)
+        {
+            return BlockCompression::encode(buffer, format);
+        }
+
+        static std::shared_ptr<Buffer<RGBA>> decode(const BlockBuffer &blocks, BufferLayout layout)
+        {
+            return BlockCompression::decode(blocks, layout);
+        }
+    };
+
+    // full mip chain from the image loader of a streamed texture, only RGBA8 textures are streamed
+    template<typename T>
+    struct StreamImageCodec
+    {
+        static bool loadChain(const ImageLoader &loader, int width, int height, BufferLayout layout, TextureImageSoft<T> &chain) { return false; }
+    };
+
+    template<>
+    struct StreamImageCodec<RGBA>
+    {
+        static bool loadChain(const ImageLoader &loader, int width, int height, BufferLayout layout, TextureImageSoft<RGBA> &chain)
+        {
+            auto buffer = loader();
+            if (!buffer || buffer->getWidth() != width || buffer->getHeight() != height)
+            {
+                return false;
+            }
+            if (buffer->getLayout() != layout)
+            {
+                buffer = Buffer<RGBA>::makeLayoutCopy(*buffer, layout);
+            }
+            chain.levels.push_back(std::make_shared<ImageBufferSoft<RGBA>>(buffer));
+            chain.generateMipmap(true);
+            return true;
+        }
     };
 
     template<typename T>
     class TextureSoft : public Texture
     {
     public:
-        explicit TextureSoft(const SamplerDesc &desc)
+        explicit TextureSoft(const TextureDesc &desc)
         {
             width = desc.width;
             height = desc.height;
@@ -99,18 +292,24 @@ namespace SoftGL
             usage = desc.usage;
             useMipmaps = desc.useMipmaps;
             multiSample = desc.multiSample;
+            layout = desc.layout;
 
             switch (type)
             {
                 case TextureType_2D:
                     layerCount_ = 1;
                     break;
-                case TextureType_Cube:
+                case TextureType_CUBE:
                     layerCount_ = 6;
                     break;
                 default: break;
             }
             images_.resize(layerCount_);
+            for (auto &image : images_)
+            {
+                image.srgb = isSrgb();
+                image.layout = layout;
+            }
         }
 
         int getId() const override
@@ -138,20 +337,164 @@ namespace SoftGL
             for (int i = 0; i < layerCount_; i++)
             {
                 images_[i].levels.resize(1);
-                images_[i].levels[0] = std::make_shared<ImageBufferSoft<T>>(buffers[i]);
-                if (useMipmaps)
+                if (buffers[i]->getLayout() == layout)
+                {
+                    images_[i].levels[0] = std::make_shared<ImageBufferSoft<T>>(buffers[i]);
+                }
+                else
                 {
-                    images_[i].generateMipmap();
+                    images_[i].levels[0] = std::make_shared<ImageBufferSoft<T>>(Buffer<T>::makeLayoutCopy(*buffers[i], layout));
                 }
             }
+            if (useMipmaps)
+            {
+                // all layers share one pass so cube faces are filtered together
+                std::vector<TextureImageSoft<T> *> images(layerCount_);
+                for (int i = 0; i < layerCount_; i++)
+                {
+                    images[i] = &images_[i];
+                }
+                TextureImageSoft<T>::generateMipmaps(images.data(), images.size(), true);
+            }
+            if (isCompressed())
+            {
+                compressImages();
+            }
+            else if (isPacked())
+            {
+                packImages();
+            }
+        }
+
+        void setImageData(const std::vector<std::shared_ptr<BlockBuffer>> &buffers) override
+        {
+            if (!isCompressed() || multiSample)
+            {
+                LOGE("set image data failed: texture format not compressed");
+                return;
+            }
+            size_t levelCount = buffers.size() / layerCount_;
+            if (levelCount == 0 || width != buffers[0]->getWidth() || height != buffers[0]->getHeight())
+            {
+                LOGE("set image data failed: size not match");
+                return;
+            }
+            for (int i = 0; i < layerCount_; i++)
+            {
+                auto &levels = images_[i].levels;
+                levels.clear();
+                for (size_t level = 0; level < (useMipmaps ? levelCount : 1); level++)
+                {
+                    levels.push_back(std::make_shared<ImageBufferSoft<T>>(buffers[i * levelCount + level]));
+                }
+            }
+            // no mip levels stored, generate from decoded level 0
+            if (useMipmaps && levelCount == 1)
+            {
+                for (auto &image : images_)
+                {
+                    image.levels[0] = std::make_shared<ImageBufferSoft<T>>(BlockImageCodec<T>::decode(*image.levels[0]->blocks, layout));
+                }
+                std::vector<TextureImageSoft<T> *> images(layerCount_);
+                for (int i = 0; i < layerCount_; i++)
+                {
+                    images[i] = &images_[i];
+                }
+                TextureImageSoft<T>::generateMipmaps(images.data(), images.size(), true);
+                compressImages();
+            }
+        }
+
+        void setImageLoader(const ImageLoader &loader) override
+        {
+            if (multiSample || type != TextureType_2D || !useMipmaps)
+            {
+                LOGE("set image loader failed: streaming needs a 2D mipmapped texture");
+                return;
+            }
+            imageLoader_ = loader;
+            // levels only carry their size until TextureStreamer loads them
+            auto &image = images_[0];
+            image.levels.resize(getLevelCount());
+            for (uint32_t level = 0; level < image.levels.size(); level++)
+            {
+                image.levels[level] = std::make_shared<ImageBufferSoft<T>>();
+                image.levels[level]->width = (int) getLevelWidth(level);
+                image.levels[level]->height = (int) getLevelHeight(level);
+            }
+            image.residency = std::make_shared<MipResidency>();
+            image.residency->baseLevel = (int) image.levels.size();
+
+            // the tail levels are loaded now, so the texture never samples before streaming starts
+            TextureImageSoft<T> chain;
+            chain.srgb = image.srgb;
+            if (!StreamImageCodec<T>::loadChain(loader, width, height, layout, chain))
+            {
+                LOGE("set image loader failed: load tail levels of %s", tag.c_str());
+                return;
+            }
+            int tail = (int) getStreamTailLevel();
+            for (int level = tail; level < (int) image.levels.size(); level++)
+            {
+                image.levels[level] = chain.levels[level];
+            }
+            image.residency->baseLevel = tail;
+        }
+
+        // finest level of the tail that stays resident, streaming loads only finer levels
+        inline uint32_t getStreamTailLevel()
+        {
+            uint32_t levelCount = getLevelCount();
+            uint32_t level = 0;
+            while (level + 1 < levelCount && std::max(getLevelWidth(level), getLevelHeight(level)) > STREAM_TAIL_SIZE)
+            {
+                level++;
+            }
+            return level;
+        }
+
+        // record sampled mip levels of all layers
+        void setSamplerFeedback(const std::shared_ptr<SamplerFeedback> &feedback)
+        {
+            for (auto &image : images_)
+            {
+                image.feedback = feedback;
+            }
+        }
+
+        inline bool isStreamed() const
+        {
+            return imageLoader_ != nullptr;
+        }
+
+        inline const ImageLoader &getImageLoader() const
+        {
+            return imageLoader_;
+        }
+
+        inline uint32_t getLevelCount()
+        {
+            return useMipmaps ? (uint32_t) std::floor(std::log2(std::max(width, height))) + 1 : 1;
         }
 
         void initImageData() override
         {
             for (auto &image : images_)
             {
+                // packed attachments are allocated without full precision storage, multi sample keeps float
+                if (isPacked() && !multiSample)
+                {
+                    uint32_t levelCount = getLevelCount();
+                    image.levels.resize(levelCount);
+                    for (uint32_t level = 0; level < levelCount; level++)
+                    {
+                        auto buf = PackedBuffer<T>::makeLayout(getLevelWidth(level), getLevelHeight(level), layout);
+                        image.levels[level] = ImageBufferSoft<T>::makePacked(buf);
+                    }
+                    continue;
+                }
                 image.levels.resize(1);
-                image.levels[0] = std::make_shared<ImageBufferSoft<T>>(width, height, multiSample ? SOFT_MS_CNT : 1);
+                image.levels[0] = std::make_shared<ImageBufferSoft<T>>(width, height, multiSample ? SOFT_MS_CNT : 1, layout);
                 if (useMipmaps)
                 {
                     image.generateMipmap(false);
@@ -159,6 +502,39 @@ namespace SoftGL
             }
         }
 
+        // encode all levels, uncompressed buffers are released
+        void compressImages()
+        {
+            BlockFormat blockFormat = getBlockFormat(format);
+            for (auto &image : images_)
+            {
+                for (auto &level : image.levels)
+                {
+                    if (level->buffer)
+                    {
+                        level->blocks = BlockImageCodec<T>::encode(*level->buffer, blockFormat);
+                        level->buffer = nullptr;
+                    }
+                }
+            }
+        }
+
+        // convert all levels to packed storage, full precision buffers are released
+        void packImages()
+        {
+            for (auto &image : images_)
+            {
+                for (auto &level : image.levels)
+                {
+                    if (level->buffer)
+                    {
+                        level->packed = ImageBufferSoft<T>::packBuffer(*level->buffer);
+                        level->buffer = nullptr;
+                    }
+                }
+            }
+        }
+
         void dumpImage(const char *path, uint32_t layer, uint32_t level) override
         {
             dumpImageSoft(path, images_[layer], level);
@@ -184,6 +560,16 @@ namespace SoftGL
             ret = glm::clamp(cvtBorderColor(samplerDesc_.borderColor) * 255.f, {0, 0, 0, 0}, {255, 255, 255, 255});
         }
 
+        inline void getBorderColor(glm::vec4 &ret)
+        {
+            ret = cvtBorderColor(samplerDesc_.borderColor);
+        }
+
+        inline void getBorderColor(glm::vec3 &ret)
+        {
+            ret = glm::vec3(cvtBorderColor(samplerDesc_.borderColor));
+        }
+
         bool loadFromFile(const char *path) 
         {
             std::ifstream file(path, std::ios::in | std::ios::binary);
@@ -198,13 +584,21 @@ namespace SoftGL
                 for (int level = 0; level < layer.levels.size(); level++)
                 {
                     auto &img = layer.getBuffer(level);
-                    if (multiSample)
+                    if (img->blocks)
                     {
-                        file.read((char *) img->bufferMs4x->getRawDataPtr(), img->bufferMs4x->getRawDataBytesSize());
+                        file.read((char *) img->blocks->getRawDataPtr(), img->blocks->getRawDataByteSize());
+                    }
+                    else if (img->packed)
+                    {
+                        file.read((char *) img->packed->getRawDataPtr(), img->packed->getRawDataByteSize());
+                    }
+                    else if (multiSample)
+                    {
+                        file.read((char *) img->bufferMs4x->getRawDataPtr(), img->bufferMs4x->getRawDataByteSize());
                     }
                     else
                     {
-                        file.read((char *) img->buffer->getRawDataPtr(), img->buffer->getRawDataBytesSize());
+                        file.read((char *) img->buffer->getRawDataPtr(), img->buffer->getRawDataByteSize());
                     }
                 }
             }
@@ -232,13 +626,24 @@ namespace SoftGL
                 for (int level = 0; level < layer.levels.size(); level++)
                 {
                     auto &img = layer.getBuffer(level);
-                    if (multiSample)
+                    if (img->blocks)
+                    {
+                        file.write((char *) img->blocks->getRawDataPtr(), img->blocks->getRawDataByteSize());
+                    }
+                    else if (img->packed)
                     {
-                        file.write((char *) img->bufferMs4x->getRawDataPtr(), img->bufferMs4x->getRawDataBytesSize());
+                        img->packed->flushClear();
+                        file.write((char *) img->packed->getRawDataPtr(), img->packed->getRawDataByteSize());
+                    }
+                    else if (multiSample)
+                    {
+                        img->bufferMs4x->flushClear();
+                        file.write((char *) img->bufferMs4x->getRawDataPtr(), img->bufferMs4x->getRawDataByteSize());
                     }
                     else
                     {
-                        file.write((char *) img->buffer->getRawDataPtr(), img->buffer->getRawDataBytesSize());
+                        img->buffer->flushClear();
+                        file.write((char *) img->buffer->getRawDataPtr(), img->buffer->getRawDataByteSize());
                     }
                 }
             }
@@ -260,17 +665,45 @@ namespace SoftGL
         void dumpImageSoft(const char *path, TextureImageSoft<T> image, uint32_t level)
         {
             if (multiSample) return;
-            void *pixels = image.getBuffer(level)->buffer->getRawDataPtr();
+            auto &img = image.getBuffer(level);
+            auto buffer = img->buffer;
+            if (img->blocks)
+            {
+                buffer = BlockImageCodec<T>::decode(*img->blocks, Layout_Linear);
+            }
+            else if (img->packed)
+            {
+                buffer = ImageBufferSoft<T>::unpackBuffer(*img->packed);
+            }
+            if (!buffer)
+            {
+                LOGE("dump image failed: level %d not resident", level);
+                return;
+            }
+            buffer->flushClear();
+            if (buffer->getLayout() != Layout_Linear)
+            {
+                buffer = Buffer<T>::makeLayoutCopy(*buffer, Layout_Linear);
+            }
+            void *pixels = buffer->getRawDataPtr();
             auto levelWidth = (int32_t) getLevelWidth(level);
             auto levelHeight = (int32_t) getLevelHeight(level);
             // convert float to rgba
-            if (format == TextureFormat_FLOAT32)
+            if (format == TextureFormat_FLOAT32 || format == TextureFormat_R16 || format == TextureFormat_D16)
             {
                 auto *rgba_pixel = new uint8_t[levelWidth * levelHeight * 4];
                 ImageUtils::convertFloatImage(reinterpret_cast<RGBA *>(rgba_pixel), reinterpret_cast<float *>(pixels), levelWidth, levelHeight);
                 ImageUtils::writeImage(path, levelWidth, levelHeight, 4, rgba_pixel, levelWidth * 4, false);
                 delete[] rgba_pixel;
             }
+            else if (format == TextureFormat_RGBA16F || format == TextureFormat_R11G11B10F)
+            {
+                auto *rgba_pixel = new uint8_t[levelWidth * levelHeight * 4];
+                ImageUtils::convertHDRImage(reinterpret_cast<RGBA *>(rgba_pixel), reinterpret_cast<float *>(pixels), levelWidth, levelHeight,
+                                            format == TextureFormat_RGBA16F ? 4 : 3, sizeof(T) / sizeof(float));
+                ImageUtils::writeImage(path, levelWidth, levelHeight, 4, rgba_pixel, levelWidth * 4, true);
+                delete[] rgba_pixel;
+            }
             else
             {
                 ImageUtils::writeImage(path, levelWidth, levelHeight, 4, pixels, levelWidth * 4, true);
@@ -282,5 +715,6 @@ namespace SoftGL
         SamplerDesc samplerDesc_;
         std::vector<TextureImageSoft<T>> images_;
         uint32_t layerCount_ = 1;
+        ImageLoader imageLoader_;
     };
 }
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "TextureStreamer.h"
+#include "SamplerSoft.h"
+
+namespace SoftGL
+{
+    void TextureStreamer::addTexture(const std::shared_ptr<TextureSoft<RGBA>> &texture)
+    {
+        StreamEntry entry;
+        entry.texture = texture;
+        entries_.push_back(std::move(entry));
+    }
+
+    void TextureStreamer::update()
+    {
+        frame_++;
+        residentBytes_ = 0;
+        loadingBytes_ = 0;
+        for (auto it = entries_.begin(); it != entries_.end();)
+        {
+            auto texture = it->texture.lock();
+            // released, or uploaded with image data instead of a loader
+            if (!texture || !texture->isStreamed())
+            {
+                it = entries_.erase(it);
+                continue;
+            }
+            int request = texture->getImage().residency->requestLevel.exchange(INT_MAX, std::memory_order_relaxed);
+            if (request != INT_MAX)
+            {
+                it->lastUsed = frame_;
+                it->wantLevel = request;
+            }
+            if (it->load && it->load->done)
+            {
+                commitLoad(*it, *texture);
+            }
+            residentBytes_ += residentBytes(*texture);
+            if (it->load)
+            {
+                for (int level = it->load->level; level < it->load->endLevel; level++)
+                {
+                    loadingBytes_ += levelBytes(*texture, level);
+                }
+            }
+            it++;
+        }
+
+        // least recently used first
+        entries_.sort([](const StreamEntry &a, const StreamEntry &b) -> bool
+                      {
+                          return a.lastUsed < b.lastUsed;
+                      });
+        // the budget may have been lowered
+        evictOverBudget(0, true);
+
+        for (auto it = entries_.rbegin(); it != entries_.rend() && it->lastUsed == frame_; it++)
+        {
+            if (it->load || it->failed)
+            {
+                continue;
+            }
+            auto texture = it->texture.lock();
+            if (it->wantLevel < texture->getImage().residency->baseLevel)
+            {
+                issueLoad(*it, *texture);
+            }
+        }
+    }
+
+    size_t TextureStreamer::levelBytes(TextureSoft<RGBA> &texture, int level)
+    {
+        return (size_t) texture.getLevelWidth(level) * texture.getLevelHeight(level) * sizeof(RGBA);
+    }
+
+    size_t TextureStreamer::residentBytes(TextureSoft<RGBA> &texture)
+    {
+        size_t bytes = 0;
+        auto &image = texture.getImage();
+        for (int level = image.residency->baseLevel; level < (int) image.levels.size(); level++)
+        {
+            bytes += levelBytes(texture, level);
+        }
+        return bytes;
+    }
+
+    int TextureStreamer::tailLevel(TextureSoft<RGBA> &texture)
+    {
+        return (int) texture.getStreamTailLevel();
+    }
+
+    void TextureStreamer::commitLoad(StreamEntry &entry, TextureSoft<RGBA> &texture)
+    {
+        auto load = std::move(entry.load);
+        if (load->buffers.empty())
+        {
+            // not retried, the texture keeps sampling its resident levels
+            LOGE("texture streaming failed: %s", texture.tag.c_str());
+            entry.failed = true;
+            return;
+        }
+        // levels with a load in flight are not evicted, so the range still ends at baseLevel
+        auto &image = texture.getImage();
+        for (int level = load->level; level < load->endLevel; level++)
+        {
+            image.levels[level]->buffer = load->buffers[level - load->level];
+        }
+        image.residency->baseLevel = load->level;
+    }
+
+    void TextureStreamer::evictLevel(TextureSoft<RGBA> &texture)
+    {
+        auto &image = texture.getImage();
+        int level = image.residency->baseLevel;
+        image.levels[level]->buffer = nullptr;
+        image.residency->baseLevel = level + 1;
+        residentBytes_ -= levelBytes(texture, level);
+    }
+
+    void TextureStreamer::evictOverBudget(size_t needBytes, bool evictUsed)
+    {
+        // pass 0: levels finer than the texture last sampled, pass 1: textures not sampled last frame,
+        // pass 2: textures in use. tail levels are never evicted
+        int passCount = evictUsed ? 3 : 2;
+        for (int pass = 0; pass < passCount; pass++)
+        {
+            for (auto &entry : entries_)
+            {
+                if (residentBytes_ + loadingBytes_ + needBytes <= budget_)
+                {
+                    return;
+                }
+                if (entry.load || (pass == 1 && entry.lastUsed == frame_))
+                {
+                    continue;
+                }
+                auto texture = entry.texture.lock();
+                auto &residency = *texture->getImage().residency;
+                int keepLevel = tailLevel(*texture);
+                if (pass == 0)
+                {
+                    keepLevel = std::min(keepLevel, entry.wantLevel);
+                }
+                while (residency.baseLevel < keepLevel && residentBytes_ + loadingBytes_ + needBytes > budget_)
+                {
+                    evictLevel(*texture);
+                }
+            }
+        }
+    }
+
+    void TextureStreamer::issueLoad(StreamEntry &entry, TextureSoft<RGBA> &texture)
+    {
+        int endLevel = texture.getImage().residency->baseLevel;
+        int level = std::max(entry.wantLevel, 0);
+        size_t bytes = 0;
+        for (int i = level; i < endLevel; i++)
+        {
+            bytes += levelBytes(texture, i);
+        }
+        evictOverBudget(bytes, false);
+
+        // drop the finest levels that do not fit, the tail is always loaded
+        int tail = tailLevel(texture);
+        while (level < std::min(endLevel, tail) && residentBytes_ + loadingBytes_ + bytes > budget_)
+        {
+            bytes -= levelBytes(texture, level);
+            level++;
+        }
+        if (level >= endLevel)
+        {
+            return;
+        }
+
+        auto load = std::make_shared<LoadRequest>();
+        load->level = level;
+        load->endLevel = endLevel;
+        entry.load = load;
+        loadingBytes_ += bytes;
+
+        if (!loadPool_)
+        {
+            loadPool_ = std::unique_ptr<ThreadPool>(new ThreadPool(1));
+        }
+        ImageLoader loader = texture.getImageLoader();
+        int width = texture.width;
+        int height = texture.height;
+        BufferLayout layout = texture.layout;
+        bool srgb = texture.isSrgb();
+        loadPool_->pushTask([load, loader, width, height, layout, srgb](size_t thread_id)
+                            {
+                                // the full chain is filtered from level 0, only the requested range is kept.
+                                // sRGB texels are filtered in linear space, as on upload
+                                TextureImageSoft<RGBA> image;
+                                image.srgb = srgb;
+                                if (StreamImageCodec<RGBA>::loadChain(loader, width, height, layout, image))
+                                {
+                                    for (int level = load->level; level < load->endLevel; level++)
+                                    {
+                                        load->buffers.push_back(image.levels[level]->buffer);
+                                    }
+                                }
+                                load->done = true;
+                            });
+    }
+}
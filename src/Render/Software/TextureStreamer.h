@@ -0,0 +1,73 @@
+#pragma once
+
+#include <list>
+#include "Base/ThreadPool.h"
+#include "TextureSoft.h"
+
+namespace SoftGL
+{
+    #define STREAM_BUDGET_DEFAULT (256u << 20)
+
+    // streams mip levels of RGBA8 textures that have an image loader. levels are loaded on
+    // a background thread when sampled, least recently used levels are evicted over budget
+    class TextureStreamer
+    {
+    public:
+        void addTexture(const std::shared_ptr<TextureSoft<RGBA>> &texture);
+
+        // apply finished loads, evict and issue new loads. must be called when no draw is running
+        void update();
+
+        inline void setMemoryBudget(size_t bytes)
+        {
+            budget_ = bytes;
+        }
+
+        inline size_t getMemoryBudget() const
+        {
+            return budget_;
+        }
+
+        // texel memory of resident streamed levels
+        inline size_t getResidentBytes() const
+        {
+            return residentBytes_;
+        }
+
+    private:
+        // levels [level, endLevel) decoded on the background thread
+        struct LoadRequest
+        {
+            int level = 0;
+            int endLevel = 0;
+            std::vector<std::shared_ptr<Buffer<RGBA>>> buffers;
+            std::atomic<bool> done{false};
+        };
+
+        struct StreamEntry
+        {
+            std::weak_ptr<TextureSoft<RGBA>> texture;
+            uint64_t lastUsed = 0;
+            int wantLevel = INT_MAX;
+            std::shared_ptr<LoadRequest> load;
+            bool failed = false;
+        };
+
+        static size_t levelBytes(TextureSoft<RGBA> &texture, int level);
+        static size_t residentBytes(TextureSoft<RGBA> &texture);
+        static int tailLevel(TextureSoft<RGBA> &texture);
+
+        void commitLoad(StreamEntry &entry, TextureSoft<RGBA> &texture);
+        void evictLevel(TextureSoft<RGBA> &texture);
+        void evictOverBudget(size_t needBytes, bool evictUsed);
+        void issueLoad(StreamEntry &entry, TextureSoft<RGBA> &texture);
+
+    private:
+        std::list<StreamEntry> entries_;
+        uint64_t frame_ = 0;
+        size_t budget_ = STREAM_BUDGET_DEFAULT;
+        size_t residentBytes_ = 0;
+        size_t loadingBytes_ = 0;
+        std::unique_ptr<ThreadPool> loadPool_;    // created on first load
+    };
+}
@@ -51,22 +51,48 @@ namespace SoftGL
                     switch (format)
                     {
                         case TextureFormat_RGBA8:
+                        case TextureFormat_RGBA8_SRGB:
+                        case TextureFormat_BC1:
+                        case TextureFormat_BC3:
+                        case TextureFormat_BC5:
+                        case TextureFormat_BC7:
                             sampler_ = std::make_shared<Sampler2DSoft<RGBA>>();
                             break;
                         case TextureFormat_FLOAT32:
+                        case TextureFormat_R16:
+                        case TextureFormat_D16:
                             sampler_ = std::make_shared<Sampler2DSoft<float>>();
                             break;
+                        case TextureFormat_RGBA16F:
+                            sampler_ = std::make_shared<Sampler2DSoft<glm::vec4>>();
+                            break;
+                        case TextureFormat_R11G11B10F:
+                            sampler_ = std::make_shared<Sampler2DSoft<glm::vec3>>();
+                            break;
                     }
                     break;
                 case TextureType_CUBE:
                     switch (format)
                     {
                         case TextureFormat_RGBA8:
+                        case TextureFormat_RGBA8_SRGB:
+                        case TextureFormat_BC1:
+                        case TextureFormat_BC3:
+                        case TextureFormat_BC5:
+                        case TextureFormat_BC7:
                             sampler_ = std::make_shared<SamplerCubeSoft<RGBA>>();
                             break;
                         case TextureFormat_FLOAT32:
+                        case TextureFormat_R16:
+                        case TextureFormat_D16:
                             sampler_ = std::make_shared<SamplerCubeSoft<float>>();
                             break;
+                        case TextureFormat_RGBA16F:
+                            sampler_ = std::make_shared<SamplerCubeSoft<glm::vec4>>();
+                            break;
+                        case TextureFormat_R11G11B10F:
+                            sampler_ = std::make_shared<SamplerCubeSoft<glm::vec3>>();
+                            break;
                     }
                     break;
                 default:
@@ -85,6 +111,10 @@ namespace SoftGL
         {
             auto programSoft = dynamic_cast<ShaderProgramSoft *>(&program);
             programSoft->bindUniformSampler(sampler_, location);
+            if (sampler_)
+            {
+                sampler_->flushClear();
+            }
         }
 
         void setTexture(const std::shared_ptr<Texture> &tex) override
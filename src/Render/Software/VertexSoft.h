@@ -1,29 +1,96 @@
 #pragma once
 
+#include "Base/MemoryUtils.h"
 #include "Base/UUID.h"
-#include "Render/Vertex.h"
+#include "Render/VertexCodec.h"
 
 namespace SoftGL
 {
     class VertexArrayObjectSoft : public VertexArrayObject
     {
     public:
-        explicit VertexArrayObjectSoft(const VertexArray &vertexArray) 
+        explicit VertexArrayObjectSoft(const VertexArray &vertexArray)
+            : codec(vertexArray)
         {
             // init vertexes
             vertexStride = vertexArray.vertexesDesc[0].stride;
             vertexCnt = vertexArray.vertexesBufferLength / vertexStride;
-            vertexes.resize(vertexCnt * vertexStride);
-            memcpy(vertexes.data(), vertexArray.vertexesBuffer, vertexArray.vertexesBufferLength);
+            // packed vertexes are decoded per shaded vertex
+            fetchStride = codec.packed() ? codec.decodedVertexSize() : vertexStride;
+            // instance attributes are appended to the fetched vertex
+            instanceDesc = vertexArray.instanceDesc;
+            instanceStride = instanceDesc.empty() ? 0 : instanceDesc[0].stride;
+            instanceFetchStride = fetchStride;
+            for (auto &desc : instanceDesc)
+            {
+                instanceFetchStride = std::max(instanceFetchStride, desc.decodedOffset + desc.size * sizeof(float));
+            }
+            instanceFetchStride = MemoryUtils::alignedSize(instanceFetchStride);
+            updateInstanceData(vertexArray.instanceBuffer, vertexArray.instanceBufferLength);
             // init indices
-            indicesCnt = vertexArray.indexBufferLength / sizeof(int32_t);
-            indices.resize(indicesCnt);
-            memcpy(indices.data(), vertexArray.indexBuffer, vertexArray.indexBufferLength);
+            indexType = vertexArray.indexType;
+            indicesCnt = vertexArray.indexCnt();
+            // owned storage is referenced in place, otherwise copied
+            storage_ = vertexArray.storage;
+            if (storage_)
+            {
+                vertexes = vertexArray.vertexesBuffer;
+                indices = vertexArray.indexBuffer;
+            }
+            else
+            {
+                vertexesCopy_.assign(vertexArray.vertexesBuffer, vertexArray.vertexesBuffer + vertexCnt * vertexStride);
+                indicesCopy_.assign(vertexArray.indexBuffer, vertexArray.indexBuffer + vertexArray.indexBufferLength);
+                vertexes = vertexesCopy_.data();
+                indices = indicesCopy_.data();
+            }
+            for (size_t i = 0; i < indicesCnt; i++)
+            {
+                maxIndex = std::max(maxIndex, getIndex(i));
+            }
         }
 
-        void updateVertexData(void *data, size_t length) override
+        void updateVertexData(void *data, size_t length, size_t offset) override
         {
-            memcpy(vertexes.data(), data, std::min(length, vertexes.size()));
+            size_t size = vertexCnt * vertexStride;
+            // in place vertexes see the caller writes directly
+            if (offset >= size || data == vertexes + offset)
+            {
+                return;
+            }
+            memcpy(vertexes + offset, data, std::min(length, size - offset));
+        }
+
+        void updateInstanceData(void *data, size_t length) override
+        {
+            if (instanceStride == 0)
+            {
+                return;
+            }
+            instanceCnt = data ? length / instanceStride : 0;
+            instances.assign((uint8_t *) data, (uint8_t *) data + instanceCnt * instanceStride);
+        }
+
+        // float vertex for the shader: decoded or copied vertex attributes, then the instance attributes
+        void fetchVertex(size_t idx, size_t instance, uint8_t *dst) const
+        {
+            const uint8_t *src = vertexes + idx * vertexStride;
+            if (codec.packed())
+            {
+                codec.decode(src, dst);
+            }
+            else
+            {
+                memcpy(dst, src, vertexStride);
+            }
+            if (instance < instanceCnt)
+            {
+                const uint8_t *instanceSrc = instances.data() + instance * instanceStride;
+                for (auto &desc : instanceDesc)
+                {
+                    memcpy(dst + desc.decodedOffset, instanceSrc + desc.offset, desc.size * sizeof(float));
+                }
+            }
         }
 
         int getId() const override
@@ -31,14 +98,48 @@ namespace SoftGL
             return uuid_.get();
         }
 
+        inline uint32_t getIndex(size_t idx) const
+        {
+            return indexType == IndexType_UINT16 ? ((const uint16_t *) indices)[idx] : ((const uint32_t *) indices)[idx];
+        }
+
+        // true if indices [first, first + count) all reference stored vertexes
+        bool indicesInRange(size_t first, size_t count) const
+        {
+            if (maxIndex < vertexCnt)
+            {
+                return true;
+            }
+            for (size_t i = first; i < first + count; i++)
+            {
+                if (getIndex(i) >= vertexCnt)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
     public:
         size_t vertexStride;
+        size_t fetchStride;     // float vertex size seen by the shader
+        VertexCodec codec;
         size_t vertexCnt;
         size_t indicesCnt;
-        std::vector<uint8_t> vertexes;
-        std::vector<int32_t> indices;
+        IndexType indexType;
+        uint32_t maxIndex = 0;
+        uint8_t *vertexes;
+        const uint8_t *indices;
+        std::vector<VertexAttrbuteDesc> instanceDesc;
+        size_t instanceStride;
+        size_t instanceFetchStride;     // float vertex size with instance attributes
+        size_t instanceCnt = 0;
+        std::vector<uint8_t> instances;
 
     private:
         UUID<VertexArrayObjectSoft> uuid_;
+        std::shared_ptr<void> storage_;
+        std::vector<uint8_t> vertexesCopy_;
+        std::vector<uint8_t> indicesCopy_;
     };
 }
\ No newline at end of file
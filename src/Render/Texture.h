@@ -2,8 +2,10 @@
 
 #include <string>
 #include <memory>
+#include <functional>
 #include <vector>
 #include "Base/Buffer.h"
+#include "Base/BlockCompression.h"
 #include "Base/GLMInc.h"
 
 namespace SoftGL
@@ -62,6 +64,18 @@ namespace SoftGL
     {
         TextureFormat_RGBA8 = 0,
         TextureFormat_FLOAT32 = 1,
+        // block compressed, sampled as RGBA8
+        TextureFormat_BC1 = 2,
+        TextureFormat_BC3 = 3,
+        TextureFormat_BC5 = 4,
+        TextureFormat_BC7 = 5,
+        // 16 bit and packed float, stored packed in software renderer
+        TextureFormat_RGBA16F = 6,
+        TextureFormat_R11G11B10F = 7,   // unsigned float, no alpha
+        TextureFormat_R16 = 8,          // unorm
+        TextureFormat_D16 = 9,          // unorm depth
+        // sRGB encoded color, sampled and rendered to in linear space
+        TextureFormat_RGBA8_SRGB = 10,
     };
 
     enum TextureUsage
@@ -82,9 +96,13 @@ namespace SoftGL
         uint32_t usage = TextureUsage_Sampler;
         bool useMipmaps = false;
         bool multiSample = false;
+        BufferLayout layout = SOFTGL_BUFFER_LAYOUT_DEFAULT;    // software renderer memory layout
         std::string tag;
     };
 
+    // decodes full resolution image data on demand
+    typedef std::function<std::shared_ptr<Buffer<RGBA>>()> ImageLoader;
+
     class Texture : public TextureDesc
     {
     public:
@@ -100,11 +118,62 @@ namespace SoftGL
             return std::max(1, height >> level);
         }
 
+        inline bool isCompressed() const
+        {
+            return format >= TextureFormat_BC1 && format <= TextureFormat_BC7;
+        }
+
+        inline bool isPacked() const
+        {
+            return format >= TextureFormat_RGBA16F && format <= TextureFormat_D16;
+        }
+
+        inline bool isSrgb() const
+        {
+            return format == TextureFormat_RGBA8_SRGB;
+        }
+
+        inline bool isDepthFormat() const
+        {
+            return format == TextureFormat_FLOAT32 || format == TextureFormat_D16;
+        }
+
+        static inline TextureFormat getCompressedFormat(BlockFormat format)
+        {
+            switch (format)
+            {
+                case BlockFormat_BC3: return TextureFormat_BC3;
+                case BlockFormat_BC5: return TextureFormat_BC5;
+                case BlockFormat_BC7: return TextureFormat_BC7;
+                default: break;
+            }
+            return TextureFormat_BC1;
+        }
+
+        static inline BlockFormat getBlockFormat(TextureFormat format)
+        {
+            switch (format)
+            {
+                case TextureFormat_BC3: return BlockFormat_BC3;
+                case TextureFormat_BC5: return BlockFormat_BC5;
+                case TextureFormat_BC7: return BlockFormat_BC7;
+                default: break;
+            }
+            return BlockFormat_BC1;
+        }
+
         virtual int getId() const = 0;
         virtual void setSamplerDesc(SamplerDesc &sampler) {};
         virtual void initImageData() {};
         virtual void setImageData(const std::vector<std::shared_ptr<Buffer<RGBA>>> &buffers) {};
         virtual void setImageData(const std::vector<std::shared_ptr<Buffer<float>>> &buffers) {};
+        // RGBA16F (vec4) and R11G11B10F (vec3), packed on upload
+        virtual void setImageData(const std::vector<std::shared_ptr<Buffer<glm::vec4>>> &buffers) {};
+        virtual void setImageData(const std::vector<std::shared_ptr<Buffer<glm::vec3>>> &buffers) {};
+        // compressed levels of each layer: buffers[layer * levelCount + level]
+        virtual void setImageData(const std::vector<std::shared_ptr<BlockBuffer>> &buffers) {};
+        // mip levels are streamed in from the loader when sampled instead of uploaded (software renderer)
+        virtual void setImageLoader(const ImageLoader &loader) {};
         virtual void dumpImage(const char *path, uint32_t layer, uint32_t level) = 0;
     };
 }
\ No newline at end of file
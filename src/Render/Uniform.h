@@ -39,6 +39,11 @@ namespace SoftGL
         virtual void setSubData(void *data, int len, int offset) = 0;
         virtual void setData(void *data, int len) = 0;
 
+        inline int getSize() const
+        {
+            return blockSize;
+        }
+
     protected:
         int blockSize;
     };
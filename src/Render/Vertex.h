@@ -10,26 +10,69 @@ namespace SoftGL
     {
     public:
         virtual int getId() const = 0;
-        virtual void updateVertexData(void *data, size_t length) = 0;
+        // length bytes at byte offset, offset is a multiple of the vertex size
+        virtual void updateVertexData(void *data, size_t length, size_t offset = 0) = 0;
+        // instances drawn by drawInstanced, length / instance stride of them
+        virtual void updateInstanceData(void *data, size_t length) = 0;
     };
 
-    // only support float type attribute
+    enum VertexFormat
+    {
+        VertexFormat_FLOAT = 0,
+        VertexFormat_HALF,          // half floats
+        VertexFormat_UNORM16,       // uint16, dequantized with the vertex array quantScale & quantOffset
+        VertexFormat_OCT16,         // unit vector as 2 snorm16 octahedral coordinates
+    };
+
+    enum IndexType
+    {
+        IndexType_UINT32 = 0,
+        IndexType_UINT16,
+    };
+
+    // attributes are read as floats, packed formats are decoded at vertex fetch
     struct VertexAttrbuteDesc
     {
-        size_t size;
+        size_t size;            // float components after decoding
         size_t stride;
         size_t offset;
+        VertexFormat format;
+        size_t decodedOffset;   // offset in the decoded vertex, used when the array has packed attributes
     };
 
     struct VertexArray
     {
         size_t vertexSize = 0;
+        size_t decodedVertexSize = 0;   // float vertex size when any attribute is packed, 0 otherwise
         std::vector<VertexAttrbuteDesc> vertexesDesc;
+        glm::vec4 quantScale{1.f};
+        glm::vec4 quantOffset{0.f};
         
         uint8_t *vertexesBuffer = nullptr;
         size_t vertexesBufferLength = 0;
         
-        int32_t *indexBuffer = nullptr;
+        uint8_t *indexBuffer = nullptr;
         size_t indexBufferLength = 0;
+        IndexType indexType = IndexType_UINT32;
+
+        // per instance float attributes following the vertex attributes, decodedOffset places them
+        // after the vertex in the fetched vertex
+        std::vector<VertexAttrbuteDesc> instanceDesc;
+        uint8_t *instanceBuffer = nullptr;
+        size_t instanceBufferLength = 0;
+
+        // owner of the vertex & index buffers when set, vertex array objects reference them in place
+        // instead of copying and keep the owner alive
+        std::shared_ptr<void> storage;
+
+        static inline size_t indexSize(IndexType type)
+        {
+            return type == IndexType_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        }
+
+        inline size_t indexCnt() const
+        {
+            return indexBufferLength / indexSize(indexType);
+        }
     };
 }
\ No newline at end of file
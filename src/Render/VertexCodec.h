@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "Render/Vertex.h"
+#include <glm/gtc/packing.hpp>
+
+namespace SoftGL
+{
+    // packed vertex attribute encoding, and decoding to the float vertex layout the shaders read
+    class VertexCodec
+    {
+    public:
+        VertexCodec() = default;
+
+        explicit VertexCodec(const VertexArray &vertexArray)
+            : decodedVertexSize_(vertexArray.decodedVertexSize),
+              quantScale_(vertexArray.quantScale),
+              quantOffset_(vertexArray.quantOffset),
+              desc_(vertexArray.vertexesDesc)
+        {
+        }
+
+        inline bool packed() const
+        {
+            return decodedVertexSize_ > 0;
+        }
+
+        inline size_t vertexSize() const
+        {
+            return desc_.empty() ? 0 : desc_[0].stride;
+        }
+
+        inline size_t decodedVertexSize() const
+        {
+            return decodedVertexSize_;
+        }
+
+        // float attributes of the decoded vertex
+        std::vector<VertexAttrbuteDesc> decodedDesc() const
+        {
+            std::vector<VertexAttrbuteDesc> ret(desc_.size());
+            for (size_t i = 0; i < desc_.size(); i++)
+            {
+                ret[i] = {desc_[i].size, decodedVertexSize_, desc_[i].decodedOffset, VertexFormat_FLOAT, desc_[i].decodedOffset};
+            }
+            return ret;
+        }
+
+        // src points to the packed vertex, dst to decodedVertexSize bytes
+        void decode(const uint8_t *src, uint8_t *dst) const
+        {
+            for (auto &desc : desc_)
+            {
+                const uint8_t *in = src + desc.offset;
+                auto *out = (float *) (dst + desc.decodedOffset);
+                switch (desc.format)
+                {
+                    case VertexFormat_FLOAT:
+                        memcpy(out, in, desc.size * sizeof(float));
+                        break;
+                    case VertexFormat_HALF:
+                        for (size_t i = 0; i < desc.size; i++)
+                        {
+                            out[i] = glm::unpackHalf1x16(((const uint16_t *) in)[i]);
+                        }
+                        break;
+                    case VertexFormat_UNORM16:
+                        for (size_t i = 0; i < desc.size; i++)
+                        {
+                            out[i] = quantOffset_[i] + (float) ((const uint16_t *) in)[i] * (1.f / 65535.f) * quantScale_[i];
+                        }
+                        break;
+                    case VertexFormat_OCT16:
+                    {
+                        glm::vec3 n = decodeOct(((const int16_t *) in)[0], ((const int16_t *) in)[1]);
+                        memcpy(out, &n[0], std::min(desc.size, (size_t) 3) * sizeof(float));
+                        break;
+                    }
+                    default:
+                        break;
+                }
+            }
+        }
+
+        void decode(const uint8_t *src, size_t vertexCnt, uint8_t *dst) const
+        {
+            for (size_t i = 0; i < vertexCnt; i++)
+            {
+                decode(src + i * vertexSize(), dst + i * decodedVertexSize_);
+            }
+        }
+
+        // octahedral mapping (Cigolle et al. 2014), 16 bit coordinates keep the direction within 0.05 degrees
+        static void encodeOct(const glm::vec3 &v, int16_t *out)
+        {
+            float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+            if (l1 <= 0.f)
+            {
+                out[0] = 0;
+                out[1] = 0;
+                return;
+            }
+            glm::vec2 p = glm::vec2(v.x, v.y) / l1;
+            if (v.z < 0.f)
+            {
+                p = (1.f - glm::abs(glm::vec2(p.y, p.x))) * glm::vec2(p.x >= 0.f ? 1.f : -1.f, p.y >= 0.f ? 1.f : -1.f);
+            }
+            out[0] = (int16_t) glm::packSnorm1x16(p.x);
+            out[1] = (int16_t) glm::packSnorm1x16(p.y);
+        }
+
+        static glm::vec3 decodeOct(int16_t x, int16_t y)
+        {
+            glm::vec2 p(glm::unpackSnorm1x16((uint16_t) x), glm::unpackSnorm1x16((uint16_t) y));
+            glm::vec3 n(p.x, p.y, 1.f - std::abs(p.x) - std::abs(p.y));
+            if (n.z < 0.f)
+            {
+                n.x = (1.f - std::abs(p.y)) * (p.x >= 0.f ? 1.f : -1.f);
+                n.y = (1.f - std::abs(p.x)) * (p.y >= 0.f ? 1.f : -1.f);
+            }
+            float len = glm::length(n);
+            return len > 0.f ? n / len : n;
+        }
+
+        static inline uint16_t encodeUnorm16(float v, float offset, float scale)
+        {
+            float t = scale > 0.f ? (v - offset) / scale : 0.f;
+            return (uint16_t) (glm::clamp(t, 0.f, 1.f) * 65535.f + 0.5f);
+        }
+
+        static inline uint16_t encodeHalf(float v)
+        {
+            return (uint16_t) glm::packHalf1x16(v);
+        }
+
+    private:
+        size_t decodedVertexSize_ = 0;
+        glm::vec4 quantScale_{1.f};
+        glm::vec4 quantOffset_{0.f};
+        std::vector<VertexAttrbuteDesc> desc_;
+    };
+}
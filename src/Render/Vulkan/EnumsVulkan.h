@@ -27,13 +27,19 @@ static inline VkFormat cvtImageFormat(TextureFormat format, uint32_t usage) {
   if (usage & TextureUsage_AttachmentDepth) {
     switch (format) {
       case TextureFormat_FLOAT32: return VK_FORMAT_D32_SFLOAT;
+      case TextureFormat_D16:     return VK_FORMAT_D16_UNORM;
       default:
         break;
     }
   } else {
     switch (format) {
       case TextureFormat_RGBA8:   return VK_FORMAT_R8G8B8A8_UNORM;
+      case TextureFormat_RGBA8_SRGB: return VK_FORMAT_R8G8B8A8_SRGB;
       case TextureFormat_FLOAT32: return VK_FORMAT_R32_SFLOAT;
+      case TextureFormat_RGBA16F: return VK_FORMAT_R16G16B16A16_SFLOAT;
+      case TextureFormat_R11G11B10F: return VK_FORMAT_B10G11R11_UFLOAT_PACK32;
+      case TextureFormat_R16:
+      case TextureFormat_D16:     return VK_FORMAT_R16_UNORM;
       default:
         break;
     }
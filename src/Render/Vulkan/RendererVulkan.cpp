@@ -141,6 +141,7 @@ void RendererVulkan::setShaderResources(std::shared_ptr<ShaderResources> &resour
     return;
   }
 
+  resources_ = resources.get();
   if (shaderProgram_) {
     shaderProgram_->beginBindUniforms(commandBuffer_);
     shaderProgram_->bindResources(*resources);
@@ -154,6 +155,59 @@ void RendererVulkan::setPipelineStates(std::shared_ptr<PipelineStates> &states)
 }
 
 void RendererVulkan::draw() {
+  bindDrawStates();
+  vkCmdDrawIndexed(drawCmd_, vao_->getIndicesCnt(), 1, 0, 0, 0);
+}
+
+void RendererVulkan::drawRanges(const std::vector<DrawRange> &ranges) {
+  bindDrawStates();
+  for (auto &range : ranges) {
+    if (range.count == 0 || range.first + range.count > vao_->getIndicesCnt()) {
+      continue;
+    }
+    vkCmdDrawIndexed(drawCmd_, (uint32_t) range.count, 1, (uint32_t) range.first, 0, 0);
+  }
+}
+
+void RendererVulkan::drawInstanced(size_t instanceCnt) {
+  if (instanceCnt == 0) {
+    return;
+  }
+  bindDrawStates();
+  vkCmdDrawIndexed(drawCmd_, vao_->getIndicesCnt(), (uint32_t) instanceCnt, 0, 0, 0);
+}
+
+void RendererVulkan::drawMulti(const std::vector<DrawCommand> &commands, const UniformTable &uniforms) {
+  if (!resources_) {
+    return;
+  }
+  VertexArrayObjectVulkan *boundVao = vao_;
+  for (auto &command : commands) {
+    auto *vao = dynamic_cast<VertexArrayObjectVulkan *>(command.vao);
+    if (!vao || command.count == 0 || command.first + command.count > vao->getIndicesCnt()) {
+      continue;
+    }
+    // blocks get new buffers once the previous ones are in use, so the descriptor sets are written per draw
+    size_t recordOffset = command.uniformOffset;
+    for (auto &block : uniforms.blocks) {
+      if (recordOffset + block->getSize() > uniforms.data.size()) {
+        break;
+      }
+      block->setData((void *) (uniforms.data.data() + recordOffset), block->getSize());
+      recordOffset += block->getSize();
+    }
+    shaderProgram_->beginBindUniforms(commandBuffer_);
+    shaderProgram_->bindResources(*resources_);
+    shaderProgram_->endBindUniforms();
+
+    vao_ = vao;
+    bindDrawStates();
+    vkCmdDrawIndexed(drawCmd_, (uint32_t) command.count, 1, (uint32_t) command.first, 0, 0);
+  }
+  vao_ = boundVao;
+}
+
+void RendererVulkan::bindDrawStates() {
   // pipeline
   vkCmdBindPipeline(drawCmd_, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineStates_->getGraphicsPipeline());
 
@@ -162,20 +216,21 @@ void RendererVulkan::draw() {
   vkCmdSetScissor(drawCmd_, 0, 1, &scissor_);
 
   // vertex buffer
-  VkBuffer vertexBuffers[] = {vao_->getVertexBuffer()};
-  VkDeviceSize offsets[] = {0};
-  vkCmdBindVertexBuffers(drawCmd_, 0, 1, vertexBuffers, offsets);
+  VkBuffer vertexBuffers[] = {vao_->getVertexBuffer(), VK_NULL_HANDLE};
+  VkDeviceSize offsets[] = {0, 0};
+  uint32_t bindingCnt = 1;
+  if (vao_->hasInstanceBuffer()) {
+    vertexBuffers[bindingCnt++] = vao_->getInstanceBuffer();
+  }
+  vkCmdBindVertexBuffers(drawCmd_, 0, bindingCnt, vertexBuffers, offsets);
 
   // index buffer
-  vkCmdBindIndexBuffer(drawCmd_, vao_->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+  vkCmdBindIndexBuffer(drawCmd_, vao_->getIndexBuffer(), 0, vao_->getIndexType());
 
   // descriptor sets
   auto &descriptorSets = shaderProgram_->getVkDescriptorSet();
   vkCmdBindDescriptorSets(drawCmd_, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineStates_->getGraphicsPipelineLayout(),
                           0, descriptorSets.size(), descriptorSets.data(), 0, nullptr);
-
-  // draw
-  vkCmdDrawIndexed(drawCmd_, vao_->getIndicesCnt(), 1, 0, 0, 0);
 }
 
 void RendererVulkan::endRenderPass() {
@@ -49,6 +49,9 @@ class RendererVulkan : public Renderer {
   void setShaderResources(std::shared_ptr<ShaderResources> &resources) override;
   void setPipelineStates(std::shared_ptr<PipelineStates> &states) override;
   void draw() override;
+  void drawRanges(const std::vector<DrawRange> &ranges) override;
+  void drawInstanced(size_t instanceCnt) override;
+  void drawMulti(const std::vector<DrawCommand> &commands, const UniformTable &uniforms) override;
   void endRenderPass() override;
   void waitIdle() override;
 
@@ -57,11 +60,15 @@ class RendererVulkan : public Renderer {
     return vkCtx_;
   }
 
+ private:
+  void bindDrawStates();
+
  private:
   FrameBufferVulkan *fbo_ = nullptr;
   VertexArrayObjectVulkan *vao_ = nullptr;
   ShaderProgramVulkan *shaderProgram_ = nullptr;
   PipelineStatesVulkan *pipelineStates_ = nullptr;
+  ShaderResources *resources_ = nullptr;
 
   VkViewport viewport_{};
   VkRect2D scissor_{};
@@ -116,13 +116,43 @@ void TextureVulkan::dumpImage(const char *path, uint32_t layer, uint32_t level)
 
   readPixels(layer, level, [&](uint8_t *buffer, uint32_t w, uint32_t h, uint32_t rowStride) -> void {
     auto *pixels = new uint8_t[w * h * 4];
-    for (uint32_t i = 0; i < h; i++) {
-      memcpy(pixels + i * rowStride, buffer + i * rowStride, w * getPixelByteSize());
-    }
-
-    // convert float to rgba
-    if (format == TextureFormat_FLOAT32) {
-      ImageUtils::convertFloatImage(reinterpret_cast<RGBA *>(pixels), reinterpret_cast<float *>(pixels), w, h);
+    uint32_t pixelBytes = getPixelByteSize();
+    if (format == TextureFormat_R16 || format == TextureFormat_D16) {
+      std::vector<float> texels(w * h);
+      for (uint32_t y = 0; y < h; y++) {
+        auto *src = reinterpret_cast<const uint16_t *>(buffer + y * rowStride);
+        for (uint32_t x = 0; x < w; x++) {
+          texels[y * w + x] = HalfFloat::unpackUnorm16(src[x]);
+        }
+      }
+      ImageUtils::convertFloatImage(reinterpret_cast<RGBA *>(pixels), texels.data(), w, h);
+    } else if (format == TextureFormat_RGBA16F || format == TextureFormat_R11G11B10F) {
+      // unpack to float, then clamp to rgba
+      std::vector<glm::vec4> texels(w * h);
+      for (uint32_t y = 0; y < h; y++) {
+        const uint8_t *src = buffer + y * rowStride;
+        for (uint32_t x = 0; x < w; x++, src += pixelBytes) {
+          if (format == TextureFormat_RGBA16F) {
+            glm::u16vec4 v;
+            memcpy(&v, src, sizeof(v));
+            texels[y * w + x] = HalfFloat::unpack4(v);
+          } else {
+            uint32_t v;
+            memcpy(&v, src, sizeof(v));
+            texels[y * w + x] = glm::vec4(HalfFloat::unpackR11G11B10(v), 1.f);
+          }
+        }
+      }
+      ImageUtils::convertHDRImage(reinterpret_cast<RGBA *>(pixels), &texels[0][0], w, h, 4, 4);
+    } else {
+      for (uint32_t i = 0; i < h; i++) {
+        memcpy(pixels + i * w * pixelBytes, buffer + i * rowStride, w * pixelBytes);
+      }
+
+      // convert float to rgba
+      if (format == TextureFormat_FLOAT32) {
+        ImageUtils::convertFloatImage(reinterpret_cast<RGBA *>(pixels), reinterpret_cast<float *>(pixels), w, h);
+      }
     }
     ImageUtils::writeImage(path, (int) w, (int) h, 4, pixels, (int) w * 4, true);
     delete[] pixels;
@@ -463,23 +493,11 @@ void TextureVulkan::generateMipmaps() {
 }
 
 void TextureVulkan::setImageData(const std::vector<std::shared_ptr<Buffer<RGBA>>> &buffers) {
-  if (format != TextureFormat_RGBA8) {
-    LOGE("setImageData error: format not match");
-    return;
-  }
-
-  if (buffers.size() != layerCount_) {
-    LOGE("setImageData error: layer count not match");
+  if (!checkImageData(buffers, format == TextureFormat_RGBA8 || isSrgb())) {
     return;
   }
 
-  auto &dataBuffer = buffers[0];
-  if (dataBuffer->getRawDataSize() != width * height) {
-    LOGE("setImageData error: size not match");
-    return;
-  }
-
-  VkDeviceSize imageSize = dataBuffer->getRawDataBytesSize();
+  VkDeviceSize imageSize = buffers[0]->getRawDataByteSize();
   std::vector<const void *> buffersPtr;
   buffersPtr.reserve(buffers.size());
   for (auto &buff : buffers) {
@@ -490,23 +508,17 @@ void TextureVulkan::setImageData(const std::vector<std::shared_ptr<Buffer<RGBA>>
 }
 
 void TextureVulkan::setImageData(const std::vector<std::shared_ptr<Buffer<float>>> &buffers) {
-  if (format != TextureFormat_FLOAT32) {
-    LOGE("setImageData error: format not match");
+  bool unorm16 = (format == TextureFormat_R16 || format == TextureFormat_D16);
+  if (!checkImageData(buffers, format == TextureFormat_FLOAT32 || unorm16)) {
     return;
   }
 
-  if (buffers.size() != layerCount_) {
-    LOGE("setImageData error: layer count not match");
+  if (unorm16) {
+    setImageDataPacked<uint16_t>(buffers, [](float v) { return HalfFloat::packUnorm16(v); });
     return;
   }
 
-  auto &dataBuffer = buffers[0];
-  if (dataBuffer->getRawDataSize() != width * height) {
-    LOGE("setImageData error: size not match");
-    return;
-  }
-
-  VkDeviceSize imageSize = dataBuffer->getRawDataBytesSize();
+  VkDeviceSize imageSize = buffers[0]->getRawDataByteSize();
   std::vector<const void *> buffersPtr;
   buffersPtr.reserve(buffers.size());
   for (auto &buff : buffers) {
@@ -516,6 +528,20 @@ void TextureVulkan::setImageData(const std::vector<std::shared_ptr<Buffer<float>
   setImageDataInternal(buffersPtr, imageSize);
 }
 
+void TextureVulkan::setImageData(const std::vector<std::shared_ptr<Buffer<glm::vec4>>> &buffers) {
+  if (!checkImageData(buffers, format == TextureFormat_RGBA16F)) {
+    return;
+  }
+  setImageDataPacked<glm::u16vec4>(buffers, [](const glm::vec4 &v) { return HalfFloat::pack4(v); });
+}
+
+void TextureVulkan::setImageData(const std::vector<std::shared_ptr<Buffer<glm::vec3>>> &buffers) {
+  if (!checkImageData(buffers, format == TextureFormat_R11G11B10F)) {
+    return;
+  }
+  setImageDataPacked<uint32_t>(buffers, [](const glm::vec3 &v) { return HalfFloat::packR11G11B10(v); });
+}
+
 void TextureVulkan::setImageDataInternal(const std::vector<const void *> &buffers, VkDeviceSize imageSize) {
   VkDeviceSize bufferSize = imageSize * layerCount_;
   if (uploadStagingBuffer_.buffer == VK_NULL_HANDLE) {
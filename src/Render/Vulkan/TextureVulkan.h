@@ -9,6 +9,7 @@
 #include <functional>
 #include "Base/UUID.h"
 #include "Base/ImageUtils.h"
+#include "Base/HalfFloat.h"
 #include "Render/Texture.h"
 #include "VKContext.h"
 #include "EnumsVulkan.h"
@@ -38,6 +39,10 @@ class TextureVulkan : public Texture {
 
   void setImageData(const std::vector<std::shared_ptr<Buffer<float>>> &buffers) override;
 
+  void setImageData(const std::vector<std::shared_ptr<Buffer<glm::vec4>>> &buffers) override;
+
+  void setImageData(const std::vector<std::shared_ptr<Buffer<glm::vec3>>> &buffers) override;
+
   void readPixels(uint32_t layer, uint32_t level,
                   const std::function<void(uint8_t *buffer, uint32_t width, uint32_t height, uint32_t rowStride)> &func);
 
@@ -68,9 +73,19 @@ class TextureVulkan : public Texture {
   inline uint32_t getPixelByteSize() {
     switch (format) {
       case TextureFormat_RGBA8:
+      case TextureFormat_RGBA8_SRGB:
         return sizeof(RGBA);
       case TextureFormat_FLOAT32:
         return sizeof(float);
+      case TextureFormat_RGBA16F:
+        return sizeof(glm::u16vec4);
+      case TextureFormat_R11G11B10F:
+        return sizeof(uint32_t);
+      case TextureFormat_R16:
+      case TextureFormat_D16:
+        return sizeof(uint16_t);
+      default:
+        break;
     }
     return 0;
   }
@@ -128,6 +143,44 @@ class TextureVulkan : public Texture {
   void generateMipmaps();
   void setImageDataInternal(const std::vector<const void *> &buffers, VkDeviceSize imageSize);
 
+  template<typename T>
+  bool checkImageData(const std::vector<std::shared_ptr<Buffer<T>>> &buffers, bool formatMatch) {
+    if (!formatMatch) {
+      LOGE("setImageData error: format not match");
+      return false;
+    }
+
+    if (buffers.size() != layerCount_) {
+      LOGE("setImageData error: layer count not match");
+      return false;
+    }
+
+    if (buffers[0]->getRawDataSize() != width * height) {
+      LOGE("setImageData error: size not match");
+      return false;
+    }
+    return true;
+  }
+
+  // convert texels to the packed image format before upload
+  template<typename P, typename T, typename F>
+  void setImageDataPacked(const std::vector<std::shared_ptr<Buffer<T>>> &buffers, F cvt) {
+    size_t texelCnt = buffers[0]->getRawDataSize();
+    std::vector<std::vector<P>> packed(buffers.size());
+    std::vector<const void *> buffersPtr;
+    buffersPtr.reserve(buffers.size());
+    for (size_t i = 0; i < buffers.size(); i++) {
+      T *src = buffers[i]->getRawDataPtr();
+      packed[i].resize(texelCnt);
+      for (size_t idx = 0; idx < texelCnt; idx++) {
+        packed[i][idx] = cvt(src[idx]);
+      }
+      buffersPtr.push_back(packed[i].data());
+    }
+
+    setImageDataInternal(buffersPtr, texelCnt * sizeof(P));
+  }
+
  protected:
   UUID<TextureVulkan> uuid_;
   VKContext &vkCtx_;
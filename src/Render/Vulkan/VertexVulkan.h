@@ -8,7 +8,7 @@
 
 #include "Base/UUID.h"
 #include "Base/Timer.h"
-#include "Render/Vertex.h"
+#include "Render/VertexCodec.h"
 #include "VulkanUtils.h"
 
 namespace SoftGL {
@@ -21,41 +21,74 @@ class VertexArrayObjectVulkan : public VertexArrayObject {
     if (!vertexArr.vertexesBuffer || !vertexArr.indexBuffer) {
       return;
     }
-    indicesCnt_ = vertexArr.indexBufferLength / sizeof(int32_t);
+    indicesCnt_ = vertexArr.indexCnt();
+    indexType_ = vertexArr.indexType == IndexType_UINT16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+    // packed vertexes are decoded on upload, the shaders read float attributes
+    codec_ = VertexCodec(vertexArr);
+    auto vertexesDesc = codec_.packed() ? codec_.decodedDesc() : vertexArr.vertexesDesc;
+    vertexesLength_ = vertexArr.vertexesBufferLength;
+    if (codec_.packed()) {
+      vertexesLength_ = vertexArr.vertexesBufferLength / codec_.vertexSize() * codec_.decodedVertexSize();
+    }
 
     // init vertex input info
-    bindingDescription_.binding = 0;
-    bindingDescription_.stride = vertexArr.vertexSize;
-    bindingDescription_.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    bindingDescriptions_.resize(vertexArr.instanceDesc.empty() ? 1 : 2);
+    bindingDescriptions_[0].binding = 0;
+    bindingDescriptions_[0].stride = codec_.packed() ? codec_.decodedVertexSize() : vertexArr.vertexSize;
+    bindingDescriptions_[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-    size_t attrCnt = vertexArr.vertexesDesc.size();
+    size_t attrCnt = vertexesDesc.size();
     attributeDescriptions_.resize(attrCnt);
     for (size_t i = 0; i < attrCnt; i++) {
-      auto &attrDesc = vertexArr.vertexesDesc[i];
+      auto &attrDesc = vertexesDesc[i];
       attributeDescriptions_[i].binding = 0;
       attributeDescriptions_[i].location = i;
       attributeDescriptions_[i].format = vertexAttributeFormat(attrDesc.size);
       attributeDescriptions_[i].offset = attrDesc.offset;
     }
 
+    // instance attributes follow the vertex attributes on binding 1
+    if (!vertexArr.instanceDesc.empty()) {
+      bindingDescriptions_[1].binding = 1;
+      bindingDescriptions_[1].stride = vertexArr.instanceDesc[0].stride;
+      bindingDescriptions_[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+      for (size_t i = 0; i < vertexArr.instanceDesc.size(); i++) {
+        auto &attrDesc = vertexArr.instanceDesc[i];
+        VkVertexInputAttributeDescription instanceAttr{};
+        instanceAttr.binding = 1;
+        instanceAttr.location = attrCnt + i;
+        instanceAttr.format = vertexAttributeFormat(attrDesc.size);
+        instanceAttr.offset = attrDesc.offset;
+        attributeDescriptions_.push_back(instanceAttr);
+      }
+    }
+
     vertexInputInfo_.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo_.vertexBindingDescriptionCount = 1;
-    vertexInputInfo_.pVertexBindingDescriptions = &bindingDescription_;
+    vertexInputInfo_.vertexBindingDescriptionCount = bindingDescriptions_.size();
+    vertexInputInfo_.pVertexBindingDescriptions = bindingDescriptions_.data();
     vertexInputInfo_.vertexAttributeDescriptionCount = attributeDescriptions_.size();
     vertexInputInfo_.pVertexAttributeDescriptions = attributeDescriptions_.data();
 
     // create buffers
-    vkCtx_.createGPUBuffer(vertexBuffer_, vertexArr.vertexesBufferLength, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    vkCtx_.createGPUBuffer(vertexBuffer_, vertexesLength_, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
     vkCtx_.createGPUBuffer(indexBuffer_, vertexArr.indexBufferLength, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
-    vkCtx_.createStagingBuffer(vertexStagingBuffer_, vertexArr.vertexesBufferLength);
+    vkCtx_.createStagingBuffer(vertexStagingBuffer_, vertexesLength_);
     vkCtx_.createStagingBuffer(indexStagingBuffer_, vertexArr.indexBufferLength);
 
     // upload data
-    uploadBufferData(vertexBuffer_, vertexStagingBuffer_, vertexArr.vertexesBuffer, vertexArr.vertexesBufferLength,
-                     VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
-    uploadBufferData(indexBuffer_, indexStagingBuffer_, vertexArr.indexBuffer, vertexArr.indexBufferLength,
+    updateVertexData(vertexArr.vertexesBuffer, vertexArr.vertexesBufferLength, 0);
+    uploadBufferData(indexBuffer_, indexStagingBuffer_, vertexArr.indexBuffer, vertexArr.indexBufferLength, 0,
                      VK_ACCESS_INDEX_READ_BIT);
+
+    // instance buffer sized by the initial instance data
+    if (!vertexArr.instanceDesc.empty() && vertexArr.instanceBufferLength > 0) {
+      instancesLength_ = vertexArr.instanceBufferLength;
+      vkCtx_.createGPUBuffer(instanceBuffer_, instancesLength_, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+      vkCtx_.createStagingBuffer(instanceStagingBuffer_, instancesLength_);
+      updateInstanceData(vertexArr.instanceBuffer, vertexArr.instanceBufferLength);
+    }
   }
 
   ~VertexArrayObjectVulkan() {
@@ -63,14 +96,39 @@ class VertexArrayObjectVulkan : public VertexArrayObject {
     vertexStagingBuffer_.destroy(vkCtx_.allocator());
     indexBuffer_.destroy(vkCtx_.allocator());
     indexStagingBuffer_.destroy(vkCtx_.allocator());
+    if (instancesLength_ > 0) {
+      instanceBuffer_.destroy(vkCtx_.allocator());
+      instanceStagingBuffer_.destroy(vkCtx_.allocator());
+    }
   }
 
   int getId() const override {
     return uuid_.get();
   }
 
-  void updateVertexData(void *data, size_t length) override {
-    uploadBufferData(vertexBuffer_, vertexStagingBuffer_, data, length, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+  void updateVertexData(void *data, size_t length, size_t offset) override {
+    if (codec_.packed()) {
+      size_t vertexCnt = length / codec_.vertexSize();
+      offset = offset / codec_.vertexSize() * codec_.decodedVertexSize();
+      std::vector<uint8_t> decoded(vertexCnt * codec_.decodedVertexSize());
+      codec_.decode((const uint8_t *) data, vertexCnt, decoded.data());
+      if (offset + decoded.size() <= vertexesLength_) {
+        uploadBufferData(vertexBuffer_, vertexStagingBuffer_, decoded.data(), decoded.size(), offset, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+      }
+      return;
+    }
+    if (offset + length <= vertexesLength_) {
+      uploadBufferData(vertexBuffer_, vertexStagingBuffer_, data, length, offset, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+    }
+  }
+
+  // instances beyond the initial instance data are dropped
+  void updateInstanceData(void *data, size_t length) override {
+    if (!data || instancesLength_ == 0) {
+      return;
+    }
+    uploadBufferData(instanceBuffer_, instanceStagingBuffer_, data, std::min(length, instancesLength_), 0,
+                     VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
   }
 
   // only Float element
@@ -94,22 +152,35 @@ class VertexArrayObjectVulkan : public VertexArrayObject {
     return indicesCnt_;
   }
 
+  inline VkIndexType getIndexType() const {
+    return indexType_;
+  }
+
   inline VkBuffer &getVertexBuffer() {
     return vertexBuffer_.buffer;
   }
 
+  inline bool hasInstanceBuffer() const {
+    return instancesLength_ > 0;
+  }
+
+  inline VkBuffer &getInstanceBuffer() {
+    return instanceBuffer_.buffer;
+  }
+
   inline VkBuffer &getIndexBuffer() {
     return indexBuffer_.buffer;
   }
 
  private:
   void uploadBufferData(AllocatedBuffer &buffer, AllocatedBuffer &stagingBuffer, void *bufferData, VkDeviceSize bufferSize,
-                        VkAccessFlags dstAccessMask) {
+                        VkDeviceSize dstOffset, VkAccessFlags dstAccessMask) {
     memcpy(stagingBuffer.allocInfo.pMappedData, bufferData, (size_t) bufferSize);
 
     auto *commandBuffer = vkCtx_.beginCommands();
 
     VkBufferCopy copyRegion{};
+    copyRegion.dstOffset = dstOffset;
     copyRegion.size = bufferSize;
     vkCmdCopyBuffer(commandBuffer->cmdBuffer, stagingBuffer.buffer, buffer.buffer, 1, &copyRegion);
 
@@ -135,9 +206,12 @@ class VertexArrayObjectVulkan : public VertexArrayObject {
   VkDevice device_ = VK_NULL_HANDLE;
 
   uint32_t indicesCnt_ = 0;
+  VkIndexType indexType_ = VK_INDEX_TYPE_UINT32;
+  size_t vertexesLength_ = 0;
+  VertexCodec codec_;
 
   VkPipelineVertexInputStateCreateInfo vertexInputInfo_{};
-  VkVertexInputBindingDescription bindingDescription_{};
+  std::vector<VkVertexInputBindingDescription> bindingDescriptions_;
   std::vector<VkVertexInputAttributeDescription> attributeDescriptions_;
 
   AllocatedBuffer vertexBuffer_{};
@@ -145,6 +219,10 @@ class VertexArrayObjectVulkan : public VertexArrayObject {
 
   AllocatedBuffer vertexStagingBuffer_{};
   AllocatedBuffer indexStagingBuffer_{};
+
+  size_t instancesLength_ = 0;
+  AllocatedBuffer instanceBuffer_{};
+  AllocatedBuffer instanceStagingBuffer_{};
 };
 
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "Base/GLMInc.h"
 #include "Render/Renderer.h"
 
@@ -18,6 +19,19 @@ namespace SoftGL
             AAType_FXAA,
         };
 
+        // mip usage of a material texture, from software renderer sampler feedback
+        struct TextureFeedbackInfo
+        {
+            std::string tag;
+            int width = 0;
+            int height = 0;
+            int minLevel = -1;                      // finest level sampled, -1 if not sampled
+            size_t unusedBytes = 0;                 // levels finer than minLevel
+            std::vector<float> levelUsage;          // share of samples per level
+            std::vector<uint8_t> regionMinLevel;    // finest level per uv region, row major
+            int regionSize = 0;
+        };
+
         class Config
         {
         public:
@@ -27,6 +41,14 @@ namespace SoftGL
             std::string skyboxPath;
 
             size_t triangleCount_ = 0;
+            float modelLoadProgress = -1.f;     // background model loading [0, 1], negative when idle
+
+            // model import post-processing, models are imported again when changed
+            bool importTangents = true;         // tangent space, skipped when no material has a normal map
+            bool importSmoothNormals = false;   // normals for meshes without them
+            bool importJoinVertices = false;    // index shared vertices, smaller meshes for slower import
+            bool meshOptimize = true;           // reorder triangles & vertexes for vertex cache, overdraw and fetch
+            bool meshQuantize = true;           // 20 byte packed vertexes instead of 64 byte float ones
 
             bool wireframe = false;
             bool worldAxis = true;
@@ -34,10 +56,15 @@ namespace SoftGL
             bool showFloor = true;
 
             bool shadowMap = true;
+            bool shadowMap16Bit = false;    // D16 shadow map depth, half the memory of FLOAT32
             bool pbrIbl = false;    // Image Based Lighting
             bool mipmaps = false;
 
             bool cullFace = true;
+            bool meshletCull = true;    // frustum & back facing cone cull of mesh clusters
+            bool multiDraw = true;      // node meshes sharing shaders drawn as one batch
+            bool meshLod = true;
+            float lodPixelError = 1.f;  // largest on-screen error of a simplified mesh level, in pixels
             bool depthTest = true;
             bool reverseZ = false;
 
@@ -50,6 +77,15 @@ namespace SoftGL
 
             int aaType = AAType_None;
             int rendererType = SoftGL::Renderer_Soft;
+            int bufferLayout = SOFTGL_BUFFER_LAYOUT_DEFAULT;    // software renderer texture & attachment layout
+            int textureFormat = TextureFormat_RGBA8;            // software renderer material texture format, compressed at import
+            bool textureStreaming = false;                      // software renderer streams material texture mips on demand
+            int textureBudgetMB = 256;                          // resident memory of streamed mips
+            size_t textureResidentBytes = 0;
+            bool samplerFeedback = false;                       // software renderer records sampled mip levels
+            int rasterTileSize = 32;                            // software renderer rasterization tile, 32 or 64
+            bool srgb = false;                                  // software renderer sRGB color textures & framebuffer, shading in linear space
+            std::vector<TextureFeedbackInfo> textureFeedback;
         };
     }
 }
\ No newline at end of file
@@ -75,6 +75,114 @@ namespace SoftGL
             }
             ImGui::Separator();
 
+            // buffer layout (software renderer)
+            if (config_.rendererType == Renderer_Soft)
+            {
+                const char* layoutItems[] =
+                {
+                    "Linear",
+                    "Tiled",
+                    "Morton",
+                };
+                ImGui::Separator();
+                ImGui::Text("buffer layout");
+                for (int i = 0; i < 3; i++)
+                {
+                    if (ImGui::RadioButton(layoutItems[i], config_.bufferLayout == i) && config_.bufferLayout != i)
+                    {
+                        config_.bufferLayout = i;
+                        if (resetBufferLayoutFunc_)
+                        {
+                            resetBufferLayoutFunc_();
+                        }
+                    }
+                    ImGui::SameLine();
+                }
+
+                // rasterization tile size
+                const int tileSizes[] = {32, 64};
+                ImGui::Separator();
+                ImGui::Text("raster tile");
+                for (int i = 0; i < 2; i++)
+                {
+                    std::string tileItem = std::to_string(tileSizes[i]) + "x" + std::to_string(tileSizes[i]);
+                    if (ImGui::RadioButton(tileItem.c_str(), config_.rasterTileSize == tileSizes[i]))
+                    {
+                        config_.rasterTileSize = tileSizes[i];
+                    }
+                    ImGui::SameLine();
+                }
+
+                // material texture format
+                const char* formatItems[] =
+                {
+                    "RGBA8",
+                    "BC1",
+                    "BC3",
+                    "BC7",
+                };
+                const int formatValues[] =
+                {
+                    TextureFormat_RGBA8,
+                    TextureFormat_BC1,
+                    TextureFormat_BC3,
+                    TextureFormat_BC7,
+                };
+                ImGui::Separator();
+                ImGui::Text("texture format");
+                for (int i = 0; i < 4; i++)
+                {
+                    if (ImGui::RadioButton(formatItems[i], config_.textureFormat == formatValues[i]) && config_.textureFormat != formatValues[i])
+                    {
+                        config_.textureFormat = formatValues[i];
+                        if (resetTextureFormatFunc_)
+                        {
+                            resetTextureFormatFunc_();
+                        }
+                    }
+                    ImGui::SameLine();
+                }
+
+                // sRGB color textures & framebuffer
+                ImGui::Separator();
+                if (ImGui::Checkbox("sRGB", &config_.srgb))
+                {
+                    if (resetColorSpaceFunc_)
+                    {
+                        resetColorSpaceFunc_();
+                    }
+                }
+
+                // material texture streaming (RGBA8)
+                ImGui::Separator();
+                if (ImGui::Checkbox("texture streaming", &config_.textureStreaming))
+                {
+                    if (resetTextureStreamingFunc_)
+                    {
+                        resetTextureStreamingFunc_();
+                    }
+                }
+                if (config_.textureStreaming)
+                {
+                    ImGui::SliderInt("budget MB", &config_.textureBudgetMB, 16, 1024);
+                    ImGui::Text("resident: %.1f MB", (float) config_.textureResidentBytes / (1024.f * 1024.f));
+                }
+
+                // sampler feedback (mipmapped material textures)
+                if (ImGui::Checkbox("sampler feedback", &config_.samplerFeedback))
+                {
+                    if (resetSamplerFeedbackFunc_)
+                    {
+                        resetSamplerFeedbackFunc_();
+                    }
+                }
+                if (config_.samplerFeedback)
+                {
+                    drawTextureFeedback();
+                }
+                ImGui::Separator();
+            }
+
             // reset camera
             ImGui::Separator();
             ImGui::Text("camera:");
@@ -119,6 +227,23 @@ namespace SoftGL
             {
                 reloadModel(modelNames_[modelIdx]);
             }
+            if (config_.modelLoadProgress >= 0.f)
+            {
+                ImGui::ProgressBar(config_.modelLoadProgress, ImVec2(-1.f, 0.f), "loading");
+            }
+            if (ImGui::TreeNode("import"))
+            {
+                bool changed = ImGui::Checkbox("tangents", &config_.importTangents);
+                changed |= ImGui::Checkbox("smooth normals", &config_.importSmoothNormals);
+                changed |= ImGui::Checkbox("join vertices", &config_.importJoinVertices);
+                changed |= ImGui::Checkbox("optimize meshes", &config_.meshOptimize);
+                changed |= ImGui::Checkbox("quantize vertexes", &config_.meshQuantize);
+                if (changed && reloadModelFunc_)
+                {
+                    reloadModelFunc_(config_.modelPath);
+                }
+                ImGui::TreePop();
+            }
 
             // skybox
             ImGui::Separator();
@@ -160,6 +285,16 @@ namespace SoftGL
             ImGui::Separator();
             ImGui::Checkbox("shadow floor", &config_.showFloor);
             config_.shadowMap = config_.showFloor;
+            if (config_.shadowMap)
+            {
+                if (ImGui::Checkbox("16 bit shadow map", &config_.shadowMap16Bit))
+                {
+                    if (resetShadowMapFunc_)
+                    {
+                        resetShadowMapFunc_();
+                    }
+                }
+            }
 
             if (!config_.wireframe)
             {
@@ -191,6 +326,16 @@ namespace SoftGL
             // face cull
             ImGui::Separator();
             ImGui::Checkbox("cull face", &config_.cullFace);
+            ImGui::Checkbox("meshlet cull", &config_.meshletCull);
+            ImGui::Checkbox("multi draw", &config_.multiDraw);
+
+            // mesh lod
+            ImGui::Separator();
+            ImGui::Checkbox("mesh lod", &config_.meshLod);
+            if (config_.meshLod)
+            {
+                ImGui::SliderFloat("lod pixel error", &config_.lodPixelError, 0.25f, 16.f, "%.2f");
+            }
 
             // depth test
             ImGui::Separator();
@@ -225,6 +370,53 @@ namespace SoftGL
             }
         }
 
+        void ConfigPanel::drawTextureFeedback()
+        {
+            if (!ImGui::TreeNode("mip usage"))
+            {
+                return;
+            }
+            for (auto &info : config_.textureFeedback)
+            {
+                size_t nameStart = info.tag.find_last_of("/\\");
+                std::string name = (nameStart == std::string::npos) ? info.tag : info.tag.substr(nameStart + 1);
+                if (!ImGui::TreeNode(info.tag.c_str(), "%s %dx%d", name.c_str(), info.width, info.height))
+                {
+                    continue;
+                }
+                if (info.minLevel < 0)
+                {
+                    ImGui::Text("not sampled");
+                    ImGui::TreePop();
+                    continue;
+                }
+                // levels finer than the finest sampled one hold memory that is never read
+                ImGui::Text("finest level: %d, unused: %.2f MB", info.minLevel, (float) info.unusedBytes / (1024.f * 1024.f));
+                for (size_t level = 0; level < info.levelUsage.size(); level++)
+                {
+                    if (info.levelUsage[level] > 0.f)
+                    {
+                        ImGui::Text("level %zu: %.1f%%", level, info.levelUsage[level] * 100.f);
+                    }
+                }
+                // finest level per uv region, '-' if not sampled
+                ImGui::Text("region min level:");
+                for (int y = 0; y < info.regionSize; y++)
+                {
+                    std::string row;
+                    for (int x = 0; x < info.regionSize; x++)
+                    {
+                        uint8_t level = info.regionMinLevel[y * info.regionSize + x];
+                        row += (level < 16) ? "0123456789abcdef"[level] : '-';
+                        row += ' ';
+                    }
+                    ImGui::TextUnformatted(row.c_str());
+                }
+                ImGui::TreePop();
+            }
+            ImGui::TreePop();
+        }
+
         void ConfigPanel::destroy()
         {
             ImGui_ImplOpenGL3_Shutdown();
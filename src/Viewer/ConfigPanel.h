@@ -47,11 +47,41 @@ namespace SoftGL
                 resetMipmapsFunc_ = func;
             }
 
+            inline void setResetTextureFormatFunc(const std::function<void(void)> &func)
+            {
+                resetTextureFormatFunc_ = func;
+            }
+
+            inline void setResetTextureStreamingFunc(const std::function<void(void)> &func)
+            {
+                resetTextureStreamingFunc_ = func;
+            }
+
+            inline void setResetSamplerFeedbackFunc(const std::function<void(void)> &func)
+            {
+                resetSamplerFeedbackFunc_ = func;
+            }
+
+            inline void setResetColorSpaceFunc(const std::function<void(void)> &func)
+            {
+                resetColorSpaceFunc_ = func;
+            }
+
             inline void setResetRevverseZFunc(const std::function<void(void)> &func)
             {
                 resetRevverseZFunc_ = func;
             }
 
+            inline void setResetShadowMapFunc(const std::function<void(void)> &func)
+            {
+                resetShadowMapFunc_ = func;
+            }
+
+            inline void setResetBufferLayoutFunc(const std::function<void(void)> &func)
+            {
+                resetBufferLayoutFunc_ = func;
+            }
+
             inline void setFrameDumpFunc(const std::function<void(void)> &func)
             {
                 frameDumpFunc_ = func;
@@ -62,6 +92,7 @@ namespace SoftGL
             bool reloadModel(const std::string &name);
             bool reloadSkybox(const std::string &name);
             void drawSettings();
+            void drawTextureFeedback();
             void destroy();
 
         private:
@@ -83,7 +114,13 @@ namespace SoftGL
             std::function<void(glm::vec3 &position, glm::vec3 &color)> updateLightFunc_;
             std::function<void(void)> resetCameraFunc_;
             std::function<void(void)> resetMipmapsFunc_;
+            std::function<void(void)> resetTextureFormatFunc_;
+            std::function<void(void)> resetTextureStreamingFunc_;
+            std::function<void(void)> resetSamplerFeedbackFunc_;
+            std::function<void(void)> resetColorSpaceFunc_;
             std::function<void(void)> resetRevverseZFunc_;
+            std::function<void(void)> resetShadowMapFunc_;
+            std::function<void(void)> resetBufferLayoutFunc_;
             std::function<void(void)> frameDumpFunc_; 
         };
     }
@@ -95,12 +95,18 @@ namespace SoftGL
             glm::float32_t u_roughness;
         };
 
+        // RGBA image with mip chain encoded to format, empty if failed
+        typedef std::function<std::vector<std::shared_ptr<BlockBuffer>>(BlockFormat format)> BlockEncoder;
+
         struct TextureData
         {
             std::string tag;
             size_t width = 0;
             size_t height = 0;
             std::vector<std::shared_ptr<Buffer<RGBA>>> data;
+            std::vector<std::shared_ptr<BlockBuffer>> blockData;    // compressed mip levels, data is empty if set
+            ImageLoader loader;     // decodes the image file, data is empty if imported for streaming
+            BlockEncoder encoder;   // compresses data off the render thread, not set for streamed or DDS textures
             WrapMode wrapModeU = Wrap_REPEAT;
             WrapMode wrapModeV = Wrap_REPEAT;
             WrapMode wrapModeW = Wrap_REPEAT;
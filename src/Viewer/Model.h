@@ -4,6 +4,7 @@
 #include <string>
 #include <unordered_map>
 #include "Base/Geometry.h"
+#include "Base/MeshOptimizer.h"
 #include "Render/Vertex.h"
 #include "Material.h"
 
@@ -19,14 +20,31 @@ namespace SoftGL
             glm::vec3 a_tangent;
         };
 
+        // Vertex packed to 20 bytes: position unorm16 in the mesh bounds, half float texcoord,
+        // octahedral snorm16 normal & tangent
+        struct QuantizedVertex
+        {
+            uint16_t a_position[4];     // w unused
+            uint16_t a_texcoord[2];
+            int16_t a_normal[2];
+            int16_t a_tangent[2];
+        };
+
         struct ModelVertexes : VertexArray
         {
             PrimitiveType primitiveType;
             size_t primitiveCnt = 0;
             std::vector<Vertex> vertexes;
             std::vector<int32_t> indices;
+            std::vector<QuantizedVertex> quantizedVertexes;     // replaces vertexes once quantized
+            std::vector<uint16_t> shortIndices;                 // replaces indices when the vertex count allows
             std::shared_ptr<VertexArrayObject> vao = nullptr;
 
+            inline size_t vertexCnt() const
+            {
+                return vertexSize > 0 ? vertexesBufferLength / vertexSize : 0;
+            }
+
             void UpdateVertexes() const
             {
                 if (vao)
@@ -38,6 +56,7 @@ namespace SoftGL
             void InitVertexes()
             {
                 vertexSize = sizeof(Vertex);
+                decodedVertexSize = 0;
 
                 vertexesDesc.resize(4);
                 vertexesDesc[0] = {3, vertexSize, offsetof(Vertex, a_position)};
@@ -48,8 +67,68 @@ namespace SoftGL
                 vertexesBuffer = vertexes.empty() ? nullptr : (uint8_t*) &vertexes[0];
                 vertexesBufferLength = vertexes.size() * vertexSize;
 
-                indexBuffer = indices.empty() ? nullptr : &indices[0];
-                indexBufferLength = indices.size() * sizeof(int32_t);
+                InitIndexes();
+            }
+
+            // use external vertex & index storage in place, kept alive by owner. vertexes and indices stay empty
+            void InitVertexes(Vertex *vertexData, size_t vertexCnt, uint8_t *indexData, size_t indexCnt, IndexType type,
+                              const std::shared_ptr<void> &owner)
+            {
+                InitVertexes();
+                vertexesBuffer = vertexCnt > 0 ? (uint8_t *) vertexData : nullptr;
+                vertexesBufferLength = vertexCnt * vertexSize;
+                InitIndexes(indexData, indexCnt, type);
+                storage = owner;
+            }
+
+            // packed vertexes decoded to the Vertex layout at fetch, positions are scale * unorm + offset
+            void InitQuantizedVertexes(const glm::vec3 &scale, const glm::vec3 &offset)
+            {
+                vertexSize = sizeof(QuantizedVertex);
+                decodedVertexSize = sizeof(Vertex);
+                quantScale = glm::vec4(scale, 1.f);
+                quantOffset = glm::vec4(offset, 0.f);
+
+                vertexesDesc.resize(4);
+                vertexesDesc[0] = {3, vertexSize, offsetof(QuantizedVertex, a_position), VertexFormat_UNORM16, offsetof(Vertex, a_position)};
+                vertexesDesc[1] = {2, vertexSize, offsetof(QuantizedVertex, a_texcoord), VertexFormat_HALF, offsetof(Vertex, a_texcoord)};
+                vertexesDesc[2] = {3, vertexSize, offsetof(QuantizedVertex, a_normal), VertexFormat_OCT16, offsetof(Vertex, a_normal)};
+                vertexesDesc[3] = {3, vertexSize, offsetof(QuantizedVertex, a_tangent), VertexFormat_OCT16, offsetof(Vertex, a_tangent)};
+
+                vertexesBuffer = quantizedVertexes.empty() ? nullptr : (uint8_t *) &quantizedVertexes[0];
+                vertexesBufferLength = quantizedVertexes.size() * vertexSize;
+
+                InitIndexes();
+            }
+
+            // external packed vertex & index storage used in place, kept alive by owner
+            void InitQuantizedVertexes(QuantizedVertex *vertexData, size_t vertexCnt, uint8_t *indexData, size_t indexCnt, IndexType type,
+                                       const glm::vec3 &scale, const glm::vec3 &offset, const std::shared_ptr<void> &owner)
+            {
+                InitQuantizedVertexes(scale, offset);
+                vertexesBuffer = vertexCnt > 0 ? (uint8_t *) vertexData : nullptr;
+                vertexesBufferLength = vertexCnt * vertexSize;
+                InitIndexes(indexData, indexCnt, type);
+                storage = owner;
+            }
+
+            void InitIndexes()
+            {
+                if (!shortIndices.empty())
+                {
+                    InitIndexes((uint8_t *) &shortIndices[0], shortIndices.size(), IndexType_UINT16);
+                }
+                else
+                {
+                    InitIndexes(indices.empty() ? nullptr : (uint8_t *) &indices[0], indices.size(), IndexType_UINT32);
+                }
+            }
+
+            void InitIndexes(uint8_t *indexData, size_t indexCnt, IndexType type)
+            {
+                indexType = type;
+                indexBuffer = indexCnt > 0 ? indexData : nullptr;
+                indexBufferLength = indexCnt * indexSize(type);
             }
         };
 
@@ -70,7 +149,32 @@ namespace SoftGL
 
         struct ModelPoints : ModelBase {};
         struct ModelLines : ModelBase {};
-        struct ModelMesh : ModelBase {};
+        // detail level of a mesh, an index range into the mesh indices
+        struct MeshLod
+        {
+            uint32_t indexOffset;
+            uint32_t indexCnt;
+            float error;        // largest surface distance to the full mesh, in model space
+        };
+
+        struct ModelMesh : ModelBase
+        {
+            std::vector<Meshlet> meshlets;      // empty for meshes culled only as a whole
+            std::vector<MeshLod> lods;          // level 0 is the full mesh, simplified levels follow its indices. empty without levels
+            std::vector<glm::mat4> instances;   // model space transforms of an instanced mesh, empty for node meshes
+
+            // instance transform columns read as 4 float attributes after the vertex attributes
+            void InitInstances()
+            {
+                instanceDesc.resize(4);
+                for (size_t i = 0; i < 4; i++)
+                {
+                    instanceDesc[i] = {4, sizeof(glm::mat4), i * sizeof(glm::vec4), VertexFormat_FLOAT, sizeof(Vertex) + i * sizeof(glm::vec4)};
+                }
+                instanceBuffer = instances.empty() ? nullptr : (uint8_t *) &instances[0];
+                instanceBufferLength = instances.size() * sizeof(glm::mat4);
+            }
+        };
 
         struct ModelNode
         {
@@ -83,6 +187,7 @@ namespace SoftGL
         {
             std::string resourcePath;
             ModelNode rootNode;
+            std::vector<ModelMesh> instancedMeshes;     // meshes shared by several nodes, drawn once with their node transforms
             BoundingBox rootAABB;
 
             size_t meshCnt = 0;
@@ -91,9 +196,15 @@ namespace SoftGL
 
             glm::mat4 centeredTransform;
 
+            std::shared_ptr<void> meshStorage;      // owner of mesh vertex & index data used in place (mapped cache file or source model)
+
             void resetStates()
             {
                 resetNodeStates(rootNode);   
+                for (auto &mesh : instancedMeshes)
+                {
+                    mesh.resetStates();
+                }
             }
 
             void resetNodeStates(ModelNode &node)
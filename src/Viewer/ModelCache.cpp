@@ -0,0 +1,580 @@
+#include "ModelCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include "json11.hpp"
+#include "Base/FileUtils.h"
+#include "Base/HashUtils.h"
+#include "Base/Logger.h"
+#include "Base/MappedFile.h"
+
+namespace SoftGL
+{
+    namespace View
+    {
+        #define MODEL_CACHE_MAGIC 0x434d4753     // "SGMC"
+        #define MODEL_CACHE_VERSION 6
+        #define MODEL_CACHE_ALIGNMENT 16
+        #define MODEL_CACHE_HASH_BLOCK (64 * 1024)     // model files are hashed in blocks of this size
+
+        const std::string MODEL_CACHE_DIR = "./cache/Model/";
+
+        // file layout: header, nodes and meshes in pre-order followed by the instanced meshes, textures in mesh order,
+        // path strings, then vertex, index, meshlet, lod and instance streams aligned to MODEL_CACHE_ALIGNMENT
+        struct CacheHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t vertexSize;
+            uint32_t nodeCnt;
+            uint64_t fileSize;
+            uint64_t meshCnt;
+            uint64_t textureCnt;
+            uint64_t nodeOffset;
+            uint64_t meshOffset;
+            uint64_t textureOffset;
+            uint64_t stringOffset;
+            uint64_t stringSize;
+            uint64_t primitiveCnt;
+            uint64_t vertexCnt;
+            uint64_t instancedMeshCnt;      // last meshes, not in the node tree
+            float rootAABB[6];
+            float centeredTransform[16];
+        };
+
+        struct CacheNode
+        {
+            float transform[16];
+            uint32_t meshCnt;
+            uint32_t childCnt;
+        };
+
+        struct CacheMesh
+        {
+            uint64_t vertexOffset;
+            uint64_t vertexCnt;
+            uint64_t indexOffset;
+            uint64_t indexCnt;
+            uint64_t meshletOffset;
+            uint64_t meshletCnt;
+            uint64_t lodOffset;
+            uint64_t lodCnt;
+            uint64_t instanceOffset;
+            uint64_t instanceCnt;       // column major float4x4 transforms
+            uint64_t primitiveCnt;
+            float aabb[6];
+            int32_t primitiveType;
+            int32_t shadingModel;
+            int32_t alphaMode;
+            int32_t doubleSided;
+            float baseColor[4];
+            uint32_t textureCnt;
+            uint32_t vertexSize;        // Vertex, or QuantizedVertex dequantized with quantScale & quantOffset
+            float quantScale[3];
+            float quantOffset[3];
+            int32_t indexType;
+            uint32_t reserved;
+        };
+
+        struct CacheMeshlet
+        {
+            uint32_t indexOffset;
+            uint32_t indexCnt;
+            float center[3];
+            float radius;
+            float coneApex[3];
+            float coneAxis[3];
+            float coneCutoff;
+        };
+
+        struct CacheLod
+        {
+            uint32_t indexOffset;
+            uint32_t indexCnt;
+            float error;
+        };
+
+        struct CacheTexture
+        {
+            int32_t type;
+            int32_t wrapU;
+            int32_t wrapV;
+            uint32_t pathOffset;
+            uint32_t pathLength;
+        };
+
+        static inline uint64_t alignOffset(uint64_t offset)
+        {
+            return (offset + MODEL_CACHE_ALIGNMENT - 1) / MODEL_CACHE_ALIGNMENT * MODEL_CACHE_ALIGNMENT;
+        }
+
+        static void collectNodes(const ModelNode &node, std::vector<CacheNode> &nodes, std::vector<const ModelMesh *> &meshes)
+        {
+            CacheNode record{};
+            memcpy(record.transform, &node.transform[0][0], sizeof(record.transform));
+            record.meshCnt = (uint32_t) node.meshes.size();
+            record.childCnt = (uint32_t) node.children.size();
+            nodes.push_back(record);
+            for (auto &mesh : node.meshes)
+            {
+                meshes.push_back(&mesh);
+            }
+            for (auto &child : node.children)
+            {
+                collectNodes(child, nodes, meshes);
+            }
+        }
+
+        struct CacheReader
+        {
+            std::shared_ptr<void> storage;      // owner of the mapping, meshes reference it in place
+            uint8_t *base;
+            const CacheHeader *header;
+            const CacheNode *nodes;
+            const CacheMesh *meshes;
+            const CacheTexture *textures;
+            const char *strings;
+            size_t nodeIdx = 0;
+            size_t meshIdx = 0;
+            size_t textureIdx = 0;
+
+            bool readMesh(Model &model, ModelMesh &mesh)
+            {
+                if (meshIdx >= header->meshCnt)
+                {
+                    return false;
+                }
+                const CacheMesh &record = meshes[meshIdx++];
+                bool quantized = record.vertexSize == sizeof(QuantizedVertex);
+                if (!quantized && record.vertexSize != sizeof(Vertex))
+                {
+                    return false;
+                }
+                uint64_t vertexEnd = record.vertexOffset + record.vertexCnt * record.vertexSize;
+                if (record.indexType != IndexType_UINT32 && record.indexType != IndexType_UINT16)
+                {
+                    return false;
+                }
+                auto indexType = (IndexType) record.indexType;
+                uint64_t indexEnd = record.indexOffset + record.indexCnt * VertexArray::indexSize(indexType);
+                uint64_t meshletEnd = record.meshletOffset + record.meshletCnt * sizeof(CacheMeshlet);
+                uint64_t lodEnd = record.lodOffset + record.lodCnt * sizeof(CacheLod);
+                uint64_t instanceEnd = record.instanceOffset + record.instanceCnt * sizeof(float) * 16;
+                if (vertexEnd > header->fileSize || indexEnd > header->fileSize || meshletEnd > header->fileSize || lodEnd > header->fileSize
+                    || instanceEnd > header->fileSize || textureIdx + record.textureCnt > header->textureCnt)
+                {
+                    return false;
+                }
+                mesh.primitiveType = (PrimitiveType) record.primitiveType;
+                mesh.primitiveCnt = record.primitiveCnt;
+                mesh.aabb = BoundingBox(glm::vec3(record.aabb[0], record.aabb[1], record.aabb[2]),
+                                        glm::vec3(record.aabb[3], record.aabb[4], record.aabb[5]));
+                mesh.material = std::make_shared<Material>();
+                mesh.material->shadingModel = (ShadingModel) record.shadingModel;
+                mesh.material->alphaMode = (AlphaMode) record.alphaMode;
+                mesh.material->doubleSided = record.doubleSided != 0;
+                memcpy(&mesh.material->baseColor[0], record.baseColor, sizeof(record.baseColor));
+                for (uint32_t i = 0; i < record.textureCnt; i++)
+                {
+                    const CacheTexture &tex = textures[textureIdx++];
+                    if ((uint64_t) tex.pathOffset + tex.pathLength > header->stringSize)
+                    {
+                        return false;
+                    }
+                    auto &texData = mesh.material->textureData[tex.type];
+                    texData.tag = model.resourcePath + "/" + std::string(strings + tex.pathOffset, tex.pathLength);
+                    texData.wrapModeU = (WrapMode) tex.wrapU;
+                    texData.wrapModeV = (WrapMode) tex.wrapV;
+                }
+                auto *meshlets = (const CacheMeshlet *) (base + record.meshletOffset);
+                mesh.meshlets.resize(record.meshletCnt);
+                for (size_t i = 0; i < mesh.meshlets.size(); i++)
+                {
+                    const CacheMeshlet &src = meshlets[i];
+                    Meshlet &meshlet = mesh.meshlets[i];
+                    if ((uint64_t) src.indexOffset + src.indexCnt > record.indexCnt)
+                    {
+                        return false;
+                    }
+                    meshlet.indexOffset = src.indexOffset;
+                    meshlet.indexCnt = src.indexCnt;
+                    meshlet.center = glm::vec3(src.center[0], src.center[1], src.center[2]);
+                    meshlet.radius = src.radius;
+                    meshlet.coneApex = glm::vec3(src.coneApex[0], src.coneApex[1], src.coneApex[2]);
+                    meshlet.coneAxis = glm::vec3(src.coneAxis[0], src.coneAxis[1], src.coneAxis[2]);
+                    meshlet.coneCutoff = src.coneCutoff;
+                }
+                auto *lods = (const CacheLod *) (base + record.lodOffset);
+                mesh.lods.resize(record.lodCnt);
+                for (size_t i = 0; i < mesh.lods.size(); i++)
+                {
+                    if ((uint64_t) lods[i].indexOffset + lods[i].indexCnt > record.indexCnt)
+                    {
+                        return false;
+                    }
+                    mesh.lods[i] = {lods[i].indexOffset, lods[i].indexCnt, lods[i].error};
+                }
+                auto *instances = (const float *) (base + record.instanceOffset);
+                mesh.instances.resize(record.instanceCnt);
+                for (size_t i = 0; i < mesh.instances.size(); i++)
+                {
+                    memcpy(&mesh.instances[i][0][0], instances + i * 16, sizeof(float) * 16);
+                }
+                if (quantized)
+                {
+                    mesh.InitQuantizedVertexes((QuantizedVertex *) (base + record.vertexOffset), record.vertexCnt,
+                                               base + record.indexOffset, record.indexCnt, indexType,
+                                               glm::vec3(record.quantScale[0], record.quantScale[1], record.quantScale[2]),
+                                               glm::vec3(record.quantOffset[0], record.quantOffset[1], record.quantOffset[2]), storage);
+                }
+                else
+                {
+                    mesh.InitVertexes((Vertex *) (base + record.vertexOffset), record.vertexCnt,
+                                      base + record.indexOffset, record.indexCnt, indexType, storage);
+                }
+                return true;
+            }
+
+            bool readInstancedMeshes(Model &model)
+            {
+                if (header->instancedMeshCnt > header->meshCnt)
+                {
+                    return false;
+                }
+                model.instancedMeshes.resize(header->instancedMeshCnt);
+                for (auto &mesh : model.instancedMeshes)
+                {
+                    if (!readMesh(model, mesh) || mesh.instances.empty())
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            bool readNode(Model &model, ModelNode &node)
+            {
+                if (nodeIdx >= header->nodeCnt)
+                {
+                    return false;
+                }
+                const CacheNode &record = nodes[nodeIdx++];
+                memcpy(&node.transform[0][0], record.transform, sizeof(record.transform));
+                node.meshes.resize(record.meshCnt);
+                for (auto &mesh : node.meshes)
+                {
+                    if (!readMesh(model, mesh))
+                    {
+                        return false;
+                    }
+                }
+                node.children.resize(record.childCnt);
+                for (auto &child : node.children)
+                {
+                    if (!readNode(model, child))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        };
+
+        // relative paths of the external buffers a glTF file references, embedded data uris are skipped
+        static std::vector<std::string> getExternalBuffers(const std::string &path)
+        {
+            std::vector<std::string> ret;
+            std::string ext = path.substr(path.find_last_of('.') + 1);
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+            if (ext != "gltf")
+            {
+                return ret;
+            }
+            std::string err;
+            json11::Json json = json11::Json::parse(FileUtils::readText(path), err);
+            for (auto &buffer : json["buffers"].array_items())
+            {
+                const std::string &uri = buffer["uri"].string_value();
+                if (uri.empty() || uri.compare(0, 5, "data:") == 0)
+                {
+                    continue;
+                }
+                // uris are percent encoded
+                std::string decoded;
+                for (size_t i = 0; i < uri.size(); i++)
+                {
+                    if (uri[i] == '%' && i + 2 < uri.size() && isxdigit(uri[i + 1]) && isxdigit(uri[i + 2]))
+                    {
+                        decoded += (char) strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16);
+                        i += 2;
+                    }
+                    else
+                    {
+                        decoded += uri[i];
+                    }
+                }
+                ret.push_back(decoded);
+            }
+            return ret;
+        }
+
+        std::string ModelCache::getCacheKey(const std::string &path, uint32_t importFlags, uint32_t options)
+        {
+            std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+            if (!file.is_open())
+            {
+                return "";
+            }
+            uint64_t fileSize = (uint64_t) file.tellg();
+            uint32_t params[4] = {MODEL_CACHE_VERSION, importFlags, (uint32_t) sizeof(Vertex), options};
+
+            // all content of the model file, any edit gives a new key and the cache entry is rebuilt
+            MD5_CTX ctx;
+            MD5_Init(&ctx);
+            MD5_Update(&ctx, (unsigned char *) params, sizeof(params));
+            MD5_Update(&ctx, (unsigned char *) &fileSize, sizeof(fileSize));
+            std::vector<char> block(MODEL_CACHE_HASH_BLOCK);
+            file.seekg(0, std::ios::beg);
+            for (uint64_t offset = 0; offset < fileSize; offset += block.size())
+            {
+                auto readSize = (std::streamsize) std::min((uint64_t) block.size(), fileSize - offset);
+                if (!file.read(block.data(), readSize))
+                {
+                    return "";
+                }
+                MD5_Update(&ctx, (unsigned char *) block.data(), (unsigned int) readSize);
+            }
+
+            // external buffers by size and modify time, they are large and only read by the importer
+            std::string dir = path.substr(0, path.find_last_of('/') + 1);
+            for (auto &uri : getExternalBuffers(path))
+            {
+                struct stat info{};
+                if (stat((dir + uri).c_str(), &info) != 0)
+                {
+                    LOGE("model cache: external buffer not found: %s", (dir + uri).c_str());
+                    return "";
+                }
+                uint64_t stamp[2] = {(uint64_t) info.st_size, (uint64_t) info.st_mtime};
+                MD5_Update(&ctx, (unsigned char *) uri.c_str(), (unsigned int) uri.size());
+                MD5_Update(&ctx, (unsigned char *) stamp, sizeof(stamp));
+            }
+            return HashUtils::finalHashMD5(ctx);
+        }
+
+        std::string ModelCache::getCacheFilePath(const std::string &key)
+        {
+            return MODEL_CACHE_DIR + key + ".model";
+        }
+
+        bool ModelCache::load(const std::string &key, Model &model)
+        {
+            auto mapping = std::make_shared<MappedFile>();
+            if (key.empty() || !mapping->open(getCacheFilePath(key)))
+            {
+                return false;
+            }
+            CacheReader reader{};
+            reader.storage = mapping;
+            reader.base = mapping->data();
+            reader.header = (const CacheHeader *) reader.base;
+            const CacheHeader &header = *reader.header;
+            if (mapping->size() < sizeof(CacheHeader) || header.magic != MODEL_CACHE_MAGIC || header.version != MODEL_CACHE_VERSION
+                || header.vertexSize != sizeof(Vertex) || header.fileSize != mapping->size()
+                || header.nodeOffset + header.nodeCnt * sizeof(CacheNode) > header.fileSize
+                || header.meshOffset + header.meshCnt * sizeof(CacheMesh) > header.fileSize
+                || header.textureOffset + header.textureCnt * sizeof(CacheTexture) > header.fileSize
+                || header.stringOffset + header.stringSize > header.fileSize)
+            {
+                LOGE("ModelCache::load, invalid cache file: %s", getCacheFilePath(key).c_str());
+                return false;
+            }
+            reader.nodes = (const CacheNode *) (reader.base + header.nodeOffset);
+            reader.meshes = (const CacheMesh *) (reader.base + header.meshOffset);
+            reader.textures = (const CacheTexture *) (reader.base + header.textureOffset);
+            reader.strings = (const char *) (reader.base + header.stringOffset);
+
+            ModelNode rootNode;
+            if (!reader.readNode(model, rootNode) || !reader.readInstancedMeshes(model))
+            {
+                LOGE("ModelCache::load, invalid cache file: %s", getCacheFilePath(key).c_str());
+                return false;
+            }
+            model.rootNode = std::move(rootNode);
+            model.rootAABB = BoundingBox(glm::vec3(header.rootAABB[0], header.rootAABB[1], header.rootAABB[2]),
+                                         glm::vec3(header.rootAABB[3], header.rootAABB[4], header.rootAABB[5]));
+            memcpy(&model.centeredTransform[0][0], header.centeredTransform, sizeof(header.centeredTransform));
+            model.meshCnt = header.meshCnt;
+            model.primitiveCnt = header.primitiveCnt;
+            model.vertexCnt = header.vertexCnt;
+            model.meshStorage = mapping;
+            return true;
+        }
+
+        bool ModelCache::store(const std::string &key, const Model &model)
+        {
+            if (key.empty() || !FileUtils::makeDirs(MODEL_CACHE_DIR))
+            {
+                return false;
+            }
+            std::vector<CacheNode> nodes;
+            std::vector<const ModelMesh *> meshes;
+            collectNodes(model.rootNode, nodes, meshes);
+            for (auto &mesh : model.instancedMeshes)
+            {
+                meshes.push_back(&mesh);
+            }
+
+            std::vector<CacheMesh> meshRecords;
+            std::vector<std::vector<CacheMeshlet>> meshletRecords;
+            std::vector<std::vector<CacheLod>> lodRecords;
+            std::vector<CacheTexture> textures;
+            std::string strings;
+            std::string pathPrefix = model.resourcePath + "/";
+            for (auto *mesh : meshes)
+            {
+                bool quantized = mesh->decodedVertexSize > 0;
+                if (mesh->vertexSize != (quantized ? sizeof(QuantizedVertex) : sizeof(Vertex)))
+                {
+                    return false;
+                }
+                CacheMesh record{};
+                record.vertexSize = (uint32_t) mesh->vertexSize;
+                record.vertexCnt = mesh->vertexCnt();
+                memcpy(record.quantScale, &mesh->quantScale[0], sizeof(record.quantScale));
+                memcpy(record.quantOffset, &mesh->quantOffset[0], sizeof(record.quantOffset));
+                record.indexCnt = mesh->indexCnt();
+                record.indexType = mesh->indexType;
+                record.meshletCnt = mesh->meshlets.size();
+                record.lodCnt = mesh->lods.size();
+                record.instanceCnt = mesh->instances.size();
+                record.primitiveCnt = mesh->primitiveCnt;
+                memcpy(record.aabb, &mesh->aabb.min[0], sizeof(float) * 3);
+                memcpy(record.aabb + 3, &mesh->aabb.max[0], sizeof(float) * 3);
+                record.primitiveType = mesh->primitiveType;
+                auto &material = *mesh->material;
+                record.shadingModel = material.shadingModel;
+                record.alphaMode = material.alphaMode;
+                record.doubleSided = material.doubleSided;
+                memcpy(record.baseColor, &material.baseColor[0], sizeof(record.baseColor));
+                for (auto &kv : material.textureData)
+                {
+                    std::string path = kv.second.tag;
+                    if (path.compare(0, pathPrefix.size(), pathPrefix) == 0)
+                    {
+                        path = path.substr(pathPrefix.size());
+                    }
+                    CacheTexture tex{};
+                    tex.type = kv.first;
+                    tex.wrapU = kv.second.wrapModeU;
+                    tex.wrapV = kv.second.wrapModeV;
+                    tex.pathOffset = (uint32_t) strings.size();
+                    tex.pathLength = (uint32_t) path.size();
+                    strings += path;
+                    textures.push_back(tex);
+                    record.textureCnt++;
+                }
+                meshRecords.push_back(record);
+
+                meshletRecords.emplace_back(mesh->meshlets.size());
+                for (size_t i = 0; i < mesh->meshlets.size(); i++)
+                {
+                    const Meshlet &meshlet = mesh->meshlets[i];
+                    CacheMeshlet &dst = meshletRecords.back()[i];
+                    dst.indexOffset = meshlet.indexOffset;
+                    dst.indexCnt = meshlet.indexCnt;
+                    memcpy(dst.center, &meshlet.center[0], sizeof(dst.center));
+                    dst.radius = meshlet.radius;
+                    memcpy(dst.coneApex, &meshlet.coneApex[0], sizeof(dst.coneApex));
+                    memcpy(dst.coneAxis, &meshlet.coneAxis[0], sizeof(dst.coneAxis));
+                    dst.coneCutoff = meshlet.coneCutoff;
+                }
+                lodRecords.emplace_back();
+                for (auto &lod : mesh->lods)
+                {
+                    lodRecords.back().push_back({lod.indexOffset, lod.indexCnt, lod.error});
+                }
+            }
+
+            CacheHeader header{};
+            header.magic = MODEL_CACHE_MAGIC;
+            header.version = MODEL_CACHE_VERSION;
+            header.vertexSize = sizeof(Vertex);
+            header.nodeCnt = (uint32_t) nodes.size();
+            header.meshCnt = meshRecords.size();
+            header.textureCnt = textures.size();
+            header.primitiveCnt = model.primitiveCnt;
+            header.vertexCnt = model.vertexCnt;
+            header.instancedMeshCnt = model.instancedMeshes.size();
+            memcpy(header.rootAABB, &model.rootAABB.min[0], sizeof(float) * 3);
+            memcpy(header.rootAABB + 3, &model.rootAABB.max[0], sizeof(float) * 3);
+            memcpy(header.centeredTransform, &model.centeredTransform[0][0], sizeof(header.centeredTransform));
+            header.nodeOffset = alignOffset(sizeof(CacheHeader));
+            header.meshOffset = alignOffset(header.nodeOffset + nodes.size() * sizeof(CacheNode));
+            header.textureOffset = alignOffset(header.meshOffset + meshRecords.size() * sizeof(CacheMesh));
+            header.stringOffset = alignOffset(header.textureOffset + textures.size() * sizeof(CacheTexture));
+            header.stringSize = strings.size();
+            uint64_t offset = alignOffset(header.stringOffset + header.stringSize);
+            for (auto &record : meshRecords)
+            {
+                record.vertexOffset = offset;
+                offset = alignOffset(offset + record.vertexCnt * record.vertexSize);
+                record.indexOffset = offset;
+                offset = alignOffset(offset + record.indexCnt * VertexArray::indexSize((IndexType) record.indexType));
+                record.meshletOffset = offset;
+                offset = alignOffset(offset + record.meshletCnt * sizeof(CacheMeshlet));
+                record.lodOffset = offset;
+                offset = alignOffset(offset + record.lodCnt * sizeof(CacheLod));
+                record.instanceOffset = offset;
+                offset = alignOffset(offset + record.instanceCnt * sizeof(float) * 16);
+            }
+            header.fileSize = offset;
+
+            // written aside and renamed, a reader never maps a partial file
+            std::string cachePath = getCacheFilePath(key);
+            std::string tmpPath = cachePath + ".tmp";
+            std::ofstream file(tmpPath, std::ios::out | std::ios::binary);
+            if (!file.is_open())
+            {
+                LOGE("ModelCache::store, failed to open file: %s", tmpPath.c_str());
+                return false;
+            }
+            auto writeAt = [&file](uint64_t pos, const void *data, size_t length)
+            {
+                // zero padding up to the aligned position
+                static const char zeros[MODEL_CACHE_ALIGNMENT] = {0};
+                file.write(zeros, (std::streamsize) (pos - (uint64_t) file.tellp()));
+                file.write((const char *) data, (std::streamsize) length);
+            };
+            writeAt(0, &header, sizeof(header));
+            writeAt(header.nodeOffset, nodes.data(), nodes.size() * sizeof(CacheNode));
+            writeAt(header.meshOffset, meshRecords.data(), meshRecords.size() * sizeof(CacheMesh));
+            writeAt(header.textureOffset, textures.data(), textures.size() * sizeof(CacheTexture));
+            writeAt(header.stringOffset, strings.data(), strings.size());
+            for (size_t i = 0; i < meshes.size(); i++)
+            {
+                writeAt(meshRecords[i].vertexOffset, meshes[i]->vertexesBuffer, meshRecords[i].vertexCnt * meshRecords[i].vertexSize);
+                writeAt(meshRecords[i].indexOffset, meshes[i]->indexBuffer, meshes[i]->indexBufferLength);
+                writeAt(meshRecords[i].meshletOffset, meshletRecords[i].data(), meshletRecords[i].size() * sizeof(CacheMeshlet));
+                writeAt(meshRecords[i].lodOffset, lodRecords[i].data(), lodRecords[i].size() * sizeof(CacheLod));
+                std::vector<float> instances(meshRecords[i].instanceCnt * 16);
+                for (size_t j = 0; j < meshes[i]->instances.size(); j++)
+                {
+                    memcpy(&instances[j * 16], &meshes[i]->instances[j][0][0], sizeof(float) * 16);
+                }
+                writeAt(meshRecords[i].instanceOffset, instances.data(), instances.size() * sizeof(float));
+            }
+            writeAt(header.fileSize, nullptr, 0);
+            file.close();
+            if (!file || std::rename(tmpPath.c_str(), cachePath.c_str()) != 0)
+            {
+                LOGE("ModelCache::store, failed to write file: %s", cachePath.c_str());
+                std::remove(tmpPath.c_str());
+                return false;
+            }
+            return true;
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include "Model.h"
+
+namespace SoftGL
+{
+    namespace View
+    {
+        // binary cache of imported models, laid out for mmap. vertex and index streams are used in
+        // place from the mapping, textures are stored as paths relative to the model directory
+        class ModelCache
+        {
+        public:
+            // key of the source file content, importer flags, loader options and cache layout
+            static std::string getCacheKey(const std::string &path, uint32_t importFlags, uint32_t options);
+            static std::string getCacheFilePath(const std::string &key);
+
+            // material textures are loaded with only tag and wrap modes set
+            static bool load(const std::string &key, Model &model);
+            static bool store(const std::string &key, const Model &model);
+        };
+    }
+}
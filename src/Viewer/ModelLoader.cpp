@@ -1,24 +1,143 @@
 #include "ModelLoader.h"
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <set>
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
+#include <assimp/ProgressHandler.hpp>
 #include <assimp/GltfMaterial.h>
 #include "Base/ImageUtils.h"
-#include "Base/ThreadPool.h"
+#include "Base/MeshOptimizer.h"
 #include "Base/StringUtils.h"
 #include "Base/Logger.h"
+#include "Base/ThreadPool.h"
+#include "Render/VertexCodec.h"
 #include "Cube.h"
+#include "ModelCache.h"
 
 namespace SoftGL
 {
     namespace View
     {
+        // share of the load progress per stage, textures take the rest
+        #define MODEL_LOAD_IMPORT_WEIGHT 0.4f
+        #define MODEL_LOAD_MESH_WEIGHT 0.3f
+
+        // loader options in the model cache key
+        #define MODEL_LOAD_OPTION_OPTIMIZE 1u
+        #define MODEL_LOAD_OPTION_QUANTIZE 2u
+
+        // smaller meshes are culled as a whole
+        #define MODEL_MESHLET_MIN_TRIANGLES (4 * MESHLET_MAX_TRIANGLES)
+
+        // lod chain: each level aims at a quarter of the previous triangles, until simplification stalls
+        // or the surface moves more than MODEL_LOD_MAX_ERROR of the mesh size
+        #define MODEL_LOD_MIN_TRIANGLES 1024
+        #define MODEL_LOD_MAX_LEVELS 8
+        #define MODEL_LOD_REDUCTION 4
+        #define MODEL_LOD_MIN_REDUCTION 0.8f
+        #define MODEL_LOD_MAX_ERROR 0.05f
+
+        // meshes referenced by this many nodes are drawn instanced
+        #define MODEL_INSTANCE_MIN_NODES 2
+
+        enum MeshJobState
+        {
+            MeshJob_Pending,
+            MeshJob_Done,
+            MeshJob_Failed,
+        };
+
+        struct MeshJob
+        {
+            const aiMesh *mesh = nullptr;
+            size_t nodeIdx = 0;
+            size_t meshIdx = 0;
+            int instancedIdx = -1;          // index into the instanced meshes, node mesh otherwise
+            std::atomic<int> state{MeshJob_Pending};
+        };
+
+        // copies one attribute array into the interleaved vertexes
+        template<typename T>
+        static void packVertexAttr(std::vector<Vertex> &vertexes, T Vertex::*attr, const aiVector3D *src)
+        {
+            static_assert(sizeof(ai_real) == sizeof(float), "single precision assimp required");
+            const size_t size = sizeof(T) < sizeof(aiVector3D) ? sizeof(T) : sizeof(aiVector3D);
+            for (size_t i = 0; i < vertexes.size(); i++)
+            {
+                memcpy(&(vertexes[i].*attr), &src[i], size);
+            }
+        }
+
+        // equal column lengths at right angles without mirroring, normals then transform like positions
+        static bool isUniformScale(const glm::mat4 &m)
+        {
+            const float eps = 1e-3f;
+            glm::vec3 c0(m[0]), c1(m[1]), c2(m[2]);
+            float l0 = glm::length(c0), l1 = glm::length(c1), l2 = glm::length(c2);
+            if (l0 <= 0.f || std::abs(l1 - l0) > eps * l0 || std::abs(l2 - l0) > eps * l0)
+            {
+                return false;
+            }
+            float d = l0 * l0 * eps;
+            return std::abs(glm::dot(c0, c1)) <= d && std::abs(glm::dot(c0, c2)) <= d && std::abs(glm::dot(c1, c2)) <= d
+                   && glm::determinant(glm::mat3(m)) > 0.f;
+        }
+
+        static bool hasNormalMap(const aiScene *scene)
+        {
+            for (size_t i = 0; i < scene->mNumMaterials; i++)
+            {
+                if (scene->mMaterials[i]->GetTextureCount(aiTextureType_NORMALS) > 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // reports import progress, aborts the import when the load is canceled
+        class ImportProgressHandler : public Assimp::ProgressHandler
+        {
+        public:
+            explicit ImportProgressHandler(ModelLoadTask &task) : task_(task) {}
+
+            bool Update(float percentage) override
+            {
+                if (percentage >= 0.f)
+                {
+                    task_.progress = percentage * MODEL_LOAD_IMPORT_WEIGHT;
+                }
+                return !task_.canceled;
+            }
+
+        private:
+            ModelLoadTask &task_;
+        };
+
         ModelLoader::ModelLoader(Config &config) : config_(config)
         {
             loadWorldAxis();
             loadLights();
             loadFloor();
+            // empty until the first model is published
+            scene_.model = std::make_shared<Model>();
+            loadThread_ = std::thread(&ModelLoader::loadWorker, this);
+        }
+
+        ModelLoader::~ModelLoader()
+        {
+            {
+                std::lock_guard<std::mutex> lock(loadMutex_);
+                loadRunning_ = false;
+                if (loadTask_)
+                {
+                    loadTask_->canceled = true;
+                }
+            }
+            loadCond_.notify_all();
+            loadThread_.join();
         }
 
         void ModelLoader::loadCubeMesh(ModelVertexes &mesh)
@@ -130,48 +249,86 @@ namespace SoftGL
             auto it = skyboxMaterialCache_.find(filepath);
             if (it != skyboxMaterialCache_.end())
             {
+                // drop a switch still decoding
+                pendingSkyboxPath_.clear();
+                pendingSkyboxFaces_.clear();
                 scene_.skybox.material = it->second;
                 return true;
             }
 
             LOGD("load skybox, path: %s", filepath.c_str());
-            auto material = std::make_shared<Material>();
-            material->shadingModel = Shading_Skybox;
-
-            std::vector<std::shared_ptr<Buffer<RGBA>>> skyboxTex;
+            // faces decode in parallel, bound by update() once all are ready
+            pendingSkyboxFaces_.clear();
             if (StringUtils::endsWith(filepath, "/"))
             {
-                skyboxTex.resize(6);
-                ThreadPool pool(6);
-                pool.pushTask([&](int thread_id) { skyboxTex[0] = loadTextureFile(filepath + "right.jpg"); });
-                pool.pushTask([&](int thread_id) { skyboxTex[1] = loadTextureFile(filepath + "left.jpg"); });
-                pool.pushTask([&](int thread_id) { skyboxTex[2] = loadTextureFile(filepath + "top.jpg"); });
-                pool.pushTask([&](int thread_id) { skyboxTex[3] = loadTextureFile(filepath + "bottom.jpg"); });
-                pool.pushTask([&](int thread_id) { skyboxTex[4] = loadTextureFile(filepath + "front.jpg"); });
-                pool.pushTask([&](int thread_id) { skyboxTex[5] = loadTextureFile(filepath + "back.jpg"); });
-                pool.waitTasksFinish();
-
-                auto &texData = material->textureData[MaterialTexType_CUBE];
-                texData.width = skyboxTex[0]->width();
-                texData.height = skyboxTex[0]->height();
-                texData.data = std::move(skyboxTex);
-                texData.wrapModeU = Wrap_CLAMP_TO_EDGE;
-                texData.wrapModeV = Wrap_CLAMP_TO_EDGE;
-                texData.wrapModeW = Wrap_CLAMP_TO_EDGE;
+                const char *faces[6] = {"right.jpg", "left.jpg", "top.jpg", "bottom.jpg", "front.jpg", "back.jpg"};
+                for (auto &face : faces)
+                {
+                    pendingSkyboxFaces_.push_back(textureDecoder_.requestImage(filepath + face));
+                }
             }
             else
             {
-                skyboxTex.resize(1);
-                skyboxTex[0] = loadTextureFile(filepath);
-                auto &texData = material->textureData[MaterialTexType_EQUIRECTANGULAR];
+                pendingSkyboxFaces_.push_back(textureDecoder_.requestImage(filepath));
+            }
+            pendingSkyboxPath_ = filepath;
+
+            // nothing to draw yet on the first load, wait once before frames start
+            if (!scene_.skybox.material)
+            {
+                return publishSkybox();
+            }
+            return true;
+        }
+
+        bool ModelLoader::skyboxFacesReady() const
+        {
+            if (pendingSkyboxPath_.empty())
+            {
+                return false;
+            }
+            for (auto &future : pendingSkyboxFaces_)
+            {
+                if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool ModelLoader::publishSkybox()
+        {
+            std::string filepath;
+            filepath.swap(pendingSkyboxPath_);
+            std::vector<std::shared_ptr<Buffer<RGBA>>> skyboxTex;
+            for (auto &future : pendingSkyboxFaces_)
+            {
+                skyboxTex.push_back(future.get());
+                if (!skyboxTex.back())
+                {
+                    LOGE("load skybox failed, path: %s", filepath.c_str());
+                    pendingSkyboxFaces_.clear();
+                    return false;
+                }
+            }
+            pendingSkyboxFaces_.clear();
+
+            auto material = std::make_shared<Material>();
+            material->shadingModel = Shading_Skybox;
+            bool cube = skyboxTex.size() > 1;
+            auto &texData = material->textureData[cube ? MaterialTexType_CUBE : MaterialTexType_EQUIRECTANGULAR];
+            if (!cube)
+            {
                 texData.tag = filepath;
-                texData.width = skyboxTex[0]->width();
-                texData.height = skyboxTex[0]->height();
-                texData.data = std::move(skyboxTex);
-                texData.wrapModeU = Wrap_CLAMP_TO_EDGE;
-                texData.wrapModeV = Wrap_CLAMP_TO_EDGE;
-                texData.wrapModeW = Wrap_CLAMP_TO_EDGE;
             }
+            texData.width = skyboxTex[0]->width();
+            texData.height = skyboxTex[0]->height();
+            texData.data = std::move(skyboxTex);
+            texData.wrapModeU = Wrap_CLAMP_TO_EDGE;
+            texData.wrapModeV = Wrap_CLAMP_TO_EDGE;
+            texData.wrapModeW = Wrap_CLAMP_TO_EDGE;
+
             skyboxMaterialCache_[filepath] = material;
             scene_.skybox.material = material;
             return true;
@@ -179,134 +336,544 @@ namespace SoftGL
 
         bool ModelLoader::loadModel(const std::string &filepath)
         {
-            std::lock_guard<std::mutex> lk(modelLoadMutex_);
             if (filepath.empty())
             {
                 return false;
             }
-            auto it = modelCache_.find(filepath);
+            uint32_t importFlags = getImportFlags();
+            std::string modelKey = filepath + "#" + std::to_string(importFlags) + (config_.meshOptimize ? "#opt" : "")
+                                   + (config_.meshQuantize ? "#quant" : "");
+            if (loadTask_ && !loadTask_->finished)
+            {
+                if (loadTask_->modelKey == modelKey)
+                {
+                    return true;
+                }
+                // unfinished model is dropped, loaded again when requested
+                loadTask_->canceled = true;
+                modelCache_.erase(loadTask_->modelKey);
+            }
+            loadTask_ = nullptr;
+            auto it = modelCache_.find(modelKey);
             if (it != modelCache_.end())
             {
                 scene_.model = it->second;
                 return true;
             }
-            modelCache_[filepath] = std::make_shared<Model>();
-            scene_.model = modelCache_[filepath];
             LOGD("load model, path: %s", filepath.c_str());
+            loadTask_ = std::make_shared<ModelLoadTask>();
+            loadTask_->path = filepath;
+            loadTask_->modelKey = modelKey;
+            loadTask_->importFlags = importFlags;
+            loadTask_->meshOptimize = config_.meshOptimize;
+            loadTask_->meshQuantize = config_.meshQuantize;
+            {
+                std::lock_guard<std::mutex> lock(loadMutex_);
+                nextTask_ = loadTask_;
+            }
+            loadCond_.notify_one();
+            return true;
+        }
+
+        uint32_t ModelLoader::getImportFlags() const
+        {
+            uint32_t flags = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenBoundingBoxes;
+            if (config_.importTangents)
+            {
+                flags |= aiProcess_CalcTangentSpace;
+            }
+            if (config_.importSmoothNormals)
+            {
+                flags |= aiProcess_GenSmoothNormals;
+            }
+            if (config_.importJoinVertices)
+            {
+                flags |= aiProcess_JoinIdenticalVertices;
+            }
+            return flags;
+        }
+
+        bool ModelLoader::hasPendingUpdates()
+        {
+            std::lock_guard<std::mutex> lock(updateMutex_);
+            return !pendingUpdates_.empty() || skyboxFacesReady();
+        }
+
+        void ModelLoader::update()
+        {
+            std::vector<std::function<void()>> updates;
+            {
+                std::lock_guard<std::mutex> lock(updateMutex_);
+                updates.swap(pendingUpdates_);
+            }
+            for (auto &func : updates)
+            {
+                func();
+            }
+            if (skyboxFacesReady())
+            {
+                publishSkybox();
+            }
+            config_.modelLoadProgress = (loadTask_ && !loadTask_->finished) ? loadTask_->progress.load() : -1.f;
+        }
+
+        void ModelLoader::loadWorker()
+        {
+            while (true)
+            {
+                std::shared_ptr<ModelLoadTask> task;
+                {
+                    std::unique_lock<std::mutex> lock(loadMutex_);
+                    loadCond_.wait(lock, [this]() { return !loadRunning_ || nextTask_; });
+                    if (!loadRunning_)
+                    {
+                        return;
+                    }
+                    task = std::move(nextTask_);
+                }
+                if (!task->canceled)
+                {
+                    loadModelTask(task);
+                }
+                pushUpdate(task, [task]() { task->finished = true; });
+            }
+        }
+
+        void ModelLoader::loadModelTask(const std::shared_ptr<ModelLoadTask> &task)
+        {
+            // the source model is only touched by this thread, the scene gets a published copy of its
+            // node tree, meshes are added to it one by one and material textures follow
+            task->model = std::make_shared<Model>();
+            task->source = std::make_shared<Model>();
+            Model &source = *task->source;
+            const std::string &filepath = task->path;
+            source.resourcePath = filepath.substr(0, filepath.find_last_of('/'));
+
+            // imported before with the same content and settings, mesh data is mapped from the cache
+            // optimized meshes are cached as optimized
+            uint32_t options = (task->meshOptimize ? MODEL_LOAD_OPTION_OPTIMIZE : 0) | (task->meshQuantize ? MODEL_LOAD_OPTION_QUANTIZE : 0);
+            std::string cacheKey = ModelCache::getCacheKey(filepath, task->importFlags, options);
+            std::vector<ModelNode *> nodes;
+            if (ModelCache::load(cacheKey, source))
+            {
+                LOGD("load model from cache: %s", ModelCache::getCacheFilePath(cacheKey).c_str());
+                publishModel(task, nodes);
+                size_t nodeIdx = 0;
+                std::function<void(ModelNode &)> publishNode = [&](ModelNode &node)
+                {
+                    ModelNode *outNode = nodes[nodeIdx++];
+                    for (auto &mesh : node.meshes)
+                    {
+                        publishMesh(task, mesh, outNode);
+                    }
+                    for (auto &child : node.children)
+                    {
+                        publishNode(child);
+                    }
+                };
+                publishNode(source.rootNode);
+                for (auto &mesh : source.instancedMeshes)
+                {
+                    publishMesh(task, mesh, nullptr);
+                }
+                task->progress = MODEL_LOAD_IMPORT_WEIGHT + MODEL_LOAD_MESH_WEIGHT;
+                publishTextures(task);
+                return;
+            }
+
             // load model
             Assimp::Importer importer;
-            if (filepath.empty())
+            importer.SetProgressHandler(new ImportProgressHandler(*task));
+            const aiScene *scene = importer.ReadFile(filepath, task->importFlags & ~aiProcess_CalcTangentSpace);
+            // tangents are only used by normal maps
+            if (scene && (task->importFlags & aiProcess_CalcTangentSpace) && hasNormalMap(scene))
             {
-                LOGE("ModelLoader::loadModel, empty model file path.");
-                return false;
+                scene = importer.ApplyPostProcessing(aiProcess_CalcTangentSpace);
+            }
+            if (task->canceled)
+            {
+                return;
             }
-            const aiScene *scene = importer.ReadFile(filepath, aiProcess_Triangulate | aiProcess_CalcTangentSpace | aiProcess_FlipUVs | aiProcess_GenBoundingBoxes);
             if (!scene || scene->mFlags == AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
             {
                 LOGE("ModelLoader::loadModel, failed to load model, desc: %s", importer.GetErrorString());
-                return false;
+                return;
             }
-            scene_.model->resourcePath = filepath.substr(0, filepath.find_last_of('/'));
             // preload textures
-            preloadTextureFiles(scene, scene_.model->resourcePath);
-            // processNode
+            preloadTextureFiles(scene, source.resourcePath);
+            // node tree & bounds
             auto currTransform = glm::mat4(1.0f);
-            if (!processNode(scene->mRootNode, scene, scene_.model->rootNode, currTransform))
+            if (!processNode(scene->mRootNode, scene, source, source.rootNode, currTransform))
             {
                 LOGE("ModelLoader::loadModel, failed to process model node.");
-                return false;
+                return;
             }
             // model center transform
-            scene_.model->centeredTransform = adjustModelCenter(scene_.model->rootAABB);
-            return true;
-        }
+            source.centeredTransform = adjustModelCenter(source.rootAABB);
+            publishModel(task, nodes);
 
-        bool ModelLoader::processNode(const aiNode *ai_node, const aiScene *ai_scene, ModelNode &outNode, glm::mat4 &transform)
-        {
-            if (!ai_node)
+            // meshes in the same pre-order as the published nodes
+            std::vector<const aiNode *> aiNodes;
+            std::vector<glm::mat4> nodeTransforms;
+            std::function<void(const aiNode *, const glm::mat4 &)> collectNode = [&](const aiNode *node, const glm::mat4 &parent)
             {
-                return false;
+                aiNodes.push_back(node);
+                nodeTransforms.push_back(parent * convertMatrix(node->mTransformation));
+                glm::mat4 transform = nodeTransforms.back();
+                for (size_t i = 0; i < node->mNumChildren; i++)
+                {
+                    if (node->mChildren[i])
+                    {
+                        collectNode(node->mChildren[i], transform);
+                    }
+                }
+            };
+            collectNode(scene->mRootNode, glm::mat4(1.0f));
+            std::vector<ModelNode *> sourceNodes;
+            std::function<void(ModelNode &)> collectSource = [&](ModelNode &node)
+            {
+                sourceNodes.push_back(&node);
+                for (auto &child : node.children)
+                {
+                    collectSource(child);
+                }
+            };
+            collectSource(source.rootNode);
+
+            // meshes shared by several nodes are converted once and drawn instanced with the node transforms,
+            // as long as those keep a uniform scale
+            std::vector<std::vector<size_t>> meshNodes(scene->mNumMeshes);
+            for (size_t nodeIdx = 0; nodeIdx < aiNodes.size(); nodeIdx++)
+            {
+                for (size_t i = 0; i < aiNodes[nodeIdx]->mNumMeshes; i++)
+                {
+                    meshNodes[aiNodes[nodeIdx]->mMeshes[i]].push_back(nodeIdx);
+                }
             }
-            outNode.transform = convertMatrix(ai_node->mTransformation);
-            auto currTransform = transform * outNode.transform;
-            for (size_t i = 0; i < ai_node->mNumMeshes; i++)
+            std::vector<int> instancedIdx(scene->mNumMeshes, -1);
+            for (size_t i = 0; i < meshNodes.size(); i++)
             {
-                const aiMesh *meshPtr = ai_scene->mMeshes[ai_node->mMeshes[i]];
-                if (meshPtr)
+                if (meshNodes[i].size() < MODEL_INSTANCE_MIN_NODES)
                 {
-                    ModelMesh mesh;
-                    if (processMesh(meshPtr, ai_scene, mesh))
+                    continue;
+                }
+                bool uniformScale = true;
+                for (size_t nodeIdx : meshNodes[i])
+                {
+                    uniformScale = uniformScale && isUniformScale(nodeTransforms[nodeIdx]);
+                }
+                if (uniformScale)
+                {
+                    instancedIdx[i] = (int) source.instancedMeshes.size();
+                    source.instancedMeshes.emplace_back();
+                    for (size_t nodeIdx : meshNodes[i])
                     {
-                        scene_.model->meshCnt++;
-                        scene_.model->primitiveCnt += mesh.primitiveCnt;
-                        scene_.model->vertexCnt += mesh.vertexes.size();
-
-                        // bounding box
-                        auto bounds = mesh.aabb.transform(currTransform);
-                        scene_.model->rootAABB.merge(bounds);
-                        outNode.meshes.push_back(std::move(mesh));
+                        source.instancedMeshes.back().instances.push_back(nodeTransforms[nodeIdx]);
                     }
                 }
             }
-            for (size_t i = 0; i < aiNode->mNumChildren; i++)
+
+            // meshes convert in parallel and are published in node order as they complete, instanced meshes last
+            size_t meshTotal = source.instancedMeshes.size();
+            for (auto *node : aiNodes)
             {
-                ModelNode childNode;
-                if (processNode(ai_node->mChildren[i], ai_scene, childNode, currTransform))
+                for (size_t i = 0; i < node->mNumMeshes; i++)
                 {
-                    outNode.children.push_back(std::move(childNode));
+                    meshTotal += instancedIdx[node->mMeshes[i]] < 0 ? 1 : 0;
                 }
             }
-            return true;
+            std::vector<MeshJob> jobs(meshTotal);
+            size_t jobIdx = 0;
+            for (size_t nodeIdx = 0; nodeIdx < aiNodes.size(); nodeIdx++)
+            {
+                const aiNode *ai_node = aiNodes[nodeIdx];
+                for (size_t i = 0; i < ai_node->mNumMeshes; i++)
+                {
+                    if (instancedIdx[ai_node->mMeshes[i]] >= 0)
+                    {
+                        continue;
+                    }
+                    MeshJob &job = jobs[jobIdx++];
+                    job.mesh = scene->mMeshes[ai_node->mMeshes[i]];
+                    job.nodeIdx = nodeIdx;
+                    job.meshIdx = sourceNodes[nodeIdx]->meshes.size();
+                    sourceNodes[nodeIdx]->meshes.emplace_back();
+                }
+            }
+            for (size_t i = 0; i < instancedIdx.size(); i++)
+            {
+                if (instancedIdx[i] >= 0)
+                {
+                    MeshJob &job = jobs[jobIdx++];
+                    job.mesh = scene->mMeshes[i];
+                    job.instancedIdx = instancedIdx[i];
+                }
+            }
+            {
+                // mesh jobs run on the process wide pool, waited as a group
+                ThreadPool &pool = ThreadPool::shared();
+                ThreadPool::TaskGroup meshTasks;
+                for (auto &job : jobs)
+                {
+                    MeshJob *jobPtr = &job;
+                    bool instanced = job.instancedIdx >= 0;
+                    ModelMesh *outMesh = instanced ? &source.instancedMeshes[job.instancedIdx] : &sourceNodes[job.nodeIdx]->meshes[job.meshIdx];
+                    pool.pushTask(meshTasks, [this, task, scene, &source, jobPtr, outMesh, instanced](size_t thread_id)
+                    {
+                        // instanced meshes are culled and drawn whole, without meshlets & levels
+                        bool success = !task->canceled && jobPtr->mesh && processMesh(jobPtr->mesh, scene, source.resourcePath, *outMesh);
+                        if (success && task->meshOptimize)
+                        {
+                            optimizeMesh(*outMesh, !instanced);
+                        }
+                        else if (success && !instanced)
+                        {
+                            buildMeshlets(*outMesh);
+                            buildLods(*outMesh);
+                        }
+                        if (success && task->meshQuantize)
+                        {
+                            quantizeMesh(*outMesh);
+                        }
+                        if (success)
+                        {
+                            shortenIndices(*outMesh);
+                        }
+                        jobPtr->state = success ? MeshJob_Done : MeshJob_Failed;
+                    });
+                }
+                for (size_t i = 0; i < jobs.size() && !task->canceled; i++)
+                {
+                    MeshJob &job = jobs[i];
+                    while (job.state == MeshJob_Pending)
+                    {
+                        std::this_thread::yield();
+                    }
+                    if (job.state == MeshJob_Done)
+                    {
+                        bool instanced = job.instancedIdx >= 0;
+                        ModelMesh &mesh = instanced ? source.instancedMeshes[job.instancedIdx] : sourceNodes[job.nodeIdx]->meshes[job.meshIdx];
+                        source.meshCnt++;
+                        source.primitiveCnt += mesh.primitiveCnt * std::max(mesh.instances.size(), (size_t) 1);
+                        source.vertexCnt += mesh.vertexCnt();
+                        publishMesh(task, mesh, instanced ? nullptr : nodes[job.nodeIdx]);
+                    }
+                    task->progress = MODEL_LOAD_IMPORT_WEIGHT + MODEL_LOAD_MESH_WEIGHT * (float) (i + 1) / (float) meshTotal;
+                }
+                // jobs reference this scope, wait for the rest after a cancel
+                meshTasks.wait();
+            }
+            if (task->canceled)
+            {
+                return;
+            }
+            // drop failed meshes, published meshes keep pointing at the moved vertex data
+            for (size_t i = jobs.size(); i > 0; i--)
+            {
+                MeshJob &job = jobs[i - 1];
+                if (job.state == MeshJob_Failed)
+                {
+                    auto &meshes = job.instancedIdx >= 0 ? source.instancedMeshes : sourceNodes[job.nodeIdx]->meshes;
+                    meshes.erase(meshes.begin() + (long) (job.instancedIdx >= 0 ? (size_t) job.instancedIdx : job.meshIdx));
+                }
+            }
+            publishTextures(task);
+            if (!task->canceled)
+            {
+                ModelCache::store(cacheKey, source);
+            }
         }
 
-        bool ModelLoader::processMesh(const aiMesh *ai_mesh, const aiScene *ai_scene, ModelMesh &outMesh)
+        void ModelLoader::publishModel(const std::shared_ptr<ModelLoadTask> &task, std::vector<ModelNode *> &outNodes)
         {
-            std::vector<Vertex> vertexes;
-            std::vector<int> indices;
-            for (size_t i = 0; i < ai_mesh->mNumVertices; i++)
+            // copy of the node tree without meshes, node addresses stay fixed once published
+            Model &model = *task->model;
+            Model &source = *task->source;
+            model.resourcePath = source.resourcePath;
+            model.rootAABB = source.rootAABB;
+            model.centeredTransform = source.centeredTransform;
+            model.meshStorage = task->source;
+            std::function<void(const ModelNode &, ModelNode &)> copyNode = [&](const ModelNode &node, ModelNode &outNode)
             {
-                Vertex vertex{};
-                if (ai_mesh->HasPositions())
+                outNodes.push_back(&outNode);
+                outNode.transform = node.transform;
+                outNode.children.resize(node.children.size());
+                for (size_t i = 0; i < node.children.size(); i++)
                 {
-                    vertex.a_position.x = ai_mesh->mVertices[i].x;
-                    vertex.a_position.y = ai_mesh->mVertices[i].y;
-                    vertex.a_position.z = ai_mesh->mVertices[i].z;
+                    copyNode(node.children[i], outNode.children[i]);
                 }
-                if (ai_mesh->HasTextureCoords(0))
+            };
+            copyNode(source.rootNode, model.rootNode);
+
+            pushUpdate(task, [this, task]() -> void
+            {
+                modelCache_[task->modelKey] = task->model;
+                scene_.model = task->model;
+            });
+        }
+
+        void ModelLoader::publishMesh(const std::shared_ptr<ModelLoadTask> &task, ModelMesh &mesh, ModelNode *node)
+        {
+            // vertex & index data used in place, material without textures until they are decoded
+            ModelMesh outMesh;
+            outMesh.primitiveType = mesh.primitiveType;
+            outMesh.primitiveCnt = mesh.primitiveCnt;
+            outMesh.aabb = mesh.aabb;
+            outMesh.meshlets = mesh.meshlets;
+            outMesh.lods = mesh.lods;
+            outMesh.instances = mesh.instances;
+            // owned by the mapped cache file, or by the source model for imported meshes
+            std::shared_ptr<void> owner = mesh.storage ? mesh.storage : std::shared_ptr<void>(task->source);
+            if (mesh.decodedVertexSize > 0)
+            {
+                outMesh.InitQuantizedVertexes((QuantizedVertex *) mesh.vertexesBuffer, mesh.vertexCnt(), mesh.indexBuffer, mesh.indexCnt(),
+                                              mesh.indexType, glm::vec3(mesh.quantScale), glm::vec3(mesh.quantOffset), owner);
+            }
+            else
+            {
+                outMesh.InitVertexes((Vertex *) mesh.vertexesBuffer, mesh.vertexCnt(), mesh.indexBuffer, mesh.indexCnt(), mesh.indexType, owner);
+            }
+            outMesh.material = std::make_shared<Material>(*mesh.material);
+            outMesh.material->textureData.clear();
+            task->materials.emplace_back(mesh.material.get(), outMesh.material);
+
+            // instanced meshes are not in the node tree, node is null
+            size_t vertexCnt = mesh.vertexCnt();
+            pushUpdate(task, [task, node, outMesh, vertexCnt]() -> void
+            {
+                Model &model = *task->model;
+                model.meshCnt++;
+                model.primitiveCnt += outMesh.primitiveCnt * std::max(outMesh.instances.size(), (size_t) 1);
+                model.vertexCnt += vertexCnt;
+                if (node)
                 {
-                    vertex.a_texcoord.x = ai_mesh->mTextureCoords[0][i].x;
-                    vertex.a_texcoord.y = ai_mesh->mTextureCoords[0][i].y;
+                    node->meshes.push_back(outMesh);
                 }
                 else
                 {
-                    vertex.a_texcoord = glm::vec2(0.0f, 0.0f);
+                    model.instancedMeshes.push_back(outMesh);
+                }
+            });
+        }
+
+        void ModelLoader::publishTextures(const std::shared_ptr<ModelLoadTask> &task)
+        {
+            std::set<std::string> texPaths;
+            for (auto &kv : task->materials)
+            {
+                for (auto &texKv : kv.first->textureData)
+                {
+                    texPaths.insert(texKv.second.tag);
                 }
-                if (ai_mesh->HasNormals())
+            }
+            preloadTextures(texPaths);
+
+            for (size_t i = 0; i < task->materials.size(); i++)
+            {
+                if (task->canceled)
                 {
-                    vertex.a_normal.x = ai_mesh->mNormals[i].x;
-                    vertex.a_normal.y = ai_mesh->mNormals[i].y;
-                    vertex.a_normal.z = ai_mesh->mNormals[i].z;
+                    return;
                 }
-                if (ai_mesh->HasTangentsAndBitangents())
+                Material &material = *task->materials[i].first;
+                for (auto it = material.textureData.begin(); it != material.textureData.end();)
                 {
-                    vertex.a_tangent.x = ai_mesh->mTangents[i].x;
-                    vertex.a_tangent.y = ai_mesh->mTangents[i].y;
-                    vertex.a_tangent.z = ai_mesh->mTangents[i].z;
+                    if (loadTextureData(it->second))
+                    {
+                        it++;
+                        continue;
+                    }
+                    LOGE("load texture file failed: %s, path: %s", Material::materialTexTypeStr((MaterialTexType) it->first), it->second.tag.c_str());
+                    it = material.textureData.erase(it);
+                }
+                if (!material.textureData.empty())
+                {
+                    auto outMaterial = task->materials[i].second;
+                    auto textureData = material.textureData;
+                    pushUpdate(task, [outMaterial, textureData]() -> void
+                    {
+                        outMaterial->textureData = textureData;
+                        outMaterial->resetStates();
+                    });
+                }
+                task->progress = MODEL_LOAD_IMPORT_WEIGHT + MODEL_LOAD_MESH_WEIGHT
+                                 + (1.f - MODEL_LOAD_IMPORT_WEIGHT - MODEL_LOAD_MESH_WEIGHT) * (float) (i + 1) / (float) task->materials.size();
+            }
+        }
+
+        void ModelLoader::pushUpdate(const std::shared_ptr<ModelLoadTask> &task, const std::function<void()> &update)
+        {
+            // results of a canceled load are dropped
+            std::lock_guard<std::mutex> lock(updateMutex_);
+            pendingUpdates_.push_back([task, update]() -> void
+            {
+                if (!task->canceled)
+                {
+                    update();
+                }
+            });
+        }
+
+        bool ModelLoader::processNode(const aiNode *ai_node, const aiScene *ai_scene, Model &model, ModelNode &outNode, glm::mat4 &transform)
+        {
+            if (!ai_node)
+            {
+                return false;
+            }
+            outNode.transform = convertMatrix(ai_node->mTransformation);
+            auto currTransform = transform * outNode.transform;
+            // meshes are converted later, bounds come from the importer
+            for (size_t i = 0; i < ai_node->mNumMeshes; i++)
+            {
+                const aiMesh *meshPtr = ai_scene->mMeshes[ai_node->mMeshes[i]];
+                if (meshPtr)
+                {
+                    auto bounds = convertBoundingBox(meshPtr->mAABB).transform(currTransform);
+                    model.rootAABB.merge(bounds);
                 }
-                vertexes.push_back(vertex);
             }
+            for (size_t i = 0; i < ai_node->mNumChildren; i++)
+            {
+                ModelNode childNode;
+                if (processNode(ai_node->mChildren[i], ai_scene, model, childNode, currTransform))
+                {
+                    outNode.children.push_back(std::move(childNode));
+                }
+            }
+            return true;
+        }
+
+        bool ModelLoader::processMesh(const aiMesh *ai_mesh, const aiScene *ai_scene, const std::string &resDir, ModelMesh &outMesh)
+        {
+            // attributes are copied array by array, missing ones stay zero
+            std::vector<Vertex> vertexes(ai_mesh->mNumVertices);
+            if (ai_mesh->HasPositions())
+            {
+                packVertexAttr(vertexes, &Vertex::a_position, ai_mesh->mVertices);
+            }
+            if (ai_mesh->HasTextureCoords(0))
+            {
+                packVertexAttr(vertexes, &Vertex::a_texcoord, ai_mesh->mTextureCoords[0]);
+            }
+            if (ai_mesh->HasNormals())
+            {
+                packVertexAttr(vertexes, &Vertex::a_normal, ai_mesh->mNormals);
+            }
+            if (ai_mesh->HasTangentsAndBitangents())
+            {
+                packVertexAttr(vertexes, &Vertex::a_tangent, ai_mesh->mTangents);
+            }
+            std::vector<int> indices(ai_mesh->mNumFaces * 3);
             for (size_t i = 0; i < ai_mesh->mNumFaces; i++)
             {
-                aiFace face = ai_mesh->mFaces[i];
+                const aiFace &face = ai_mesh->mFaces[i];
                 if (face.mNumIndices != 3)
                 {
                     LOGE("ModelLoader::processMesh, mesh not tranformed to triangle mesh.");
                     return false;
                 }
-                for (size_t j = 0; j < face.mNumIndices; j++)
-                {
-                    indices.push_back(face.mIndices[j]);
-                }
+                indices[i * 3 + 0] = (int) face.mIndices[0];
+                indices[i * 3 + 1] = (int) face.mIndices[1];
+                indices[i * 3 + 2] = (int) face.mIndices[2];
             }
             outMesh.material = std::make_shared<Material>();
             outMesh.material->baseColor = glm::vec4(1.f);
@@ -343,7 +910,7 @@ namespace SoftGL
                 }
                 for (int i = 0; i <= AI_TEXTURE_TYPE_MAX; i++)
                 {
-                    processMaterial(material, static_cast<aiTextureType>(i), *outMesh.material);
+                    processMaterial(material, static_cast<aiTextureType>(i), resDir, *outMesh.material);
                 }
             }
             outMesh.primitiveType = Primitive_TRIANGLE;
@@ -355,7 +922,134 @@ namespace SoftGL
             return true;
         }
 
-        void ModelLoader::processMaterial(const aiMaterial *ai_material, aiTextureType textureType, Material &material)
+        void ModelLoader::optimizeMesh(ModelMesh &mesh, bool clusters)
+        {
+            auto &vertexes = mesh.vertexes;
+            auto &indices = mesh.indices;
+            if (vertexes.empty() || indices.size() < 3)
+            {
+                return;
+            }
+            const float *positions = &vertexes[0].a_position.x;
+            size_t indexCnt = indices.size();
+            float acmrBefore = MeshOptimizer::analyzeVertexCache(indices.data(), indexCnt, vertexes.size());
+            float overdrawBefore = MeshOptimizer::analyzeOverdraw(indices.data(), indexCnt, positions, vertexes.size(), sizeof(Vertex));
+
+            MeshOptimizer::optimizeTriangleOrder(indices.data(), indexCnt, positions, vertexes.size(), sizeof(Vertex));
+            if (clusters)
+            {
+                buildMeshlets(mesh);
+                buildLods(mesh);
+            }
+            for (size_t i = 1; i < mesh.lods.size(); i++)
+            {
+                MeshOptimizer::optimizeTriangleOrder(&indices[mesh.lods[i].indexOffset], mesh.lods[i].indexCnt, positions, vertexes.size(), sizeof(Vertex));
+            }
+            size_t vertexCnt = MeshOptimizer::optimizeVertexFetch(vertexes.data(), vertexes.size(), sizeof(Vertex), indices.data(), indices.size());
+            vertexes.resize(vertexCnt);
+            mesh.InitVertexes();
+
+            positions = &vertexes[0].a_position.x;
+            float acmr = MeshOptimizer::analyzeVertexCache(indices.data(), indexCnt, vertexes.size());
+            float overdraw = MeshOptimizer::analyzeOverdraw(indices.data(), indexCnt, positions, vertexes.size(), sizeof(Vertex));
+            LOGD("optimize mesh, triangles: %zu, ACMR: %.3f -> %.3f, overdraw: %.3f -> %.3f", mesh.primitiveCnt, acmrBefore, acmr, overdrawBefore, overdraw);
+        }
+
+        void ModelLoader::buildMeshlets(ModelMesh &mesh)
+        {
+            if (mesh.primitiveType != Primitive_TRIANGLE || mesh.primitiveCnt < MODEL_MESHLET_MIN_TRIANGLES || mesh.vertexes.empty())
+            {
+                return;
+            }
+            MeshOptimizer::buildMeshlets(mesh.indices.data(), mesh.indices.size(), &mesh.vertexes[0].a_position.x, mesh.vertexes.size(),
+                                         sizeof(Vertex), mesh.meshlets);
+        }
+
+        void ModelLoader::buildLods(ModelMesh &mesh)
+        {
+            if (mesh.primitiveType != Primitive_TRIANGLE || mesh.primitiveCnt < MODEL_LOD_MIN_TRIANGLES || mesh.vertexes.empty())
+            {
+                return;
+            }
+            // levels appended to the index buffer, all sharing the vertexes
+            auto &indices = mesh.indices;
+            const float *positions = &mesh.vertexes[0].a_position.x;
+            float maxError = glm::length(mesh.aabb.max - mesh.aabb.min) * MODEL_LOD_MAX_ERROR;
+            mesh.lods.push_back({0, (uint32_t) indices.size(), 0.f});
+            std::vector<int32_t> levelIndices;
+            while (mesh.lods.size() < MODEL_LOD_MAX_LEVELS)
+            {
+                // simplified from the previous level, errors add up
+                MeshLod prev = mesh.lods.back();
+                size_t targetIndexCnt = prev.indexCnt / 3 / MODEL_LOD_REDUCTION * 3;
+                if (targetIndexCnt == 0)
+                {
+                    break;
+                }
+                levelIndices.resize(prev.indexCnt);
+                float error = 0.f;
+                size_t indexCnt = MeshOptimizer::simplify(levelIndices.data(), &indices[prev.indexOffset], prev.indexCnt, positions,
+                                                          mesh.vertexes.size(), sizeof(Vertex), targetIndexCnt, maxError - prev.error, &error);
+                if (indexCnt == 0 || (float) indexCnt > (float) prev.indexCnt * MODEL_LOD_MIN_REDUCTION)
+                {
+                    break;
+                }
+                mesh.lods.push_back({(uint32_t) indices.size(), (uint32_t) indexCnt, prev.error + error});
+                indices.insert(indices.end(), levelIndices.begin(), levelIndices.begin() + (std::ptrdiff_t) indexCnt);
+            }
+            if (mesh.lods.size() < 2)
+            {
+                mesh.lods.clear();
+            }
+            mesh.InitVertexes();
+        }
+
+        void ModelLoader::quantizeMesh(ModelMesh &mesh)
+        {
+            if (mesh.vertexes.empty())
+            {
+                return;
+            }
+            // positions quantized in the vertex bounds, the mesh aabb may be unset by the importer
+            glm::vec3 minPos = mesh.vertexes[0].a_position;
+            glm::vec3 maxPos = minPos;
+            for (auto &vertex : mesh.vertexes)
+            {
+                minPos = glm::min(minPos, vertex.a_position);
+                maxPos = glm::max(maxPos, vertex.a_position);
+            }
+            glm::vec3 scale = maxPos - minPos;
+            mesh.quantizedVertexes.resize(mesh.vertexes.size());
+            for (size_t i = 0; i < mesh.vertexes.size(); i++)
+            {
+                const Vertex &src = mesh.vertexes[i];
+                QuantizedVertex &dst = mesh.quantizedVertexes[i];
+                for (int j = 0; j < 3; j++)
+                {
+                    dst.a_position[j] = VertexCodec::encodeUnorm16(src.a_position[j], minPos[j], scale[j]);
+                }
+                dst.a_position[3] = 0;
+                dst.a_texcoord[0] = VertexCodec::encodeHalf(src.a_texcoord.x);
+                dst.a_texcoord[1] = VertexCodec::encodeHalf(src.a_texcoord.y);
+                VertexCodec::encodeOct(src.a_normal, dst.a_normal);
+                VertexCodec::encodeOct(src.a_tangent, dst.a_tangent);
+            }
+            std::vector<Vertex>().swap(mesh.vertexes);
+            mesh.InitQuantizedVertexes(scale, minPos);
+        }
+
+        void ModelLoader::shortenIndices(ModelMesh &mesh)
+        {
+            if (mesh.indices.empty() || mesh.vertexCnt() > 65536)
+            {
+                return;
+            }
+            mesh.shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+            std::vector<int32_t>().swap(mesh.indices);
+            mesh.InitIndexes();
+        }
+
+        void ModelLoader::processMaterial(const aiMaterial *ai_material, aiTextureType textureType, const std::string &resDir, Material &material)
         {
             if (ai_material->GetTextureCount(textureType) <= 0)
             {
@@ -371,7 +1065,7 @@ namespace SoftGL
                     LOGE("load texture type=%d, index=%d failed with return value=%d", textureType, i, retstatus);
                     continue;
                 }
-                std::string absolutePath = scene_.model->resourcePath + "/" + texPath.C_Str();
+                std::string absolutePath = resDir + "/" + texPath.C_Str();
                 MaterialTexType texType = MaterialTexType_None;
                 switch (textureType)
                 {
@@ -394,22 +1088,56 @@ namespace SoftGL
                     default:
                         continue; // notsupport
                 }
-                auto buffer = loadTextureFile(absolutePath);
-                if (buffer)
-                {
-                    auto &texData = material.textureData[texType];
-                    texData.tag = absolutePath;
-                    texData.width = buffer->getWidth();
-                    texData.height = buffer->getHeight();
-                    texData.data = {buffer};
-                    texData.wrapModeU = convertTexWrapMode(texMapMode[0]);
-                    texData.wrapModeV = convertTexWrapMode(texMapMode[1]);
-                }
-                else
+                // texture files are decoded after all meshes are published
+                TextureData texData;
+                texData.tag = absolutePath;
+                texData.wrapModeU = convertTexWrapMode(texMapMode[0]);
+                texData.wrapModeV = convertTexWrapMode(texMapMode[1]);
+                material.textureData[texType] = std::move(texData);
+            }
+        }
+
+        bool ModelLoader::loadTextureData(TextureData &texData)
+        {
+            const std::string &path = texData.tag;
+            if (StringUtils::endsWith(path, ".dds"))
+            {
+                auto blocks = loadTextureFileDDS(path);
+                if (blocks.empty())
                 {
-                    LOGE("load texture file failed: %s, path: %s", Material::materialTexTypeStr(texType), absolutePath.c_str());
+                    return false;
                 }
+                texData.width = blocks[0]->getWidth();
+                texData.height = blocks[0]->getHeight();
+                texData.blockData = std::move(blocks);
+                return true;
+            }
+            texData.loader = [path]() -> std::shared_ptr<Buffer<RGBA>>
+            {
+                return ImageUtils::readImageRGBA(path);
+            };
+            // streamed textures are decoded by the renderer when sampled, only the size is read here
+            int width = 0, height = 0;
+            if (config_.textureStreaming && ImageUtils::readImageSize(path, width, height))
+            {
+                texData.width = width;
+                texData.height = height;
+                return true;
+            }
+            auto buffer = loadTextureFile(path);
+            if (!buffer)
+            {
+                return false;
             }
+            texData.width = buffer->getWidth();
+            texData.height = buffer->getHeight();
+            texData.data = {buffer};
+            auto *decoder = &textureDecoder_;
+            texData.encoder = [decoder, path](BlockFormat format) -> std::vector<std::shared_ptr<BlockBuffer>>
+            {
+                return decoder->requestCompressed(path, format).get();
+            };
+            return true;
         }
 
         glm::mat4 ModelLoader::convertMatrix(const aiMatrix4x4 &m)
@@ -487,42 +1215,44 @@ namespace SoftGL
                     }
                 }
             }
-            if (texPaths.empty())
-            {
-                return;
-            }
-            ThreadPool pool(std::min(texPaths.size(), (size_t)std::thread::hardware_concurrency()));
+            preloadTextures(texPaths);
+        }
+
+        void ModelLoader::preloadTextures(const std::set<std::string> &texPaths)
+        {
+            // software renderer compresses material textures at upload, encode them with the decode
+            bool compress = config_.rendererType == Renderer_Soft
+                            && config_.textureFormat >= TextureFormat_BC1 && config_.textureFormat <= TextureFormat_BC7;
             for (auto &path : texPaths)
             {
-                pool.pushTask([&](const int thread_id) 
-                            { 
-                                loadTextureFile(path); 
-                            }
-                );
+                if (StringUtils::endsWith(path, ".dds"))
+                {
+                    textureDecoder_.requestBlocks(path);
+                }
+                else if (config_.textureStreaming)
+                {
+                    // streamed textures are not decoded at import
+                    continue;
+                }
+                else if (compress)
+                {
+                    textureDecoder_.requestCompressed(path, Texture::getBlockFormat((TextureFormat) config_.textureFormat));
+                }
+                else
+                {
+                    textureDecoder_.requestImage(path);
+                }
             }
         }
 
         std::shared_ptr<Buffer<RGBA>> ModelLoader::loadTextureFile(const std::string &path)
         {
-            texCacheMutex_.lock();
-            if (textureDataCache_.find(path) != textureDataCache_.end())
-            {
-                auto &buffer = textureDataCache_[path];
-                texCacheMutex_.unlock();
-                return buffer;
-            }
-            texCacheMutex_.unlock();
-            LOGD("load texture file: %s", path.c_str());
-            auto buffer = ImageUtils::readImageRGBA(path);
-            if (buffer == nullptr)
-            {
-                LOGD("load texture file failed: %s", path.c_str());
-                return nullptr;
-            }
-            texCacheMutex_.lock();
-            textureDataCache_[path] = buffer;
-            texCacheMutex_.unlock();
-            return buffer;
+            return textureDecoder_.requestImage(path).get();
+        }
+
+        std::vector<std::shared_ptr<BlockBuffer>> ModelLoader::loadTextureFileDDS(const std::string &path)
+        {
+            return textureDecoder_.requestBlocks(path).get();
         }
     }
 }
\ No newline at end of file
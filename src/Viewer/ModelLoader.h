@@ -1,25 +1,54 @@
 #pragma once
 
 #include <unordered_map>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <mutex>
+#include <set>
+#include <thread>
 #include <assimp/scene.h>
 #include "Base/Buffer.h"
 #include "Model.h"
 #include "Config.h"
 #include "ConfigPanel.h"
+#include "TextureDecoder.h"
 
 namespace SoftGL
 {
     namespace View
     {
+        // one background model load, canceled and progress are shared with the render thread,
+        // the other fields are used by the loader thread only until the model is published
+        struct ModelLoadTask
+        {
+            std::string path;
+            std::string modelKey;               // path & import flags
+            uint32_t importFlags = 0;
+            bool meshOptimize = false;
+            bool meshQuantize = false;
+            std::shared_ptr<Model> model;       // published to the scene once the node tree is ready
+            std::shared_ptr<Model> source;      // imported mesh data & textures, read in place by the published meshes
+            std::vector<std::pair<Material *, std::shared_ptr<Material>>> materials;   // source -> published placeholder
+            std::atomic<bool> canceled{false};
+            std::atomic<float> progress{0.f};
+            bool finished = false;              // render thread
+        };
+
         class ModelLoader
         {
         public:
             explicit ModelLoader(Config &config);
+            ~ModelLoader();
 
+            // returns immediately, the model is imported on the loader thread and shown progressively
             bool loadModel(const std::string &filePath);
             bool loadSkybox(const std::string &filePath);
 
+            // apply loader thread results to the scene, called by the render thread between frames
+            bool hasPendingUpdates();
+            void update();
+
             inline DemoScene &getScene() { return scene_; }
 
             inline size_t getModelPrimitiveCnt() const
@@ -49,10 +78,25 @@ namespace SoftGL
             void loadWorldAxis();
             void loadLights();
             void loadFloor();
+            bool skyboxFacesReady() const;
+            bool publishSkybox();
 
-            bool processNode(const aiNode *ai_node, const aiScene *ai_scene, ModelNode &outNode, glm::mat4 &transform);
-            bool processMesh(const aiMesh *ai_mesh, const aiScene *ai_scene, ModelMesh &outMesh);
-            bool processMaterial(const aiMaterial *ai_material, aiTextureType textureType, Material &material);
+            uint32_t getImportFlags() const;
+            void loadWorker();
+            void loadModelTask(const std::shared_ptr<ModelLoadTask> &task);
+            void publishModel(const std::shared_ptr<ModelLoadTask> &task, std::vector<ModelNode *> &outNodes);
+            void publishMesh(const std::shared_ptr<ModelLoadTask> &task, ModelMesh &mesh, ModelNode *node);
+            void publishTextures(const std::shared_ptr<ModelLoadTask> &task);
+            void pushUpdate(const std::shared_ptr<ModelLoadTask> &task, const std::function<void()> &update);
+
+            bool processNode(const aiNode *ai_node, const aiScene *ai_scene, Model &model, ModelNode &outNode, glm::mat4 &transform);
+            bool processMesh(const aiMesh *ai_mesh, const aiScene *ai_scene, const std::string &resDir, ModelMesh &outMesh);
+            bool processMaterial(const aiMaterial *ai_material, aiTextureType textureType, const std::string &resDir, Material &material);
+            static void optimizeMesh(ModelMesh &mesh, bool clusters = true);
+            static void buildMeshlets(ModelMesh &mesh);
+            static void buildLods(ModelMesh &mesh);
+            static void quantizeMesh(ModelMesh &mesh);
+            static void shortenIndices(ModelMesh &mesh);
 
             static glm::mat4 convertMatrix(const aiMatrix4x4 &m);
             static BoundingBox convertBoundingBox(const aiAABB &aabb);
@@ -60,16 +104,29 @@ namespace SoftGL
             static glm::mat4 adjustModelCenter(BoundingBox &bounds);
 
             void preloadTextureFiles(const aiScene *scene, const std::string &resDir);
+            void preloadTextures(const std::set<std::string> &texPaths);
+            bool loadTextureData(TextureData &texData);
             std::shared_ptr<Buffer<RGBA>> loadTextureFile(const std::string &path);
+            std::vector<std::shared_ptr<BlockBuffer>> loadTextureFileDDS(const std::string &path);
 
         private:
             Config &config_;
             DemoScene scene_;
             std::unordered_map<std::string, std::shared_ptr<Model>> modelCache_;
-            std::unordered_map<std::string, std::shared_ptr<Buffer<RGBA>> textureDataCache_;
             std::unordered_map<std::string, std::shared_ptr<SkyboxMaterial>> skyboxMaterialCache_;
-            std::mutex modelLoadMutex_;
-            std::mutex texCacheMutex_;
+            TextureDecoder textureDecoder_;
+            std::string pendingSkyboxPath_;                 // skybox decoding, render thread
+            std::vector<ImageFuture> pendingSkyboxFaces_;
+
+            std::shared_ptr<ModelLoadTask> loadTask_;       // latest requested load, render thread
+            std::shared_ptr<ModelLoadTask> nextTask_;
+            std::thread loadThread_;
+            std::mutex loadMutex_;
+            std::condition_variable loadCond_;
+            bool loadRunning_ = true;
+
+            std::mutex updateMutex_;
+            std::vector<std::function<void()>> pendingUpdates_;
         };
     }
 }
\ No newline at end of file
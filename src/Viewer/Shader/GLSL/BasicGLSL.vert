@@ -3,6 +3,10 @@ layout (location = 1) in vec2 a_texCoord;
 layout (location = 2) in vec3 a_normal;
 layout (location = 3) in vec3 a_tangent;
 
+#if defined(INSTANCED)
+layout (location = 4) in mat4 a_instanceMatrix;
+#endif
+
 layout (binding = 0, std140) uniform UniformsModel {
     bool u_reverseZ;
     mat4 u_modelMatrix;
@@ -22,6 +26,10 @@ layout (binding = 1, std140) uniform UniformsMaterial {
 };
 
 void main() {
-    gl_Position = u_modelViewProjectionMatrix * vec4(a_position, 1.0);
+    vec4 position = vec4(a_position, 1.0);
+    #if defined(INSTANCED)
+    position = a_instanceMatrix * position;
+    #endif
+    gl_Position = u_modelViewProjectionMatrix * position;
     gl_PointSize = u_pointSize;
 }
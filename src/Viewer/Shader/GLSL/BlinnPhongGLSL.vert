@@ -3,6 +3,10 @@ layout (location = 1) in vec2 a_texCoord;
 layout (location = 2) in vec3 a_normal;
 layout (location = 3) in vec3 a_tangent;
 
+#if defined(INSTANCED)
+layout (location = 4) in mat4 a_instanceMatrix;
+#endif
+
 layout (location = 0) out vec2 v_texCoord;
 layout (location = 1) out vec3 v_normalVector;
 layout (location = 2) out vec3 v_worldPos;
@@ -32,19 +36,27 @@ layout (binding = 1, std140) uniform UniformsScene {
 
 void main() {
     vec4 position = vec4(a_position, 1.0);
+    vec3 normal = a_normal;
+    vec3 tangent = a_tangent;
+    #if defined(INSTANCED)
+    // instance matrices keep a uniform scale, normals need no inverse transpose
+    position = a_instanceMatrix * position;
+    normal = mat3(a_instanceMatrix) * normal;
+    tangent = mat3(a_instanceMatrix) * tangent;
+    #endif
     gl_Position = u_modelViewProjectionMatrix * position;
     v_texCoord = a_texCoord;
     v_shadowFragPos = u_shadowMVPMatrix * position;
 
     // world space
     v_worldPos = vec3(u_modelMatrix * position);
-    v_normalVector = mat3(u_modelMatrix) * a_normal;
+    v_normalVector = mat3(u_modelMatrix) * normal;
     v_lightDirection = u_pointLightPosition - v_worldPos;
     v_cameraDirection = u_cameraPosition - v_worldPos;
 
     #if defined(NORMAL_MAP)
-    vec3 N = normalize(u_inverseTransposeModelMatrix * a_normal);
-    vec3 T = normalize(u_inverseTransposeModelMatrix * a_tangent);
+    vec3 N = normalize(u_inverseTransposeModelMatrix * normal);
+    vec3 T = normalize(u_inverseTransposeModelMatrix * tangent);
     v_normal = N;
     v_tangent = normalize(T - dot(T, N) * N);
     #endif
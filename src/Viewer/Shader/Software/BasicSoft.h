@@ -6,7 +6,10 @@ namespace SoftGL
 {
     namespace ShaderBasic
     {
-        struct ShaderDefines{};
+        struct ShaderDefines
+        {
+            uint8_t INSTANCED;
+        };
         
         struct ShaderAttributes
         {
@@ -14,6 +17,7 @@ namespace SoftGL
             glm::vec2 a_texCoord;
             glm::vec3 a_normal;
             glm::vec4 a_tangent;
+            glm::mat4 a_instanceMatrix;
         };
 
         struct ShaderUniforms
@@ -43,7 +47,10 @@ namespace SoftGL
 
             std::vector<std::string> &getDefines() override
             {
-                static std::vector<std::string> defines;
+                static std::vector<std::string> defines =
+                {
+                    "INSTANCED",
+                };
                 return defines;
             }
 
@@ -64,7 +71,12 @@ namespace SoftGL
 
             void shaderMain() override
             {
-                gl->Position = u->u_modelViewProjectionMatrix * glm::vec4(a->a_position, 1.0f);
+                glm::vec4 position = glm::vec4(a->a_position, 1.0f);
+                if (def->INSTANCED)
+                {
+                    position = a->a_instanceMatrix * position;
+                }
+                gl->Position = u->u_modelViewProjectionMatrix * position;
                 gl->PointSize = u->u_pointSize;
             }
         };
@@ -12,6 +12,7 @@ namespace SoftGL
             uint8_t NORMAL_MAP;
             uint8_t EMISSIVE_MAP;
             uint8_t AO_MAP;
+            uint8_t INSTANCED;
         };
 
         struct ShaderAttributes 
@@ -20,6 +21,7 @@ namespace SoftGL
             glm::vec2 a_texCoord;
             glm::vec3 a_normal;
             glm::vec3 a_tangent;
+            glm::mat4 a_instanceMatrix;
         };
 
         struct ShaderUniforms 
@@ -79,6 +81,7 @@ namespace SoftGL
                     "NORMAL_MAP",
                     "EMISSIVE_MAP",
                     "AO_MAP",
+                    "INSTANCED",
                 };
                 return defines;
             }
@@ -108,20 +111,30 @@ namespace SoftGL
             void shaderMain() override 
             {
                 glm::vec4 position = glm::vec4(a->a_position, 1.0);
+                glm::vec3 normal = a->a_normal;
+                glm::vec3 tangent = a->a_tangent;
+                if (def->INSTANCED)
+                {
+                    // instance matrices keep a uniform scale, normals need no inverse transpose
+                    glm::mat3 instanceMatrix = glm::mat3(a->a_instanceMatrix);
+                    position = a->a_instanceMatrix * position;
+                    normal = instanceMatrix * normal;
+                    tangent = instanceMatrix * tangent;
+                }
                 gl->Position = u->u_modelViewProjectionMatrix * position;
                 v->v_texCoord = a->a_texCoord;
                 v->v_shadowFragPos = u->u_shadowMVPMatrix * position;
 
                 // world space
                 v->v_worldPos = glm::vec3(u->u_modelMatrix * position);
-                v->v_normalVector = glm::mat3(u->u_modelMatrix) * a->a_normal;
+                v->v_normalVector = glm::mat3(u->u_modelMatrix) * normal;
                 v->v_lightDirection = u->u_pointLightPosition - v->v_worldPos;
                 v->v_cameraDirection = u->u_cameraPosition - v->v_worldPos;
 
                 if (def->NORMAL_MAP) 
                 {
-                    glm::vec3 N = glm::normalize(u->u_inverseTransposeModelMatrix * a->a_normal);
-                    glm::vec3 T = glm::normalize(u->u_inverseTransposeModelMatrix * a->a_tangent);
+                    glm::vec3 N = glm::normalize(u->u_inverseTransposeModelMatrix * normal);
+                    glm::vec3 T = glm::normalize(u->u_inverseTransposeModelMatrix * tangent);
                     v->v_normal = N;
                     v->v_tangent = glm::normalize(T - glm::dot(T, N) * N);
                 }
@@ -86,6 +86,21 @@ namespace SoftGL
                 glm::vec3 right = glm::normalize(glm::cross(up, N));
                 up = glm::normalize(glm::cross(N, right));
 
+                // samples are fetched in batches
+                glm::vec3 sampleVecs[CUBE_BATCH_SIZE];
+                float sampleWeights[CUBE_BATCH_SIZE];
+                glm::vec4 sampleColors[CUBE_BATCH_SIZE];
+                size_t batchCnt = 0;
+                auto flushBatch = [&]() 
+                {
+                    textureLod(u->u_cubeMap, sampleVecs, batchCnt, 0.f, sampleColors);
+                    for (size_t i = 0; i < batchCnt; i++) 
+                    {
+                        irradiance += glm::vec3(sampleColors[i]) * sampleWeights[i];
+                    }
+                    batchCnt = 0;
+                };
+
                 float sampleDelta = 0.025f;
                 float nrSamples = 0.0f;
                 for (float phi = 0.0f; phi < 2.0f * PI; phi += sampleDelta) 
@@ -96,12 +111,16 @@ namespace SoftGL
                         glm::vec3 tangentSample = glm::vec3(glm::sin(theta) * glm::cos(phi),
                                                             glm::sin(theta) * glm::sin(phi), glm::cos(theta));
                         // tangent space to world
-                        glm::vec3 sampleVec = tangentSample.x * right + tangentSample.y * up + tangentSample.z * N;
-
-                        irradiance += glm::vec3(texture(u->u_cubeMap, sampleVec)) * glm::cos(theta) * glm::sin(theta);
+                        sampleVecs[batchCnt] = tangentSample.x * right + tangentSample.y * up + tangentSample.z * N;
+                        sampleWeights[batchCnt] = glm::cos(theta) * glm::sin(theta);
+                        if (++batchCnt == CUBE_BATCH_SIZE) 
+                        {
+                            flushBatch();
+                        }
                         nrSamples++;
                     }
                 }
+                flushBatch();
                 irradiance = PI * irradiance * (1.0f / float(nrSamples));
 
                 gl->FragColor = glm::vec4(irradiance, 1.0f);
@@ -14,6 +14,8 @@ namespace SoftGL
             uint8_t EMISSIVE_MAP;
             uint8_t AO_MAP;
             uint8_t METALROUGHNESS_MAP;
+            uint8_t SRGB_OUTPUT;
+            uint8_t INSTANCED;
         };
 
         struct ShaderAttributes 
@@ -22,6 +24,7 @@ namespace SoftGL
             glm::vec2 a_texCoord;
             glm::vec3 a_normal;
             glm::vec3 a_tangent;
+            glm::mat4 a_instanceMatrix;
         };
 
         struct ShaderUniforms 
@@ -85,6 +88,8 @@ namespace SoftGL
                     "EMISSIVE_MAP",
                     "AO_MAP",
                     "METALROUGHNESS_MAP",
+                    "SRGB_OUTPUT",
+                    "INSTANCED",
                 };
                 return defines;
             }
@@ -116,18 +121,28 @@ namespace SoftGL
             void shaderMain() override 
             {
                 glm::vec4 position = glm::vec4(a->a_position, 1.0);
+                glm::vec3 normal = a->a_normal;
+                glm::vec3 tangent = a->a_tangent;
+                if (def->INSTANCED)
+                {
+                    // instance matrices keep a uniform scale, normals need no inverse transpose
+                    glm::mat3 instanceMatrix = glm::mat3(a->a_instanceMatrix);
+                    position = a->a_instanceMatrix * position;
+                    normal = instanceMatrix * normal;
+                    tangent = instanceMatrix * tangent;
+                }
                 gl->Position = u->u_modelViewProjectionMatrix * position;
                 v->v_texCoord = a->a_texCoord;
 
                 // world space
                 v->v_worldPos = glm::vec3(u->u_modelMatrix * position);
-                v->v_normalVector = glm::mat3(u->u_modelMatrix) * a->a_normal;
+                v->v_normalVector = glm::mat3(u->u_modelMatrix) * normal;
                 v->v_lightDirection = u->u_pointLightPosition - v->v_worldPos;
                 v->v_cameraDirection = u->u_cameraPosition - v->v_worldPos;
 
                 if (def->NORMAL_MAP) {
-                glm::vec3 N = glm::normalize(u->u_inverseTransposeModelMatrix * a->a_normal);
-                glm::vec3 T = glm::normalize(u->u_inverseTransposeModelMatrix * a->a_tangent);
+                glm::vec3 N = glm::normalize(u->u_inverseTransposeModelMatrix * normal);
+                glm::vec3 T = glm::normalize(u->u_inverseTransposeModelMatrix * tangent);
                 v->v_normal = N;
                 v->v_tangent = glm::normalize(T - glm::dot(T, N) * N);
                 }
@@ -259,7 +274,9 @@ namespace SoftGL
                     albedo_rgba = u->u_baseColor;
                 }
 
-                glm::vec3 albedo = glm::pow(glm::vec3(albedo_rgba), glm::vec3(2.2f));
+                // sRGB albedo map is decoded by the sampler
+                glm::vec3 albedo = (def->ALBEDO_MAP && u->u_albedoMap->isSrgb()) ? glm::vec3(albedo_rgba)
+                                                                                  : glm::pow(glm::vec3(albedo_rgba), glm::vec3(2.2f));
 
                 float metallic = 0.0f;
                 float roughness = 1.0f;
@@ -342,8 +359,11 @@ namespace SoftGL
                 // Ambient end ---------------------------------------------------------------
 
                 glm::vec3 color = ambient + Lo;
-                // gamma correct
-                color = pow(color, glm::vec3(1.0f / 2.2f));
+                // gamma correct, sRGB color attachment encodes on write
+                if (!def->SRGB_OUTPUT)
+                {
+                    color = pow(color, glm::vec3(1.0f / 2.2f));
+                }
 
                 // emissive
                 glm::vec3 emissive = glm::vec3(0.f);
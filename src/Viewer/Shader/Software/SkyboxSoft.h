@@ -88,6 +88,19 @@ namespace SoftGL
         public:
             CREATE_SHADER_CLONE(FS)
 
+            size_t getSamplerDerivativeOffset(BaseSampler<RGBA> *sampler) const override 
+            {
+                return offsetof(ShaderVaryings, v_worldPos);
+            }
+
+            void setupSamplerDerivative() override 
+            {
+                if (!def->EQUIRECTANGULAR_MAP) 
+                {
+                    u->u_cubeMap->setLodFunc(&texCubeLodFunc);
+                }
+            }
+
             static glm::vec2 SampleSphericalMap(glm::vec3 dir) 
             {
                 glm::vec2 uv = glm::vec2(glm::atan(dir.z, dir.x), asin(-dir.y));
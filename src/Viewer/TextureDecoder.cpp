@@ -0,0 +1,171 @@
+#include "TextureDecoder.h"
+#include "Base/ImageUtils.h"
+#include "Base/Logger.h"
+
+namespace SoftGL
+{
+    namespace View
+    {
+        TextureDecoder::TextureDecoder(size_t threadCnt)
+        {
+            threadCnt = std::max<size_t>(1, threadCnt);
+            for (size_t i = 0; i < threadCnt; i++)
+            {
+                threads_.emplace_back(&TextureDecoder::taskWorker, this);
+            }
+        }
+
+        TextureDecoder::~TextureDecoder()
+        {
+            {
+                std::lock_guard<std::mutex> lock(taskMutex_);
+                running_ = false;
+            }
+            taskCond_.notify_all();
+            for (auto &thread : threads_)
+            {
+                thread.join();
+            }
+        }
+
+        ImageFuture TextureDecoder::requestImage(const std::string &path)
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex_);
+            auto it = images_.find(path);
+            if (it != images_.end())
+            {
+                return it->second;
+            }
+            auto future = pushTask<std::shared_ptr<Buffer<RGBA>>>([path]() -> std::shared_ptr<Buffer<RGBA>>
+            {
+                LOGD("load texture file: %s", path.c_str());
+                auto buffer = ImageUtils::readImageRGBA(path);
+                if (!buffer)
+                {
+                    LOGD("load texture file failed: %s", path.c_str());
+                }
+                return buffer;
+            });
+            images_[path] = future;
+            return future;
+        }
+
+        BlocksFuture TextureDecoder::requestBlocks(const std::string &path)
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex_);
+            auto it = blocks_.find(path);
+            if (it != blocks_.end())
+            {
+                return it->second;
+            }
+            auto future = pushTask<std::vector<std::shared_ptr<BlockBuffer>>>([path]() -> std::vector<std::shared_ptr<BlockBuffer>>
+            {
+                LOGD("load texture file: %s", path.c_str());
+                auto blocks = ImageUtils::readImageDDS(path);
+                if (blocks.empty())
+                {
+                    LOGD("load texture file failed: %s", path.c_str());
+                }
+                return blocks;
+            });
+            blocks_[path] = future;
+            return future;
+        }
+
+        BlocksFuture TextureDecoder::requestCompressed(const std::string &path, BlockFormat format)
+        {
+            auto mips = requestMips(path);
+
+            std::lock_guard<std::mutex> lock(cacheMutex_);
+            std::string key = path + "#" + std::to_string((int) format);
+            auto it = compressed_.find(key);
+            if (it != compressed_.end())
+            {
+                return it->second;
+            }
+            auto future = pushTask<std::vector<std::shared_ptr<BlockBuffer>>>([mips, format]() -> std::vector<std::shared_ptr<BlockBuffer>>
+            {
+                std::vector<std::shared_ptr<BlockBuffer>> ret;
+                for (auto &level : mips.get())
+                {
+                    ret.push_back(BlockCompression::encode(*level, format));
+                }
+                return ret;
+            });
+            compressed_[key] = future;
+            return future;
+        }
+
+        void TextureDecoder::clear()
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex_);
+            images_.clear();
+            blocks_.clear();
+            mips_.clear();
+            compressed_.clear();
+        }
+
+        template<typename R>
+        std::shared_future<R> TextureDecoder::pushTask(const std::function<R()> &task)
+        {
+            auto packaged = std::make_shared<std::packaged_task<R()>>(task);
+            std::shared_future<R> future = packaged->get_future().share();
+            {
+                std::lock_guard<std::mutex> lock(taskMutex_);
+                tasks_.push([packaged]() { (*packaged)(); });
+            }
+            taskCond_.notify_one();
+            return future;
+        }
+
+        TextureDecoder::MipsFuture TextureDecoder::requestMips(const std::string &path)
+        {
+            auto image = requestImage(path);
+
+            std::lock_guard<std::mutex> lock(cacheMutex_);
+            auto it = mips_.find(path);
+            if (it != mips_.end())
+            {
+                return it->second;
+            }
+            auto future = pushTask<std::vector<std::shared_ptr<Buffer<RGBA>>>>([image]() -> std::vector<std::shared_ptr<Buffer<RGBA>>>
+            {
+                std::vector<std::shared_ptr<Buffer<RGBA>>> levels;
+                auto buffer = image.get();
+                if (!buffer)
+                {
+                    return levels;
+                }
+                levels.push_back(buffer);
+                while (buffer->getWidth() > 1 || buffer->getHeight() > 1)
+                {
+                    buffer = ImageUtils::downsample(*buffer);
+                    levels.push_back(buffer);
+                }
+                return levels;
+            });
+            mips_[path] = future;
+            return future;
+        }
+
+        void TextureDecoder::taskWorker()
+        {
+            while (true)
+            {
+                std::function<void()> task;
+                {
+                    // idle workers sleep, the decoder lives as long as the model loader
+                    std::unique_lock<std::mutex> lock(taskMutex_);
+                    taskCond_.wait(lock, [this]() { return !running_ || !tasks_.empty(); });
+                    if (!running_ && tasks_.empty())
+                    {
+                        return;
+                    }
+                    task = std::move(tasks_.front());
+                    tasks_.pop();
+                }
+                task();
+            }
+        }
+    }
+}
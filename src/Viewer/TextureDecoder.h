@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Base/Buffer.h"
+#include "Base/BlockCompression.h"
+
+namespace SoftGL
+{
+    namespace View
+    {
+        typedef std::shared_future<std::shared_ptr<Buffer<RGBA>>> ImageFuture;
+        typedef std::shared_future<std::vector<std::shared_ptr<BlockBuffer>>> BlocksFuture;
+
+        // decodes texture files on persistent worker threads shared by model and skybox loading.
+        // requests of the same file share one decode, results stay cached until cleared.
+        // stages of one texture (decode -> mip chain -> block encode) are queued as separate tasks,
+        // a task only waits on tasks queued before it, so the FIFO queue never deadlocks
+        class TextureDecoder
+        {
+        public:
+            explicit TextureDecoder(size_t threadCnt = std::thread::hardware_concurrency());
+            ~TextureDecoder();
+
+            // RGBA image, nullptr if failed
+            ImageFuture requestImage(const std::string &path);
+            // block compressed DDS image with stored mip levels, empty if failed
+            BlocksFuture requestBlocks(const std::string &path);
+            // RGBA image with full mip chain encoded to format, empty if failed
+            BlocksFuture requestCompressed(const std::string &path, BlockFormat format);
+
+            // drop cached results, pending requests still finish
+            void clear();
+
+        private:
+            typedef std::shared_future<std::vector<std::shared_ptr<Buffer<RGBA>>>> MipsFuture;
+
+            template<typename R>
+            std::shared_future<R> pushTask(const std::function<R()> &task);
+            MipsFuture requestMips(const std::string &path);
+            void taskWorker();
+
+        private:
+            std::vector<std::thread> threads_;
+            std::queue<std::function<void()>> tasks_;
+            std::mutex taskMutex_;
+            std::condition_variable taskCond_;
+            bool running_ = true;
+
+            std::mutex cacheMutex_;
+            std::unordered_map<std::string, ImageFuture> images_;
+            std::unordered_map<std::string, BlocksFuture> blocks_;
+            std::unordered_map<std::string, MipsFuture> mips_;
+            std::unordered_map<std::string, BlocksFuture> compressed_;
+        };
+    }
+}
@@ -1,5 +1,6 @@
 #include "Viewer.h"
 #include <algorithm>
+#include <limits>
 #include "Base/Logger.h"
 #include "Base/HashUtils.h"
 #include "Environment.h"
@@ -86,6 +87,18 @@ namespace SoftGL
             texDepthShadow_ = nullptr;
         }
 
+        void Viewer::resetShadowMap()
+        {
+            texDepthShadow_ = nullptr;
+        }
+
+        void Viewer::resetBufferLayout()
+        {
+            texDepthShadow_ = nullptr;
+            texDepthMain_ = nullptr;
+            texColorFxaa_ = nullptr;
+        }
+
         void Viewer::waitRendererIdle()
         {
             if (renderer_)
@@ -158,15 +171,16 @@ namespace SoftGL
             {
                 return;
             }
-            if (!texColorFxaa_)
+            if (!texColorFxaa_ || texColorFxaa_->format != getColorFormat())
             {
                 TextureDesc texDesc{};
                 texDesc.width = width_;
                 texDesc.height = height_;
-                texDesc.format = TextureFormat_RGBA8;
+                texDesc.format = getColorFormat();
                 texDesc.usage = TextureUsage_Sampler | TextureUsage_AttachmentColor;
                 texDesc.useMipmaps = false;
                 texDesc.multiSample = false;
+                texDesc.layout = (BufferLayout) config_.bufferLayout;
                 texColorFxaa_ = renderer_->createTexture(texDesc);
 
                 SamplerDesc sampler{};
@@ -228,6 +242,8 @@ namespace SoftGL
             // model nodes
             ModelNode &modelNode = scene_->model->rootNode;
             setupModelNodes(modelNode, config_.wireframe);
+            // instanced meshes
+            setupInstancedMeshes(*scene_->model, config_.wireframe);
         }
 
         void Viewer::setupPoints(ModelPoints &points)
@@ -278,6 +294,26 @@ namespace SoftGL
             }
         }
 
+        void Viewer::setupInstancedMeshes(Model &model, bool wireframe)
+        {
+            for (auto &mesh : model.instancedMeshes)
+            {
+                // instance data referenced in place, the mesh may have moved since it was loaded
+                if (!mesh.vao)
+                {
+                    mesh.InitInstances();
+                }
+                if (wireframe)
+                {
+                    setupMeshBaseColor(mesh, true);
+                }
+                else
+                {
+                    setupMeshTextured(mesh);
+                }
+            }
+        }
+
         void Viewer::drawScene(bool shadowPass)
         {
             // update scene uniform
@@ -303,6 +339,8 @@ namespace SoftGL
             // draw model node opaque
             ModelNode &modelNode = scene_->model->rootNode;
             drawModelNodes(modelNode, shadowPass, scene_->model->centeredTransform, Alpha_Opaque);
+            flushMeshBatch(shadowPass);
+            drawInstancedMeshes(*scene_->model, shadowPass, Alpha_Opaque);
             // draw skybox
             if (!shadowPass && config_.showSkybox)
             {
@@ -312,13 +350,18 @@ namespace SoftGL
             }
             // draw model nodes blend
             drawModelNodes(modelNode, shadowPass, scene_->model->centeredTransform, Alpha_Blend);
+            flushMeshBatch(shadowPass);
+            drawInstancedMeshes(*scene_->model, shadowPass, Alpha_Blend);
         }
 
         void Viewer::drawModelNodes(ModelNode &node, bool shadowPass, glm::mat4 &transform, AlphaMode mode, float specular)
         {
             glm::mat4 modelMatrix = transform * node.transform;
             // update model uniform
-            updateUniformModel(modelMatrix, camera_->viewMatrix());
+            if (!config_.multiDraw)
+            {
+                updateUniformModel(modelMatrix, camera_->viewMatrix());
+            }
             // draw nodes
             for (auto &mesh : node.meshes)
             {
@@ -329,9 +372,41 @@ namespace SoftGL
                 // frustum cull
                 if (!checkMeshFrustumCull(mesh, modelMatrix))
                 {
-                    return;
+                    continue;
+                }
+                // simplified level, or visible meshlets of the full mesh
+                const std::vector<DrawRange> *ranges = nullptr;
+                size_t lod = selectMeshLod(mesh, modelMatrix);
+                if (lod > 0)
+                {
+                    drawRanges_.assign(1, {mesh.lods[lod].indexOffset, mesh.lods[lod].indexCnt});
+                    ranges = &drawRanges_;
+                }
+                else if (config_.meshletCull && !mesh.meshlets.empty())
+                {
+                    if (!checkMeshletsCull(mesh, modelMatrix, drawRanges_))
+                    {
+                        continue;
+                    }
+                    ranges = drawRanges_.empty() ? nullptr : &drawRanges_;
+                }
+                // indices of the simplified levels follow the full mesh
+                if (!ranges && !mesh.lods.empty())
+                {
+                    drawRanges_.assign(1, {0, mesh.lods[0].indexCnt});
+                    ranges = &drawRanges_;
                 }
-                drawModelMesh(mesh, shadowPass, specular);
+                if (config_.multiDraw)
+                {
+                    if (batchModelMesh(mesh, modelMatrix, shadowPass, specular, ranges))
+                    {
+                        continue;
+                    }
+                    // batched draws overwrite the block data
+                    flushMeshBatch(shadowPass);
+                    updateUniformModel(modelMatrix, camera_->viewMatrix());
+                }
+                drawModelMesh(mesh, shadowPass, specular, ranges);
             }
             // draw child
             for (auto &child : node.children)
@@ -340,7 +415,32 @@ namespace SoftGL
             }
         }
 
-        void Viewer::drawModelMesh(ModelMesh &mesh, bool shadowPass, float specular)
+        void Viewer::drawInstancedMeshes(Model &model, bool shadowPass, AlphaMode mode)
+        {
+            // instance matrices place the meshes in model space
+            updateUniformModel(model.centeredTransform, camera_->viewMatrix());
+            for (auto &mesh : model.instancedMeshes)
+            {
+                if (mesh.material->alphaMode != mode)
+                {
+                    continue;
+                }
+                // instances are drawn together if any of them is inside the frustum, the instance data stays the
+                // same across the passes of a frame
+                bool visible = false;
+                for (size_t i = 0; i < mesh.instances.size() && !visible; i++)
+                {
+                    visible = checkMeshFrustumCull(mesh, model.centeredTransform * mesh.instances[i]);
+                }
+                if (!visible)
+                {
+                    continue;
+                }
+                drawModelMesh(mesh, shadowPass, 1.f, nullptr, mesh.instances.size());
+            }
+        }
+
+        void Viewer::drawModelMesh(ModelMesh &mesh, bool shadowPass, float specular, const std::vector<DrawRange> *ranges, size_t instanceCnt)
         {
             // update material
             updateUniformMaterial(*mesh.material, specular);
@@ -355,7 +455,82 @@ namespace SoftGL
                 updateShadowTextures(mesh.material->materialObject.get(), shadowPass);
             }
             // draw mesh
-            pipelineDraw(mesh);
+            pipelineDraw(mesh, ranges, instanceCnt);
+        }
+
+        bool Viewer::batchModelMesh(ModelMesh &mesh, const glm::mat4 &modelMatrix, bool shadowPass, float specular,
+                                    const std::vector<DrawRange> *ranges)
+        {
+            // meshes with own textures bind their own samplers
+            auto &materialObj = mesh.material->materialObject;
+            if (!mesh.vao || !materialObj || !mesh.material->textures.empty())
+            {
+                return false;
+            }
+            if (batchMesh_)
+            {
+                auto &batchObj = batchMesh_->material->materialObject;
+                if (batchObj->shaderProgram != materialObj->shaderProgram || batchObj->pipelineStates != materialObj->pipelineStates)
+                {
+                    flushMeshBatch(shadowPass);
+                }
+            }
+            if (!batchMesh_)
+            {
+                batchMesh_ = &mesh;
+                batchCommands_.clear();
+                batchUniforms_.blocks = {uniformBlockModel_, uniformBlockMaterial_};
+                batchUniforms_.data.clear();
+            }
+
+            // uniform record of the mesh: model block, then material block
+            UniformsModel uniformsModel{};
+            UniformsMaterial uniformsMaterial{};
+            fillUniformModel(uniformsModel, modelMatrix, camera_->viewMatrix());
+            fillUniformMaterial(uniformsMaterial, *mesh.material, specular);
+            size_t offset = batchUniforms_.data.size();
+            batchUniforms_.data.resize(offset + sizeof(UniformsModel) + sizeof(UniformsMaterial));
+            memcpy(&batchUniforms_.data[offset], &uniformsModel, sizeof(UniformsModel));
+            memcpy(&batchUniforms_.data[offset + sizeof(UniformsModel)], &uniformsMaterial, sizeof(UniformsMaterial));
+
+            // visible ranges of a mesh share its record
+            if (ranges)
+            {
+                for (auto &range : *ranges)
+                {
+                    batchCommands_.push_back({mesh.vao.get(), range.first, range.count, offset});
+                }
+            }
+            else
+            {
+                batchCommands_.push_back({mesh.vao.get(), 0, mesh.indexCnt(), offset});
+            }
+            return true;
+        }
+
+        void Viewer::flushMeshBatch(bool shadowPass)
+        {
+            if (!batchMesh_)
+            {
+                return;
+            }
+            ModelMesh &mesh = *batchMesh_;
+            batchMesh_ = nullptr;
+            // samplers of the first mesh are shared by the batch
+            auto &materialObj = mesh.material->materialObject;
+            if (mesh.material->shadingModel == Shading_PBR)
+            {
+                updateIBLTextures(materialObj.get());
+            }
+            if (config_.shadowMap)
+            {
+                updateShadowTextures(materialObj.get(), shadowPass);
+            }
+            renderer_->setVertexArrayObject(mesh.vao);
+            renderer_->setShaderProgram(materialObj->shaderProgram);
+            renderer_->setShaderResources(materialObj->shaderResources);
+            renderer_->setPipelineStates(materialObj->pipelineStates);
+            renderer_->drawMulti(batchCommands_, batchUniforms_);
         }
 
         void Viewer::pipelineSetup(ModelBase &model, ShadingModel shading, const std::set<int> &uniformBlocks, const std::function<void(RenderStates &rs)> &extraStates)
@@ -372,7 +547,7 @@ namespace SoftGL
             setupMaterial(model, shading, uniformBlocks, extraStates);
         }
 
-        void Viewer::pipelineDraw(ModelBase &model)
+        void Viewer::pipelineDraw(ModelBase &model, const std::vector<DrawRange> *ranges, size_t instanceCnt)
         {
             auto &materialObj = model.material->materialObject;
 
@@ -380,7 +555,18 @@ namespace SoftGL
             renderer_->setShaderProgram(materialObj->shaderProgram);
             renderer_->setShaderResources(materialObj->shaderResources);
             renderer_->setPipelineStates(materialObj->pipelineStates);
-            renderer_->draw();
+            if (instanceCnt > 0)
+            {
+                renderer_->drawInstanced(instanceCnt);
+            }
+            else if (ranges)
+            {
+                renderer_->drawRanges(*ranges);
+            }
+            else
+            {
+                renderer_->draw();
+            }
         }
 
         void Viewer::setupMainBuffers()
@@ -424,10 +610,11 @@ namespace SoftGL
                 texDesc.width = SHADOW_MAP_WIDTH;
                 texDesc.height = SHADOW_MAP_HEIGHT;
                 texDesc.type = TextureType_2D;
-                texDesc.format = TextureFormat_FLOAT32;
+                texDesc.format = config_.shadowMap16Bit ? TextureFormat_D16 : TextureFormat_FLOAT32;
                 texDesc.usage = TextureUsage_Sampler | TextureUsage_AttachmentDepth;
                 texDesc.useMipmaps = false;
                 texDesc.multiSample = false;
+                texDesc.layout = (BufferLayout) config_.bufferLayout;
                 texDepthShadow_ = renderer_->createTexture(texDesc);
 
                 SamplerDesc sampler{};
@@ -450,16 +637,18 @@ namespace SoftGL
 
         void Viewer::setupMainColorBuffer(bool multiSample)
         {
-            if (!texColorMain_ || texColorMain_->multiSample != multiSample)
+            if (!texColorMain_ || texColorMain_->multiSample != multiSample || texColorMain_->format != getColorFormat())
             {
                 TextureDesc texDesc{};
                 texDesc.width = width_;
                 texDesc.height = height_;
                 texDesc.type = TextureType_2D;
-                texDesc.format = TextureFormat_RGBA8;
+                texDesc.format = getColorFormat();
                 texDesc.usage = TextureUsage_AttachmentColor | TextureUsage_RendererOutput;
                 texDesc.useMipmaps = false;
                 texDesc.multiSample = multiSample;
+                // output buffer is uploaded as raw pixels
+                texDesc.layout = Layout_Linear;
                 texColorMain_ = renderer_->createTexture(texDesc);
 
                 SamplerDesc sampler{};
@@ -483,6 +672,7 @@ namespace SoftGL
                 texDesc.usage = TextureUsage_AttachmentDepth;
                 texDesc.useMipmaps = false;
                 texDesc.multiSample = multiSample;
+                texDesc.layout = (BufferLayout) config_.bufferLayout;
                 texDepthMain_ = renderer_->createTexture(texDesc);
 
                 SamplerDesc sampler{};
@@ -513,6 +703,7 @@ namespace SoftGL
                 texDesc.usage = TextureUsage_Sampler | TextureUsage_UploadData;
                 texDesc.useMipmaps = false;
                 texDesc.multiSample = false;
+                texDesc.layout = (BufferLayout) config_.bufferLayout;
 
                 SamplerDesc sampler{};
                 sampler.wrapS = kv.second.wrapModeU;
@@ -521,6 +712,8 @@ namespace SoftGL
                 sampler.filterMag = Filter_LINEAR;
 
                 std::shared_ptr<Texture> texture  = nullptr;
+                std::vector<std::shared_ptr<BlockBuffer>> blockData = kv.second.blockData;
+                bool streamed = false;
                 switch (kv.first)
                 {
                     case MaterialTexType_IBL_IRRADIANCE:
@@ -533,6 +726,13 @@ namespace SoftGL
                     {
                         texDesc.type = TextureType_CUBE;
                         sampler.wrapR = kv.second.wrapModeW;
+                        // software renderer selects cube levels from quad derivatives
+                        if (config_.rendererType == Renderer_Soft)
+                        {
+                            texDesc.format = getColorFormat();
+                            texDesc.useMipmaps = config_.mipmaps;
+                            sampler.filterMin = config_.mipmaps ? Filter_LINEAR_MIPMAP_LINEAR : Filter_LINEAR;
+                        }
                         break;
                     }
                     default:
@@ -540,12 +740,70 @@ namespace SoftGL
                         texDesc.type = TextureType_2D;
                         texDesc.useMipmaps = config_.mipmaps;
                         sampler.filterMin = config_.mipmaps ? Filter_LINEAR_MIPMAP_LINEAR : Filter_LINEAR;
+                        // software renderer samples block compressed textures directly
+                        if (config_.rendererType == Renderer_Soft)
+                        {
+                            if (!kv.second.blockData.empty())
+                            {
+                                texDesc.format = Texture::getCompressedFormat(kv.second.blockData[0]->getFormat());
+                            }
+                            else
+                            {
+                                texDesc.format = (TextureFormat) config_.textureFormat;
+                                // mip chain is encoded on the decode threads, usually done at import
+                                if (texDesc.format >= TextureFormat_BC1 && texDesc.format <= TextureFormat_BC7 && kv.second.encoder)
+                                {
+                                    blockData = kv.second.encoder(Texture::getBlockFormat(texDesc.format));
+                                }
+                            }
+                            // color textures are sRGB encoded, data textures stay linear
+                            bool colorTex = kv.first == MaterialTexType_ALBEDO || kv.first == MaterialTexType_EMISSIVE
+                                            || kv.first == MaterialTexType_EQUIRECTANGULAR;
+                            if (colorTex && texDesc.format == TextureFormat_RGBA8)
+                            {
+                                texDesc.format = getColorFormat();
+                            }
+                            // streaming needs the mip chain, levels are loaded as sampled
+                            streamed = config_.textureStreaming && kv.second.loader
+                                       && (texDesc.format == TextureFormat_RGBA8 || texDesc.format == TextureFormat_RGBA8_SRGB);
+                            if (streamed)
+                            {
+                                texDesc.useMipmaps = true;
+                                sampler.filterMin = Filter_LINEAR_MIPMAP_LINEAR;
+                            }
+                        }
                         break;
                     }
                 }
+                if (!streamed && blockData.empty() && kv.second.data.empty())
+                {
+                    // imported for streaming, decode now
+                    auto buffer = kv.second.loader ? kv.second.loader() : nullptr;
+                    if (!buffer)
+                    {
+                        LOGE("load texture failed: %s", kv.second.tag.c_str());
+                        continue;
+                    }
+                    kv.second.data = {buffer};
+                }
                 texture = renderer_->createTexture(texDesc);
                 texture->setSamplerDesc(sampler);
-                texture->setImageData(kv.second.data);
+                if (streamed)
+                {
+                    texture->setImageLoader(kv.second.loader);
+                }
+                else if (blockData.empty())
+                {
+                    texture->setImageData(kv.second.data);
+                }
+                else if (texture->isCompressed())
+                {
+                    texture->setImageData(blockData);
+                }
+                else
+                {
+                    texture->setImageData({BlockCompression::decode(*blockData[0])});
+                }
                 texture->tag = kv.second.tag;
                 material.textures[kv.first] = texture;
             }
@@ -650,6 +908,10 @@ namespace SoftGL
             {
                 setupTextures(material);
                 material.shaderDefines = generateShaderDefines(material);
+                if (!model.instanceDesc.empty())
+                {
+                    material.shaderDefines.insert("INSTANCED");
+                }
             }
             if (!material.materialObject)
             {
@@ -703,10 +965,24 @@ namespace SoftGL
         {
             static UniformsModel uniformsModel{};
 
-            uniformsModel.u_reverseZ = config_.reverseZ ? 1u : 0u;
-            uniformsModel.u_modelMatrix = model;
-            uniformsModel.u_modelViewProjectionMatrix = camera_->projectionMatrix() * view * model;
-            uniformsModel.u_inverseTransposeModelMatrix = glm::mat3(glm::transpose(glm::inverse(model)));
+            fillUniformModel(uniformsModel, model, view);
+            uniformBlockModel_->setData(&uniformsModel, sizeof(uniformsModel));
+        }
+
+        void Viewer::updateUniformMaterial(Material &material, float specular)
+        {
+            static UniformsMaterial uniformsMaterial{};
+
+            fillUniformMaterial(uniformsMaterial, material, specular);
+            uniformBlockMaterial_->setData(&uniformsMaterial, sizeof(uniformsMaterial));
+        }
+
+        void Viewer::fillUniformModel(UniformsModel &uniforms, const glm::mat4 &model, const glm::mat4 &view)
+        {
+            uniforms.u_reverseZ = config_.reverseZ ? 1u : 0u;
+            uniforms.u_modelMatrix = model;
+            uniforms.u_modelViewProjectionMatrix = camera_->projectionMatrix() * view * model;
+            uniforms.u_inverseTransposeModelMatrix = glm::mat3(glm::transpose(glm::inverse(model)));
             // shadow mvp
             if (config_.shadowMap && cameraDepth_)
             {
@@ -714,24 +990,19 @@ namespace SoftGL
                                                     0.0f, 0.5f, 0.0f, 0.0f,
                                                     0.0f, 0.0f, 1.0f, 0.0f,
                                                     0.5f, 0.5f, 0.0f, 1.0f);
-                uniformsModel.u_shadowMVPMatrix = biasMat * cameraDepth_->projectionMatrix() * cameraDepth_->viewMatrix() * model;
+                uniforms.u_shadowMVPMatrix = biasMat * cameraDepth_->projectionMatrix() * cameraDepth_->viewMatrix() * model;
             }
-            uniformBlockModel_->setData(&uniformsModel, sizeof(uniformsModel));
         }
 
-        void Viewer::updateUniformMaterial(Material &material, float specular)
+        void Viewer::fillUniformMaterial(UniformsMaterial &uniforms, Material &material, float specular)
         {
-            static UniformsMaterial uniformsMaterial{};
+            uniforms.u_enableLight = config_.showLight ? 1u : 0u;
+            uniforms.u_enableIBL = iBLEnabled() ? 1u : 0u;
+            uniforms.u_enableShadow = config_.shadowMap ? 1u : 0u;
 
-            uniformsMaterial.u_enableLight = config_.showLight ? 1u : 0u;
-            uniformsMaterial.u_enableIBL = iBLEnabled() ? 1u : 0u;
-            uniformsMaterial.u_enableShadow = config_.shadowMap ? 1u : 0u;
-
-            uniformsMaterial.u_pointSize = material.pointSize;
-            uniformsMaterial.u_kSpecular = specular;
-            uniformsMaterial.u_baseColor = material.baseColor;
-
-            uniformBlockMaterial_->setData(&uniformsMaterial, sizeof(uniformsMaterial));
+            uniforms.u_pointSize = material.pointSize;
+            uniforms.u_kSpecular = specular;
+            uniforms.u_baseColor = material.baseColor;
         }
 
         bool Viewer::initSkyboxIBL()
@@ -884,16 +1155,23 @@ namespace SoftGL
             }
         }
 
+        TextureFormat Viewer::getColorFormat()
+        {
+            // software renderer only
+            return (config_.srgb && config_.rendererType == Renderer_Soft) ? TextureFormat_RGBA8_SRGB : TextureFormat_RGBA8;
+        }
+
         std::shared_ptr<Texture> Viewer::createTextureCubeDefault(int width, int height, uint32_t usage, bool mipmaps)
         {
             TextureDesc texDesc{};
             texDesc.width = width;
             texDesc.height = height;
             texDesc.type = TextureType_CUBE;
-            texDesc.format = TextureFormat_RGBA8;
+            texDesc.format = getColorFormat();
             texDesc.usage = usage;
             texDesc.useMipmaps = mipmaps;
             texDesc.multiSample = false;
+            texDesc.layout = (BufferLayout) config_.bufferLayout;
             auto textureCube = renderer_->createTexture(texDesc);
             if (!textureCube)
             {
@@ -919,6 +1197,7 @@ namespace SoftGL
             texDesc.usage = usage;
             texDesc.useMipmaps = mipmaps;
             texDesc.multiSample = false;
+            texDesc.layout = (BufferLayout) config_.bufferLayout;
             auto texture2d = renderer_->createTexture(texDesc);
             if (!texture2d)
             {
@@ -945,6 +1224,11 @@ namespace SoftGL
                     shaderDefines.insert(samplerDefine);
                 }
             }
+            // color attachment encodes, skip gamma correction in shader
+            if (getColorFormat() == TextureFormat_RGBA8_SRGB)
+            {
+                shaderDefines.insert("SRGB_OUTPUT");
+            }
             return shaderDefines;
         }
 
@@ -990,5 +1274,91 @@ namespace SoftGL
             BoundingBox bbox = mesh.aabb.transform(modelMatrix);
             return camera_->getFrustum().intersects(bbox);
         }
+
+        size_t Viewer::selectMeshLod(ModelMesh &mesh, const glm::mat4 &modelMatrix)
+        {
+            if (!config_.meshLod || mesh.lods.size() < 2)
+            {
+                return 0;
+            }
+            // projected bounds with the main camera, shadow and main passes draw the same level
+            glm::mat4 mvp = cameraMain_.projectionMatrix() * cameraMain_.viewMatrix() * modelMatrix;
+            glm::vec3 corners[8];
+            mesh.aabb.getCorners(corners);
+            glm::vec2 screenMin(std::numeric_limits<float>::max());
+            glm::vec2 screenMax(-std::numeric_limits<float>::max());
+            for (auto &corner : corners)
+            {
+                glm::vec4 clip = mvp * glm::vec4(corner, 1.f);
+                if (clip.w <= 0.f)
+                {
+                    return 0;
+                }
+                glm::vec2 ndc = glm::vec2(clip) / clip.w;
+                screenMin = glm::min(screenMin, ndc);
+                screenMax = glm::max(screenMax, ndc);
+            }
+            glm::vec2 screenSize = (screenMax - screenMin) * 0.5f * glm::vec2((float) width_, (float) height_);
+            float meshSize = glm::length(mesh.aabb.max - mesh.aabb.min);
+            if (meshSize <= 0.f)
+            {
+                return 0;
+            }
+            // coarsest level whose error stays under the threshold in pixels
+            float pixelsPerUnit = glm::length(screenSize) / meshSize;
+            size_t lod = 0;
+            for (size_t i = 1; i < mesh.lods.size(); i++)
+            {
+                if (mesh.lods[i].error * pixelsPerUnit > config_.lodPixelError)
+                {
+                    break;
+                }
+                lod = i;
+            }
+            return lod;
+        }
+
+        bool Viewer::checkMeshletsCull(ModelMesh &mesh, const glm::mat4 &modelMatrix, std::vector<DrawRange> &ranges)
+        {
+            ranges.clear();
+            const Frustum &frustum = camera_->getFrustum();
+            // bounding spheres scaled by the largest axis scale
+            float scale = std::sqrt(std::max(glm::dot(glm::vec3(modelMatrix[0]), glm::vec3(modelMatrix[0])),
+                                             std::max(glm::dot(glm::vec3(modelMatrix[1]), glm::vec3(modelMatrix[1])),
+                                                      glm::dot(glm::vec3(modelMatrix[2]), glm::vec3(modelMatrix[2])))));
+            // normal cones tested in model space, facing is kept if the transform does not mirror
+            bool coneCull = config_.cullFace && !mesh.material->doubleSided && glm::determinant(glm::mat3(modelMatrix)) > 0.f;
+            glm::vec3 eye = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(camera_->eye(), 1.f));
+            size_t visibleCnt = 0;
+            for (auto &meshlet : mesh.meshlets)
+            {
+                if (coneCull && meshlet.coneCutoff < 1.f
+                    && glm::dot(glm::normalize(meshlet.coneApex - eye), meshlet.coneAxis) >= meshlet.coneCutoff)
+                {
+                    continue;
+                }
+                glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(meshlet.center, 1.f));
+                if (!frustum.intersects(center, meshlet.radius * scale))
+                {
+                    continue;
+                }
+                visibleCnt++;
+                // adjacent visible meshlets merged into one range
+                if (!ranges.empty() && ranges.back().first + ranges.back().count == meshlet.indexOffset)
+                {
+                    ranges.back().count += meshlet.indexCnt;
+                }
+                else
+                {
+                    ranges.push_back({meshlet.indexOffset, meshlet.indexCnt});
+                }
+            }
+            // all visible, drawn as a whole
+            if (visibleCnt == mesh.meshlets.size())
+            {
+                ranges.clear();
+            }
+            return visibleCnt > 0;
+        }
     }
 }
\ No newline at end of file
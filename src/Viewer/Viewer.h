@@ -26,6 +26,8 @@ namespace SoftGL
 
             void waitRendererIdle();
             void resetReverseZ();
+            void resetShadowMap();
+            void resetBufferLayout();
 
             //used by RenderDoc to capture frames
             virtual void *getDevicesPointer() { return nullptr; }
@@ -47,14 +49,20 @@ namespace SoftGL
             void setupMeshBaseColor(ModelMesh &mesh, bool wireframe);
             void setupMeshTextured(ModelMesh &mesh);
             void setupModelNodes(ModelNode &node, bool wireframe);
+            void setupInstancedMeshes(Model &model, bool wireframe);
             void setupSkybox(ModelMesh &skybox);
 
             void drawScene(bool shadowPass);
             void drawModelNodes(ModelNode &node, bool shadowPass, glm::mat4 &transform, AlphaMode mode, float specular = 1.f);
-            void drawModelMesh(ModelMesh &mesh, bool shadowPass, float specular);
+            void drawInstancedMeshes(Model &model, bool shadowPass, AlphaMode mode);
+            void drawModelMesh(ModelMesh &mesh, bool shadowPass, float specular, const std::vector<DrawRange> *ranges = nullptr,
+                               size_t instanceCnt = 0);
+            bool batchModelMesh(ModelMesh &mesh, const glm::mat4 &modelMatrix, bool shadowPass, float specular,
+                                const std::vector<DrawRange> *ranges);
+            void flushMeshBatch(bool shadowPass);
 
             void pipelineSetup(ModelBase &model, ShadingModel shading, const std::set<int> &uniformBlocks, const std::function<void(RenderStates &rs)> &extraStates = nullptr);
-            void pipelineDraw(ModelBase &model);
+            void pipelineDraw(ModelBase &model, const std::vector<DrawRange> *ranges = nullptr, size_t instanceCnt = 0);
 
             void setupMainBuffers();
             void setupShadowMapBuffers();
@@ -71,6 +79,8 @@ namespace SoftGL
             void updateUniformScene();
             void updateUniformModel(const glm::mat4 &model, const glm::mat4 &view);
             void updateUniformMaterial(Material &material, float specular = 1.f);
+            void fillUniformModel(UniformsModel &uniforms, const glm::mat4 &model, const glm::mat4 &view);
+            void fillUniformMaterial(UniformsMaterial &uniforms, Material &material, float specular);
 
             inline SkyboxMaterial *getSkyboxMaterial();
             bool initSkyboxIBL();
@@ -78,13 +88,16 @@ namespace SoftGL
             void updateIBLTextures(MaterialObject *materialObject);
             void updateShadowTextures(MaterialObject *materialObject, bool shadowPass);
 
-            static std::set<std::string> generateShaderDefines(Material &material);
+            std::set<std::string> generateShaderDefines(Material &material);
             static size_t getShaderProgramCacheKey(ShadingModel shading, const std::set<std::string> &defines);
             static size_t getPipelineCacheKey(Material &material, const RenderStates &rs);
 
+            TextureFormat getColorFormat();
             std::shared_ptr<Texture> createTextureCubeDefault(int width, int height, uint32_t usage, bool mipmaps = false);
             std::shared_ptr<Texture> createTexture2DDefault(int width, int height, TextureFormat format, uint32_t usage, bool mipmaps = false); 
             bool checkMeshFrustumCull(ModelMesh &mesh, const glm::mat4 &transform);
+            size_t selectMeshLod(ModelMesh &mesh, const glm::mat4 &transform);
+            bool checkMeshletsCull(ModelMesh &mesh, const glm::mat4 &transform, std::vector<DrawRange> &ranges);
 
         protected:
             Config &config_;
@@ -127,6 +140,14 @@ namespace SoftGL
             // caches
             std::unordered_map<size_t, std::shared_ptr<ShaderProgram>> programCache_;
             std::unordered_map<size_t, std::shared_ptr<PipelineStates>> pipelineCache_;
+
+            // index ranges of the current mesh, a simplified level or its visible meshlets
+            std::vector<DrawRange> drawRanges_;
+
+            // pending multi draw of node meshes sharing program & pipeline states, one uniform record per mesh
+            ModelMesh *batchMesh_ = nullptr;
+            std::vector<DrawCommand> batchCommands_;
+            UniformTable batchUniforms_;
         };
     }
 }
\ No newline at end of file
@@ -72,6 +72,39 @@ namespace SoftGL
                     auto &viewer = viewers_[config_->rendererType];
                     viewer->resetReverseZ();
                 });
+                configPanel_->setResetShadowMapFunc([&]()->void
+                {
+                    waitRenderIdle();
+                    auto &viewer = viewers_[config_->rendererType];
+                    viewer->resetShadowMap();
+                });
+                configPanel_->setResetTextureFormatFunc([&]()->void
+                {
+                    waitRenderIdle();
+                    modelLoader_->getScene().model->resetStates();
+                });
+                configPanel_->setResetTextureStreamingFunc([&]()->void
+                {
+                    waitRenderIdle();
+                    modelLoader_->getScene().model->resetStates();
+                });
+                configPanel_->setResetSamplerFeedbackFunc([&]()->void
+                {
+                    waitRenderIdle();
+                    modelLoader_->getScene().model->resetStates();
+                });
+                configPanel_->setResetColorSpaceFunc([&]()->void
+                {
+                    waitRenderIdle();
+                    modelLoader_->getScene().resetStates();
+                });
+                configPanel_->setResetBufferLayoutFunc([&]()->void
+                {
+                    waitRenderIdle();
+                    modelLoader_->getScene().resetStates();
+                    auto &viewer = viewers_[config_->rendererType];
+                    viewer->resetBufferLayout();
+                });
                 configPanel_->setReloadModelFunc([&](const std::string &path)->bool
                 {
                     waitRenderIdle();
@@ -101,6 +134,13 @@ namespace SoftGL
                 camera_->update();
                 configPanel_->update();
 
+                // apply background model loading results, renderer may still use the replaced states
+                if (modelLoader_->hasPendingUpdates())
+                {
+                    waitRenderIdle();
+                }
+                modelLoader_->update();
+
                 // update triangle count
                 config_->triangleCnt = modelLoader_->getModelPrimitiveCnt();
 
@@ -22,12 +22,25 @@ namespace SoftGL
             {
                 camera_->setReverseZ(config_.reverseZ);
                 cameraDepth_->setReverseZ(config_.reverseZ);
+
+                // between frames no draw is running, streamed mips can be swapped in
+                auto *renderer = dynamic_cast<RendererSoft *>(renderer_.get());
+                auto &streamer = renderer->getTextureStreamer();
+                streamer.setMemoryBudget((size_t) config_.textureBudgetMB << 20);
+                streamer.update();
+                config_.textureResidentBytes = streamer.getResidentBytes();
+
+                renderer->setRasterTileSize(config_.rasterTileSize);
+                renderer->setEnableSamplerFeedback(config_.samplerFeedback);
+                renderer->updateSamplerFeedback();
+                updateTextureFeedback(renderer->getSamplerFeedback());
             }
 
             int swapBuffer() override
             {
                 auto *texOut = dynamic_cast<TextureSoft<RGBA> *>(texColorMain_.get());
                 auto buffer = texOut->getImage().getBuffer()->buffer;
+                buffer->flushClear();
                 GL_CHECK(glBindTexture(GL_TEXTURE_2D, outTexId_));
                 GL_CHECK(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 
                                          (int)buffer->getWidth(), (int)buffer->getHeight(),
@@ -35,6 +48,44 @@ namespace SoftGL
                 return outTexId_;
             }
 
+            void updateTextureFeedback(std::vector<TextureFeedback> &feedbacks)
+            {
+                config_.textureFeedback.clear();
+                if (!config_.samplerFeedback)
+                {
+                    return;
+                }
+                for (auto &feedback : feedbacks)
+                {
+                    auto texture = feedback.texture.lock();
+                    FeedbackStats &stats = feedback.stats;
+                    TextureFeedbackInfo info;
+                    info.tag = texture->tag;
+                    info.width = texture->width;
+                    info.height = texture->height;
+                    info.regionSize = FEEDBACK_REGIONS;
+                    info.regionMinLevel.assign(stats.regionMinLevel, stats.regionMinLevel + FEEDBACK_REGIONS * FEEDBACK_REGIONS);
+                    uint64_t total = 0;
+                    for (auto cnt : stats.levelCounts)
+                    {
+                        total += cnt;
+                    }
+                    if (total > 0)
+                    {
+                        info.minLevel = stats.minLevel;
+                        for (int level = 0; level < FEEDBACK_MAX_LEVELS; level++)
+                        {
+                            info.levelUsage.push_back((float) ((double) stats.levelCounts[level] / (double) total));
+                            if (level < stats.minLevel)
+                            {
+                                info.unusedBytes += (size_t) texture->getLevelWidth(level) * texture->getLevelHeight(level) * sizeof(RGBA);
+                            }
+                        }
+                    }
+                    config_.textureFeedback.push_back(std::move(info));
+                }
+            }
+
             std::shared_ptr<Renderer> createRenderer() override
             {
                 auto renderer = std::make_shared<RendererSoft>();